@@ -3,6 +3,16 @@ include $(CLEAR_VARS)
 
 LOCAL_MODULE := playxsvf
 LOCAL_MODULE_TAGS := optional
-LOCAL_SRC_FILES := ports.c micro.c lenval.c 
+LOCAL_CFLAGS := -Wall -Wextra -DXSVF_SUPPORT_GZIP
+LOCAL_SHARED_LIBRARIES := libz
+LOCAL_SRC_FILES := ports.c ports_sysfs.c ports_gpiod.c ports_mmio.c ports_spi.c ports_null.c ports_sim.c ports_pace.c micro.c xsvflearn.c lenval.c input.c xsvfplan.c timing.c rt.c svf.c bitfile.c xsvfmulti.c
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := xsvfbench
+LOCAL_MODULE_TAGS := optional
+LOCAL_CFLAGS := -Wall -Wextra -DXSVF_NO_MAIN -DXSVF_SUPPORT_GZIP
+LOCAL_SHARED_LIBRARIES := libz
+LOCAL_SRC_FILES := ports.c ports_sysfs.c ports_gpiod.c ports_mmio.c ports_spi.c ports_null.c ports_sim.c ports_pace.c micro.c xsvflearn.c lenval.c input.c xsvfplan.c timing.c rt.c svf.c bitfile.c xsvfbench.c
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,455 @@
+/*****************************************************************************
+* file:         bitfile.c
+* abstract:     This file contains the direct FPGA configuration mode (see
+*               bitfile.h).
+* Usage:        bitRun() plays the same JTAG sequence an XSVF file made for
+*               the .bit file would:
+*                   TMS reset
+*                   SIR JPROGRAM;   wait lProgramUs in Run-Test/Idle
+*                   SIR CFG_IN;     SDR <bitstream>
+*                   SIR JSTART;     lStartupTck TCKs in Run-Test/Idle
+*                   TMS reset
+*               The FPGA takes each bitstream byte MSB first, while
+*               shiftBits() shifts a lenVal LSB first from its last byte.
+*               Each chunk is therefore read from the input (in place when
+*               the file is mapped), byte- and bit-reversed into one
+*               BIT_CHUNK_BYTES buffer and shifted with xsvfShiftOnly();
+*               the TAP stays in Shift-DR between chunks, so the bitstream
+*               is one continuous shift, as with XSDRB/XSDRC/XSDRE.
+*****************************************************************************/
+#define DEBUG_MODE
+#ifdef  DEBUG_MODE
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+#endif  /* DEBUG_MODE */
+
+#include "micro.h"
+#include "lenval.h"
+#include "microint.h"
+#include "ports.h"
+#include "input.h"
+#include "bitfile.h"
+
+
+/*============================================================================
+* Bitstream File Formats
+============================================================================*/
+
+/* .bit:  a 9-byte field and a 1, then keyed fields 'a'-'d' and 'e' */
+static const unsigned char bit_aucBitMagic[] =
+{
+    0x00, 0x09, 0x0F, 0xF0, 0x0F, 0xF0, 0x0F, 0xF0, 0x0F, 0xF0, 0x00,
+    0x00, 0x01
+};
+
+/* .bin:  the configuration sync word after the 0xFF padding */
+static const unsigned char bit_aucSync[] = { 0xAA, 0x99, 0x55, 0x66 };
+
+#define BIT_MAX_FIELD   256     /* longest 'a'-'d' text kept */
+
+SBitConfig bit_config =
+{
+    BIT_DEFAULT_IRLEN,
+    BIT_DEFAULT_CFG_IN,
+    BIT_DEFAULT_JSTART,
+    BIT_DEFAULT_JPROGRAM,
+    BIT_DEFAULT_PROGRAM_US,
+    BIT_DEFAULT_STARTUP_TCK
+};
+
+/* bit-reversed nibbles */
+static const unsigned char bit_aucReverse[ 16 ] =
+{
+    0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+    0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF
+};
+#define BIT_REVERSE(uc) \
+    ( (unsigned char)( ( bit_aucReverse[ (uc) & 0xF ] << 4 ) | \
+                       bit_aucReverse[ (uc) >> 4 ] ) )
+
+/*****************************************************************************
+* Function:     bitParseConfig
+* Description:  Parse "irlen[,cfg_in,jstart,jprogram]"; see bitfile.h.
+* Parameters:   pConfig     - receives the values.
+*               pzList      - the option value.
+* Returns:      int         - 0 = success.
+*****************************************************************************/
+int bitParseConfig( SBitConfig* pConfig, const char* pzList )
+{
+    unsigned long   aulValue[ 4 ];
+    char*           pzEnd;
+    int             iNumValues;
+
+    for ( iNumValues = 0; iNumValues < 4; ++iNumValues )
+    {
+        aulValue[ iNumValues ]  = strtoul( pzList, &pzEnd, 0 );
+        if ( pzEnd == pzList )
+        {
+            return( -1 );
+        }
+        pzList  = pzEnd;
+        if ( !*pzList )
+        {
+            break;
+        }
+        if ( *pzList++ != ',' )
+        {
+            return( -1 );
+        }
+    }
+    if ( ( iNumValues != 0 ) && ( iNumValues != 3 ) )
+    {
+        return( -1 );
+    }
+    if ( ( aulValue[ 0 ] < 1 ) || ( aulValue[ 0 ] > 32 ) )
+    {
+        return( -1 );
+    }
+
+    pConfig->iIrLen = (int)aulValue[ 0 ];
+    if ( iNumValues == 3 )
+    {
+        pConfig->ulCfgIn    = aulValue[ 1 ];
+        pConfig->ulJstart   = aulValue[ 2 ];
+        pConfig->ulJprogram = aulValue[ 3 ];
+    }
+    return( 0 );
+}
+
+/*****************************************************************************
+* Function:     bitIsBitstream
+* Description:  See bitfile.h.
+* Parameters:   pucData     - the first bytes of the input.
+*               lSize       - number of bytes.
+* Returns:      int         - non-zero for a bitstream.
+*****************************************************************************/
+int bitIsBitstream( const unsigned char* pucData, long lSize )
+{
+    long    i;
+
+    if ( ( lSize >= (long)sizeof( bit_aucBitMagic ) ) &&
+         !memcmp( pucData, bit_aucBitMagic, sizeof( bit_aucBitMagic ) ) )
+    {
+        return( 1 );
+    }
+
+    /* .bin:  padding, optionally the bus width words, then the sync word */
+    if ( ( lSize < 8 ) || ( pucData[ 0 ] != 0xFF ) || ( pucData[ 3 ] != 0xFF ) )
+    {
+        return( 0 );
+    }
+    for ( i = 0; i + (long)sizeof( bit_aucSync ) <= lSize; ++i )
+    {
+        if ( !memcmp( pucData + i, bit_aucSync, sizeof( bit_aucSync ) ) )
+        {
+            return( 1 );
+        }
+    }
+    return( 0 );
+}
+
+/*****************************************************************************
+* Function:     bitReadHeader
+* Description:  Skip the .bit header and find the bitstream length.  The
+*               design and part names are printed.
+* Parameters:   pInput      - the .bit file, at its start.
+*               plLength    - receives the bitstream length in bytes.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+static int bitReadHeader( SXsvfInput* pInput, long* plLength )
+{
+    unsigned char   aucField[ BIT_MAX_FIELD + 1 ];
+    unsigned char   aucHead[ sizeof( bit_aucBitMagic ) ];
+    char            aszText[ 4 ][ BIT_MAX_FIELD + 1 ];
+    unsigned char   aucLength[ 4 ];
+    unsigned char   ucKey;
+    long            lLength;
+    long            lKeep;
+    int             i;
+
+    memset( aszText, 0, sizeof( aszText ) );
+    if ( inputRead( pInput, aucHead, sizeof( aucHead ) ) != sizeof( aucHead ) )
+    {
+        return( XSVF_ERROR_TRUNCATED );
+    }
+
+    for ( ; ; )
+    {
+        if ( inputRead( pInput, &ucKey, 1 ) != 1 )
+        {
+            return( XSVF_ERROR_TRUNCATED );
+        }
+        if ( ucKey == 'e' )
+        {
+            /* 4-byte big-endian bitstream length, then the bitstream */
+            if ( inputRead( pInput, aucLength, 4 ) != 4 )
+            {
+                return( XSVF_ERROR_TRUNCATED );
+            }
+            *plLength   = ( (long)aucLength[ 0 ] << 24 ) |
+                          ( (long)aucLength[ 1 ] << 16 ) |
+                          ( (long)aucLength[ 2 ] << 8 ) | (long)aucLength[ 3 ];
+            break;
+        }
+        if ( ( ucKey < 'a' ) || ( ucKey > 'd' ) ||
+             ( inputRead( pInput, aucLength, 2 ) != 2 ) )
+        {
+            XSVFDBG_PRINTF( 0, "ERROR:  Bad .bit header\n" );
+            return( XSVF_ERROR_ILLEGALCMD );
+        }
+
+        /* 2-byte length, then NUL-terminated text */
+        lLength = ( (long)aucLength[ 0 ] << 8 ) | (long)aucLength[ 1 ];
+        while ( lLength > 0 )
+        {
+            lKeep   = ( lLength > BIT_MAX_FIELD ) ? BIT_MAX_FIELD : lLength;
+            if ( inputRead( pInput, aucField, lKeep ) != lKeep )
+            {
+                return( XSVF_ERROR_TRUNCATED );
+            }
+            if ( !aszText[ ucKey - 'a' ][ 0 ] )
+            {
+                aucField[ lKeep ]   = 0;
+                strcpy( aszText[ ucKey - 'a' ], (const char*)aucField );
+            }
+            lLength -= lKeep;
+        }
+    }
+
+    for ( i = 0; i < 4; ++i )
+    {
+        if ( !aszText[ i ][ 0 ] )
+        {
+            strcpy( aszText[ i ], "?" );
+        }
+    }
+    XSVFDBG_PRINTF3( 0, "Bitstream = %s for %s; %ld bytes\n",
+                     aszText[ 0 ], aszText[ 1 ], *plLength );
+    XSVFDBG_PRINTF2( 1, "   Built %s %s\n", aszText[ 2 ], aszText[ 3 ] );
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     bitReverseChunk
+* Description:  pucDst = pucSrc with the byte order and the bits of every
+*               byte reversed, so that the first bit shifted is the MSB
+*               of pucSrc[ 0 ].  pucDst may be pucSrc.
+* Parameters:   pucDst      - receives lNumBytes.
+*               pucSrc      - the bitstream bytes in file order.
+*               lNumBytes   - number of bytes.
+* Returns:      void.
+*****************************************************************************/
+static void bitReverseChunk( unsigned char*         pucDst,
+                             const unsigned char*   pucSrc,
+                             long                   lNumBytes )
+{
+    unsigned char   ucFirst;
+    long            i;
+    long            j;
+
+    for ( i = 0, j = lNumBytes - 1; i <= j; ++i, --j )
+    {
+        ucFirst         = pucSrc[ i ];
+        pucDst[ i ]     = BIT_REVERSE( pucSrc[ j ] );
+        pucDst[ j ]     = BIT_REVERSE( ucFirst );
+    }
+}
+
+/*****************************************************************************
+* Function:     bitShiftIr
+* Description:  Shift an instruction and go to Run-Test/Idle.
+* Parameters:   pucTapState - current TAP state; returns the final state.
+*               pConfig     - the IR length.
+*               ulCode      - the instruction.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+static int bitShiftIr( unsigned char*       pucTapState,
+                       const SBitConfig*    pConfig,
+                       unsigned long        ulCode )
+{
+    unsigned char   aucIr[ 4 ];
+    lenVal          lvIr;
+    long            lNumBytes;
+    long            i;
+
+    ++xsvf_stats.lCommands;
+    lNumBytes   = xsvfGetAsNumBytes( pConfig->iIrLen );
+    for ( i = 0; i < lNumBytes; ++i )
+    {
+        aucIr[ i ]  = (unsigned char)( ulCode >> ( 8 * ( lNumBytes - 1 - i ) ) );
+    }
+    lvIr.len    = lNumBytes;
+    lvIr.val    = aucIr;
+    return( xsvfShift( pucTapState, XTAPSTATE_SHIFTIR, pConfig->iIrLen,
+                       &lvIr, 0, 0, 0, XTAPSTATE_RUNTEST, 0, 0 ) );
+}
+
+/*****************************************************************************
+* Function:     bitShiftBitstream
+* Description:  Shift the bitstream from pInput as one Shift-DR and go to
+*               Run-Test/Idle.
+* Parameters:   pucTapState - current TAP state; returns the final state.
+*               pInput      - the bitstream, at its first byte.
+*               lLength     - bitstream bytes; -1 = to the end of the input.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+static int bitShiftBitstream( unsigned char*    pucTapState,
+                              SXsvfInput*       pInput,
+                              long              lLength )
+{
+    const unsigned char*    pucSrc;
+    unsigned char*          pucChunk;
+    lenVal                  lvChunk;
+    long                    lNumBytes;
+    long                    lTotal;
+    int                     iLast;
+    int                     iErrorCode;
+
+    pucChunk    = (unsigned char*)malloc( BIT_CHUNK_BYTES );
+    if ( !pucChunk )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+
+    ++xsvf_stats.lCommands;
+    iErrorCode  = xsvfGotoTapState( pucTapState, XTAPSTATE_SHIFTDR );
+    lTotal      = 0;
+    iLast       = 0;
+    while ( !iErrorCode && !iLast )
+    {
+        lNumBytes   = BIT_CHUNK_BYTES;
+        if ( ( lLength >= 0 ) && ( lLength - lTotal < lNumBytes ) )
+        {
+            lNumBytes   = lLength - lTotal;
+        }
+
+        /* mapped:  reverse straight from the file; else read, then reverse */
+        pucSrc  = inputSpan( pInput, lNumBytes );
+        if ( !pucSrc )
+        {
+            lNumBytes   = inputRead( pInput, pucChunk, lNumBytes );
+            pucSrc      = pucChunk;
+            if ( lLength < 0 )
+            {
+                /* a .bin file ends where its bitstream ends */
+                pInput->iEof    = 0;
+            }
+        }
+        if ( !lNumBytes )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        bitReverseChunk( pucChunk, pucSrc, lNumBytes );
+
+        /* only now:  looking ahead may refill the block pucSrc is in */
+        lTotal  += lNumBytes;
+        iLast   = ( lLength >= 0 ) ? ( lTotal >= lLength )
+                                   : !inputPeek( pInput, 1 );
+        if ( ( lLength >= 0 ) && !iLast && ( lNumBytes < BIT_CHUNK_BYTES ) )
+        {
+            /* the file ends before the length in its header */
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+
+        lvChunk.len = lNumBytes;
+        lvChunk.val = pucChunk;
+        iErrorCode  = xsvfShiftOnly( 8 * lNumBytes, &lvChunk, 0, iLast );
+    }
+    free( pucChunk );
+
+    if ( iErrorCode )
+    {
+        return( iErrorCode );
+    }
+    XSVFDBG_PRINTF1( 2, "   Bitstream shifted: %ld bytes\n", lTotal );
+
+    /* iExitShift on the last bit left Shift-DR */
+    *pucTapState    = XTAPSTATE_EXIT1DR;
+    return( xsvfGotoTapState( pucTapState, XTAPSTATE_RUNTEST ) );
+}
+
+/*****************************************************************************
+* Function:     bitRun
+* Description:  See bitfile.h.
+* Parameters:   pInput      - the bitstream file.
+*               pConfig     - instructions and timing.
+* Returns:      int         - XSVF_ERROR_*; see micro.h.
+*****************************************************************************/
+int bitRun( SXsvfInput* pInput, const SBitConfig* pConfig )
+{
+    const unsigned char*    pucHead;
+    unsigned char           ucTapState;
+    long                    lLength;
+    long                    lClocks;
+    int                     iNumBits;
+    int                     iErrorCode;
+
+    /* .bit:  skip its header; .bin:  the bitstream is the whole file */
+    lLength = -1;
+    pucHead = inputPeek( pInput, (long)sizeof( bit_aucBitMagic ) );
+    if ( pucHead && !memcmp( pucHead, bit_aucBitMagic, sizeof( bit_aucBitMagic ) ) )
+    {
+        iErrorCode  = bitReadHeader( pInput, &lLength );
+        if ( iErrorCode )
+        {
+            return( iErrorCode );
+        }
+    }
+    else
+    {
+        XSVFDBG_PRINTF( 0, "Bitstream = .bin file\n" );
+        if ( inputRemaining( pInput, &lLength ) )
+        {
+            XSVFDBG_PRINTF1( 1, "   %ld bytes\n", lLength );
+        }
+        else
+        {
+            lLength = -1;
+        }
+    }
+
+    /* Initialize the TAP */
+    ucTapState  = XTAPSTATE_RESET;
+    iErrorCode  = xsvfGotoTapState( &ucTapState, XTAPSTATE_RESET );
+
+    /* JPROGRAM clears the configuration memory */
+    if ( !iErrorCode )
+    {
+        iErrorCode  = bitShiftIr( &ucTapState, pConfig, pConfig->ulJprogram );
+    }
+    if ( !iErrorCode && pConfig->lProgramUs )
+    {
+        XSVFDBG_PRINTF1( 3, "   Wait = %ld usec\n", pConfig->lProgramUs );
+        waitTime( pConfig->lProgramUs );
+    }
+
+    if ( !iErrorCode )
+    {
+        iErrorCode  = bitShiftIr( &ucTapState, pConfig, pConfig->ulCfgIn );
+    }
+    if ( !iErrorCode )
+    {
+        iErrorCode  = bitShiftBitstream( &ucTapState, pInput, lLength );
+    }
+
+    /* JSTART and the startup sequence clocks in Run-Test/Idle */
+    if ( !iErrorCode )
+    {
+        iErrorCode  = bitShiftIr( &ucTapState, pConfig, pConfig->ulJstart );
+    }
+    if ( !iErrorCode )
+    {
+        ++xsvf_stats.lCommands;
+        for ( lClocks = pConfig->lStartupTck; lClocks > 0; lClocks -= iNumBits )
+        {
+            iNumBits    = ( lClocks > 16 ) ? 16 : (int)lClocks;
+            xsvfShiftTms( 0, (unsigned short)iNumBits );
+        }
+        iErrorCode  = xsvfGotoTapState( &ucTapState, XTAPSTATE_RESET );
+    }
+
+    return( iErrorCode );
+}
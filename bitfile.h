@@ -0,0 +1,77 @@
+/*****************************************************************************
+* File:         bitfile.h
+* Description:  This header file contains the direct FPGA configuration
+*               mode.  A Xilinx .bit file (header and bitstream) or .bin
+*               file (bitstream only) is loaded through JTAG without an
+*               XSVF conversion:  JPROGRAM, CFG_IN, the whole bitstream as
+*               one continuous Shift-DR, then JSTART and the startup
+*               clocks.  The bitstream is streamed from the input in
+*               chunks, so it is never held in memory as a whole.
+*               One FPGA must be the only device in the chain.
+*****************************************************************************/
+#ifndef XSVF_BITFILE_H
+#define XSVF_BITFILE_H
+
+#include "input.h"
+
+/* bytes bitIsBitstream() wants to look at, if the input has them */
+#define BIT_SNIFF_BYTES     128
+
+/* bitstream bytes handed to the port per xsvfShiftOnly() */
+#define BIT_CHUNK_BYTES     (64L * 1024L)
+
+/* 7-series/UltraScale defaults:  6-bit IR */
+#define BIT_DEFAULT_IRLEN       6
+#define BIT_DEFAULT_CFG_IN      0x05
+#define BIT_DEFAULT_JSTART      0x0C
+#define BIT_DEFAULT_JPROGRAM    0x0B
+#define BIT_DEFAULT_PROGRAM_US  10000L  /* JPROGRAM to CFG_IN */
+#define BIT_DEFAULT_STARTUP_TCK 2000L   /* clocks after JSTART */
+
+/*****************************************************************************
+* Struct:       SBitConfig
+* Description:  The JTAG instructions and timing of the configuration
+*               sequence.  bit_config is what xsvfExecuteInput() uses.
+*****************************************************************************/
+typedef struct tagSBitConfig
+{
+    int             iIrLen;         /* IR bits (1-32) */
+    unsigned long   ulCfgIn;        /* CFG_IN instruction */
+    unsigned long   ulJstart;       /* JSTART instruction */
+    unsigned long   ulJprogram;     /* JPROGRAM instruction */
+    long            lProgramUs;     /* wait after JPROGRAM */
+    long            lStartupTck;    /* TCK cycles in Run-Test/Idle after JSTART */
+} SBitConfig;
+
+extern SBitConfig bit_config;
+
+/*****************************************************************************
+* Function:     bitParseConfig
+* Description:  Parse "irlen[,cfg_in,jstart,jprogram]" into pConfig.
+* Parameters:   pConfig     - receives the values; others are unchanged.
+*               pzList      - the option value.
+* Returns:      int         - 0 = success.
+*****************************************************************************/
+extern int bitParseConfig( SBitConfig* pConfig, const char* pzList );
+
+/*****************************************************************************
+* Function:     bitIsBitstream
+* Description:  Check whether data starts like a .bit file (its fixed
+*               header) or a .bin file (0xFF padding and the sync word).
+* Parameters:   pucData     - the first bytes of the input.
+*               lSize       - number of bytes (up to BIT_SNIFF_BYTES).
+* Returns:      int         - non-zero for a bitstream.
+*****************************************************************************/
+extern int bitIsBitstream( const unsigned char* pucData, long lSize );
+
+/*****************************************************************************
+* Function:     bitRun
+* Description:  Configure the FPGA on the current port with the .bit or
+*               .bin file in pInput.
+* Parameters:   pInput      - the bitstream file.
+*               pConfig     - instructions and timing.
+* Returns:      int         - XSVF_ERROR_*; see micro.h.
+*****************************************************************************/
+extern int bitRun( SXsvfInput* pInput, const SBitConfig* pConfig );
+
+#endif  /* XSVF_BITFILE_H */
@@ -0,0 +1,698 @@
+/*******************************************************/
+/* file: input.c                                       */
+/* abstract:  This file contains the XSVF data source. */
+/*            Regular files are mmap()ed so readVal()  */
+/*            is a single memcpy (or a zero-copy span);*/
+/*            other files fall back to large block     */
+/*            reads instead of a stdio call per byte.  */
+/*            Reads past the end set iEof so truncated */
+/*            XSVF data is reported instead of being   */
+/*            played as 0xFF bytes.                    */
+/*            A pipelined input moves the read() calls */
+/*            to a reader thread that fills a single-  */
+/*            producer single-consumer ring of slots;  */
+/*            each side owns its own index and the two */
+/*            semaphores only enter the kernel when    */
+/*            the ring is empty or full.  The reader is */
+/*            stopped cooperatively (bionic has no     */
+/*            pthread_cancel()):  a stop flag, a post  */
+/*            of semFree for a full ring and a byte on */
+/*            a wake-up pipe that it polls with fd.    */
+/*            A gzip, xz or zstd file (by its magic    */
+/*            number) is decoded into the block buffer */
+/*            one block at a time, so memory stays at  */
+/*            the block, one INPUT_ZBUF_SIZE buffer of */
+/*            compressed bytes (none when mapped) and  */
+/*            the decoder's window, which is limited   */
+/*            to INPUT_MAX_WINDOW.                     */
+/*******************************************************/
+#include "input.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef XSVF_SUPPORT_GZIP
+#include <zlib.h>
+#endif
+#ifdef XSVF_SUPPORT_XZ
+#include <lzma.h>
+#endif
+#ifdef XSVF_SUPPORT_ZSTD
+#include <zstd.h>
+#endif
+
+/* longest magic number below */
+#define INPUT_MAGIC_SIZE    6
+
+struct tagSXsvfDecoder
+{
+    unsigned char*          pucIn;      /* compressed block, or 0 if mapped */
+    const unsigned char*    pucNext;    /* next compressed byte */
+    long                    lAvail;     /* compressed bytes at pucNext */
+    int                     iSourceEnd; /* no more compressed bytes to read */
+    int                     iStreamEnd; /* the decoder saw the end */
+#ifdef XSVF_SUPPORT_GZIP
+    z_stream                zs;
+#endif
+#ifdef XSVF_SUPPORT_XZ
+    lzma_stream             xz;
+#endif
+#ifdef XSVF_SUPPORT_ZSTD
+    ZSTD_DStream*           pZstd;
+#endif
+};
+
+static const char* g_apzFormat[] = { "raw", "gzip", "xz", "zstd" };
+
+struct tagSXsvfPipe
+{
+    pthread_t       thread;
+    int             fd;
+    sem_t           semFilled;  /* slots the reader has filled */
+    sem_t           semFree;    /* slots the player has emptied */
+    unsigned char*  pucRing;    /* INPUT_PIPE_SLOTS * INPUT_PIPE_SLOT_SIZE */
+    long            alLen[INPUT_PIPE_SLOTS];    /* 0 = end, -1 = error */
+    int             aiErrno[INPUT_PIPE_SLOTS];
+    int             iHead;      /* next slot to fill; reader only */
+    int             iTail;      /* slot being emptied; player only */
+    int             iHaveTail;  /* iTail has been taken from semFilled */
+    long            lOffset;    /* bytes of iTail already copied out */
+    volatile int    iStop;      /* set by pipeStop() */
+    int             aiWake[2];  /* pipeStop() writes aiWake[1] */
+};
+
+static void* pipeReader(void* pvPipe)
+{
+    SXsvfPipe*      pPipe = (SXsvfPipe*)pvPipe;
+    unsigned char*  pucSlot;
+    long            lRead;
+    struct pollfd   aPoll[2];
+
+    aPoll[0].fd = pPipe->fd;
+    aPoll[0].events = POLLIN;
+    aPoll[1].fd = pPipe->aiWake[0];
+    aPoll[1].events = POLLIN;
+    do {
+        while(sem_wait(&pPipe->semFree) && (errno == EINTR)) {
+        }
+        if(pPipe->iStop) { break; }
+        pucSlot = pPipe->pucRing + pPipe->iHead * INPUT_PIPE_SLOT_SIZE;
+        /* wait for data or for pipeStop(); a regular file polls ready */
+        aPoll[0].revents = aPoll[1].revents = 0;
+        while((poll(aPoll, 2, -1) < 0) && (errno == EINTR)) {
+        }
+        if(pPipe->iStop || aPoll[1].revents) { break; }
+        do {
+            lRead = read(pPipe->fd, pucSlot, INPUT_PIPE_SLOT_SIZE);
+        } while((lRead < 0) && (errno == EINTR));
+        pPipe->aiErrno[pPipe->iHead] = (lRead < 0) ? errno : 0;
+        pPipe->alLen[pPipe->iHead] = (lRead < 0) ? -1 : lRead;
+        pPipe->iHead = (pPipe->iHead + 1) % INPUT_PIPE_SLOTS;
+        sem_post(&pPipe->semFilled);
+    } while(lRead > 0);
+    return 0;
+}
+
+/* copy what the reader has filled; only waits if nothing is ready.   */
+/* The end (or error) slot is kept, so every later read sees it too.   */
+static long pipeRead(SXsvfInput* pInput, unsigned char* pucData, long lNumBytes)
+{
+    SXsvfPipe*  pPipe = pInput->pPipe;
+    long        lCopied = 0;
+    long        lLen;
+    long        lChunk;
+
+    while(lCopied < lNumBytes) {
+        if(!pPipe->iHaveTail) {
+            if(sem_trywait(&pPipe->semFilled)) {
+                /* nothing ready:  return what was copied, or wait */
+                if(lCopied) { break; }
+                ++pInput->lPipeWaits;
+                while(sem_wait(&pPipe->semFilled) && (errno == EINTR)) {
+                }
+            }
+            pPipe->iHaveTail = 1;
+            pPipe->lOffset = 0;
+        }
+
+        lLen = pPipe->alLen[pPipe->iTail];
+        if(lLen <= 0) {
+            if((lLen < 0) && !lCopied) {
+                errno = pPipe->aiErrno[pPipe->iTail];
+                return -1;
+            }
+            break;
+        }
+        lChunk = lLen - pPipe->lOffset;
+        if(lChunk > lNumBytes - lCopied) { lChunk = lNumBytes - lCopied; }
+        memcpy(pucData + lCopied,
+               pPipe->pucRing + pPipe->iTail * INPUT_PIPE_SLOT_SIZE + pPipe->lOffset,
+               lChunk);
+        lCopied += lChunk;
+        pPipe->lOffset += lChunk;
+        if(pPipe->lOffset == lLen) {
+            pPipe->iHaveTail = 0;
+            pPipe->iTail = (pPipe->iTail + 1) % INPUT_PIPE_SLOTS;
+            sem_post(&pPipe->semFree);
+        }
+    }
+    return lCopied;
+}
+
+static void pipeStop(SXsvfInput* pInput)
+{
+    SXsvfPipe* pPipe = pInput->pPipe;
+
+    /* the reader may be waiting for input or on a full ring */
+    pPipe->iStop = 1;
+    while((write(pPipe->aiWake[1], "", 1) < 0) && (errno == EINTR)) {
+    }
+    sem_post(&pPipe->semFree);
+    pthread_join(pPipe->thread, 0);
+    close(pPipe->aiWake[0]);
+    close(pPipe->aiWake[1]);
+    sem_destroy(&pPipe->semFilled);
+    sem_destroy(&pPipe->semFree);
+    free(pPipe->pucRing);
+    free(pPipe);
+    pInput->pPipe = 0;
+}
+
+/* bytes as stored in the file:  from the reader thread or read() */
+static long readRaw(SXsvfInput* pInput, unsigned char* pucData, long lNumBytes)
+{
+    long lRead;
+
+    if(pInput->pPipe) {
+        lRead = pipeRead(pInput, pucData, lNumBytes);
+    } else {
+        do {
+            lRead = read(pInput->fd, pucData, lNumBytes);
+        } while((lRead < 0) && (errno == EINTR));
+    }
+    if(lRead > 0) { pInput->lSourceBytes += lRead; }
+    return lRead;
+}
+
+static int formatOf(const unsigned char* puc, long lSize)
+{
+    if((lSize >= 2) && (puc[0] == 0x1F) && (puc[1] == 0x8B)) { return INPUT_GZIP; }
+    if((lSize >= 6) && !memcmp(puc, "\xFD" "7zXZ\0", 6)) { return INPUT_XZ; }
+    if((lSize >= 4) && (puc[0] == 0x28) && (puc[1] == 0xB5) &&
+       (puc[2] == 0x2F) && (puc[3] == 0xFD)) { return INPUT_ZSTD; }
+    return INPUT_RAW;
+}
+
+/* start decoding iFormat; the compressed bytes are set up by the caller */
+static int decoderOpen(SXsvfInput* pInput, int iFormat)
+{
+    SXsvfDecoder* pDec = (SXsvfDecoder*)calloc(1, sizeof(SXsvfDecoder));
+    int iError = 1;
+
+    if(!pDec) { return -1; }
+    switch(iFormat) {
+#ifdef XSVF_SUPPORT_GZIP
+    case INPUT_GZIP:
+        /* 16 + MAX_WBITS:  gzip header and trailer, 32 KiB window */
+        iError = (inflateInit2(&pDec->zs, 16 + MAX_WBITS) != Z_OK);
+        break;
+#endif
+#ifdef XSVF_SUPPORT_XZ
+    case INPUT_XZ:
+        {
+            lzma_stream xzInit = LZMA_STREAM_INIT;
+            pDec->xz = xzInit;
+            iError = (lzma_stream_decoder(&pDec->xz, INPUT_MAX_WINDOW,
+                                          LZMA_CONCATENATED) != LZMA_OK);
+        }
+        break;
+#endif
+#ifdef XSVF_SUPPORT_ZSTD
+    case INPUT_ZSTD:
+        pDec->pZstd = ZSTD_createDStream();
+        iError = !pDec->pZstd || ZSTD_isError(ZSTD_initDStream(pDec->pZstd));
+        if(!iError) {
+            /* refuse frames whose window is above INPUT_MAX_WINDOW */
+            iError = ZSTD_isError(ZSTD_DCtx_setParameter(pDec->pZstd,
+                                      ZSTD_d_windowLogMax, 26));
+        }
+        break;
+#endif
+    default:
+        printf("ERROR: %s XSVF data needs XSVF_SUPPORT_%s\n",
+               g_apzFormat[iFormat], (iFormat == INPUT_GZIP) ? "GZIP" :
+               ((iFormat == INPUT_XZ) ? "XZ" : "ZSTD"));
+        free(pDec);
+        return -1;
+    }
+    if(iError) {
+        printf("ERROR: cannot start the %s decoder\n", g_apzFormat[iFormat]);
+        pInput->pDecoder = pDec;
+        pInput->iFormat = iFormat;
+        return -1;
+    }
+    pInput->pDecoder = pDec;
+    pInput->iFormat = iFormat;
+    return 0;
+}
+
+static void decoderClose(SXsvfInput* pInput)
+{
+    SXsvfDecoder* pDec = pInput->pDecoder;
+
+    switch(pInput->iFormat) {
+#ifdef XSVF_SUPPORT_GZIP
+    case INPUT_GZIP: inflateEnd(&pDec->zs); break;
+#endif
+#ifdef XSVF_SUPPORT_XZ
+    case INPUT_XZ: lzma_end(&pDec->xz); break;
+#endif
+#ifdef XSVF_SUPPORT_ZSTD
+    case INPUT_ZSTD: if(pDec->pZstd) { ZSTD_freeDStream(pDec->pZstd); } break;
+#endif
+    default: break;
+    }
+    free(pDec->pucIn);
+    free(pDec);
+    pInput->pDecoder = 0;
+}
+
+/* one decoder call:  *plOut bytes decoded from *plIn compressed ones. */
+/* Returns 0, 1 at the end of a stream, or -1 for corrupt data.         */
+static int decoderStep(SXsvfInput* pInput, unsigned char* pucOut, long lMax,
+                       long* plIn, long* plOut)
+{
+    int iEnd = 0;
+
+    switch(pInput->iFormat) {
+#ifdef XSVF_SUPPORT_GZIP
+    case INPUT_GZIP:
+        {
+            SXsvfDecoder* pDec = pInput->pDecoder;
+            int iRet;
+            pDec->zs.next_in = (Bytef*)pDec->pucNext;
+            pDec->zs.avail_in = (uInt)pDec->lAvail;
+            pDec->zs.next_out = pucOut;
+            pDec->zs.avail_out = (uInt)lMax;
+            iRet = inflate(&pDec->zs, Z_NO_FLUSH);
+            *plIn = pDec->lAvail - (long)pDec->zs.avail_in;
+            *plOut = lMax - (long)pDec->zs.avail_out;
+            if(iRet == Z_STREAM_END) {
+                /* another gzip member may follow */
+                inflateReset(&pDec->zs);
+                iEnd = 1;
+            } else if((iRet != Z_OK) && (iRet != Z_BUF_ERROR)) {
+                return -1;
+            }
+        }
+        break;
+#endif
+#ifdef XSVF_SUPPORT_XZ
+    case INPUT_XZ:
+        {
+            SXsvfDecoder* pDec = pInput->pDecoder;
+            lzma_ret ret;
+            pDec->xz.next_in = pDec->pucNext;
+            pDec->xz.avail_in = (size_t)pDec->lAvail;
+            pDec->xz.next_out = pucOut;
+            pDec->xz.avail_out = (size_t)lMax;
+            ret = lzma_code(&pDec->xz, pDec->iSourceEnd ? LZMA_FINISH : LZMA_RUN);
+            *plIn = pDec->lAvail - (long)pDec->xz.avail_in;
+            *plOut = lMax - (long)pDec->xz.avail_out;
+            if(ret == LZMA_STREAM_END) {
+                iEnd = 1;
+            } else if((ret != LZMA_OK) && (ret != LZMA_BUF_ERROR)) {
+                return -1;
+            }
+        }
+        break;
+#endif
+#ifdef XSVF_SUPPORT_ZSTD
+    case INPUT_ZSTD:
+        {
+            SXsvfDecoder* pDec = pInput->pDecoder;
+            ZSTD_inBuffer zIn;
+            ZSTD_outBuffer zOut;
+            size_t ret;
+            zIn.src = pDec->pucNext;
+            zIn.size = (size_t)pDec->lAvail;
+            zIn.pos = 0;
+            zOut.dst = pucOut;
+            zOut.size = (size_t)lMax;
+            zOut.pos = 0;
+            ret = ZSTD_decompressStream(pDec->pZstd, &zOut, &zIn);
+            *plIn = (long)zIn.pos;
+            *plOut = (long)zOut.pos;
+            if(ZSTD_isError(ret)) { return -1; }
+            /* 0:  a frame is complete; another may follow */
+            iEnd = (ret == 0);
+        }
+        break;
+#endif
+    default:
+        /* no decoder built in */
+        (void)pucOut; (void)lMax; (void)plIn; (void)plOut;
+        return -1;
+    }
+    return iEnd;
+}
+
+/* decoded bytes:  0 at the end of the data, -1 for a read error */
+static long decoderRead(SXsvfInput* pInput, unsigned char* pucData, long lNumBytes)
+{
+    SXsvfDecoder* pDec = pInput->pDecoder;
+    long lIn;
+    long lOut = 0;
+    long lRead;
+    int iRet;
+
+    if(!lNumBytes) { return 0; }
+    while(!lOut) {
+        if(!pDec->lAvail && !pDec->iSourceEnd) {
+            lRead = readRaw(pInput, pDec->pucIn, INPUT_ZBUF_SIZE);
+            if(lRead < 0) { return -1; }
+            pDec->iSourceEnd = !lRead;
+            pDec->pucNext = pDec->pucIn;
+            pDec->lAvail = lRead;
+        }
+        if(pDec->iStreamEnd && !pDec->lAvail) { return 0; }
+
+        iRet = decoderStep(pInput, pucData, lNumBytes, &lIn, &lOut);
+        if(iRet < 0) {
+            printf("ERROR: corrupt %s XSVF data\n", g_apzFormat[pInput->iFormat]);
+            pDec->iStreamEnd = 1;
+            pDec->lAvail = 0;
+            return 0;
+        }
+        if(!pDec->pucIn) { pInput->lSourceBytes += lIn; }
+        pDec->pucNext += lIn;
+        pDec->lAvail -= lIn;
+        pDec->iStreamEnd = iRet;
+        if(!lOut && !lIn && !iRet) {
+            /* no progress:  a truncated stream (readEOF() reports it), */
+            /* or input the decoder will not take                      */
+            printf("ERROR: %s XSVF data %s\n", g_apzFormat[pInput->iFormat],
+                   pDec->lAvail ? "is corrupt" : "ends early");
+            pDec->iStreamEnd = 1;
+            pDec->lAvail = 0;
+            return 0;
+        }
+    }
+    return lOut;
+}
+
+static long readSource(SXsvfInput* pInput, unsigned char* pucData, long lNumBytes)
+{
+    if(pInput->pDecoder) { return decoderRead(pInput, pucData, lNumBytes); }
+    return readRaw(pInput, pucData, lNumBytes);
+}
+
+/* block source:  read the first bytes and start a decoder if they are */
+/* a compressed container; raw bytes are left in the block.            */
+static int sniffBlock(SXsvfInput* pInput)
+{
+    long lSize = 0;
+    long lRead;
+    int iFormat;
+
+    do {
+        lRead = readRaw(pInput, pInput->pucBlock + lSize, INPUT_ZBUF_SIZE - lSize);
+        if(lRead > 0) { lSize += lRead; }
+    } while((lRead > 0) && (lSize < INPUT_MAGIC_SIZE));
+
+    iFormat = formatOf(pInput->pucBlock, lSize);
+    if(iFormat == INPUT_RAW) {
+        pInput->pucEnd = pInput->pucBlock + lSize;
+        return 0;
+    }
+    if(decoderOpen(pInput, iFormat)) { return -1; }
+    pInput->pDecoder->pucIn = (unsigned char*)malloc(INPUT_ZBUF_SIZE);
+    if(!pInput->pDecoder->pucIn) { return -1; }
+    memcpy(pInput->pDecoder->pucIn, pInput->pucBlock, lSize);
+    pInput->pDecoder->pucNext = pInput->pDecoder->pucIn;
+    pInput->pDecoder->lAvail = lSize;
+    pInput->pDecoder->iSourceEnd = (lRead <= 0);
+    return 0;
+}
+
+static long refillNone(SXsvfInput* pInput)
+{
+    (void)pInput;
+    return 0;
+}
+
+/* keep the unread tail and read the rest of the block */
+static long refillBlock(SXsvfInput* pInput)
+{
+    long lTail = (long)(pInput->pucEnd - pInput->pucCur);
+    long lRead;
+
+    pInput->lConsumed += (long)(pInput->pucCur - pInput->pucBlock);
+    memmove(pInput->pucBlock, pInput->pucCur, lTail);
+    lRead = readSource(pInput, pInput->pucBlock + lTail, INPUT_BLOCK_SIZE - lTail);
+    if(lRead < 0) {
+        printf("ERROR: reading XSVF data: %s\n", strerror(errno));
+        lRead = 0;
+    }
+
+    pInput->pucCur = pInput->pucBlock;
+    pInput->pucEnd = pInput->pucBlock + lTail + lRead;
+    return lRead;
+}
+
+int inputOpenFile(SXsvfInput* pInput, const char* pzFileName)
+{
+    struct stat st;
+
+    memset(pInput, 0, sizeof(*pInput));
+    /* "-" reads the XSVF from stdin, e.g. from a decompressor */
+    pInput->fd = strcmp(pzFileName, "-") ? open(pzFileName, O_RDONLY) : dup(0);
+    if(pInput->fd < 0) { return -1; }
+
+    if(!fstat(pInput->fd, &st) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+        pInput->pvMap = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, pInput->fd, 0);
+        if(pInput->pvMap != MAP_FAILED) {
+            madvise(pInput->pvMap, st.st_size, MADV_SEQUENTIAL);
+            pInput->lMapSize = (long)st.st_size;
+            pInput->iFormat = formatOf((const unsigned char*)pInput->pvMap, pInput->lMapSize);
+            if(pInput->iFormat == INPUT_RAW) {
+                pInput->pucStart = (const unsigned char*)pInput->pvMap;
+                pInput->pucCur = pInput->pucStart;
+                pInput->pucEnd = pInput->pucCur + pInput->lMapSize;
+                pInput->pfRefill = refillNone;
+                return 0;
+            }
+
+            /* decode from the mapping into the block buffer */
+            pInput->pucBlock = (unsigned char*)malloc(INPUT_BLOCK_SIZE);
+            if(!pInput->pucBlock || decoderOpen(pInput, pInput->iFormat)) {
+                inputClose(pInput);
+                return -1;
+            }
+            pInput->pDecoder->pucNext = (const unsigned char*)pInput->pvMap;
+            pInput->pDecoder->lAvail = pInput->lMapSize;
+            pInput->pDecoder->iSourceEnd = 1;
+            pInput->pucCur = pInput->pucEnd = pInput->pucBlock;
+            pInput->pfRefill = refillBlock;
+            return 0;
+        }
+        pInput->pvMap = 0;
+    }
+
+    pInput->pucBlock = (unsigned char*)malloc(INPUT_BLOCK_SIZE);
+    if(!pInput->pucBlock) { inputClose(pInput); return -1; }
+    pInput->pucCur = pInput->pucEnd = pInput->pucBlock;
+    pInput->pfRefill = refillBlock;
+    if(sniffBlock(pInput)) { inputClose(pInput); return -1; }
+    return 0;
+}
+
+int inputOpenPipelined(SXsvfInput* pInput, const char* pzFileName)
+{
+    SXsvfPipe* pPipe;
+
+    memset(pInput, 0, sizeof(*pInput));
+    pInput->fd = strcmp(pzFileName, "-") ? open(pzFileName, O_RDONLY) : dup(0);
+    if(pInput->fd < 0) { return -1; }
+
+    pInput->pucBlock = (unsigned char*)malloc(INPUT_BLOCK_SIZE);
+    if(!pInput->pucBlock) { inputClose(pInput); return -1; }
+    pInput->pucCur = pInput->pucEnd = pInput->pucBlock;
+    pInput->pfRefill = refillBlock;
+
+    /* without memory for the ring, read inline like inputOpenFile() */
+    pPipe = (SXsvfPipe*)calloc(1, sizeof(SXsvfPipe));
+    if(pPipe) {
+        pPipe->pucRing = (unsigned char*)malloc(INPUT_PIPE_SLOTS * INPUT_PIPE_SLOT_SIZE);
+        if(!pPipe->pucRing) { free(pPipe); pPipe = 0; }
+    }
+    if(pPipe && pipe(pPipe->aiWake)) {
+        free(pPipe->pucRing);
+        free(pPipe);
+        pPipe = 0;
+    }
+    if(pPipe) {
+        pPipe->fd = pInput->fd;
+        sem_init(&pPipe->semFilled, 0, 0);
+        sem_init(&pPipe->semFree, 0, INPUT_PIPE_SLOTS);
+    }
+    if(pPipe && pthread_create(&pPipe->thread, 0, pipeReader, pPipe)) {
+        printf("WARNING: no reader thread, reading XSVF data inline\n");
+        close(pPipe->aiWake[0]);
+        close(pPipe->aiWake[1]);
+        sem_destroy(&pPipe->semFilled);
+        sem_destroy(&pPipe->semFree);
+        free(pPipe->pucRing);
+        free(pPipe);
+        pPipe = 0;
+    }
+    pInput->pPipe = pPipe;
+    if(sniffBlock(pInput)) { inputClose(pInput); return -1; }
+    return 0;
+}
+
+void inputOpenMemory(SXsvfInput* pInput, const unsigned char* pucData, long lSize)
+{
+    memset(pInput, 0, sizeof(*pInput));
+    pInput->fd = -1;
+    pInput->pucStart = pucData;
+    pInput->pucCur = pucData;
+    pInput->pucEnd = pucData + lSize;
+    pInput->pfRefill = refillNone;
+}
+
+void inputClose(SXsvfInput* pInput)
+{
+    if(pInput->pPipe) { pipeStop(pInput); }
+    if(pInput->pDecoder) { decoderClose(pInput); }
+    if(pInput->pvMap) { munmap(pInput->pvMap, pInput->lMapSize); }
+    if(pInput->pucBlock) { free(pInput->pucBlock); }
+    if(pInput->pucAll) { free(pInput->pucAll); }
+    if(pInput->fd >= 0) { close(pInput->fd); }
+    pInput->pvMap = 0;
+    pInput->pucBlock = 0;
+    pInput->pucAll = 0;
+    pInput->fd = -1;
+    pInput->pucCur = pInput->pucEnd = 0;
+}
+
+long inputRead(SXsvfInput* pInput, unsigned char* pucData, long lNumBytes)
+{
+    long lCopied = 0;
+    long lChunk;
+
+    while(lCopied < lNumBytes) {
+        lChunk = (long)(pInput->pucEnd - pInput->pucCur);
+        if(!lChunk) {
+            if(!pInput->pfRefill(pInput)) {
+                pInput->iEof = 1;
+                break;
+            }
+            continue;
+        }
+        if(lChunk > lNumBytes - lCopied) { lChunk = lNumBytes - lCopied; }
+        memcpy(pucData + lCopied, pInput->pucCur, lChunk);
+        pInput->pucCur += lChunk;
+        lCopied += lChunk;
+    }
+    return lCopied;
+}
+
+const unsigned char* inputPeek(SXsvfInput* pInput, long lNumBytes)
+{
+    if((pInput->pucEnd - pInput->pucCur) < lNumBytes) {
+        /* a block source can still gather a span that fits in one block */
+        if(!pInput->pucBlock || (lNumBytes > INPUT_BLOCK_SIZE)) { return 0; }
+        while(((pInput->pucEnd - pInput->pucCur) < lNumBytes) &&
+              pInput->pfRefill(pInput)) {
+        }
+        if((pInput->pucEnd - pInput->pucCur) < lNumBytes) { return 0; }
+    }
+    return pInput->pucCur;
+}
+
+const unsigned char* inputSpan(SXsvfInput* pInput, long lNumBytes)
+{
+    const unsigned char* pucSpan = inputPeek(pInput, lNumBytes);
+
+    if(pucSpan) { pInput->pucCur += lNumBytes; }
+    return pucSpan;
+}
+
+const unsigned char* inputRemaining(SXsvfInput* pInput, long* plSize)
+{
+    if(pInput->pucBlock) { return 0; }
+    *plSize = (long)(pInput->pucEnd - pInput->pucCur);
+    return pInput->pucCur;
+}
+
+const unsigned char* inputLoadAll(SXsvfInput* pInput, long* plSize)
+{
+    unsigned char* pucNew;
+    long lSize;
+    long lMax;
+    long lRead;
+
+    if(!pInput->pucBlock) { return inputRemaining(pInput, plSize); }
+
+    /* keep the unread tail, then read the rest of the source after it */
+    lSize = (long)(pInput->pucEnd - pInput->pucCur);
+    lMax = INPUT_BLOCK_SIZE;
+    while(lMax <= lSize) { lMax *= 2; }
+    pInput->pucAll = (unsigned char*)malloc(lMax);
+    if(!pInput->pucAll) { return 0; }
+    memcpy(pInput->pucAll, pInput->pucCur, lSize);
+    for(;;) {
+        if(lSize == lMax) {
+            pucNew = (unsigned char*)realloc(pInput->pucAll, lMax * 2);
+            if(!pucNew) { return 0; }
+            pInput->pucAll = pucNew;
+            lMax *= 2;
+        }
+        lRead = readSource(pInput, pInput->pucAll + lSize, lMax - lSize);
+        if(lRead < 0) { printf("ERROR: reading XSVF data: %s\n", strerror(errno)); }
+        if(lRead <= 0) { break; }
+        lSize += lRead;
+    }
+
+    /* from here on the source is a single memory block */
+    pInput->lConsumed += (long)(pInput->pucCur - pInput->pucBlock);
+    free(pInput->pucBlock);
+    pInput->pucBlock = 0;
+    pInput->pucStart = pInput->pucAll;
+    pInput->pucCur = pInput->pucAll;
+    pInput->pucEnd = pInput->pucAll + lSize;
+    pInput->pfRefill = refillNone;
+    return inputRemaining(pInput, plSize);
+}
+
+long inputSourceBytes(SXsvfInput* pInput)
+{
+    if(!pInput->pDecoder && !pInput->pucBlock && !pInput->pucAll) {
+        /* mapped or memory:  what was consumed */
+        return inputOffset(pInput);
+    }
+    return pInput->lSourceBytes;
+}
+
+const char* inputFormatName(SXsvfInput* pInput)
+{
+    return g_apzFormat[pInput->iFormat];
+}
+
+long inputOffset(SXsvfInput* pInput)
+{
+    if(pInput->pucBlock) {
+        return pInput->lConsumed + (long)(pInput->pucCur - pInput->pucBlock);
+    }
+    return pInput->lConsumed + (long)(pInput->pucCur - pInput->pucStart);
+}
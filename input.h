@@ -0,0 +1,104 @@
+/*******************************************************/
+/* file: input.h                                       */
+/* abstract:  This file contains the XSVF data source  */
+/*            used by readByte() and readVal().  A     */
+/*            regular file is mmap()ed; anything else  */
+/*            (pipes, devices) is read in large blocks.*/
+/*            A pipelined input reads ahead on its own */
+/*            thread into a ring of blocks, so file    */
+/*            I/O overlaps the shifts.                 */
+/*            gzip, xz and zstd files are recognized by*/
+/*            their magic number and decoded a block at*/
+/*            a time (XSVF_SUPPORT_GZIP, _XZ, _ZSTD).  */
+/*******************************************************/
+
+#ifndef input_dot_h
+#define input_dot_h
+
+#define INPUT_BLOCK_SIZE    (256L * 1024L)
+
+/* read-ahead ring of a pipelined input:  slots of INPUT_PIPE_SLOT_SIZE */
+#define INPUT_PIPE_SLOTS        16
+#define INPUT_PIPE_SLOT_SIZE    (64L * 1024L)
+
+/* compressed input:  bytes read from the source per decoder refill,  */
+/* and the largest window/dictionary a stream may ask for              */
+#define INPUT_ZBUF_SIZE         (64L * 1024L)
+#define INPUT_MAX_WINDOW        (64L * 1024L * 1024L)
+
+/* SXsvfInput.iFormat */
+#define INPUT_RAW               0
+#define INPUT_GZIP              1
+#define INPUT_XZ                2
+#define INPUT_ZSTD              3
+
+typedef struct tagSXsvfInput SXsvfInput;
+typedef struct tagSXsvfPipe SXsvfPipe;
+typedef struct tagSXsvfDecoder SXsvfDecoder;
+
+struct tagSXsvfInput
+{
+    const unsigned char*    pucCur;     /* next unread byte */
+    const unsigned char*    pucEnd;     /* end of the bytes available now */
+    /* make more bytes available; 0 = none left */
+    long                    (*pfRefill)( SXsvfInput* pInput );
+    int                     iEof;       /* a read ran past the end */
+    long                    lConsumed;  /* bytes before pucCur's block */
+    const unsigned char*    pucStart;   /* first byte of a mapped/memory source */
+
+    int                     fd;
+    void*                   pvMap;      /* mmap()ed file, or 0 */
+    long                    lMapSize;
+    unsigned char*          pucBlock;   /* block buffer, or 0 */
+    unsigned char*          pucAll;     /* whole source from inputLoadAll(), or 0 */
+    SXsvfPipe*              pPipe;      /* reader thread, or 0 */
+    long                    lPipeWaits; /* refills that waited for the reader */
+    int                     iFormat;    /* INPUT_RAW, INPUT_GZIP, ... */
+    SXsvfDecoder*           pDecoder;   /* compressed source, or 0 */
+    long                    lSourceBytes;   /* read() from a block source */
+};
+
+/* open pzFileName ("-" = stdin); 0 = success */
+extern int inputOpenFile(SXsvfInput* pInput, const char* pzFileName);
+
+/* like inputOpenFile(), but never mmap()ed:  a reader thread reads   */
+/* ahead into a ring while the player shifts; 0 = success.  Falls back */
+/* to block reads if the thread cannot be started.                     */
+extern int inputOpenPipelined(SXsvfInput* pInput, const char* pzFileName);
+
+/* read from a caller-owned buffer */
+extern void inputOpenMemory(SXsvfInput* pInput, const unsigned char* pucData,
+                            long lSize);
+
+extern void inputClose(SXsvfInput* pInput);
+
+/* copy lNumBytes into pucData; returns bytes copied, short on EOF */
+extern long inputRead(SXsvfInput* pInput, unsigned char* pucData,
+                      long lNumBytes);
+
+/* zero-copy: pointer to the next lNumBytes, or 0 if they are not     */
+/* contiguous in memory (use inputRead).  The bytes are consumed.     */
+extern const unsigned char* inputSpan(SXsvfInput* pInput, long lNumBytes);
+
+/* pointer to all remaining bytes if the whole source is in memory    */
+/* (mapped file or memory buffer), else 0.  Nothing is consumed.       */
+extern const unsigned char* inputRemaining(SXsvfInput* pInput, long* plSize);
+
+/* pointer to the next lNumBytes without consuming them, or 0 if the  */
+/* source ends first or they do not fit in one block                   */
+extern const unsigned char* inputPeek(SXsvfInput* pInput, long lNumBytes);
+
+/* like inputRemaining(), but a block source is first read to the end  */
+/* into one buffer owned by the input; 0 = out of memory.              */
+extern const unsigned char* inputLoadAll(SXsvfInput* pInput, long* plSize);
+
+/* number of bytes consumed so far */
+extern long inputOffset(SXsvfInput* pInput);
+
+/* bytes taken from the file so far (compressed bytes if compressed) */
+extern long inputSourceBytes(SXsvfInput* pInput);
+
+/* "raw", "gzip", "xz" or "zstd" */
+extern const char* inputFormatName(SXsvfInput* pInput);
+
+#endif
@@ -6,6 +6,16 @@
 #include "lenval.h"
 #include "ports.h"
 
+#include <string.h>
+#if defined( __SSE2__ )
+    #include <emmintrin.h>
+#elif defined( __ARM_NEON )
+    #include <arm_neon.h>
+#endif
+
+/* bytes compared per step by EqualLenVal()/CompareLenVal() */
+#define LENVAL_BLOCK    16L
+
 /*****************************************************************************
 * Function:     value
 * Description:  Extract the long value from the lenval array.
@@ -15,13 +25,13 @@
 long value( lenVal*     plvValue )
 {
 	long    lValue;         /* result to hold the accumulated result */
-	short   sIndex;
+	long    lIndex;
 
     lValue  = 0;
-	for ( sIndex = 0; sIndex < plvValue->len ; ++sIndex )
+	for ( lIndex = 0; lIndex < plvValue->len ; ++lIndex )
 	{
 		lValue <<= 8;                       /* shift the accumulated result */
-		lValue |= plvValue->val[ sIndex];   /* get the last byte first */
+		lValue |= plvValue->val[ lIndex];   /* get the last byte first */
 	}
 
 	return( lValue );
@@ -42,6 +52,160 @@ void initLenVal( lenVal*    plv,
 	plv->val[0] = (unsigned char)lValue;
 }
 
+/*****************************************************************************
+* Function:     lenValBlockDiffers
+* Description:  Check one LENVAL_BLOCK-byte block for a masked difference.
+*               One SSE2/NEON XOR, AND and test per block; otherwise two
+*               64-bit words.
+* Parameters:   pucVal1     - ptr to the block in value #1.
+*               pucVal2     - ptr to the block in value #2.
+*               pucMask     - ptr to the block in the mask (=0 if no mask).
+* Returns:      int         - 0 = equal under the mask; 1 = differs.
+*****************************************************************************/
+static int lenValBlockDiffers( const unsigned char* pucVal1,
+                               const unsigned char* pucVal2,
+                               const unsigned char* pucMask )
+{
+#if defined( __SSE2__ )
+    __m128i             xDiff;
+
+    xDiff   = _mm_xor_si128( _mm_loadu_si128( (const __m128i*)pucVal1 ),
+                             _mm_loadu_si128( (const __m128i*)pucVal2 ) );
+    if ( pucMask )
+    {
+        xDiff   = _mm_and_si128( xDiff,
+                                 _mm_loadu_si128( (const __m128i*)pucMask ) );
+    }
+    return( _mm_movemask_epi8( _mm_cmpeq_epi8( xDiff,
+                                               _mm_setzero_si128() ) )
+            != 0xFFFF );
+#elif defined( __ARM_NEON )
+    uint8x16_t          xDiff;
+    uint64x2_t          xWords;
+
+    xDiff   = veorq_u8( vld1q_u8( pucVal1 ), vld1q_u8( pucVal2 ) );
+    if ( pucMask )
+    {
+        xDiff   = vandq_u8( xDiff, vld1q_u8( pucMask ) );
+    }
+    xWords  = vreinterpretq_u64_u8( xDiff );
+    return( ( vgetq_lane_u64( xWords, 0 ) | vgetq_lane_u64( xWords, 1 ) )
+            != 0 );
+#else   /* scalar */
+    unsigned long long  aullVal1[ 2 ];
+    unsigned long long  aullVal2[ 2 ];
+    unsigned long long  aullMask[ 2 ];
+
+    memcpy( aullVal1, pucVal1, LENVAL_BLOCK );
+    memcpy( aullVal2, pucVal2, LENVAL_BLOCK );
+    aullVal1[ 0 ]   ^= aullVal2[ 0 ];
+    aullVal1[ 1 ]   ^= aullVal2[ 1 ];
+    if ( pucMask )
+    {
+        memcpy( aullMask, pucMask, LENVAL_BLOCK );
+        aullVal1[ 0 ]   &= aullMask[ 0 ];
+        aullVal1[ 1 ]   &= aullMask[ 1 ];
+    }
+    return( ( aullVal1[ 0 ] | aullVal1[ 1 ] ) != 0 );
+#endif
+}
+
+/*****************************************************************************
+* Function:     lenValLastDiff
+* Description:  Find the last byte before lIndex whose masked values differ.
+*               The last byte is shifted first, so this is the first
+*               mismatch in shift order.  Whole blocks are skipped from
+*               the tail; the block that differs, and the head that is
+*               shorter than a block, are scanned by byte.
+* Parameters:   plvVal1     - ptr to lenval #1.
+*               plvVal2     - ptr to lenval #2.
+*               plvMask     - optional ptr to mask (=0 if no mask).
+*               lIndex      - number of bytes to search.
+* Returns:      long        - the byte index; -1 = equal.
+*****************************************************************************/
+static long lenValLastDiff( lenVal*     plvVal1,
+                            lenVal*     plvVal2,
+                            lenVal*     plvMask,
+                            long        lIndex )
+{
+    const unsigned char*    pucMask;
+    unsigned char           ucByteMask;
+
+    pucMask = plvMask ? plvMask->val : 0;
+    while ( ( lIndex >= LENVAL_BLOCK ) &&
+            !lenValBlockDiffers( plvVal1->val + lIndex - LENVAL_BLOCK,
+                                 plvVal2->val + lIndex - LENVAL_BLOCK,
+                                 pucMask ? pucMask + lIndex - LENVAL_BLOCK
+                                         : 0 ) )
+    {
+        lIndex  -= LENVAL_BLOCK;
+    }
+
+    while ( lIndex-- )
+    {
+        ucByteMask  = pucMask ? pucMask[ lIndex ] : 0xFF;
+        if ( ( plvVal1->val[ lIndex ] ^ plvVal2->val[ lIndex ] ) & ucByteMask )
+        {
+            break;
+        }
+    }
+
+    return( lIndex );
+}
+
+/*****************************************************************************
+* Function:     lenValCountBits
+* Description:  Count the bits set in the masked XOR of the first lNumBytes
+*               bytes of two lenvals.
+* Parameters:   plvVal1     - ptr to lenval #1.
+*               plvVal2     - ptr to lenval #2.
+*               plvMask     - optional ptr to mask (=0 if no mask).
+*               lNumBytes   - number of bytes to count.
+* Returns:      long        - the number of bits that differ.
+*****************************************************************************/
+static long lenValCountBits( lenVal*    plvVal1,
+                             lenVal*    plvVal2,
+                             lenVal*    plvMask,
+                             long       lNumBytes )
+{
+    long                lCount;
+    long                lIndex;
+    unsigned long long  ullVal1;
+    unsigned long long  ullVal2;
+    unsigned long long  ullMask;
+    unsigned char       ucDiff;
+
+    lCount  = 0;
+    lIndex  = 0;
+#if defined( __GNUC__ )
+    for ( ; lIndex + 8 <= lNumBytes; lIndex += 8 )
+    {
+        memcpy( &ullVal1, plvVal1->val + lIndex, 8 );
+        memcpy( &ullVal2, plvVal2->val + lIndex, 8 );
+        ullMask = ~0ULL;
+        if ( plvMask )
+        {
+            memcpy( &ullMask, plvMask->val + lIndex, 8 );
+        }
+        lCount  += __builtin_popcountll( ( ullVal1 ^ ullVal2 ) & ullMask );
+    }
+#endif  /* __GNUC__ */
+    for ( ; lIndex < lNumBytes; ++lIndex )
+    {
+        ucDiff  = plvVal1->val[ lIndex ] ^ plvVal2->val[ lIndex ];
+        if ( plvMask )
+        {
+            ucDiff  &= plvMask->val[ lIndex ];
+        }
+        for ( ; ucDiff; ucDiff &= ( ucDiff - 1 ) )
+        {
+            ++lCount;
+        }
+    }
+
+    return( lCount );
+}
+
 /*****************************************************************************
 * Function:     EqualLenVal
 * Description:  Compare two lenval arrays with an optional mask.
@@ -54,32 +218,51 @@ short EqualLenVal( lenVal*  plvTdoExpected,
                    lenVal*  plvTdoCaptured,
                    lenVal*  plvTdoMask )
 {
-    short           sEqual;
-	short           sIndex;
-    unsigned char   ucByteVal1;
-    unsigned char   ucByteVal2;
-    unsigned char   ucByteMask;
+    return( (short)( lenValLastDiff( plvTdoExpected, plvTdoCaptured,
+                                     plvTdoMask, plvTdoExpected->len ) < 0 ) );
+}
 
-    sEqual  = 1;
-    sIndex  = plvTdoExpected->len;
+/*****************************************************************************
+* Function:     CompareLenVal
+* Description:  Compare two lenval arrays with an optional mask and locate
+*               the mismatch.  Bits are numbered in shift order:  bit 0 is
+*               the lsb of the last byte.
+* Parameters:   plvTdoExpected  - ptr to lenval #1.
+*               plvTdoCaptured  - ptr to lenval #2.
+*               plvTdoMask      - optional ptr to mask (=0 if no mask).
+*               plFirstBit      - receives the first mismatching bit, or -1.
+* Returns:      long    - number of mismatching bits; 0 = equal.
+*****************************************************************************/
+long CompareLenVal( lenVal* plvTdoExpected,
+                    lenVal* plvTdoCaptured,
+                    lenVal* plvTdoMask,
+                    long*   plFirstBit )
+{
+    long            lIndex;
+    unsigned char   ucDiff;
+    long            lBit;
 
-    while ( sEqual && sIndex-- )
+    *plFirstBit = -1;
+    lIndex      = lenValLastDiff( plvTdoExpected, plvTdoCaptured,
+                                  plvTdoMask, plvTdoExpected->len );
+    if ( lIndex < 0 )
+    {
+        return( 0 );
+    }
+
+    ucDiff  = plvTdoExpected->val[ lIndex ] ^ plvTdoCaptured->val[ lIndex ];
+    if ( plvTdoMask )
+    {
+        ucDiff  &= plvTdoMask->val[ lIndex ];
+    }
+    for ( lBit = 0; !( ucDiff & ( 1 << lBit ) ); ++lBit )
     {
-        ucByteVal1  = plvTdoExpected->val[ sIndex ];
-        ucByteVal2  = plvTdoCaptured->val[ sIndex ];
-        if ( plvTdoMask )
-        {
-            ucByteMask  = plvTdoMask->val[ sIndex ];
-            ucByteVal1  &= ucByteMask;
-            ucByteVal2  &= ucByteMask;
-        }
-        if ( ucByteVal1 != ucByteVal2 )
-        {
-            sEqual  = 0;
-        }
     }
+    *plFirstBit = ( plvTdoExpected->len - 1 - lIndex ) * 8 + lBit;
 
-	return( sEqual );
+    /* The bytes after lIndex are equal */
+    return( lenValCountBits( plvTdoExpected, plvTdoCaptured, plvTdoMask,
+                             lIndex + 1 ) );
 }
 
 
@@ -145,17 +328,17 @@ void addVal( lenVal*    plvResVal,
     unsigned short  usSum;
     unsigned short  usVal1;
     unsigned short  usVal2;
-	short           sIndex;
+	long            lIndex;
 	
 	plvResVal->len  = plvVal1->len;         /* set up length of result */
 	
 	/* start at least significant bit and add bytes    */
     ucCarry = 0;
-    sIndex  = plvVal1->len;
-    while ( sIndex-- )
+    lIndex  = plvVal1->len;
+    while ( lIndex-- )
     {
-		usVal1  = plvVal1->val[ sIndex ];   /* i'th byte of val1 */
-		usVal2  = plvVal2->val[ sIndex ];   /* i'th byte of val2 */
+		usVal1  = plvVal1->val[ lIndex ];   /* i'th byte of val1 */
+		usVal2  = plvVal2->val[ lIndex ];   /* i'th byte of val2 */
 		
 		/* add the two bytes plus carry from previous addition */
 		usSum   = (unsigned short)( usVal1 + usVal2 + ucCarry );
@@ -164,7 +347,7 @@ void addVal( lenVal*    plvResVal,
 		ucCarry = (unsigned char)( ( usSum > 255 ) ? 1 : 0 );
 		
         /* set the i'th byte of the result */
-		plvResVal->val[ sIndex ]    = (unsigned char)usSum;
+		plvResVal->val[ lIndex ]    = (unsigned char)usSum;
     }
 }
 
@@ -172,19 +355,12 @@ void addVal( lenVal*    plvResVal,
 * Function:     readVal
 * Description:  read from XSVF numBytes bytes of data into x.
 * Parameters:   plv         - ptr to lenval in which to put the bytes read.
-*               sNumBytes   - the number of bytes to read.
+*               lNumBytes   - the number of bytes to read.
 * Returns:      void.
 *****************************************************************************/
 void readVal( lenVal*   plv,
-              short     sNumBytes )
+              long      lNumBytes )
 {
-    unsigned char*  pucVal;
-	
-    plv->len    = sNumBytes;        /* set the length of the lenVal        */
-    for ( pucVal = plv->val; sNumBytes; --sNumBytes, ++pucVal )
-    {
-        /* read a byte of data into the lenVal */
-		readByte( pucVal );
-    }
+    plv->len    = lNumBytes;        /* set the length of the lenVal        */
+    readBytes( plv->val, lNumBytes );
 }
-
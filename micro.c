@@ -56,10 +56,22 @@
     #include <string.h>
     #include <time.h>
 #endif  /* DEBUG_MODE */
+#if defined( __BMI2__ )
+    #include <immintrin.h>
+#endif  /* __BMI2__ */
 
 #include "micro.h"
 #include "lenval.h"
+#include "microint.h"
 #include "ports.h"
+#include "input.h"
+#include "timing.h"
+#include "xsvfplan.h"
+#include "xsvfmulti.h"
+#include "svf.h"
+#include "bitfile.h"
+#include "rt.h"
+#include "xsvflearn.h"
 
 
 /*============================================================================
@@ -68,19 +80,6 @@
 
 #define XSVF_VERSION    "5.01"
 
-/*****************************************************************************
-* Define:       XSVF_SUPPORT_COMPRESSION
-* Description:  Define this to support the XC9500/XL XSVF data compression
-*               scheme.
-*               Code size can be reduced by NOT supporting this feature.
-*               However, you must use the -nc (no compress) option when
-*               translating SVF to XSVF using the SVF2XSVF translator.
-*               Corresponding, uncompressed XSVF may be larger.
-*****************************************************************************/
-#ifndef XSVF_SUPPORT_COMPRESSION
-    #define XSVF_SUPPORT_COMPRESSION    1
-#endif
-
 /*****************************************************************************
 * Define:       XSVF_SUPPORT_ERRORCODES
 * Description:  Define this to support the new XSVF error codes.
@@ -101,44 +100,16 @@
 /*****************************************************************************
 * Define:       XSVF_MAIN
 * Description:  Define this to compile with a main function for standalone
-*               debugging.
+*               debugging.  Define XSVF_NO_MAIN instead to link micro.c into
+*               another program, e.g. xsvfbench.
 *****************************************************************************/
-#ifndef XSVF_MAIN
+#if !defined( XSVF_MAIN ) && !defined( XSVF_NO_MAIN )
     #ifdef DEBUG_MODE
         #define XSVF_MAIN   1
     #endif  /* DEBUG_MODE */
 #endif  /* XSVF_MAIN */
 
 
-/*============================================================================
-* DEBUG_MODE #define
-============================================================================*/
-
-#ifdef  DEBUG_MODE
-    #define XSVFDBG_PRINTF(iDebugLevel,pzFormat) \
-                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
-                    printf( pzFormat ); }
-    #define XSVFDBG_PRINTF1(iDebugLevel,pzFormat,arg1) \
-                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
-                    printf( pzFormat, arg1 ); }
-    #define XSVFDBG_PRINTF2(iDebugLevel,pzFormat,arg1,arg2) \
-                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
-                    printf( pzFormat, arg1, arg2 ); }
-    #define XSVFDBG_PRINTF3(iDebugLevel,pzFormat,arg1,arg2,arg3) \
-                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
-                    printf( pzFormat, arg1, arg2, arg3 ); }
-    #define XSVFDBG_PRINTLENVAL(iDebugLevel,plenVal) \
-                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
-                    xsvfPrintLenVal(plenVal); }
-#else   /* !DEBUG_MODE */
-    #define XSVFDBG_PRINTF(iDebugLevel,pzFormat)
-    #define XSVFDBG_PRINTF1(iDebugLevel,pzFormat,arg1)
-    #define XSVFDBG_PRINTF2(iDebugLevel,pzFormat,arg1,arg2)
-    #define XSVFDBG_PRINTF3(iDebugLevel,pzFormat,arg1,arg2,arg3)
-    #define XSVFDBG_PRINTLENVAL(iDebugLevel,plenVal)
-#endif  /* DEBUG_MODE */
-
-
 /*============================================================================
 * XSVF Type Declarations
 ============================================================================*/
@@ -147,16 +118,13 @@
 * Struct:       SXsvfInfo
 * Description:  This structure contains all of the data used during the
 *               execution of the XSVF.  Some data is persistent, predefined
-*               information (e.g. lRunTestTime).  The bulk of this struct's
-*               size is due to the lenVal structs (defined in lenval.h)
-*               which contain buffers for the active shift data.  The MAX_LEN
-*               #define in lenval.h defines the size of these buffers.
-*               These buffers must be large enough to store the longest
-*               shift data in your XSVF file.  For example:
-*                   MAX_LEN >= ( longest_shift_data_in_bits / 8 )
-*               Because the lenVal struct dominates the space usage of this
-*               struct, the rough size of this struct is:
-*                   sizeof( SXsvfInfo ) ~= MAX_LEN * 7 (number of lenVals)
+*               information (e.g. lRunTestTime).  The lenVal structs
+*               (defined in lenval.h) are views into a single heap arena
+*               that holds the active shift data.  Each view gets
+*               lLenValBytes bytes of the arena, sized from a pre-scan of
+*               the XSVF for its longest shift and grown by
+*               xsvfInfoReserve() if a longer shift turns up.  So:
+*                   arena size = lLenValBytes * XSVF_NUM_LENVALS
 *               xsvfInitialize() contains initialization code for the data
 *               in this struct.
 *               xsvfCleanup() contains cleanup code for the data in this
@@ -181,7 +149,10 @@ typedef struct tagSXsvfInfo
 
     /* Shift Data Info and Buffers */
     long            lShiftLengthBits;   /* Len. current shift data in bits */
-    short           sShiftLengthBytes;  /* Len. current shift data in bytes */
+    long            lShiftLengthBytes;  /* Len. current shift data in bytes */
+
+    unsigned char*  pucArena;           /* Storage behind the lenVals */
+    long            lLenValBytes;       /* Arena bytes per lenVal */
 
     lenVal          lvTdi;              /* Current TDI shift data */
     lenVal          lvTdoExpected;      /* Expected TDO shift data */
@@ -193,76 +164,20 @@ typedef struct tagSXsvfInfo
     lenVal          lvAddressMask;      /* Address mask for XSDRINC */
     lenVal          lvDataMask;         /* Data mask for XSDRINC */
     lenVal          lvNextData;         /* Next data for XSDRINC */
+    SXsvfSdrMap     sdrMap;             /* XSETSDRMASKS compiled for XSDRINC */
 #endif  /* XSVF_SUPPORT_COMPRESSION */
 } SXsvfInfo;
 
+#ifdef  XSVF_SUPPORT_COMPRESSION
+    #define XSVF_NUM_LENVALS    7
+#else
+    #define XSVF_NUM_LENVALS    4
+#endif  /* XSVF_SUPPORT_COMPRESSION */
+
 /* Declare pointer to functions that perform XSVF commands */
 typedef int (*TXsvfDoCmdFuncPtr)( SXsvfInfo* );
 
 
-/*============================================================================
-* XSVF Command Bytes
-============================================================================*/
-
-/* encodings of xsvf instructions */
-#define XCOMPLETE        0
-#define XTDOMASK         1
-#define XSIR             2
-#define XSDR             3
-#define XRUNTEST         4
-/* Reserved              5 */
-/* Reserved              6 */
-#define XREPEAT          7
-#define XSDRSIZE         8
-#define XSDRTDO          9
-#define XSETSDRMASKS     10
-#define XSDRINC          11
-#define XSDRB            12
-#define XSDRC            13
-#define XSDRE            14
-#define XSDRTDOB         15
-#define XSDRTDOC         16
-#define XSDRTDOE         17
-#define XSTATE           18         /* 4.00 */
-#define XENDIR           19         /* 4.04 */
-#define XENDDR           20         /* 4.04 */
-#define XSIR2            21         /* 4.10 */
-#define XCOMMENT         22         /* 4.14 */
-#define XWAIT            23         /* 5.00 */
-/* Insert new commands here */
-/* and add corresponding xsvfDoCmd function to xsvf_pfDoCmd below. */
-#define XLASTCMD         24         /* Last command marker */
-
-
-/*============================================================================
-* XSVF Command Parameter Values
-============================================================================*/
-
-#define XSTATE_RESET     0          /* 4.00 parameter for XSTATE */
-#define XSTATE_RUNTEST   1          /* 4.00 parameter for XSTATE */
-
-#define XENDXR_RUNTEST   0          /* 4.04 parameter for XENDIR/DR */
-#define XENDXR_PAUSE     1          /* 4.04 parameter for XENDIR/DR */
-
-/* TAP states */
-#define XTAPSTATE_RESET     0x00
-#define XTAPSTATE_RUNTEST   0x01    /* a.k.a. IDLE */
-#define XTAPSTATE_SELECTDR  0x02
-#define XTAPSTATE_CAPTUREDR 0x03
-#define XTAPSTATE_SHIFTDR   0x04
-#define XTAPSTATE_EXIT1DR   0x05
-#define XTAPSTATE_PAUSEDR   0x06
-#define XTAPSTATE_EXIT2DR   0x07
-#define XTAPSTATE_UPDATEDR  0x08
-#define XTAPSTATE_IRSTATES  0x09    /* All IR states begin here */
-#define XTAPSTATE_SELECTIR  0x09
-#define XTAPSTATE_CAPTUREIR 0x0A
-#define XTAPSTATE_SHIFTIR   0x0B
-#define XTAPSTATE_EXIT1IR   0x0C
-#define XTAPSTATE_PAUSEIR   0x0D
-#define XTAPSTATE_EXIT2IR   0x0E
-#define XTAPSTATE_UPDATEIR  0x0F
-
 /*============================================================================
 * XSVF Function Prototypes
 ============================================================================*/
@@ -364,7 +279,9 @@ TXsvfDoCmdFuncPtr   xsvf_pfDoCmd[]  =
         "ERROR:  TDO mismatch and exceeded max retries",
         "ERROR:  Unsupported XSVF command",
         "ERROR:  Illegal state specification",
-        "ERROR:  Data overflows allocated MAX_LEN buffer size"
+        "ERROR:  Data overflows LENVAL_MAX_BYTES or out of memory",
+        "ERROR:  XSVF data ends before XCOMPLETE",
+        "ERROR:  JTAG port failed a shift"
     };
 
     char*   xsvf_pzTapState[] =
@@ -388,8 +305,347 @@ TXsvfDoCmdFuncPtr   xsvf_pfDoCmd[]  =
     };
 #endif  /* DEBUG_MODE */
 
+/*****************************************************************************
+* Table:        xsvf_aTapPath
+* Description:  TMS sequence for every (from, to) pair of TAP states:
+*               ucTms holds the bits to clock, first bit in the LSB, and
+*               ucNumTms the count.  The paths are the ones the original
+*               state-by-state walker took:
+*                   - A RESET target always clocks six TMS=1 (reset/sync).
+*                   - A Pause target equal to the current state goes
+*                     Pause->Exit2->...->Pause, as the SVF standard requires.
+*                   - Exit2 is only reachable from the matching Pause;
+*                     other Exit2 targets are XTAPPATH_ILLEGAL.
+*****************************************************************************/
+typedef struct tagSTapPath
+{
+    unsigned char   ucTms;
+    unsigned char   ucNumTms;
+} STapPath;
+
+#define XTAPPATH_ILLEGAL_LEN    0xFF
+#define XTAPPATH_ILLEGAL        { 0x00, XTAPPATH_ILLEGAL_LEN }
+
+static const STapPath xsvf_aTapPath[ 16 ][ 16 ] =
+{
+    {   /* from RESET */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x00, 1 },        /* -> RUNTEST/IDLE */
+        { 0x02, 2 },        /* -> DRSELECT */
+        { 0x02, 3 },        /* -> DRCAPTURE */
+        { 0x02, 4 },        /* -> DRSHIFT */
+        { 0x0A, 4 },        /* -> DREXIT1 */
+        { 0x0A, 5 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x1A, 5 },        /* -> DRUPDATE */
+        { 0x06, 3 },        /* -> IRSELECT */
+        { 0x06, 4 },        /* -> IRCAPTURE */
+        { 0x06, 5 },        /* -> IRSHIFT */
+        { 0x16, 5 },        /* -> IREXIT1 */
+        { 0x16, 6 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x36, 6 }         /* -> IRUPDATE */
+    },
+    {   /* from RUNTEST/IDLE */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x00, 0 },        /* -> RUNTEST/IDLE */
+        { 0x01, 1 },        /* -> DRSELECT */
+        { 0x01, 2 },        /* -> DRCAPTURE */
+        { 0x01, 3 },        /* -> DRSHIFT */
+        { 0x05, 3 },        /* -> DREXIT1 */
+        { 0x05, 4 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x0D, 4 },        /* -> DRUPDATE */
+        { 0x03, 2 },        /* -> IRSELECT */
+        { 0x03, 3 },        /* -> IRCAPTURE */
+        { 0x03, 4 },        /* -> IRSHIFT */
+        { 0x0B, 4 },        /* -> IREXIT1 */
+        { 0x0B, 5 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x1B, 5 }         /* -> IRUPDATE */
+    },
+    {   /* from DRSELECT */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x06, 4 },        /* -> RUNTEST/IDLE */
+        { 0x00, 0 },        /* -> DRSELECT */
+        { 0x00, 1 },        /* -> DRCAPTURE */
+        { 0x00, 2 },        /* -> DRSHIFT */
+        { 0x02, 2 },        /* -> DREXIT1 */
+        { 0x02, 3 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x06, 3 },        /* -> DRUPDATE */
+        { 0x01, 1 },        /* -> IRSELECT */
+        { 0x01, 2 },        /* -> IRCAPTURE */
+        { 0x01, 3 },        /* -> IRSHIFT */
+        { 0x05, 3 },        /* -> IREXIT1 */
+        { 0x05, 4 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x0D, 4 }         /* -> IRUPDATE */
+    },
+    {   /* from DRCAPTURE */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x03, 3 },        /* -> RUNTEST/IDLE */
+        { 0x07, 3 },        /* -> DRSELECT */
+        { 0x00, 0 },        /* -> DRCAPTURE */
+        { 0x00, 1 },        /* -> DRSHIFT */
+        { 0x01, 1 },        /* -> DREXIT1 */
+        { 0x01, 2 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x03, 2 },        /* -> DRUPDATE */
+        { 0x0F, 4 },        /* -> IRSELECT */
+        { 0x0F, 5 },        /* -> IRCAPTURE */
+        { 0x0F, 6 },        /* -> IRSHIFT */
+        { 0x2F, 6 },        /* -> IREXIT1 */
+        { 0x2F, 7 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x6F, 7 }         /* -> IRUPDATE */
+    },
+    {   /* from DRSHIFT */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x03, 3 },        /* -> RUNTEST/IDLE */
+        { 0x07, 3 },        /* -> DRSELECT */
+        { 0x07, 4 },        /* -> DRCAPTURE */
+        { 0x00, 0 },        /* -> DRSHIFT */
+        { 0x01, 1 },        /* -> DREXIT1 */
+        { 0x01, 2 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x03, 2 },        /* -> DRUPDATE */
+        { 0x0F, 4 },        /* -> IRSELECT */
+        { 0x0F, 5 },        /* -> IRCAPTURE */
+        { 0x0F, 6 },        /* -> IRSHIFT */
+        { 0x2F, 6 },        /* -> IREXIT1 */
+        { 0x2F, 7 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x6F, 7 }         /* -> IRUPDATE */
+    },
+    {   /* from DREXIT1 */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x01, 2 },        /* -> RUNTEST/IDLE */
+        { 0x03, 2 },        /* -> DRSELECT */
+        { 0x03, 3 },        /* -> DRCAPTURE */
+        { 0x03, 4 },        /* -> DRSHIFT */
+        { 0x00, 0 },        /* -> DREXIT1 */
+        { 0x00, 1 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x01, 1 },        /* -> DRUPDATE */
+        { 0x07, 3 },        /* -> IRSELECT */
+        { 0x07, 4 },        /* -> IRCAPTURE */
+        { 0x07, 5 },        /* -> IRSHIFT */
+        { 0x17, 5 },        /* -> IREXIT1 */
+        { 0x17, 6 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x37, 6 }         /* -> IRUPDATE */
+    },
+    {   /* from DRPAUSE */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x03, 3 },        /* -> RUNTEST/IDLE */
+        { 0x07, 3 },        /* -> DRSELECT */
+        { 0x07, 4 },        /* -> DRCAPTURE */
+        { 0x01, 2 },        /* -> DRSHIFT */
+        { 0x17, 5 },        /* -> DREXIT1 */
+        { 0x17, 6 },        /* -> DRPAUSE */
+        { 0x01, 1 },        /* -> DREXIT2 */
+        { 0x03, 2 },        /* -> DRUPDATE */
+        { 0x0F, 4 },        /* -> IRSELECT */
+        { 0x0F, 5 },        /* -> IRCAPTURE */
+        { 0x0F, 6 },        /* -> IRSHIFT */
+        { 0x2F, 6 },        /* -> IREXIT1 */
+        { 0x2F, 7 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x6F, 7 }         /* -> IRUPDATE */
+    },
+    {   /* from DREXIT2 */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x01, 2 },        /* -> RUNTEST/IDLE */
+        { 0x03, 2 },        /* -> DRSELECT */
+        { 0x03, 3 },        /* -> DRCAPTURE */
+        { 0x00, 1 },        /* -> DRSHIFT */
+        { 0x0B, 4 },        /* -> DREXIT1 */
+        { 0x0B, 5 },        /* -> DRPAUSE */
+        { 0x00, 0 },        /* -> DREXIT2 */
+        { 0x01, 1 },        /* -> DRUPDATE */
+        { 0x07, 3 },        /* -> IRSELECT */
+        { 0x07, 4 },        /* -> IRCAPTURE */
+        { 0x07, 5 },        /* -> IRSHIFT */
+        { 0x17, 5 },        /* -> IREXIT1 */
+        { 0x17, 6 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x37, 6 }         /* -> IRUPDATE */
+    },
+    {   /* from DRUPDATE */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x00, 1 },        /* -> RUNTEST/IDLE */
+        { 0x01, 1 },        /* -> DRSELECT */
+        { 0x01, 2 },        /* -> DRCAPTURE */
+        { 0x01, 3 },        /* -> DRSHIFT */
+        { 0x05, 3 },        /* -> DREXIT1 */
+        { 0x05, 4 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x00, 0 },        /* -> DRUPDATE */
+        { 0x03, 2 },        /* -> IRSELECT */
+        { 0x03, 3 },        /* -> IRCAPTURE */
+        { 0x03, 4 },        /* -> IRSHIFT */
+        { 0x0B, 4 },        /* -> IREXIT1 */
+        { 0x0B, 5 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x1B, 5 }         /* -> IRUPDATE */
+    },
+    {   /* from IRSELECT */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x06, 4 },        /* -> RUNTEST/IDLE */
+        { 0x0E, 4 },        /* -> DRSELECT */
+        { 0x0E, 5 },        /* -> DRCAPTURE */
+        { 0x0E, 6 },        /* -> DRSHIFT */
+        { 0x2E, 6 },        /* -> DREXIT1 */
+        { 0x2E, 7 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x6E, 7 },        /* -> DRUPDATE */
+        { 0x00, 0 },        /* -> IRSELECT */
+        { 0x00, 1 },        /* -> IRCAPTURE */
+        { 0x00, 2 },        /* -> IRSHIFT */
+        { 0x02, 2 },        /* -> IREXIT1 */
+        { 0x02, 3 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x06, 3 }         /* -> IRUPDATE */
+    },
+    {   /* from IRCAPTURE */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x03, 3 },        /* -> RUNTEST/IDLE */
+        { 0x07, 3 },        /* -> DRSELECT */
+        { 0x07, 4 },        /* -> DRCAPTURE */
+        { 0x07, 5 },        /* -> DRSHIFT */
+        { 0x17, 5 },        /* -> DREXIT1 */
+        { 0x17, 6 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x37, 6 },        /* -> DRUPDATE */
+        { 0x0F, 4 },        /* -> IRSELECT */
+        { 0x00, 0 },        /* -> IRCAPTURE */
+        { 0x00, 1 },        /* -> IRSHIFT */
+        { 0x01, 1 },        /* -> IREXIT1 */
+        { 0x01, 2 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x03, 2 }         /* -> IRUPDATE */
+    },
+    {   /* from IRSHIFT */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x03, 3 },        /* -> RUNTEST/IDLE */
+        { 0x07, 3 },        /* -> DRSELECT */
+        { 0x07, 4 },        /* -> DRCAPTURE */
+        { 0x07, 5 },        /* -> DRSHIFT */
+        { 0x17, 5 },        /* -> DREXIT1 */
+        { 0x17, 6 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x37, 6 },        /* -> DRUPDATE */
+        { 0x0F, 4 },        /* -> IRSELECT */
+        { 0x0F, 5 },        /* -> IRCAPTURE */
+        { 0x00, 0 },        /* -> IRSHIFT */
+        { 0x01, 1 },        /* -> IREXIT1 */
+        { 0x01, 2 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x03, 2 }         /* -> IRUPDATE */
+    },
+    {   /* from IREXIT1 */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x01, 2 },        /* -> RUNTEST/IDLE */
+        { 0x03, 2 },        /* -> DRSELECT */
+        { 0x03, 3 },        /* -> DRCAPTURE */
+        { 0x03, 4 },        /* -> DRSHIFT */
+        { 0x0B, 4 },        /* -> DREXIT1 */
+        { 0x0B, 5 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x1B, 5 },        /* -> DRUPDATE */
+        { 0x07, 3 },        /* -> IRSELECT */
+        { 0x07, 4 },        /* -> IRCAPTURE */
+        { 0x07, 5 },        /* -> IRSHIFT */
+        { 0x00, 0 },        /* -> IREXIT1 */
+        { 0x00, 1 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x01, 1 }         /* -> IRUPDATE */
+    },
+    {   /* from IRPAUSE */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x03, 3 },        /* -> RUNTEST/IDLE */
+        { 0x07, 3 },        /* -> DRSELECT */
+        { 0x07, 4 },        /* -> DRCAPTURE */
+        { 0x07, 5 },        /* -> DRSHIFT */
+        { 0x17, 5 },        /* -> DREXIT1 */
+        { 0x17, 6 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x37, 6 },        /* -> DRUPDATE */
+        { 0x0F, 4 },        /* -> IRSELECT */
+        { 0x0F, 5 },        /* -> IRCAPTURE */
+        { 0x01, 2 },        /* -> IRSHIFT */
+        { 0x2F, 6 },        /* -> IREXIT1 */
+        { 0x2F, 7 },        /* -> IRPAUSE */
+        { 0x01, 1 },        /* -> IREXIT2 */
+        { 0x03, 2 }         /* -> IRUPDATE */
+    },
+    {   /* from IREXIT2 */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x01, 2 },        /* -> RUNTEST/IDLE */
+        { 0x03, 2 },        /* -> DRSELECT */
+        { 0x03, 3 },        /* -> DRCAPTURE */
+        { 0x03, 4 },        /* -> DRSHIFT */
+        { 0x0B, 4 },        /* -> DREXIT1 */
+        { 0x0B, 5 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x1B, 5 },        /* -> DRUPDATE */
+        { 0x07, 3 },        /* -> IRSELECT */
+        { 0x07, 4 },        /* -> IRCAPTURE */
+        { 0x00, 1 },        /* -> IRSHIFT */
+        { 0x17, 5 },        /* -> IREXIT1 */
+        { 0x17, 6 },        /* -> IRPAUSE */
+        { 0x00, 0 },        /* -> IREXIT2 */
+        { 0x01, 1 }         /* -> IRUPDATE */
+    },
+    {   /* from IRUPDATE */
+        { 0x3F, 6 },        /* -> RESET */
+        { 0x00, 1 },        /* -> RUNTEST/IDLE */
+        { 0x01, 1 },        /* -> DRSELECT */
+        { 0x01, 2 },        /* -> DRCAPTURE */
+        { 0x01, 3 },        /* -> DRSHIFT */
+        { 0x05, 3 },        /* -> DREXIT1 */
+        { 0x05, 4 },        /* -> DRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> DREXIT2 */
+        { 0x0D, 4 },        /* -> DRUPDATE */
+        { 0x03, 2 },        /* -> IRSELECT */
+        { 0x03, 3 },        /* -> IRCAPTURE */
+        { 0x03, 4 },        /* -> IRSHIFT */
+        { 0x0B, 4 },        /* -> IREXIT1 */
+        { 0x0B, 5 },        /* -> IRPAUSE */
+        XTAPPATH_ILLEGAL,   /* -> IREXIT2 */
+        { 0x00, 0 }         /* -> IRUPDATE */
+    }
+};
+
+#ifdef  DEBUG_MODE
+    /* IEEE 1149.1 next state for TMS=0 and TMS=1; used to print paths */
+    static const unsigned char xsvf_aucTapNext[ 16 ][ 2 ] =
+    {
+        { XTAPSTATE_RUNTEST,    XTAPSTATE_RESET },      /* RESET */
+        { XTAPSTATE_RUNTEST,    XTAPSTATE_SELECTDR },   /* RUNTEST/IDLE */
+        { XTAPSTATE_CAPTUREDR,  XTAPSTATE_SELECTIR },   /* DRSELECT */
+        { XTAPSTATE_SHIFTDR,    XTAPSTATE_EXIT1DR },    /* DRCAPTURE */
+        { XTAPSTATE_SHIFTDR,    XTAPSTATE_EXIT1DR },    /* DRSHIFT */
+        { XTAPSTATE_PAUSEDR,    XTAPSTATE_UPDATEDR },   /* DREXIT1 */
+        { XTAPSTATE_PAUSEDR,    XTAPSTATE_EXIT2DR },    /* DRPAUSE */
+        { XTAPSTATE_SHIFTDR,    XTAPSTATE_UPDATEDR },   /* DREXIT2 */
+        { XTAPSTATE_RUNTEST,    XTAPSTATE_SELECTDR },   /* DRUPDATE */
+        { XTAPSTATE_CAPTUREIR,  XTAPSTATE_RESET },      /* IRSELECT */
+        { XTAPSTATE_SHIFTIR,    XTAPSTATE_EXIT1IR },    /* IRCAPTURE */
+        { XTAPSTATE_SHIFTIR,    XTAPSTATE_EXIT1IR },    /* IRSHIFT */
+        { XTAPSTATE_PAUSEIR,    XTAPSTATE_UPDATEIR },   /* IREXIT1 */
+        { XTAPSTATE_PAUSEIR,    XTAPSTATE_EXIT2IR },    /* IRPAUSE */
+        { XTAPSTATE_SHIFTIR,    XTAPSTATE_UPDATEIR },   /* IREXIT2 */
+        { XTAPSTATE_RUNTEST,    XTAPSTATE_SELECTDR }    /* IRUPDATE */
+    };
+#endif  /* DEBUG_MODE */
+
+XSVF_THREAD SXsvfStats  xsvf_stats;
+XSVF_THREAD SXsvfBroadcast  xsvf_broadcast;
+
 #ifdef DEBUG_MODE
-    FILE* in;   /* Legacy DEBUG_MODE file pointer */
+    XSVF_THREAD SXsvfInput* in; /* XSVF data source read by readByte() */
     int xsvf_iDebugLevel;
 #endif /* DEBUG_MODE */
 
@@ -420,16 +676,265 @@ void xsvfPrintLenVal( lenVal *plv )
 #endif  /* DEBUG_MODE */
 
 
+/*****************************************************************************
+* Function:     xsvfStatsNow
+* Description:  Monotonic timestamp for xsvf_stats, taken only when the
+*               run is timed so untimed runs add no clock reads.
+* Parameters:   none.
+* Returns:      long long   - nanoseconds, or 0 if xsvf_stats.iTimed is 0.
+*****************************************************************************/
+long long xsvfStatsNow()
+{
+    return( xsvf_stats.iTimed ? timingNowNs() : 0 );
+}
+
+/*****************************************************************************
+* Function:     xsvfStatsCommand
+* Description:  Count one executed XSVF command and its time.
+* Parameters:   ucCommand   - the command byte.
+*               llStartNs   - xsvfStatsNow() before the command.
+* Returns:      void.
+*****************************************************************************/
+void xsvfStatsCommand( unsigned char ucCommand, long long llStartNs )
+{
+    ++xsvf_stats.lCommands;
+    if ( ucCommand < XLASTCMD )
+    {
+        ++xsvf_stats.alCommands[ ucCommand ];
+        if ( xsvf_stats.iTimed )
+        {
+            xsvf_stats.allCommandNs[ ucCommand ]   += timingNowNs() - llStartNs;
+        }
+    }
+}
+
+/*****************************************************************************
+* Function:     xsvfGetAsNumBytes
+* Description:  Calculate the number of bytes the given number of bits
+*               consumes.
+* Parameters:   lNumBits    - the number of bits.
+* Returns:      long        - the number of bytes to store the number of bits.
+*****************************************************************************/
+long xsvfGetAsNumBytes( long lNumBits )
+{
+    return( ( lNumBits + 7L ) / 8L );
+}
+
+/*****************************************************************************
+* Function:     xsvfInfoLenVals
+* Description:  Collect pointers to the lenVals backed by the arena.
+* Parameters:   pXsvfInfo   - ptr to the XSVF info structure.
+*               aplv        - receives XSVF_NUM_LENVALS lenVal pointers.
+* Returns:      void.
+*****************************************************************************/
+void xsvfInfoLenVals( SXsvfInfo* pXsvfInfo, lenVal** aplv )
+{
+    aplv[ 0 ]   = &(pXsvfInfo->lvTdi);
+    aplv[ 1 ]   = &(pXsvfInfo->lvTdoExpected);
+    aplv[ 2 ]   = &(pXsvfInfo->lvTdoCaptured);
+    aplv[ 3 ]   = &(pXsvfInfo->lvTdoMask);
+#ifdef  XSVF_SUPPORT_COMPRESSION
+    aplv[ 4 ]   = &(pXsvfInfo->lvAddressMask);
+    aplv[ 5 ]   = &(pXsvfInfo->lvDataMask);
+    aplv[ 6 ]   = &(pXsvfInfo->lvNextData);
+#endif  /* XSVF_SUPPORT_COMPRESSION */
+}
+
+/*****************************************************************************
+* Function:     xsvfInfoReserve
+* Description:  Make every lenVal able to hold at least lNumBytes bytes.
+*               The arena is reallocated and the current lenVal contents
+*               are preserved when it has to grow.
+* Parameters:   pXsvfInfo   - ptr to the XSVF info structure.
+*               lNumBytes   - required bytes per lenVal.
+* Returns:      int         - 0 = success; otherwise XSVF_ERROR_DATAOVERFLOW.
+*****************************************************************************/
+int xsvfInfoReserve( SXsvfInfo* pXsvfInfo, long lNumBytes )
+{
+    lenVal*         aplv[ XSVF_NUM_LENVALS ];
+    unsigned char*  pucArena;
+    long            lBytes;
+    int             i;
+
+    if ( lNumBytes <= pXsvfInfo->lLenValBytes )
+    {
+        return( XSVF_ERROR_NONE );
+    }
+    if ( lNumBytes > LENVAL_MAX_BYTES )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+
+    lBytes      = ( lNumBytes < LENVAL_MIN_BYTES ) ? LENVAL_MIN_BYTES : lNumBytes;
+    pucArena    = (unsigned char*)calloc( XSVF_NUM_LENVALS, lBytes );
+    if ( !pucArena )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+
+    xsvfInfoLenVals( pXsvfInfo, aplv );
+    for ( i = 0; i < XSVF_NUM_LENVALS; ++i )
+    {
+        if ( pXsvfInfo->pucArena )
+        {
+            memcpy( pucArena + ( i * lBytes ), aplv[ i ]->val,
+                    pXsvfInfo->lLenValBytes );
+        }
+        aplv[ i ]->val  = pucArena + ( i * lBytes );
+    }
+    free( pXsvfInfo->pucArena );
+    pXsvfInfo->pucArena     = pucArena;
+    pXsvfInfo->lLenValBytes = lBytes;
+
+    XSVFDBG_PRINTF1( 4, "    lenVal arena = %ld bytes\n",
+                     lBytes * XSVF_NUM_LENVALS );
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     xsvfScanMaxBytes
+* Description:  Walk the XSVF commands without executing them to find the
+*               longest shift, in bytes, so the lenVal arena can be sized
+*               once up front.  Stops at XCOMPLETE, an unknown command, or
+*               the end of the data; the run itself reports those errors.
+* Parameters:   pucData     - the XSVF data.
+*               lSize       - number of bytes of XSVF data.
+* Returns:      long        - longest shift in bytes (>= LENVAL_MIN_BYTES).
+*****************************************************************************/
+long xsvfScanMaxBytes( const unsigned char* pucData, long lSize )
+{
+    const unsigned char*    pucEnd;
+    const unsigned char*    pucDataMask;
+    long                    lSdrBytes;
+    long                    lBytes;
+    long                    lMax;
+    long                    lDataMaskBits;
+    long                    i;
+    unsigned char           ucMask;
+
+    pucEnd          = pucData + lSize;
+    pucDataMask     = 0;
+    lSdrBytes       = 0;
+    lDataMaskBits   = 0;
+    lMax            = LENVAL_MIN_BYTES;
+
+    /* XSCAN_NEED() stops the scan if fewer than n parameter bytes remain */
+    #define XSCAN_NEED(n)   if ( ( pucEnd - pucData ) < (long)(n) ) { return( lMax ); }
+
+    while ( pucData < pucEnd )
+    {
+        switch ( *pucData++ )
+        {
+        case XTDOMASK:
+        case XSDR:
+        case XSDRB:
+        case XSDRC:
+        case XSDRE:
+            XSCAN_NEED( lSdrBytes );
+            pucData += lSdrBytes;
+            break;
+        case XSDRTDO:
+        case XSDRTDOB:
+        case XSDRTDOC:
+        case XSDRTDOE:
+            XSCAN_NEED( 2 * lSdrBytes );
+            pucData += 2 * lSdrBytes;
+            break;
+        case XSIR:
+            XSCAN_NEED( 1 );
+            lBytes  = xsvfGetAsNumBytes( pucData[ 0 ] );
+            lMax    = ( lBytes > lMax ) ? lBytes : lMax;
+            XSCAN_NEED( 1 + lBytes );
+            pucData += 1 + lBytes;
+            break;
+        case XSIR2:
+            XSCAN_NEED( 2 );
+            lBytes  = xsvfGetAsNumBytes( ( (long)pucData[ 0 ] << 8 ) | pucData[ 1 ] );
+            lMax    = ( lBytes > lMax ) ? lBytes : lMax;
+            XSCAN_NEED( 2 + lBytes );
+            pucData += 2 + lBytes;
+            break;
+        case XSDRSIZE:
+            XSCAN_NEED( 4 );
+            lSdrBytes   = xsvfGetAsNumBytes( ( (long)pucData[ 0 ] << 24 ) |
+                                             ( (long)pucData[ 1 ] << 16 ) |
+                                             ( (long)pucData[ 2 ] << 8 ) |
+                                             pucData[ 3 ] );
+            if ( ( lSdrBytes < 0 ) || ( lSdrBytes > LENVAL_MAX_BYTES ) )
+            {
+                /* Leave the overflow for xsvfDoXSDRSIZE to report */
+                return( lMax );
+            }
+            lMax    = ( lSdrBytes > lMax ) ? lSdrBytes : lMax;
+            pucData += 4;
+            break;
+        case XRUNTEST:
+            pucData += 4;
+            break;
+        case XREPEAT:
+        case XSTATE:
+        case XENDIR:
+        case XENDDR:
+            pucData += 1;
+            break;
+        case XWAIT:
+            pucData += 6;
+            break;
+        case XCOMMENT:
+            while ( ( pucData < pucEnd ) && *pucData++ )
+            {
+            }
+            break;
+#ifdef  XSVF_SUPPORT_COMPRESSION
+        case XSETSDRMASKS:
+            XSCAN_NEED( 2 * lSdrBytes );
+            pucDataMask     = pucData + lSdrBytes;
+            lDataMaskBits   = 0;
+            for ( i = 0; i < lSdrBytes; ++i )
+            {
+                for ( ucMask = pucDataMask[ i ]; ucMask; ucMask >>= 1 )
+                {
+                    lDataMaskBits   += ( ucMask & 1 );
+                }
+            }
+            pucData += 2 * lSdrBytes;
+            break;
+        case XSDRINC:
+            XSCAN_NEED( lSdrBytes + 1 );
+            pucData += lSdrBytes;
+            lBytes  = pucData[ 0 ] * xsvfGetAsNumBytes( lDataMaskBits );
+            XSCAN_NEED( 1 + lBytes );
+            pucData += 1 + lBytes;
+            break;
+#endif  /* XSVF_SUPPORT_COMPRESSION */
+        default:
+            /* XCOMPLETE or a command the run will reject */
+            return( lMax );
+        }
+    }
+    #undef  XSCAN_NEED
+
+    return( lMax );
+}
+
 /*****************************************************************************
 * Function:     xsvfInfoInit
 * Description:  Initialize the xsvfInfo data.
+*               If the whole XSVF is already in memory, pre-scan it to size
+*               the lenVal arena for the longest shift.
 * Parameters:   pXsvfInfo   - ptr to the XSVF info structure.
 * Returns:      int         - 0 = success; otherwise error.
 *****************************************************************************/
 int xsvfInfoInit( SXsvfInfo* pXsvfInfo )
 {
+    lenVal*                 aplv[ XSVF_NUM_LENVALS ];
+    const unsigned char*    pucData;
+    long                    lSize;
+    long                    lMaxBytes;
+    int                     i;
+
     XSVFDBG_PRINTF1( 4, "    sizeof( SXsvfInfo ) = %d bytes\n",
-                     sizeof( SXsvfInfo ) );
+                     (int)sizeof( SXsvfInfo ) );
 
     pXsvfInfo->ucComplete       = 0;
     pXsvfInfo->ucCommand        = XCOMPLETE;
@@ -440,10 +945,31 @@ int xsvfInfoInit( SXsvfInfo* pXsvfInfo )
     pXsvfInfo->ucEndIR          = XTAPSTATE_RUNTEST;
     pXsvfInfo->ucEndDR          = XTAPSTATE_RUNTEST;
     pXsvfInfo->lShiftLengthBits = 0L;
-    pXsvfInfo->sShiftLengthBytes= 0;
+    pXsvfInfo->lShiftLengthBytes= 0;
     pXsvfInfo->lRunTestTime     = 0L;
+    pXsvfInfo->pucArena         = 0;
+    pXsvfInfo->lLenValBytes     = 0;
+#ifdef  XSVF_SUPPORT_COMPRESSION
+    memset( &(pXsvfInfo->sdrMap), 0, sizeof( pXsvfInfo->sdrMap ) );
+    pXsvfInfo->sdrMap.lAddrFirst    = -1;
+    pXsvfInfo->sdrMap.lAddrLast     = -1;
+#endif  /* XSVF_SUPPORT_COMPRESSION */
 
-    return( 0 );
+    xsvfInfoLenVals( pXsvfInfo, aplv );
+    for ( i = 0; i < XSVF_NUM_LENVALS; ++i )
+    {
+        aplv[ i ]->len  = 0;
+        aplv[ i ]->val  = 0;
+    }
+
+    lMaxBytes   = LENVAL_MIN_BYTES;
+    pucData     = inputRemaining( in, &lSize );
+    if ( pucData )
+    {
+        lMaxBytes   = xsvfScanMaxBytes( pucData, lSize );
+    }
+
+    return( xsvfInfoReserve( pXsvfInfo, lMaxBytes ) );
 }
 
 /*****************************************************************************
@@ -454,32 +980,70 @@ int xsvfInfoInit( SXsvfInfo* pXsvfInfo )
 *****************************************************************************/
 void xsvfInfoCleanup( SXsvfInfo* pXsvfInfo )
 {
+    free( pXsvfInfo->pucArena );
+    pXsvfInfo->pucArena     = 0;
+    pXsvfInfo->lLenValBytes = 0;
+#ifdef  XSVF_SUPPORT_COMPRESSION
+    xsvfSdrMapFree( &(pXsvfInfo->sdrMap) );
+#endif  /* XSVF_SUPPORT_COMPRESSION */
 }
 
 /*****************************************************************************
-* Function:     xsvfGetAsNumBytes
-* Description:  Calculate the number of bytes the given number of bits
-*               consumes.
-* Parameters:   lNumBits    - the number of bits.
-* Returns:      short       - the number of bytes to store the number of bits.
+* Function:     xsvfTapPath
+* Description:  Look up the TMS sequence that goes from ucStartState to
+*               ucTargetState (see xsvf_aTapPath).
+* Parameters:   ucStartState    - TAP state before the path.
+*               ucTargetState   - TAP state after the path.
+*               pusTms          - returns the TMS bits; first bit is the LSB.
+*               pusNumTms       - returns the number of TMS bits.
+* Returns:      int             - 0 = success; otherwise error.
 *****************************************************************************/
-short xsvfGetAsNumBytes( long lNumBits )
+int xsvfTapPath( unsigned char      ucStartState,
+                 unsigned char      ucTargetState,
+                 unsigned short*    pusTms,
+                 unsigned short*    pusNumTms )
 {
-    return( (short)( ( lNumBits + 7L ) / 8L ) );
+    const STapPath* pPath;
+
+    *pusTms     = 0;
+    *pusNumTms  = 0;
+    if ( ( ucStartState > XTAPSTATE_UPDATEIR ) ||
+         ( ucTargetState > XTAPSTATE_UPDATEIR ) )
+    {
+        return( XSVF_ERROR_ILLEGALSTATE );
+    }
+    pPath   = &(xsvf_aTapPath[ ucStartState ][ ucTargetState ]);
+    if ( pPath->ucNumTms == XTAPPATH_ILLEGAL_LEN )
+    {
+        return( XSVF_ERROR_ILLEGALSTATE );
+    }
+    *pusTms     = pPath->ucTms;
+    *pusNumTms  = pPath->ucNumTms;
+    return( XSVF_ERROR_NONE );
 }
 
 /*****************************************************************************
-* Function:     xsvfTmsTransition
-* Description:  Apply TMS and transition TAP controller by applying one TCK
-*               cycle.
-* Parameters:   sTms    - new TMS value.
+* Function:     xsvfShiftTms
+* Description:  Clock a TAP path with shiftTms() and count it in xsvf_stats.
+* Parameters:   usTms       - TMS bits; first bit is the LSB.
+*               usNumTms    - number of TMS bits.
 * Returns:      void.
 *****************************************************************************/
-void xsvfTmsTransition( short sTms )
+void xsvfShiftTms( unsigned short usTms, unsigned short usNumTms )
 {
-    setPort( TMS, sTms );
-    setPort( TCK, 0 );
-    setPort( TCK, 1 );
+    long long   llStartNs;
+
+    if ( usNumTms )
+    {
+        llStartNs   = xsvfStatsNow();
+        shiftTms( usTms, usNumTms );
+        ++xsvf_stats.lTapTransitions;
+        xsvf_stats.lTmsBits += usNumTms;
+        if ( xsvf_stats.iTimed )
+        {
+            xsvf_stats.llTmsNs  += timingNowNs() - llStartNs;
+        }
+    }
 }
 
 /*****************************************************************************
@@ -491,6 +1055,8 @@ void xsvfTmsTransition( short sTms )
 *               which cause an XSVF_ERROR_ILLEGALSTATE:
 *                   - Target==DREXIT2;  Start!=DRPAUSE
 *                   - Target==IREXIT2;  Start!=IRPAUSE
+*               The path comes from xsvf_aTapPath and is clocked as one
+*               shiftTms() burst.
 * Parameters:   pucTapState     - Current TAP state; returns final TAP state.
 *               ucTargetState   - New target TAP state.
 * Returns:      int             - 0 = success; otherwise error.
@@ -498,283 +1064,246 @@ void xsvfTmsTransition( short sTms )
 int xsvfGotoTapState( unsigned char*   pucTapState,
                       unsigned char    ucTargetState )
 {
-    int i;
-    int iErrorCode;
+    unsigned short  usTms;
+    unsigned short  usNumTms;
+    int             iErrorCode;
+#ifdef  DEBUG_MODE
+    unsigned char   ucTapState;
+    int             i;
+#endif  /* DEBUG_MODE */
 
-    iErrorCode  = XSVF_ERROR_NONE;
+    iErrorCode  = xsvfTapPath( *pucTapState, ucTargetState,
+                               &usTms, &usNumTms );
+    if ( iErrorCode != XSVF_ERROR_NONE )
+    {
+        /* Trap illegal TAP state path specification */
+        return( iErrorCode );
+    }
+
+    if ( xsvf_learn.lOwedUs && !xsvf_learn.iVerifying &&
+         ( *pucTapState == XTAPSTATE_RUNTEST ) &&
+         ( ucTargetState != XTAPSTATE_RUNTEST ) )
+    {
+        /* An early pulse that is not verified next:  finish it first */
+        xsvfLearnSettle();
+    }
+
+    xsvfShiftTms( usTms, usNumTms );
+
+#ifdef  DEBUG_MODE
     if ( ucTargetState == XTAPSTATE_RESET )
     {
-        /* If RESET, always perform TMS reset sequence to reset/sync TAPs */
-        xsvfTmsTransition( 1 );
-        for ( i = 0; i < 5; ++i )
-        {
-            setPort( TCK, 0 );
-            setPort( TCK, 1 );
-        }
-        *pucTapState    = XTAPSTATE_RESET;
         XSVFDBG_PRINTF( 3, "   TMS Reset Sequence -> Test-Logic-Reset\n" );
         XSVFDBG_PRINTF1( 3, "   TAP State = %s\n",
-                         xsvf_pzTapState[ *pucTapState ] );
+                         xsvf_pzTapState[ ucTargetState ] );
     }
-    else if ( ( ucTargetState != *pucTapState ) &&
-              ( ( ( ucTargetState == XTAPSTATE_EXIT2DR ) && ( *pucTapState != XTAPSTATE_PAUSEDR ) ) ||
-                ( ( ucTargetState == XTAPSTATE_EXIT2IR ) && ( *pucTapState != XTAPSTATE_PAUSEIR ) ) ) )
-    {
-        /* Trap illegal TAP state path specification */
-        iErrorCode      = XSVF_ERROR_ILLEGALSTATE;
-    }
-    else
+    else if ( xsvf_iDebugLevel >= 3 )
     {
-        if ( ucTargetState == *pucTapState )
-        {
-            /* Already in target state.  Do nothing except when in DRPAUSE
-               or in IRPAUSE to comply with SVF standard */
-            if ( ucTargetState == XTAPSTATE_PAUSEDR )
-            {
-                xsvfTmsTransition( 1 );
-                *pucTapState    = XTAPSTATE_EXIT2DR;
-                XSVFDBG_PRINTF1( 3, "   TAP State = %s\n",
-                                 xsvf_pzTapState[ *pucTapState ] );
-            }
-            else if ( ucTargetState == XTAPSTATE_PAUSEIR )
-            {
-                xsvfTmsTransition( 1 );
-                *pucTapState    = XTAPSTATE_EXIT2IR;
-                XSVFDBG_PRINTF1( 3, "   TAP State = %s\n",
-                                 xsvf_pzTapState[ *pucTapState ] );
-            }
-        }
-
-        /* Perform TAP state transitions to get to the target state */
-        while ( ucTargetState != *pucTapState )
+        ucTapState  = *pucTapState;
+        for ( i = 0; i < usNumTms; ++i )
         {
-            switch ( *pucTapState )
-            {
-            case XTAPSTATE_RESET:
-                xsvfTmsTransition( 0 );
-                *pucTapState    = XTAPSTATE_RUNTEST;
-                break;
-            case XTAPSTATE_RUNTEST:
-                xsvfTmsTransition( 1 );
-                *pucTapState    = XTAPSTATE_SELECTDR;
-                break;
-            case XTAPSTATE_SELECTDR:
-                if ( ucTargetState >= XTAPSTATE_IRSTATES )
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_SELECTIR;
-                }
-                else
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_CAPTUREDR;
-                }
-                break;
-            case XTAPSTATE_CAPTUREDR:
-                if ( ucTargetState == XTAPSTATE_SHIFTDR )
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_SHIFTDR;
-                }
-                else
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_EXIT1DR;
-                }
-                break;
-            case XTAPSTATE_SHIFTDR:
-                xsvfTmsTransition( 1 );
-                *pucTapState    = XTAPSTATE_EXIT1DR;
-                break;
-            case XTAPSTATE_EXIT1DR:
-                if ( ucTargetState == XTAPSTATE_PAUSEDR )
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_PAUSEDR;
-                }
-                else
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_UPDATEDR;
-                }
-                break;
-            case XTAPSTATE_PAUSEDR:
-                xsvfTmsTransition( 1 );
-                *pucTapState    = XTAPSTATE_EXIT2DR;
-                break;
-            case XTAPSTATE_EXIT2DR:
-                if ( ucTargetState == XTAPSTATE_SHIFTDR )
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_SHIFTDR;
-                }
-                else
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_UPDATEDR;
-                }
-                break;
-            case XTAPSTATE_UPDATEDR:
-                if ( ucTargetState == XTAPSTATE_RUNTEST )
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_RUNTEST;
-                }
-                else
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_SELECTDR;
-                }
-                break;
-            case XTAPSTATE_SELECTIR:
-                xsvfTmsTransition( 0 );
-                *pucTapState    = XTAPSTATE_CAPTUREIR;
-                break;
-            case XTAPSTATE_CAPTUREIR:
-                if ( ucTargetState == XTAPSTATE_SHIFTIR )
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_SHIFTIR;
-                }
-                else
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_EXIT1IR;
-                }
-                break;
-            case XTAPSTATE_SHIFTIR:
-                xsvfTmsTransition( 1 );
-                *pucTapState    = XTAPSTATE_EXIT1IR;
-                break;
-            case XTAPSTATE_EXIT1IR:
-                if ( ucTargetState == XTAPSTATE_PAUSEIR )
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_PAUSEIR;
-                }
-                else
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_UPDATEIR;
-                }
-                break;
-            case XTAPSTATE_PAUSEIR:
-                xsvfTmsTransition( 1 );
-                *pucTapState    = XTAPSTATE_EXIT2IR;
-                break;
-            case XTAPSTATE_EXIT2IR:
-                if ( ucTargetState == XTAPSTATE_SHIFTIR )
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_SHIFTIR;
-                }
-                else
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_UPDATEIR;
-                }
-                break;
-            case XTAPSTATE_UPDATEIR:
-                if ( ucTargetState == XTAPSTATE_RUNTEST )
-                {
-                    xsvfTmsTransition( 0 );
-                    *pucTapState    = XTAPSTATE_RUNTEST;
-                }
-                else
-                {
-                    xsvfTmsTransition( 1 );
-                    *pucTapState    = XTAPSTATE_SELECTDR;
-                }
-                break;
-            default:
-                iErrorCode      = XSVF_ERROR_ILLEGALSTATE;
-                *pucTapState    = ucTargetState;    /* Exit while loop */
-                break;
-            }
-            XSVFDBG_PRINTF1( 3, "   TAP State = %s\n",
-                             xsvf_pzTapState[ *pucTapState ] );
+            ucTapState  = xsvf_aucTapNext[ ucTapState ][ ( usTms >> i ) & 1 ];
+            printf( "   TAP State = %s\n", xsvf_pzTapState[ ucTapState ] );
         }
     }
+#endif  /* DEBUG_MODE */
 
+    *pucTapState    = ucTargetState;
     return( iErrorCode );
 }
 
 /*****************************************************************************
-* Function:     xsvfShiftOnly
-* Description:  Assumes that starting TAP state is SHIFT-DR or SHIFT-IR.
-*               Shift the given TDI data into the JTAG scan chain.
-*               Optionally, save the TDO data shifted out of the scan chain.
-*               Last shift cycle is special:  capture last TDO, set last TDI,
-*               but does not pulse TCK.  Caller must pulse TCK and optionally
-*               set TMS=1 to exit shift state.
-* Parameters:   lNumBits        - number of bits to shift.
-*               plvTdi          - ptr to lenval for TDI data.
-*               plvTdoCaptured  - ptr to lenval for storing captured TDO data.
-*               iExitShift      - 1=exit at end of shift; 0=stay in Shift-DR.
-* Returns:      void.
+* Function:     xsvfTdoConsumed
+* Description:  Determine whether the TDO captured by a shift is ever used,
+*               i.e. an expected TDO value is given and the mask selects at
+*               least one bit to compare.
+* Parameters:   plvTdoExpected  - ptr to expected TDO data (0 = none).
+*               plvTdoMask      - ptr to TDO mask (0 = compare all bits).
+* Returns:      int             - 1 = TDO is compared; 0 = write-only shift.
 *****************************************************************************/
-void xsvfShiftOnly( long    lNumBits,
-                    lenVal* plvTdi,
-                    lenVal* plvTdoCaptured,
-                    int     iExitShift )
+int xsvfTdoConsumed( lenVal*    plvTdoExpected,
+                     lenVal*    plvTdoMask )
 {
-    unsigned char*  pucTdi;
-    unsigned char*  pucTdo;
-    unsigned char   ucTdiByte;
-    unsigned char   ucTdoByte;
-    unsigned char   ucTdoBit;
-    int             i;
-
-    /* assert( ( ( lNumBits + 7 ) / 8 ) == plvTdi->len ); */
+    long    lIndex;
 
-    /* Initialize TDO storage len == TDI len */
-    pucTdo  = 0;
-    if ( plvTdoCaptured )
+    if ( !plvTdoExpected )
     {
-        plvTdoCaptured->len = plvTdi->len;
-        pucTdo              = plvTdoCaptured->val + plvTdi->len;
+        return( 0 );
     }
-
-    /* Shift LSB first.  val[N-1] == LSB.  val[0] == MSB. */
-    pucTdi  = plvTdi->val + plvTdi->len;
-    while ( lNumBits )
+    if ( !plvTdoMask )
     {
-        /* Process on a byte-basis */
-        ucTdiByte   = (*(--pucTdi));
-        ucTdoByte   = 0;
-        for ( i = 0; ( lNumBits && ( i < 8 ) ); ++i )
+        return( 1 );
+    }
+    for ( lIndex = 0; lIndex < plvTdoExpected->len; ++lIndex )
+    {
+        if ( plvTdoMask->val[ lIndex ] )
         {
-            --lNumBits;
-            if ( iExitShift && !lNumBits )
-            {
-                /* Exit Shift-DR state */
-                setPort( TMS, 1 );
-            }
+            return( 1 );
+        }
+    }
+    return( 0 );
+}
 
-            /* Set the new TDI value */
-            setPort( TDI, (short)(ucTdiByte & 1) );
-            ucTdiByte   >>= 1;
+/*****************************************************************************
+* Function:     xsvfBroadcastReserve
+* Description:  Make the broadcast TDO buffer hold lNumBytes for each of
+*               chains 1..N-1.
+* Parameters:   lNumBytes   - bytes per chain.
+* Returns:      int         - 0 = success; otherwise XSVF_ERROR_DATAOVERFLOW.
+*****************************************************************************/
+static int xsvfBroadcastReserve( long lNumBytes )
+{
+    unsigned char*  pucTdo;
 
-            /* Set TCK low */
-            setPort( TCK, 0 );
+    if ( lNumBytes <= xsvf_broadcast.lTdoBytes )
+    {
+        return( XSVF_ERROR_NONE );
+    }
+    pucTdo  = (unsigned char*)realloc( xsvf_broadcast.pucTdo,
+                  lNumBytes * ( xsvf_broadcast.iNumChains - 1 ) );
+    if ( !pucTdo )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+    xsvf_broadcast.pucTdo       = pucTdo;
+    xsvf_broadcast.lTdoBytes    = lNumBytes;
+    return( XSVF_ERROR_NONE );
+}
 
-            if ( pucTdo )
+/*****************************************************************************
+* Function:     xsvfBroadcastCompare
+* Description:  Compare the TDO each pending broadcast chain captured in
+*               the last shift against the expected TDO.
+* Parameters:   plvTdoExpected  - ptr to expected TDO data.
+*               plvTdoCaptured  - ptr to chain 0's captured TDO data.
+*               plvTdoMask      - ptr to TDO mask.
+*               ulPending       - chains to compare, chain i in bit i.
+*               plMismatchBits  - receives the differing bits of the first
+*                                 mismatching chain.
+*               plFirstMismatch - receives the first of them.
+* Returns:      unsigned long   - the pending chains that mismatch.
+*****************************************************************************/
+static unsigned long xsvfBroadcastCompare( lenVal*         plvTdoExpected,
+                                           lenVal*         plvTdoCaptured,
+                                           lenVal*         plvTdoMask,
+                                           unsigned long   ulPending,
+                                           long*           plMismatchBits,
+                                           long*           plFirstMismatch )
+{
+    lenVal          lvTdo;
+    unsigned long   ulMismatch;
+    long            lBits;
+    long            lFirst;
+    int             iChain;
+
+    ulMismatch  = 0;
+    lvTdo.len   = plvTdoCaptured->len;
+    for ( iChain = 0; iChain < xsvf_broadcast.iNumChains; ++iChain )
+    {
+        if ( !( ( ulPending >> iChain ) & 1 ) )
+        {
+            continue;
+        }
+        lvTdo.val   = iChain ? ( xsvf_broadcast.pucTdo +
+                                 ( iChain - 1 ) * xsvf_broadcast.lTdoBytes )
+                             : plvTdoCaptured->val;
+        lBits       = CompareLenVal( plvTdoExpected, &lvTdo, plvTdoMask,
+                                     &lFirst );
+        if ( lBits )
+        {
+            if ( !ulMismatch )
             {
-                /* Save the TDO value */
-                ucTdoBit    = readTDOBit();
-                ucTdoByte   |= ( ucTdoBit << i );
+                *plMismatchBits     = lBits;
+                *plFirstMismatch    = lFirst;
             }
-
-            /* Set TCK high */
-            setPort( TCK, 1 );
+            ulMismatch  |= ( 1UL << iChain );
         }
+    }
+    return( ulMismatch );
+}
 
-        /* Save the TDO byte value */
-        if ( pucTdo )
+/*****************************************************************************
+* Function:     xsvfShiftOnly
+* Description:  Assumes that starting TAP state is SHIFT-DR or SHIFT-IR.
+*               Shift the given TDI data into the JTAG scan chain.
+*               Optionally, save the TDO data shifted out of the scan chain.
+*               The whole span is handed to the port's shiftBits() so that
+*               drivers can shift words or buffers at a time.  With
+*               iExitShift, TMS=1 on the last bit exits the shift state.
+*               When broadcasting, chains 1..N-1 capture into
+*               xsvf_broadcast.pucTdo at the same offset.
+*               A driver that could not complete the shift counts it in
+*               SPort.lErrors:  the TAP state and TDO are then unknown.
+* Parameters:   lNumBits        - number of bits to shift.
+*               plvTdi          - ptr to lenval for TDI data.
+*               plvTdoCaptured  - ptr to lenval for storing captured TDO data.
+*               iExitShift      - 1=exit at end of shift; 0=stay in Shift-DR.
+* Returns:      int             - 0 = success; XSVF_ERROR_PORT if the port
+*                                 failed the shift.
+*****************************************************************************/
+int xsvfShiftOnly( long    lNumBits,
+                    lenVal* plvTdi,
+                    lenVal* plvTdoCaptured,
+                    int     iExitShift )
+{
+    long            lNumBytes;
+    unsigned char*  pucTdo;
+    unsigned char*  apucTdo[ PORT_MAX_TDO ];
+    long long       llStartNs;
+    int             iChain;
+
+    /* assert( ( ( lNumBits + 7 ) / 8 ) == plvTdi->len ); */
+    lNumBytes   = xsvfGetAsNumBytes( lNumBits );
+
+    /* Initialize TDO storage len == TDI len */
+    pucTdo  = 0;
+    if ( plvTdoCaptured )
+    {
+        plvTdoCaptured->len = plvTdi->len;
+        pucTdo              = plvTdoCaptured->val + plvTdi->len - lNumBytes;
+    }
+
+    ++xsvf_stats.lShifts;
+    xsvf_stats.lBitsShifted += lNumBits;
+    if ( pucTdo )
+    {
+        xsvf_stats.lTdoBitsSampled  += lNumBits;
+    }
+    else
+    {
+        ++xsvf_stats.lShiftsWriteOnly;
+    }
+
+    /* Hand the whole span to the port driver.  Shift LSB first:
+       val[N-1] == LSB.  val[0] == MSB. */
+    llStartNs   = xsvfStatsNow();
+    if ( pucTdo && ( xsvf_broadcast.iNumChains > 1 ) )
+    {
+        apucTdo[ 0 ]    = pucTdo;
+        for ( iChain = 1; iChain < xsvf_broadcast.iNumChains; ++iChain )
         {
-            (*(--pucTdo))   = ucTdoByte;
+            apucTdo[ iChain ]   = xsvf_broadcast.pucTdo +
+                                  ( iChain - 1 ) * xsvf_broadcast.lTdoBytes +
+                                  plvTdi->len - lNumBytes;
         }
+        shiftBitsBroadcast( plvTdi->val + plvTdi->len - lNumBytes, apucTdo,
+                            lNumBits, iExitShift );
+    }
+    else
+    {
+        shiftBits( plvTdi->val + plvTdi->len - lNumBytes, pucTdo, lNumBits,
+                   iExitShift );
+    }
+    if ( xsvf_stats.iTimed )
+    {
+        xsvf_stats.llShiftNs    += timingNowNs() - llStartNs;
+    }
+
+    if ( portsCurrent()->lErrors )
+    {
+        return( XSVF_ERROR_PORT );
     }
+    return( XSVF_ERROR_NONE );
 }
 
 /*****************************************************************************
@@ -800,6 +1329,16 @@ void xsvfShiftOnly( long    lNumBits,
 * Notes:        XC9500XL-only Optimization:
 *               Skip the waitTime() if plvTdoMask->val[0:plvTdoMask->len-1]
 *               is NOT all zeros and sMatch==1.
+*               Write-only:  if there is no expected TDO or the TDO mask is
+*               all zeros, TDO is not sampled and no compare is made.
+*               Broadcast:  every active chain is compared and the retries
+*               go on while any of them mismatches.  Chains that still
+*               mismatch are masked out of xsvf_broadcast.ulActive; the
+*               shift only fails when no active chain is left.
+*               Retry history (xsvflearn.h):  a status-checked shift, with
+*               ucMaxRepeat and lRunTestTime, verifies the pulse before
+*               it; an early pulse that fails gets one retry at the file's
+*               lRunTestTime that does not count against ucMaxRepeat.
 *****************************************************************************/
 int xsvfShift( unsigned char*   pucTapState,
                unsigned char    ucStartState,
@@ -814,14 +1353,63 @@ int xsvfShift( unsigned char*   pucTapState,
 {
     int             iErrorCode;
     int             iMismatch;
+    long            lMismatchBits;
+    long            lFirstMismatch;
     unsigned char   ucRepeat;
     int             iExitShift;
+    unsigned long   ulPending;
+    int             iLearn;
+    int             iFree;
+    long            lFileTime;
+    long            lWaitTime;
 
-    iErrorCode  = XSVF_ERROR_NONE;
-    iMismatch   = 0;
+    iErrorCode      = XSVF_ERROR_NONE;
+    iMismatch       = 0;
+    lMismatchBits   = 0;
+    lFirstMismatch  = -1;
     ucRepeat    = 0;
     iExitShift  = ( ucStartState != ucEndState );
 
+    if ( readEOF() )
+    {
+        /* Do not shift the zeros that stand in for missing data */
+        return( XSVF_ERROR_TRUNCATED );
+    }
+
+    /* Run write-only if the captured TDO would never be compared */
+    if ( !xsvfTdoConsumed( plvTdoExpected, plvTdoMask ) )
+    {
+        plvTdoCaptured  = 0;
+        plvTdoExpected  = 0;
+    }
+
+    /* Broadcast:  compare every chain that has not failed yet */
+    ulPending   = 0;
+    if ( plvTdoExpected && ( xsvf_broadcast.iNumChains > 1 ) )
+    {
+        if ( xsvfBroadcastReserve( plvTdi->len ) )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        ulPending   = xsvf_broadcast.ulActive;
+    }
+
+    /* Retry history:  single-chain status checks only */
+    iLearn      = 0;
+    iFree       = 0;
+    lFileTime   = lRunTestTime;
+    if ( xsvfLearnEnabled() )
+    {
+        iLearn  = ( ucMaxRepeat && lRunTestTime && plvTdoExpected &&
+                    iExitShift && lNumBits && !ulPending &&
+                    ( ucStartState == XTAPSTATE_SHIFTDR ) );
+        xsvfLearnBegin( iLearn );
+        if ( ucStartState == XTAPSTATE_SHIFTIR )
+        {
+            xsvfLearnScan( ucStartState, plvTdi, 0, 0 );
+        }
+    }
+
     XSVFDBG_PRINTF1( 3, "   Shift Length = %ld\n", lNumBits );
     XSVFDBG_PRINTF( 4, "    TDI          = ");
     XSVFDBG_PRINTLENVAL( 4, plvTdi );
@@ -845,18 +1433,51 @@ int xsvfShift( unsigned char*   pucTapState,
     {
         do
         {
+            if ( ucRepeat )
+            {
+                ++xsvf_stats.lRetries;
+            }
+
             /* Goto Shift-DR or Shift-IR */
             xsvfGotoTapState( pucTapState, ucStartState );
 
             /* Shift TDI and capture TDO */
-            xsvfShiftOnly( lNumBits, plvTdi, plvTdoCaptured, iExitShift );
+            if ( ( iErrorCode = xsvfShiftOnly( lNumBits, plvTdi,
+                                               plvTdoCaptured, iExitShift ) ) )
+            {
+                /* Bits were dropped:  stop rather than go on */
+                return( iErrorCode );
+            }
 
-            if ( plvTdoExpected )
+            if ( ulPending )
+            {
+                /* Compare each chain; retry only the mismatching ones */
+                ulPending   = xsvfBroadcastCompare( plvTdoExpected,
+                                                    plvTdoCaptured,
+                                                    plvTdoMask, ulPending,
+                                                    &lMismatchBits,
+                                                    &lFirstMismatch );
+                iMismatch   = ( ulPending != 0 );
+            }
+            else if ( plvTdoExpected )
             {
                 /* Compare TDO data to expected TDO data */
-                iMismatch   = !EqualLenVal( plvTdoExpected,
-                                            plvTdoCaptured,
-                                            plvTdoMask );
+                lMismatchBits   = CompareLenVal( plvTdoExpected,
+                                                 plvTdoCaptured,
+                                                 plvTdoMask,
+                                                 &lFirstMismatch );
+                iMismatch       = ( lMismatchBits != 0 );
+                if ( xsvfLearnEnabled() )
+                {
+                    xsvfLearnScan( ucStartState, plvTdi, plvTdoCaptured,
+                                   plvTdoMask );
+                }
+            }
+
+            if ( iLearn )
+            {
+                /* This compare verifies the pulse before the shift */
+                iFree   = xsvfLearnVerified( iMismatch );
             }
 
             if ( iExitShift )
@@ -866,7 +1487,8 @@ int xsvfShift( unsigned char*   pucTapState,
                 XSVFDBG_PRINTF1( 3, "   TAP State = %s\n",
                                  xsvf_pzTapState[ *pucTapState ] );
 
-                if ( iMismatch && lRunTestTime && ( ucRepeat < ucMaxRepeat ) )
+                if ( iMismatch && lRunTestTime &&
+                     ( iFree || ( ucRepeat < ucMaxRepeat ) ) )
                 {
                     XSVFDBG_PRINTF( 4, "    TDO Expected = ");
                     XSVFDBG_PRINTLENVAL( 4, plvTdoExpected );
@@ -877,13 +1499,19 @@ int xsvfShift( unsigned char*   pucTapState,
                     XSVFDBG_PRINTF( 4, "    TDO Mask     = ");
                     XSVFDBG_PRINTLENVAL( 4, plvTdoMask );
                     XSVFDBG_PRINTF( 4, "\n");
-                    XSVFDBG_PRINTF1( 3, "   Retry #%d\n", ( ucRepeat + 1 ) );
+                    XSVFDBG_PRINTF3( 3, "   Retry #%d (%ld bits differ, first at bit %ld)\n",
+                                     ( ucRepeat + 1 ), lMismatchBits,
+                                     lFirstMismatch );
                     /* Do exception handling retry - ShiftDR only */
                     xsvfGotoTapState( pucTapState, XTAPSTATE_PAUSEDR );
                     /* Shift 1 extra bit */
                     xsvfGotoTapState( pucTapState, XTAPSTATE_SHIFTDR );
                     /* Increment RUNTEST time by an additional 25% */
-                    lRunTestTime    += ( lRunTestTime >> 2 );
+                    /* (not after an early pulse:  retry the file's time) */
+                    if ( !iFree )
+                    {
+                        lRunTestTime    += ( lRunTestTime >> 2 );
+                    }
                 }
                 else
                 {
@@ -895,24 +1523,44 @@ int xsvfShift( unsigned char*   pucTapState,
                 {
                     /* Wait for prespecified XRUNTEST time */
                     xsvfGotoTapState( pucTapState, XTAPSTATE_RUNTEST );
-                    XSVFDBG_PRINTF1( 3, "   Wait = %ld usec\n", lRunTestTime );
-                    waitTime( lRunTestTime );
+                    lWaitTime   = iLearn ? xsvfLearnPulse( lFileTime,
+                                                           lRunTestTime,
+                                                           !iMismatch )
+                                         : lRunTestTime;
+                    XSVFDBG_PRINTF1( 3, "   Wait = %ld usec\n", lWaitTime );
+                    waitTime( lWaitTime );
                 }
             }
-        } while ( iMismatch && ( ucRepeat++ < ucMaxRepeat ) );
+        } while ( iMismatch && ( iFree || ( ucRepeat++ < ucMaxRepeat ) ) );
     }
 
     if ( iMismatch )
     {
-        XSVFDBG_PRINTF( 1, " TDO Expected = ");
-        XSVFDBG_PRINTLENVAL( 1, plvTdoExpected );
-        XSVFDBG_PRINTF( 1, "\n");
-        XSVFDBG_PRINTF( 1, " TDO Captured = ");
-        XSVFDBG_PRINTLENVAL( 1, plvTdoCaptured );
-        XSVFDBG_PRINTF( 1, "\n");
-        XSVFDBG_PRINTF( 1, " TDO Mask     = ");
-        XSVFDBG_PRINTLENVAL( 1, plvTdoMask );
-        XSVFDBG_PRINTF( 1, "\n");
+        xsvf_stats.lMismatchBits    = lMismatchBits;
+        xsvf_stats.lFirstMismatch   = lFirstMismatch;
+        XSVFDBG_PRINTF3( 1, " TDO Mismatch = %ld of %ld bits, first at bit %ld\n",
+                         lMismatchBits, lNumBits, lFirstMismatch );
+        XSVFDBG_PRINTF( 4, "    TDO Expected = ");
+        XSVFDBG_PRINTLENVAL( 4, plvTdoExpected );
+        XSVFDBG_PRINTF( 4, "\n");
+        XSVFDBG_PRINTF( 4, "    TDO Captured = ");
+        XSVFDBG_PRINTLENVAL( 4, plvTdoCaptured );
+        XSVFDBG_PRINTF( 4, "\n");
+        XSVFDBG_PRINTF( 4, "    TDO Mask     = ");
+        XSVFDBG_PRINTLENVAL( 4, plvTdoMask );
+        XSVFDBG_PRINTF( 4, "\n");
+        if ( ulPending )
+        {
+            /* Mask the failed chains out and carry on with the others */
+            xsvf_broadcast.ulFailed |= ulPending;
+            xsvf_broadcast.ulActive &= ~ulPending;
+            XSVFDBG_PRINTF2( 1, " Broadcast chains 0x%lx failed, 0x%lx still active\n",
+                             ulPending, xsvf_broadcast.ulActive );
+            if ( xsvf_broadcast.ulActive )
+            {
+                return( XSVF_ERROR_NONE );
+            }
+        }
         if ( ucMaxRepeat && ( ucRepeat > ucMaxRepeat ) )
         {
             iErrorCode  = XSVF_ERROR_MAXRETRIES;
@@ -932,7 +1580,7 @@ int xsvfShift( unsigned char*   pucTapState,
 *               This is the common function for all XSDRTDO commands.
 * Parameters:   pucTapState         - Current TAP state.
 *               lShiftLengthBits    - number of bits to shift.
-*               sShiftLengthBytes   - number of bytes to read.
+*               lShiftLengthBytes   - number of bytes to read.
 *               plvTdi              - ptr to lenval for TDI data.
 *               lvTdoCaptured       - ptr to lenval for storing TDO data.
 *               iEndState           - state in which to end the shift.
@@ -942,7 +1590,7 @@ int xsvfShift( unsigned char*   pucTapState,
 *****************************************************************************/
 int xsvfBasicXSDRTDO( unsigned char*    pucTapState,
                       long              lShiftLengthBits,
-                      short             sShiftLengthBytes,
+                      long              lShiftLengthBytes,
                       lenVal*           plvTdi,
                       lenVal*           plvTdoCaptured,
                       lenVal*           plvTdoExpected,
@@ -951,10 +1599,10 @@ int xsvfBasicXSDRTDO( unsigned char*    pucTapState,
                       long              lRunTestTime,
                       unsigned char     ucMaxRepeat )
 {
-    readVal( plvTdi, sShiftLengthBytes );
+    readVal( plvTdi, lShiftLengthBytes );
     if ( plvTdoExpected )
     {
-        readVal( plvTdoExpected, sShiftLengthBytes );
+        readVal( plvTdoExpected, lShiftLengthBytes );
     }
     return( xsvfShift( pucTapState, XTAPSTATE_SHIFTDR, lShiftLengthBits,
                        plvTdi, plvTdoCaptured, plvTdoExpected, plvTdoMask,
@@ -962,78 +1610,209 @@ int xsvfBasicXSDRTDO( unsigned char*    pucTapState,
 }
 
 /*****************************************************************************
-* Function:     xsvfDoSDRMasking
-* Description:  Update the data value with the next XSDRINC data and address.
-* Example:      dataVal=0x01ff, nextData=0xab, addressMask=0x0100,
-*               dataMask=0x00ff, should set dataVal to 0x02ab
-* Parameters:   plvTdi          - The current TDI value.
-*               plvNextData     - the next data value.
+* Function:     xsvfCountBits
+* Description:  Count the 1 bits of a byte.
+* Parameters:   ucByte  - the byte.
+* Returns:      unsigned char   - the number of 1 bits.
+*****************************************************************************/
+#ifdef  XSVF_SUPPORT_COMPRESSION
+static unsigned char xsvfCountBits( unsigned char ucByte )
+{
+    unsigned char   ucCount;
+
+    for ( ucCount = 0; ucByte; ucByte &= (unsigned char)( ucByte - 1 ) )
+    {
+        ++ucCount;
+    }
+    return( ucCount );
+}
+
+/*****************************************************************************
+* Function:     xsvfSdrMapBuild
+* Description:  Compile the XSETSDRMASKS masks for xsvfDoSDRMasking():
+*               count the data mask bits once, record which TDI bytes take
+*               which next-data bits, and find the span of address bytes.
+* Parameters:   pMap            - the map to (re)build.
 *               plvAddressMask  - the address mask.
 *               plvDataMask     - the data mask.
-* Returns:      void.
+* Returns:      int             - 0 = success; otherwise
+*                                 XSVF_ERROR_DATAOVERFLOW.
 *****************************************************************************/
-#ifdef  XSVF_SUPPORT_COMPRESSION
-void xsvfDoSDRMasking( lenVal*  plvTdi,
-                       lenVal*  plvNextData,
-                       lenVal*  plvAddressMask,
-                       lenVal*  plvDataMask )
+int xsvfSdrMapBuild( SXsvfSdrMap*   pMap,
+                     lenVal*        plvAddressMask,
+                     lenVal*        plvDataMask )
 {
-    int             i;
-    unsigned char   ucTdi;
-    unsigned char   ucTdiMask;
-    unsigned char   ucDataMask;
-    unsigned char   ucNextData;
-    unsigned char   ucNextMask;
-    short           sNextData;
-
-    /* add the address Mask to dataVal and return as a new dataVal */
-    addVal( plvTdi, plvTdi, plvAddressMask );
-
-    ucNextData  = 0;
-    ucNextMask  = 0;
-    sNextData   = plvNextData->len;
+    SXsvfSdrScatter*    pScatter;
+    unsigned char       ucMask;
+    long                i;
+
+    if ( pMap->lMaxScatter < plvDataMask->len )
+    {
+        pScatter    = (SXsvfSdrScatter*)realloc( pMap->pScatter,
+                        plvDataMask->len * sizeof( SXsvfSdrScatter ) );
+        if ( !pScatter )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        pMap->pScatter      = pScatter;
+        pMap->lMaxScatter   = plvDataMask->len;
+    }
+
+    /* Next data is consumed from the lsb of the last data mask byte up */
+    pMap->lDataBits     = 0;
+    pMap->lNumScatter   = 0;
     for ( i = plvDataMask->len - 1; i >= 0; --i )
     {
-        /* Go through data mask in reverse order looking for mask (1) bits */
-        ucDataMask  = plvDataMask->val[ i ];
-        if ( ucDataMask )
+        ucMask  = plvDataMask->val[ i ];
+        if ( ucMask )
         {
-            /* Retrieve the corresponding TDI byte value */
-            ucTdi       = plvTdi->val[ i ];
+            pScatter    = pMap->pScatter + pMap->lNumScatter++;
+            pScatter->lByte     = i;
+            pScatter->lDataBit  = pMap->lDataBits;
+            pScatter->ucMask    = ucMask;
+            pScatter->ucNumBits = xsvfCountBits( ucMask );
+            pScatter->ucLowBits = xsvfCountBits( ucMask & 0x0F );
+            pMap->lDataBits     += pScatter->ucNumBits;
+        }
+    }
 
-            /* For each bit in the data mask byte, look for 1's */
-            ucTdiMask   = 1;
-            while ( ucDataMask )
+    pMap->lAddrFirst    = -1;
+    pMap->lAddrLast     = -1;
+    for ( i = 0; i < plvAddressMask->len; ++i )
+    {
+        if ( plvAddressMask->val[ i ] )
+        {
+            if ( pMap->lAddrFirst < 0 )
             {
-                if ( ucDataMask & 1 )
-                {
-                    if ( !ucNextMask )
-                    {
-                        /* Get the next data byte */
-                        ucNextData  = plvNextData->val[ --sNextData ];
-                        ucNextMask  = 1;
-                    }
+                pMap->lAddrFirst    = i;
+            }
+            pMap->lAddrLast = i;
+        }
+    }
 
-                    /* Set or clear the data bit according to the next data */
-                    if ( ucNextData & ucNextMask )
-                    {
-                        ucTdi   |= ucTdiMask;       /* Set bit */
-                    }
-                    else
-                    {
-                        ucTdi   &= ( ~ucTdiMask );  /* Clear bit */
-                    }
+    return( XSVF_ERROR_NONE );
+}
 
-                    /* Update the next data */
-                    ucNextMask  <<= 1;
-                }
-                ucTdiMask   <<= 1;
-                ucDataMask  >>= 1;
-            }
+/*****************************************************************************
+* Function:     xsvfSdrMapFree
+* Description:  Release the scatter entries of an XSDRINC map.
+* Parameters:   pMap    - the map.
+* Returns:      void.
+*****************************************************************************/
+void xsvfSdrMapFree( SXsvfSdrMap* pMap )
+{
+    free( pMap->pScatter );
+    pMap->pScatter      = 0;
+    pMap->lMaxScatter   = 0;
+    pMap->lNumScatter   = 0;
+}
+
+/*****************************************************************************
+* Function:     xsvfDeposit
+* Description:  Deposit the low bits of ucBits into the 1 bits of ucMask,
+*               lsb first (the x86 BMI2 PDEP operation).  Without BMI2 each
+*               nibble of the mask is looked up in xsvf_aucDeposit.
+* Parameters:   ucBits      - the bits to deposit.
+*               pScatter    - the scatter entry with the mask.
+* Returns:      unsigned char   - the deposited bits.
+*****************************************************************************/
+#if !defined( __BMI2__ )
+/* xsvf_aucDeposit[ mask nibble ][ bits ] */
+static const unsigned char xsvf_aucDeposit[ 16 ][ 16 ] =
+{
+    { 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0 },
+    { 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1, 0x0, 0x1 },
+    { 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2, 0x0, 0x2 },
+    { 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3, 0x0, 0x1, 0x2, 0x3 },
+    { 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4, 0x0, 0x4 },
+    { 0x0, 0x1, 0x4, 0x5, 0x0, 0x1, 0x4, 0x5, 0x0, 0x1, 0x4, 0x5, 0x0, 0x1, 0x4, 0x5 },
+    { 0x0, 0x2, 0x4, 0x6, 0x0, 0x2, 0x4, 0x6, 0x0, 0x2, 0x4, 0x6, 0x0, 0x2, 0x4, 0x6 },
+    { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7 },
+    { 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8, 0x0, 0x8 },
+    { 0x0, 0x1, 0x8, 0x9, 0x0, 0x1, 0x8, 0x9, 0x0, 0x1, 0x8, 0x9, 0x0, 0x1, 0x8, 0x9 },
+    { 0x0, 0x2, 0x8, 0xA, 0x0, 0x2, 0x8, 0xA, 0x0, 0x2, 0x8, 0xA, 0x0, 0x2, 0x8, 0xA },
+    { 0x0, 0x1, 0x2, 0x3, 0x8, 0x9, 0xA, 0xB, 0x0, 0x1, 0x2, 0x3, 0x8, 0x9, 0xA, 0xB },
+    { 0x0, 0x4, 0x8, 0xC, 0x0, 0x4, 0x8, 0xC, 0x0, 0x4, 0x8, 0xC, 0x0, 0x4, 0x8, 0xC },
+    { 0x0, 0x1, 0x4, 0x5, 0x8, 0x9, 0xC, 0xD, 0x0, 0x1, 0x4, 0x5, 0x8, 0x9, 0xC, 0xD },
+    { 0x0, 0x2, 0x4, 0x6, 0x8, 0xA, 0xC, 0xE, 0x0, 0x2, 0x4, 0x6, 0x8, 0xA, 0xC, 0xE },
+    { 0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0xA, 0xB, 0xC, 0xD, 0xE, 0xF }
+};
+#endif  /* !__BMI2__ */
+
+static unsigned char xsvfDeposit( unsigned char             ucBits,
+                                  const SXsvfSdrScatter*    pScatter )
+{
+#if defined( __BMI2__ )
+    return( (unsigned char)_pdep_u32( ucBits, pScatter->ucMask ) );
+#else   /* !__BMI2__ */
+    return( (unsigned char)( xsvf_aucDeposit[ pScatter->ucMask & 0x0F ]
+                                            [ ucBits & 0x0F ] |
+             ( xsvf_aucDeposit[ pScatter->ucMask >> 4 ]
+                              [ ( ucBits >> pScatter->ucLowBits ) & 0x0F ]
+               << 4 ) ) );
+#endif  /* __BMI2__ */
+}
+
+/*****************************************************************************
+* Function:     xsvfDoSDRMasking
+* Description:  Update the data value with the next XSDRINC data and address.
+*               The address add stops where the carry does; the next data
+*               bits are deposited one TDI byte at a time (see
+*               xsvfSdrMapBuild()).
+* Example:      dataVal=0x01ff, nextData=0xab, addressMask=0x0100,
+*               dataMask=0x00ff, should set dataVal to 0x02ab
+* Parameters:   plvTdi          - The current TDI value.
+*               plvNextData     - the next data value.
+*               plvAddressMask  - the address mask.
+*               pMap            - the masks compiled by xsvfSdrMapBuild().
+* Returns:      void.
+*****************************************************************************/
+void xsvfDoSDRMasking( lenVal*      plvTdi,
+                       lenVal*      plvNextData,
+                       lenVal*      plvAddressMask,
+                       SXsvfSdrMap* pMap )
+{
+    SXsvfSdrScatter*    pScatter;
+    SXsvfSdrScatter*    pScatterEnd;
+    unsigned short      usSum;
+    unsigned short      usNextData;
+    unsigned char       ucCarry;
+    long                lIndex;
+    long                lByte;
+
+    /* add the address Mask to dataVal, from its last non-zero byte */
+    ucCarry = 0;
+    lIndex  = pMap->lAddrLast;
+    if ( lIndex >= plvTdi->len )
+    {
+        lIndex  = plvTdi->len - 1;
+    }
+    for ( ; ( lIndex >= 0 ) && ( ucCarry || ( lIndex >= pMap->lAddrFirst ) );
+          --lIndex )
+    {
+        usSum   = (unsigned short)( plvTdi->val[ lIndex ] +
+                                    plvAddressMask->val[ lIndex ] + ucCarry );
+        ucCarry = (unsigned char)( usSum >> 8 );
+        plvTdi->val[ lIndex ]   = (unsigned char)usSum;
+    }
 
-            /* Update the TDI value */
-            plvTdi->val[ i ]    = ucTdi;
+    pScatterEnd = pMap->pScatter + pMap->lNumScatter;
+    for ( pScatter = pMap->pScatter; pScatter < pScatterEnd; ++pScatter )
+    {
+        /* The next data bits for this byte, from at most two bytes */
+        lByte       = plvNextData->len - 1 - ( pScatter->lDataBit >> 3 );
+        usNextData  = plvNextData->val[ lByte ];
+        if ( lByte > 0 )
+        {
+            usNextData  |= (unsigned short)( plvNextData->val[ lByte - 1 ] << 8 );
         }
+        usNextData  >>= ( pScatter->lDataBit & 7 );
+
+        plvTdi->val[ pScatter->lByte ]  =
+            (unsigned char)( ( plvTdi->val[ pScatter->lByte ] &
+                               ~pScatter->ucMask ) |
+                             xsvfDeposit( (unsigned char)usNextData,
+                                          pScatter ) );
     }
 }
 #endif  /* XSVF_SUPPORT_COMPRESSION */
@@ -1084,7 +1863,7 @@ int xsvfDoXCOMPLETE( SXsvfInfo* pXsvfInfo )
 *****************************************************************************/
 int xsvfDoXTDOMASK( SXsvfInfo* pXsvfInfo )
 {
-    readVal( &(pXsvfInfo->lvTdoMask), pXsvfInfo->sShiftLengthBytes );
+    readVal( &(pXsvfInfo->lvTdoMask), pXsvfInfo->lShiftLengthBytes );
     XSVFDBG_PRINTF( 4, "    TDO Mask     = ");
     XSVFDBG_PRINTLENVAL( 4, &(pXsvfInfo->lvTdoMask) );
     XSVFDBG_PRINTF( 4, "\n");
@@ -1103,20 +1882,17 @@ int xsvfDoXTDOMASK( SXsvfInfo* pXsvfInfo )
 int xsvfDoXSIR( SXsvfInfo* pXsvfInfo )
 {
     unsigned char   ucShiftIrBits;
-    short           sShiftIrBytes;
+    long            lShiftIrBytes;
     int             iErrorCode;
 
     /* Get the shift length and store */
     readByte( &ucShiftIrBits );
-    sShiftIrBytes   = xsvfGetAsNumBytes( ucShiftIrBits );
+    lShiftIrBytes   = xsvfGetAsNumBytes( ucShiftIrBits );
     XSVFDBG_PRINTF1( 3, "   XSIR length = %d\n",
                      ((unsigned int)ucShiftIrBits) );
 
-    if ( sShiftIrBytes > MAX_LEN )
-    {
-        iErrorCode  = XSVF_ERROR_DATAOVERFLOW;
-    }
-    else
+    iErrorCode  = xsvfInfoReserve( pXsvfInfo, lShiftIrBytes );
+    if ( iErrorCode == XSVF_ERROR_NONE )
     {
         /* Get and store instruction to shift in */
         readVal( &(pXsvfInfo->lvTdi), xsvfGetAsNumBytes( ucShiftIrBits ) );
@@ -1148,20 +1924,17 @@ int xsvfDoXSIR( SXsvfInfo* pXsvfInfo )
 int xsvfDoXSIR2( SXsvfInfo* pXsvfInfo )
 {
     long            lShiftIrBits;
-    short           sShiftIrBytes;
+    long            lShiftIrBytes;
     int             iErrorCode;
 
     /* Get the shift length and store */
     readVal( &(pXsvfInfo->lvTdi), 2 );
     lShiftIrBits    = value( &(pXsvfInfo->lvTdi) );
-    sShiftIrBytes   = xsvfGetAsNumBytes( lShiftIrBits );
-    XSVFDBG_PRINTF1( 3, "   XSIR2 length = %d\n", lShiftIrBits);
+    lShiftIrBytes   = xsvfGetAsNumBytes( lShiftIrBits );
+    XSVFDBG_PRINTF1( 3, "   XSIR2 length = %ld\n", lShiftIrBits);
 
-    if ( sShiftIrBytes > MAX_LEN )
-    {
-        iErrorCode  = XSVF_ERROR_DATAOVERFLOW;
-    }
-    else
+    iErrorCode  = xsvfInfoReserve( pXsvfInfo, lShiftIrBytes );
+    if ( iErrorCode == XSVF_ERROR_NONE )
     {
         /* Get and store instruction to shift in */
         readVal( &(pXsvfInfo->lvTdi), xsvfGetAsNumBytes( lShiftIrBits ) );
@@ -1194,7 +1967,7 @@ int xsvfDoXSIR2( SXsvfInfo* pXsvfInfo )
 int xsvfDoXSDR( SXsvfInfo* pXsvfInfo )
 {
     int iErrorCode;
-    readVal( &(pXsvfInfo->lvTdi), pXsvfInfo->sShiftLengthBytes );
+    readVal( &(pXsvfInfo->lvTdi), pXsvfInfo->lShiftLengthBytes );
     /* use TDOExpected from last XSDRTDO instruction */
     iErrorCode  = xsvfShift( &(pXsvfInfo->ucTapState), XTAPSTATE_SHIFTDR,
                              pXsvfInfo->lShiftLengthBits, &(pXsvfInfo->lvTdi),
@@ -1243,6 +2016,8 @@ int xsvfDoXREPEAT( SXsvfInfo* pXsvfInfo )
 * Function:     xsvfDoXSDRSIZE
 * Description:  XSDRSIZE <uint32>
 *               Prespecify the XRUNTEST wait time for shift operations.
+*               A length that is negative (>= 2^31 with a 32-bit long) or
+*               over LENVAL_MAX_BYTES is XSVF_ERROR_DATAOVERFLOW.
 * Parameters:   pXsvfInfo   - XSVF information pointer.
 * Returns:      int         - 0 = success;  non-zero = error.
 *****************************************************************************/
@@ -1252,11 +2027,18 @@ int xsvfDoXSDRSIZE( SXsvfInfo* pXsvfInfo )
     iErrorCode  = XSVF_ERROR_NONE;
     readVal( &(pXsvfInfo->lvTdi), 4 );
     pXsvfInfo->lShiftLengthBits = value( &(pXsvfInfo->lvTdi) );
-    pXsvfInfo->sShiftLengthBytes= xsvfGetAsNumBytes( pXsvfInfo->lShiftLengthBits );
     XSVFDBG_PRINTF1( 3, "   XSDRSIZE = %ld\n", pXsvfInfo->lShiftLengthBits );
-    if ( pXsvfInfo->sShiftLengthBytes > MAX_LEN )
+    if ( ( pXsvfInfo->lShiftLengthBits < 0 ) ||
+         ( pXsvfInfo->lShiftLengthBits > LENVAL_MAX_BYTES * 8 ) )
+    {
+        pXsvfInfo->lShiftLengthBits = 0;
+        pXsvfInfo->iErrorCode       = XSVF_ERROR_DATAOVERFLOW;
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+    pXsvfInfo->lShiftLengthBytes= xsvfGetAsNumBytes( pXsvfInfo->lShiftLengthBits );
+    iErrorCode  = xsvfInfoReserve( pXsvfInfo, pXsvfInfo->lShiftLengthBytes );
+    if ( iErrorCode != XSVF_ERROR_NONE )
     {
-        iErrorCode  = XSVF_ERROR_DATAOVERFLOW;
         pXsvfInfo->iErrorCode   = iErrorCode;
     }
     return( iErrorCode );
@@ -1276,7 +2058,7 @@ int xsvfDoXSDRTDO( SXsvfInfo* pXsvfInfo )
     int iErrorCode;
     iErrorCode  = xsvfBasicXSDRTDO( &(pXsvfInfo->ucTapState),
                                     pXsvfInfo->lShiftLengthBits,
-                                    pXsvfInfo->sShiftLengthBytes,
+                                    pXsvfInfo->lShiftLengthBytes,
                                     &(pXsvfInfo->lvTdi),
                                     &(pXsvfInfo->lvTdoCaptured),
                                     &(pXsvfInfo->lvTdoExpected),
@@ -1296,7 +2078,7 @@ int xsvfDoXSDRTDO( SXsvfInfo* pXsvfInfo )
 * Description:  XSETSDRMASKS <lenVal.AddressMask[XSDRSIZE]>
 *                            <lenVal.DataMask[XSDRSIZE]>
 *               Get the prespecified address and data mask for the XSDRINC
-*               command.
+*               command and compile them for xsvfDoSDRMasking().
 *               Used for xc9500/xl compressed XSVF data.
 * Parameters:   pXsvfInfo   - XSVF information pointer.
 * Returns:      int         - 0 = success;  non-zero = error.
@@ -1304,10 +2086,12 @@ int xsvfDoXSDRTDO( SXsvfInfo* pXsvfInfo )
 #ifdef  XSVF_SUPPORT_COMPRESSION
 int xsvfDoXSETSDRMASKS( SXsvfInfo* pXsvfInfo )
 {
+    int iErrorCode;
+
     /* read the addressMask */
-    readVal( &(pXsvfInfo->lvAddressMask), pXsvfInfo->sShiftLengthBytes );
+    readVal( &(pXsvfInfo->lvAddressMask), pXsvfInfo->lShiftLengthBytes );
     /* read the dataMask    */
-    readVal( &(pXsvfInfo->lvDataMask), pXsvfInfo->sShiftLengthBytes );
+    readVal( &(pXsvfInfo->lvDataMask), pXsvfInfo->lShiftLengthBytes );
 
     XSVFDBG_PRINTF( 4, "    Address Mask = " );
     XSVFDBG_PRINTLENVAL( 4, &(pXsvfInfo->lvAddressMask) );
@@ -1316,7 +2100,14 @@ int xsvfDoXSETSDRMASKS( SXsvfInfo* pXsvfInfo )
     XSVFDBG_PRINTLENVAL( 4, &(pXsvfInfo->lvDataMask) );
     XSVFDBG_PRINTF( 4, "\n" );
 
-    return( XSVF_ERROR_NONE );
+    iErrorCode  = xsvfSdrMapBuild( &(pXsvfInfo->sdrMap),
+                                   &(pXsvfInfo->lvAddressMask),
+                                   &(pXsvfInfo->lvDataMask) );
+    if ( iErrorCode != XSVF_ERROR_NONE )
+    {
+        pXsvfInfo->iErrorCode   = iErrorCode;
+    }
+    return( iErrorCode );
 }
 #endif  /* XSVF_SUPPORT_COMPRESSION */
 
@@ -1340,12 +2131,10 @@ int xsvfDoXSETSDRMASKS( SXsvfInfo* pXsvfInfo )
 int xsvfDoXSDRINC( SXsvfInfo* pXsvfInfo )
 {
     int             iErrorCode;
-    int             iDataMaskLen;
-    unsigned char   ucDataMask;
     unsigned char   ucNumTimes;
     unsigned char   i;
 
-    readVal( &(pXsvfInfo->lvTdi), pXsvfInfo->sShiftLengthBytes );
+    readVal( &(pXsvfInfo->lvTdi), pXsvfInfo->lShiftLengthBytes );
     iErrorCode  = xsvfShift( &(pXsvfInfo->ucTapState), XTAPSTATE_SHIFTDR,
                              pXsvfInfo->lShiftLengthBits,
                              &(pXsvfInfo->lvTdi), &(pXsvfInfo->lvTdoCaptured),
@@ -1354,18 +2143,6 @@ int xsvfDoXSDRINC( SXsvfInfo* pXsvfInfo )
                              pXsvfInfo->lRunTestTime, pXsvfInfo->ucMaxRepeat );
     if ( !iErrorCode )
     {
-        /* Calculate number of data mask bits */
-        iDataMaskLen    = 0;
-        for ( i = 0; i < pXsvfInfo->lvDataMask.len; ++i )
-        {
-            ucDataMask  = pXsvfInfo->lvDataMask.val[ i ];
-            while ( ucDataMask )
-            {
-                iDataMaskLen    += ( ucDataMask & 1 );
-                ucDataMask      >>= 1;
-            }
-        }
-
         /* Get the number of data pieces, i.e. number of times to shift */
         readByte( &ucNumTimes );
 
@@ -1373,11 +2150,11 @@ int xsvfDoXSDRINC( SXsvfInfo* pXsvfInfo )
         for ( i = 0; !iErrorCode && ( i < ucNumTimes ); ++i )
         {
             readVal( &(pXsvfInfo->lvNextData),
-                     xsvfGetAsNumBytes( iDataMaskLen ) );
+                     xsvfGetAsNumBytes( pXsvfInfo->sdrMap.lDataBits ) );
             xsvfDoSDRMasking( &(pXsvfInfo->lvTdi),
                               &(pXsvfInfo->lvNextData),
                               &(pXsvfInfo->lvAddressMask),
-                              &(pXsvfInfo->lvDataMask) );
+                              &(pXsvfInfo->sdrMap) );
             iErrorCode  = xsvfShift( &(pXsvfInfo->ucTapState),
                                      XTAPSTATE_SHIFTDR,
                                      pXsvfInfo->lShiftLengthBits,
@@ -1417,7 +2194,7 @@ int xsvfDoXSDRBCE( SXsvfInfo* pXsvfInfo )
                                 pXsvfInfo->ucEndDR : XTAPSTATE_SHIFTDR);
     iErrorCode  = xsvfBasicXSDRTDO( &(pXsvfInfo->ucTapState),
                                     pXsvfInfo->lShiftLengthBits,
-                                    pXsvfInfo->sShiftLengthBytes,
+                                    pXsvfInfo->lShiftLengthBytes,
                                     &(pXsvfInfo->lvTdi),
                                     /*plvTdoCaptured*/0, /*plvTdoExpected*/0,
                                     /*plvTdoMask*/0, ucEndDR,
@@ -1448,7 +2225,7 @@ int xsvfDoXSDRTDOBCE( SXsvfInfo* pXsvfInfo )
                                 pXsvfInfo->ucEndDR : XTAPSTATE_SHIFTDR);
     iErrorCode  = xsvfBasicXSDRTDO( &(pXsvfInfo->ucTapState),
                                     pXsvfInfo->lShiftLengthBits,
-                                    pXsvfInfo->sShiftLengthBytes,
+                                    pXsvfInfo->lShiftLengthBytes,
                                     &(pXsvfInfo->lvTdi),
                                     &(pXsvfInfo->lvTdoCaptured),
                                     &(pXsvfInfo->lvTdoExpected),
@@ -1545,6 +2322,7 @@ int xsvfDoXENDXR( SXsvfInfo* pXsvfInfo )
 * Description:  XCOMMENT <text string ending in \0>
 *               <text string ending in \0> == text comment;
 *               Arbitrary comment embedded in the XSVF.
+*               A "FREQUENCY f HZ;" comment starts the next -tck phase.
 * Parameters:   pXsvfInfo   - XSVF information pointer.
 * Returns:      int         - 0 = success;  non-zero = error.
 *****************************************************************************/
@@ -1553,12 +2331,15 @@ int xsvfDoXCOMMENT( SXsvfInfo* pXsvfInfo )
     /* Use the comment for debugging */
     /* Otherwise, read through the comment to the end '\0' and ignore */
     unsigned char   ucText;
+    char            szText[ 64 ];   /* enough for a FREQUENCY statement */
+    int             iLength;
 
     if ( xsvf_iDebugLevel > 0 )
     {
         putchar( ' ' );
     }
 
+    iLength = 0;
     do
     {
         readByte( &ucText );
@@ -1566,7 +2347,13 @@ int xsvfDoXCOMMENT( SXsvfInfo* pXsvfInfo )
         {
             putchar( ucText ? ucText : '\n' );
         }
+        if ( iLength < (int)sizeof( szText ) - 1 )
+        {
+            szText[ iLength++ ] = (char)ucText;
+        }
     } while ( ucText );
+    szText[ iLength ] = 0;
+    portsPaceComment( portsCurrent(), szText );
 
     pXsvfInfo->iErrorCode   = XSVF_ERROR_NONE;
 
@@ -1663,6 +2450,8 @@ int xsvfInitialize( SXsvfInfo* pXsvfInfo )
 *****************************************************************************/
 int xsvfRun( SXsvfInfo* pXsvfInfo )
 {
+    long long   llStartNs;
+
     /* Process the XSVF commands */
     if ( (!pXsvfInfo->iErrorCode) && (!pXsvfInfo->ucComplete) )
     {
@@ -1670,20 +2459,33 @@ int xsvfRun( SXsvfInfo* pXsvfInfo )
         readByte( &(pXsvfInfo->ucCommand) );
         ++(pXsvfInfo->lCommandCount);
 
-        if ( pXsvfInfo->ucCommand < XLASTCMD )
+        if ( readEOF() )
+        {
+            /* Ran out of data without an XCOMPLETE */
+            pXsvfInfo->iErrorCode   = XSVF_ERROR_TRUNCATED;
+        }
+        else if ( pXsvfInfo->ucCommand < XLASTCMD )
         {
             /* Execute the command.  Func sets error code. */
             XSVFDBG_PRINTF1( 2, "  %s\n",
                              xsvf_pzCommandName[pXsvfInfo->ucCommand] );
             /* If your compiler cannot take this form,
                then convert to a switch statement */
+            llStartNs   = xsvfStatsNow();
             xsvf_pfDoCmd[ pXsvfInfo->ucCommand ]( pXsvfInfo );
+            xsvfStatsCommand( pXsvfInfo->ucCommand, llStartNs );
         }
         else
         {
             /* Illegal command value.  Func sets error code. */
             xsvfDoIllegalCmd( pXsvfInfo );
         }
+
+        if ( !pXsvfInfo->iErrorCode && readEOF() )
+        {
+            /* Command parameters were cut short */
+            pXsvfInfo->iErrorCode   = XSVF_ERROR_TRUNCATED;
+        }
     }
 
     return( pXsvfInfo->iErrorCode );
@@ -1705,6 +2507,26 @@ void xsvfCleanup( SXsvfInfo* pXsvfInfo )
 * xsvfExecute() - The primary entry point to the XSVF player
 ============================================================================*/
 
+/*****************************************************************************
+* Function:     xsvfReportSuccess
+* Description:  Print the SUCCESS line of a run.  A broadcast run holds it
+*               back:  xsvfExecuteInput() prints it, or a FAILURE line,
+*               once the failed chains are known.
+* Parameters:   pzWhat  - what was completed, e.g. "XSVF execution".
+* Returns:      void.
+*****************************************************************************/
+static void xsvfReportSuccess( const char* pzWhat )
+{
+    if ( xsvf_broadcast.iNumChains > 1 )
+    {
+        xsvf_broadcast.pzCompleted  = pzWhat;
+    }
+    else
+    {
+        XSVFDBG_PRINTF1( 0, "SUCCESS - Completed %s.\n", pzWhat );
+    }
+}
+
 /*****************************************************************************
 * Function:     xsvfExecute
 * Description:  Process, interpret, and apply the XSVF commands.
@@ -1733,7 +2555,7 @@ int xsvfExecute()
     }
     else
     {
-        XSVFDBG_PRINTF( 0, "SUCCESS - Completed XSVF execution.\n" );
+        xsvfReportSuccess( "XSVF execution" );
     }
 
     xsvfCleanup( &xsvfInfo );
@@ -1742,6 +2564,437 @@ int xsvfExecute()
 }
 
 
+/*****************************************************************************
+* Function:     xsvfExecutePlan
+* Description:  Replay a compiled XSVF execution plan (see xsvfplan.h) and
+*               report the result the same way as xsvfExecute().
+* Parameters:   pPlan   - the compiled or loaded plan.
+* Returns:      int     - For error codes see micro.h.
+*****************************************************************************/
+int xsvfExecutePlan( SXsvfPlan* pPlan )
+{
+    int     iErrorCode;
+    long    lCommand;
+
+    iErrorCode  = xsvfPlanRun( pPlan, &lCommand );
+    if ( iErrorCode )
+    {
+        XSVFDBG_PRINTF1( 0, "%s\n", xsvf_pzErrorName[
+                         ( iErrorCode < XSVF_ERROR_LAST )
+                         ? iErrorCode : XSVF_ERROR_UNKNOWN ] );
+        XSVFDBG_PRINTF2( 0, "ERROR at or near XSVF command #%ld.  See line #%ld in the XSVF ASCII file.\n",
+                         lCommand, lCommand );
+    }
+    else
+    {
+        xsvfReportSuccess( "XSVF execution" );
+    }
+
+    return( XSVF_ERRORCODE(iErrorCode) );
+}
+
+/*****************************************************************************
+* Function:     xsvfSniffInput
+* Description:  Look at the first bytes of the input to tell its format.
+*               Nothing is consumed; a short file is looked at as far as
+*               it goes.
+* Parameters:   pInput  - the opened file.
+*               lWant   - bytes wanted.
+*               plSize  - receives the bytes available, up to lWant.
+* Returns:      const unsigned char*    - the bytes, or 0 if none.
+*****************************************************************************/
+static const unsigned char* xsvfSniffInput( SXsvfInput* pInput,
+                                            long        lWant,
+                                            long*       plSize )
+{
+    const unsigned char*    pucData;
+
+    pucData = inputRemaining( pInput, plSize );
+    if ( pucData )
+    {
+        if ( *plSize > lWant )
+        {
+            *plSize = lWant;
+        }
+        return( pucData );
+    }
+    for ( *plSize = lWant; *plSize; *plSize /= 2 )
+    {
+        pucData = inputPeek( pInput, *plSize );
+        if ( pucData )
+        {
+            return( pucData );
+        }
+    }
+    return( 0 );
+}
+
+/*****************************************************************************
+* Function:     xsvfExecuteBitstream
+* Description:  Configure an FPGA from a .bit or .bin file (see bitfile.h)
+*               and report the result the same way as xsvfExecute().
+* Parameters:   pInput  - the opened bitstream file.
+* Returns:      int     - For error codes see micro.h.
+*****************************************************************************/
+static int xsvfExecuteBitstream( SXsvfInput* pInput )
+{
+    int     iErrorCode;
+
+    iErrorCode  = bitRun( pInput, &bit_config );
+    if ( iErrorCode )
+    {
+        XSVFDBG_PRINTF1( 0, "%s\n", xsvf_pzErrorName[
+                         ( iErrorCode < XSVF_ERROR_LAST )
+                         ? iErrorCode : XSVF_ERROR_UNKNOWN ] );
+        XSVFDBG_PRINTF1( 0, "ERROR at or near bitstream byte %ld.\n",
+                         inputOffset( pInput ) );
+    }
+    else
+    {
+        xsvfReportSuccess( "bitstream configuration" );
+    }
+
+    return( XSVF_ERRORCODE(iErrorCode) );
+}
+
+/*****************************************************************************
+* Function:     xsvfExecuteSvf
+* Description:  Play SVF text (see svf.h) and report the result the same
+*               way as xsvfExecute().
+* Parameters:   pInput  - the opened SVF file.
+* Returns:      int     - For error codes see micro.h.
+*****************************************************************************/
+static int xsvfExecuteSvf( SXsvfInput* pInput )
+{
+    int     iErrorCode;
+    long    lLine;
+
+    iErrorCode  = svfRun( pInput, &lLine );
+    if ( iErrorCode )
+    {
+        XSVFDBG_PRINTF1( 0, "%s\n", xsvf_pzErrorName[
+                         ( iErrorCode < XSVF_ERROR_LAST )
+                         ? iErrorCode : XSVF_ERROR_UNKNOWN ] );
+        XSVFDBG_PRINTF1( 0, "ERROR at or near SVF line %ld.\n", lLine );
+    }
+    else
+    {
+        xsvfReportSuccess( "SVF execution" );
+    }
+
+    return( XSVF_ERRORCODE(iErrorCode) );
+}
+
+/*****************************************************************************
+* Function:     xsvfRtReport
+* Description:  Print the -rt scheduling results of this thread's run.
+* Parameters:   none.
+* Returns:      void.
+*****************************************************************************/
+static void xsvfRtReport()
+{
+    const SRtStats* pRt = rtStats();
+
+    XSVFDBG_PRINTF3( 0, "Realtime: CPU %d, SCHED_FIFO %s, memory %s\n",
+                     pRt->iCpu, pRt->iFifo ? "on" : "refused",
+                     pRt->iLocked ? "locked" : "not locked" );
+    XSVFDBG_PRINTF3( 0, "Realtime: %ld sleeps (%ld at normal priority); wake-up latency avg %ld usec",
+                     pRt->lSleeps, pRt->lDemoted,
+                     (long)( pRt->lSleeps
+                             ? pRt->llWakeNs / pRt->lSleeps / 1000 : 0 ) );
+    XSVFDBG_PRINTF1( 0, ", max %ld usec\n", (long)( pRt->llMaxWakeNs / 1000 ) );
+    XSVFDBG_PRINTF3( 0, "Realtime: %ld involuntary context switches; page faults %ld major, %ld minor\n",
+                     pRt->lInvoluntary, pRt->lMajorFaults, pRt->lMinorFaults );
+}
+
+/*****************************************************************************
+* Function:     xsvfExecuteInput
+* Description:  Play an XSVF or SVF file, replay a plan file, or load a
+*               .bit/.bin bitstream, from pInput on the current port and
+*               report like xsvfExecute().
+*               Each chain of a multi-chain run (xsvfmulti.c) calls this on
+*               its own thread.
+* Parameters:   pInput  - the opened XSVF, SVF, plan or bitstream file.
+* Returns:      int     - XSVF_ERROR_*; see micro.h.
+*****************************************************************************/
+int xsvfExecuteInput( SXsvfInput* pInput )
+{
+    SXsvfPlan               plan;
+    const unsigned char*    pucData;
+    const unsigned char*    pucHead;
+    long                    lSize;
+    long                    lHeadSize;
+    int                     iResult;
+    int                     iChain;
+    int                     iChainText;
+    char                    szChains[ 128 ];
+
+    /* read from the XSVF file instead of a real prom */
+    in  = pInput;
+
+    /* -rt:  pin, lock and raise this thread for the whole run */
+    rtEnter();
+
+    /* Retry history:  the device is found again in each file */
+    xsvfLearnStart();
+
+    /* Broadcast:  one TDO per chain, all of them active */
+    memset( &xsvf_broadcast, 0, sizeof( xsvf_broadcast ) );
+    xsvf_broadcast.iNumChains   = portsCurrent()->iNumTdo;
+    if ( xsvf_broadcast.iNumChains > 1 )
+    {
+        xsvf_broadcast.ulActive = ( xsvf_broadcast.iNumChains < 32 )
+            ? ( ( 1UL << xsvf_broadcast.iNumChains ) - 1 ) : 0xFFFFFFFFUL;
+    }
+
+    /* Initialize the I/O.  SetPort initializes I/O on first call */
+    setPort( TMS, 1 );
+
+    pucData = inputRemaining( in, &lSize );
+    if ( !pucData )
+    {
+        /* A block or pipelined source:  a plan is loaded whole */
+        pucData = inputPeek( in, (long)sizeof( SXsvfPlanHeader ) );
+        if ( pucData && xsvfPlanIsPlan( pucData, sizeof( SXsvfPlanHeader ) ) )
+        {
+            pucData = inputLoadAll( in, &lSize );
+        }
+        else
+        {
+            pucData = 0;
+        }
+    }
+    if ( pucData && xsvfPlanIsPlan( pucData, lSize ) )
+    {
+        if ( xsvfPlanLoad( &plan, pucData, lSize ) )
+        {
+            XSVFDBG_PRINTF( 0, "ERROR:  Bad plan file\n" );
+            iResult = XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN );
+        }
+        else
+        {
+            iResult = xsvfExecutePlan( &plan );
+            xsvfPlanFree( &plan );
+        }
+    }
+    else if ( ( pucHead = xsvfSniffInput( in, BIT_SNIFF_BYTES, &lHeadSize ) ) &&
+              bitIsBitstream( pucHead, lHeadSize ) )
+    {
+        iResult = xsvfExecuteBitstream( in );
+    }
+    else if ( pucHead && svfIsSvf( pucHead, ( lHeadSize < SVF_SNIFF_BYTES )
+                                            ? lHeadSize : SVF_SNIFF_BYTES ) )
+    {
+        iResult = xsvfExecuteSvf( in );
+    }
+    else
+    {
+        iResult = xsvfExecute();
+    }
+
+    /* An early pulse left at the end is finished to the file's time */
+    xsvfLearnSettle();
+
+    if ( xsvf_broadcast.iNumChains > 1 )
+    {
+        XSVFDBG_PRINTF3( 0, "Broadcast: %d chains, failed bitmap 0x%lx, active bitmap 0x%lx\n",
+                         xsvf_broadcast.iNumChains, xsvf_broadcast.ulFailed,
+                         xsvf_broadcast.ulActive );
+        free( xsvf_broadcast.pucTdo );
+        xsvf_broadcast.pucTdo   = 0;
+        if ( xsvf_broadcast.ulFailed && ( iResult == XSVF_ERRORCODE( XSVF_ERROR_NONE ) ) )
+        {
+            /* Some chains were masked out:  the run as a whole failed */
+            iResult = XSVF_ERRORCODE( XSVF_ERROR_TDOMISMATCH );
+        }
+        if ( xsvf_broadcast.ulFailed )
+        {
+            /* Name each failed chain (bit i = chain i) */
+            iChainText  = 0;
+            szChains[ 0 ] = 0;
+            for ( iChain = 0; ( iChain < xsvf_broadcast.iNumChains ) &&
+                              ( iChain < 32 ); ++iChain )
+            {
+                if ( ( ( xsvf_broadcast.ulFailed >> iChain ) & 1 ) &&
+                     ( iChainText < (int)sizeof( szChains ) - 4 ) )
+                {
+                    iChainText  += sprintf( szChains + iChainText, " %d",
+                                            iChain );
+                }
+            }
+            XSVFDBG_PRINTF2( 0, "FAILURE - Broadcast chain(s)%s failed of %d.\n",
+                             szChains, xsvf_broadcast.iNumChains );
+        }
+        else if ( xsvf_broadcast.pzCompleted )
+        {
+            XSVFDBG_PRINTF1( 0, "SUCCESS - Completed %s.\n",
+                             xsvf_broadcast.pzCompleted );
+        }
+    }
+
+    if ( rtEnabled() )
+    {
+        rtLeave();
+        xsvfRtReport();
+    }
+
+#ifdef  XSVF_SUPPORT_ERRORCODES
+    return( iResult );
+#else   /* !XSVF_SUPPORT_ERRORCODES */
+    return( ( iResult == XSVF_LEGACY_SUCCESS ) ? XSVF_ERROR_NONE
+                                               : XSVF_ERROR_UNKNOWN );
+#endif  /* XSVF_SUPPORT_ERRORCODES */
+}
+
+/*****************************************************************************
+* Function:     xsvfWriteStats
+* Description:  Write the run summary as JSON, or as CSV rows of
+*               kind,name,count,usec if the file name ends in ".csv".
+*               Port I/O time is the time spent in shiftBits() and
+*               shiftTms(); wait time is the measured waitTime() total.
+*               Comparing the two shows whether a run is I/O or wait bound.
+* Parameters:   pzFileName  - output file; "-" = stdout.
+*               iErrorCode  - the run's return code.
+*               llWallNs    - wall-clock run time in nanoseconds.
+*               llCpuNs     - CPU time in nanoseconds.
+*               lSyscalls   - port driver syscalls.
+* Returns:      int         - 0 = success; otherwise the file failed.
+*****************************************************************************/
+int xsvfWriteStats( const char* pzFileName,
+                    int         iErrorCode,
+                    long long   llWallNs,
+                    long long   llCpuNs,
+                    long        lSyscalls )
+{
+    FILE*               pFile;
+    const STimingStats* pTiming;
+    const char*         pzExt;
+    int                 iCsv;
+    int                 iFirst;
+    int                 i;
+    char                szName[ 16 ];
+
+    pFile   = strcmp( pzFileName, "-" ) ? fopen( pzFileName, "w" ) : stdout;
+    if ( !pFile )
+    {
+        printf( "ERROR:  Cannot write stats file %s\n", pzFileName );
+        return( 1 );
+    }
+    pTiming = timingStats();
+    pzExt   = strrchr( pzFileName, '.' );
+    iCsv    = ( pzExt && !strcasecmp( pzExt, ".csv" ) );
+
+    if ( iCsv )
+    {
+        fprintf( pFile, "kind,name,count,usec\n" );
+        fprintf( pFile, "run,exit_code,%d,\n", iErrorCode );
+        fprintf( pFile, "run,wall,,%lld\n", llWallNs / 1000 );
+        fprintf( pFile, "run,cpu,,%lld\n", llCpuNs / 1000 );
+        fprintf( pFile, "run,commands,%ld,\n", xsvf_stats.lCommands );
+        fprintf( pFile, "shift,shifts,%ld,%lld\n", xsvf_stats.lShifts,
+                 xsvf_stats.llShiftNs / 1000 );
+        fprintf( pFile, "shift,write_only,%ld,\n",
+                 xsvf_stats.lShiftsWriteOnly );
+        fprintf( pFile, "shift,bits_shifted,%ld,\n",
+                 xsvf_stats.lBitsShifted );
+        fprintf( pFile, "shift,tdo_bits_sampled,%ld,\n",
+                 xsvf_stats.lTdoBitsSampled );
+        fprintf( pFile, "shift,retries,%ld,\n", xsvf_stats.lRetries );
+        fprintf( pFile, "shift,mismatch_bits,%ld,\n",
+                 xsvf_stats.lMismatchBits );
+        fprintf( pFile, "shift,first_mismatch_bit,%ld,\n",
+                 xsvf_stats.lMismatchBits ? xsvf_stats.lFirstMismatch : -1 );
+        fprintf( pFile, "tap,transitions,%ld,%lld\n",
+                 xsvf_stats.lTapTransitions, xsvf_stats.llTmsNs / 1000 );
+        fprintf( pFile, "tap,tms_bits,%ld,\n", xsvf_stats.lTmsBits );
+        fprintf( pFile, "port,io,%ld,%lld\n", lSyscalls,
+                 ( xsvf_stats.llShiftNs + xsvf_stats.llTmsNs ) / 1000 );
+        fprintf( pFile, "wait,%s,%ld,%ld\n", timingModeName(),
+                 pTiming->lWaits, pTiming->lActualUs );
+        fprintf( pFile, "wait,requested,,%ld\n", pTiming->lRequestedUs );
+        fprintf( pFile, "wait,max_overshoot,,%ld\n", pTiming->lMaxOverUs );
+        fprintf( pFile, "wait,tck_pulses,%ld,\n", pTiming->lTckPulses );
+    }
+    else
+    {
+        fprintf( pFile, "{\n" );
+        fprintf( pFile, "  \"exit_code\": %d,\n", iErrorCode );
+        fprintf( pFile, "  \"wall_usec\": %lld,\n", llWallNs / 1000 );
+        fprintf( pFile, "  \"cpu_usec\": %lld,\n", llCpuNs / 1000 );
+        fprintf( pFile, "  \"commands\": %ld,\n", xsvf_stats.lCommands );
+        fprintf( pFile, "  \"shifts\": %ld,\n", xsvf_stats.lShifts );
+        fprintf( pFile, "  \"shifts_write_only\": %ld,\n",
+                 xsvf_stats.lShiftsWriteOnly );
+        fprintf( pFile, "  \"bits_shifted\": %ld,\n",
+                 xsvf_stats.lBitsShifted );
+        fprintf( pFile, "  \"tdo_bits_sampled\": %ld,\n",
+                 xsvf_stats.lTdoBitsSampled );
+        fprintf( pFile, "  \"retries\": %ld,\n", xsvf_stats.lRetries );
+        fprintf( pFile, "  \"mismatch_bits\": %ld,\n",
+                 xsvf_stats.lMismatchBits );
+        fprintf( pFile, "  \"first_mismatch_bit\": %ld,\n",
+                 xsvf_stats.lMismatchBits ? xsvf_stats.lFirstMismatch : -1 );
+        fprintf( pFile, "  \"tap_transitions\": %ld,\n",
+                 xsvf_stats.lTapTransitions );
+        fprintf( pFile, "  \"tms_bits\": %ld,\n", xsvf_stats.lTmsBits );
+        fprintf( pFile, "  \"port_syscalls\": %ld,\n", lSyscalls );
+        fprintf( pFile, "  \"port_io_usec\": %lld,\n",
+                 ( xsvf_stats.llShiftNs + xsvf_stats.llTmsNs ) / 1000 );
+        fprintf( pFile, "  \"shift_usec\": %lld,\n",
+                 xsvf_stats.llShiftNs / 1000 );
+        fprintf( pFile, "  \"tms_usec\": %lld,\n",
+                 xsvf_stats.llTmsNs / 1000 );
+        fprintf( pFile, "  \"wait_mode\": \"%s\",\n", timingModeName() );
+        fprintf( pFile, "  \"waits\": %ld,\n", pTiming->lWaits );
+        fprintf( pFile, "  \"wait_usec\": %ld,\n", pTiming->lActualUs );
+        fprintf( pFile, "  \"wait_requested_usec\": %ld,\n",
+                 pTiming->lRequestedUs );
+        fprintf( pFile, "  \"wait_max_overshoot_usec\": %ld,\n",
+                 pTiming->lMaxOverUs );
+        fprintf( pFile, "  \"wait_tck_pulses\": %ld,\n",
+                 pTiming->lTckPulses );
+        fprintf( pFile, "  \"per_command\": {" );
+    }
+
+    /* Per command byte, only the commands that ran */
+    iFirst  = 1;
+    for ( i = 0; i < XLASTCMD; ++i )
+    {
+        if ( !xsvf_stats.alCommands[ i ] )
+        {
+            continue;
+        }
+#ifdef  DEBUG_MODE
+        snprintf( szName, sizeof( szName ), "%s", xsvf_pzCommandName[ i ] );
+#else   /* !DEBUG_MODE */
+        snprintf( szName, sizeof( szName ), "CMD%d", i );
+#endif  /* DEBUG_MODE */
+        if ( iCsv )
+        {
+            fprintf( pFile, "command,%s,%ld,%lld\n", szName,
+                     xsvf_stats.alCommands[ i ],
+                     xsvf_stats.allCommandNs[ i ] / 1000 );
+        }
+        else
+        {
+            fprintf( pFile, "%s\n    \"%s\": { \"count\": %ld, \"usec\": %lld }",
+                     iFirst ? "" : ",", szName, xsvf_stats.alCommands[ i ],
+                     xsvf_stats.allCommandNs[ i ] / 1000 );
+        }
+        iFirst  = 0;
+    }
+    if ( !iCsv )
+    {
+        fprintf( pFile, "%s}\n}\n", iFirst ? "" : "\n  " );
+    }
+
+    if ( pFile != stdout )
+    {
+        fclose( pFile );
+    }
+    return( 0 );
+}
+
 extern int hardwareSetup();
 /*============================================================================
 * main
@@ -1761,20 +3014,38 @@ int main( int iArgc, char** ppzArgv )
 {
     int     iErrorCode;
     char*   pzXsvfFileName;
+    char*   pzPlanFileName;
+    char*   pzStatsFileName;
+    char*   pzHistoryFileName;
+    int     iAdaptive;
+    SXsvfInput  input;
+    SXsvfPlan   plan;
+    const unsigned char*    pucData;
+    long    lSize;
     int     i;
+    int     iNumChains;
+    int     iPipelined;
+    static SXsvfChain   aChain[ XSVF_MAX_CHAINS ];
     clock_t startClock;
     clock_t endClock;
+    long long   llStartNs;
+    long long   llEndNs;
+    SPort*  pPort;
+    double  dTckHz;
+    double  adTckHz[ PORT_PACE_PHASES ];
 
     iErrorCode          = XSVF_ERRORCODE( XSVF_ERROR_NONE );
     pzXsvfFileName      = 0;
+    pzPlanFileName      = 0;
+    pzStatsFileName     = 0;
+    pzHistoryFileName   = 0;
+    iAdaptive           = 0;
+    iNumChains          = 0;
+    iPipelined          = 0;
 
     printf( "XSVF Player v%s, Xilinx, Inc.\n", XSVF_VERSION );
 
-    i = hardwareSetup();
-    if(i != 0){
-        printf("Error: hardwareSetup failed: %d", i);
-        return i;
-    }
+    pPort               = portsCurrent();
 
     for ( i = 1; i < iArgc ; ++i )
     {
@@ -1791,41 +3062,360 @@ int main( int iArgc, char** ppzArgv )
                 printf( "Verbose level = %d\n", xsvf_iDebugLevel );
             }
         }
-        else
+        else if ( !strcasecmp( ppzArgv[ i ], "-port" ) )
         {
-            pzXsvfFileName  = ppzArgv[ i ];
+            ++i;
+            if ( ( i >= iArgc ) || portsSelectDriver( pPort, ppzArgv[ i ] ) )
+            {
+                printf( "ERROR:  missing or unknown <driver> for -port option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-gpio" ) )
+        {
+            ++i;
+            if ( i >= iArgc )
+            {
+                printf( "ERROR:  missing <path> parameter for -gpio option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+            pPort->pzPath   = ppzArgv[ i ];
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-spi" ) )
+        {
+            ++i;
+            if ( i >= iArgc )
+            {
+                printf( "ERROR:  missing <device> parameter for -spi option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+            pPort->pzSpiDevice  = ppzArgv[ i ];
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-tck" ) )
+        {
+            ++i;
+            if ( ( i >= iArgc ) ||
+                 portsParseTck( ppzArgv[ i ], &dTckHz, adTckHz ) )
+            {
+                printf( "ERROR:  missing or bad <hz[,phase=hz...]> for -tck option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+            pPort->pzTck    = ppzArgv[ i ];
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-wait" ) )
+        {
+            ++i;
+            if ( ( i >= iArgc ) || timingSelectMode( ppzArgv[ i ] ) )
+            {
+                printf( "ERROR:  missing or unknown <mode> for -wait option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-stats" ) )
+        {
+            ++i;
+            if ( i >= iArgc )
+            {
+                printf( "ERROR:  missing <file> parameter for -stats option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+            pzStatsFileName     = ppzArgv[ i ];
+            xsvf_stats.iTimed   = 1;
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-history" ) )
+        {
+            ++i;
+            if ( i >= iArgc )
+            {
+                printf( "ERROR:  missing <file> parameter for -history option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+            pzHistoryFileName   = ppzArgv[ i ];
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-adaptive" ) )
+        {
+            iAdaptive   = 1;
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-compile" ) )
+        {
+            ++i;
+            if ( i >= iArgc )
+            {
+                printf( "ERROR:  missing <plan> parameter for -compile option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+            pzPlanFileName  = ppzArgv[ i ];
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-pins" ) )
+        {
+            ++i;
+            if ( ( i >= iArgc ) || portsParsePins( pPort, ppzArgv[ i ] ) )
+            {
+                printf( "ERROR:  missing or bad <tms,tdi,tck,tdo> for -pins option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-pipeline" ) )
+        {
+            iPipelined  = 1;
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-tdo" ) )
+        {
+            ++i;
+            if ( ( i >= iArgc ) || portsParseTdo( pPort, ppzArgv[ i ] ) )
+            {
+                printf( "ERROR:  missing or bad <tdo,...> for -tdo option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-rt" ) )
+        {
+            ++i;
+            if ( ( i >= iArgc ) || rtParse( ppzArgv[ i ] ) )
+            {
+                printf( "ERROR:  missing or bad <cpu[,priority]> for -rt option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+        }
+        else if ( !strcasecmp( ppzArgv[ i ], "-bitir" ) )
+        {
+            ++i;
+            if ( ( i >= iArgc ) || bitParseConfig( &bit_config, ppzArgv[ i ] ) )
+            {
+                printf( "ERROR:  missing or bad <irlen[,cfg_in,jstart,jprogram]> for -bitir option.\n" );
+                return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+            }
+        }
+        else if ( iNumChains < XSVF_MAX_CHAINS )
+        {
+            /* Each file is a chain on the port options given so far */
+            pzXsvfFileName                      = ppzArgv[ i ];
+            aChain[ iNumChains ].port           = *pPort;
+            aChain[ iNumChains ].pzFileName     = pzXsvfFileName;
+            aChain[ iNumChains ].iPipelined     = iPipelined;
+            ++iNumChains;
             printf( "XSVF file = %s\n", pzXsvfFileName );
         }
+        else
+        {
+            printf( "ERROR:  more than %d XSVF files.\n", XSVF_MAX_CHAINS );
+            return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+        }
+    }
+
+    if ( pzPlanFileName && ( iNumChains > 1 ) )
+    {
+        printf( "ERROR:  -compile takes one XSVF file.\n" );
+        return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
+    }
+
+    if ( iAdaptive && !pzHistoryFileName )
+    {
+        printf( "ERROR:  -adaptive needs a -history file.\n" );
+        return( XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN ) );
     }
 
     if ( !pzXsvfFileName )
     {
-        printf( "USAGE:  playxsvf [-v level] filename.xsvf\n" );
+        printf( "USAGE:  playxsvf [-v level] [-port driver] [-gpio path]\n" );
+        printf( "                 [-pins tms,tdi,tck,tdo] [-tdo list] [-spi dev[:hz]]\n" );
+        printf( "                 [-tck hz[,n=hz...]] [-wait mode] [-stats file]\n" );
+        printf( "                 [-compile plan] [-pipeline]\n" );
+        printf( "                 [-bitir irlen[,cfg_in,jstart,jprogram]]\n" );
+        printf( "                 [-rt cpu[,priority]] [-history file [-adaptive]]\n" );
+        printf( "                 filename.xsvf [[options] filename.xsvf ...]\n" );
         printf( "where:  -v level      = verbose, level = 0-4 (default=0)\n" );
-        printf( "        filename.xsvf = the XSVF file to execute.\n" );
+        printf( "        -port driver  = JTAG port driver: sysfs, gpiod, mmio,\n" );
+        printf( "                        null (no I/O), sim (simulated chain)\n" );
+        printf( "                        (default=sysfs)\n" );
+        printf( "        -gpio path    = GPIO root, chip device, mmio config,\n" );
+        printf( "                        or sim chain (device count or config)\n" );
+        printf( "        -pins list    = GPIO numbers (sysfs) or line offsets\n" );
+        printf( "                        (gpiod) of TMS,TDI,TCK,TDO\n" );
+        printf( "        -tdo list     = broadcast: identical chains share TMS,\n" );
+        printf( "                        TDI and TCK, each with its own TDO pin\n" );
+        printf( "                        (sysfs, gpiod line, mmio bit); a chain\n" );
+        printf( "                        that fails is masked out, the rest go on\n" );
+        printf( "        -spi dev[:hz] = shift whole bytes over spidev (SCLK=TCK)\n" );
+        printf( "        -tck hz[,n=hz]= pace TCK at most at hz (k, M; 0 or max =\n" );
+        printf( "                        free running) and at the file's\n" );
+        printf( "                        FREQUENCY (SVF, or XSVF XCOMMENT\n" );
+        printf( "                        \"FREQUENCY f HZ;\"), which starts\n" );
+        printf( "                        phase 1, 2, ...; n=hz sets phase n\n" );
+        printf( "        -wait mode    = XRUNTEST/XWAIT wait: sleep (TCK low),\n" );
+        printf( "                        spin (TCK low, calibrated spin), or\n" );
+        printf( "                        tck (running TCK, FPGAs/flash)\n" );
+        printf( "                        (default=sleep)\n" );
+        printf( "        -stats file   = write per-command counters and times as\n" );
+        printf( "                        JSON, or CSV for *.csv (- = stdout)\n" );
+        printf( "        -compile plan = compile the XSVF into a plan file and exit\n" );
+        printf( "        -pipeline     = read the file ahead on a reader thread\n" );
+        printf( "                        (slow storage, network, decompressor)\n" );
+        printf( "        -bitir list   = FPGA IR length and CFG_IN, JSTART and\n" );
+        printf( "                        JPROGRAM codes for .bit/.bin files\n" );
+        printf( "                        (default=6,0x05,0x0c,0x0b)\n" );
+        printf( "        -rt cpu[,prio]= real-time: pin the player to cpu (any =\n" );
+        printf( "                        no pinning; chains take the next CPUs),\n" );
+        printf( "                        SCHED_FIFO prio (default=%d), lock\n",
+                RT_DEFAULT_PRIORITY );
+        printf( "                        memory; sleeps over %ld usec run at\n",
+                RT_DEMOTE_US );
+        printf( "                        normal priority\n" );
+        printf( "        -history file = record how XREPEAT/XRUNTEST status\n" );
+        printf( "                        checks verified, per device (IDCODE)\n" );
+        printf( "                        and instruction, across runs\n" );
+        printf( "        -adaptive     = with -history:  wait shorter pulses\n" );
+        printf( "                        where the history never needed a\n" );
+        printf( "                        retry; a failed check is retried at\n" );
+        printf( "                        the file's time, free of XREPEAT\n" );
+        printf( "        filename.xsvf = the XSVF or SVF file to execute\n" );
+        printf( "                        (- = stdin), a plan file to replay,\n" );
+        printf( "                        or a Xilinx .bit/.bin file to load\n" );
+        printf( "                        into the only device in the chain;\n" );
+        printf( "                        gzip, xz and zstd files\n" );
+        printf( "                        are decoded.  Several files are\n" );
+        printf( "                        played concurrently, each on the\n" );
+        printf( "                        -port/-gpio/-pins/-spi/-tck given\n" );
+        printf( "                        before it.\n" );
+    }
+    else if ( pzPlanFileName )
+    {
+        /* Compile only:  no JTAG port is used */
+        in = &input;
+        if ( inputOpenFile( in, pzXsvfFileName ) ||
+             !( pucData = inputLoadAll( in, &lSize ) ) )
+        {
+            printf( "ERROR:  Cannot read file %s\n", pzXsvfFileName );
+            iErrorCode  = XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN );
+        }
+        else if ( svfIsSvf( pucData, ( lSize < SVF_SNIFF_BYTES )
+                                     ? lSize : SVF_SNIFF_BYTES ) ||
+                  bitIsBitstream( pucData, ( lSize < BIT_SNIFF_BYTES )
+                                           ? lSize : BIT_SNIFF_BYTES ) )
+        {
+            printf( "ERROR:  -compile takes an XSVF file, not SVF or a bitstream.\n" );
+            iErrorCode  = XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN );
+        }
+        else
+        {
+            iErrorCode  = xsvfPlanCompile( &plan, pucData, lSize );
+            if ( iErrorCode )
+            {
+                printf( "%s\n", xsvf_pzErrorName[
+                        ( iErrorCode < XSVF_ERROR_LAST )
+                        ? iErrorCode : XSVF_ERROR_UNKNOWN ] );
+                printf( "ERROR at or near XSVF command #%ld.\n",
+                        plan.lErrorCommand );
+            }
+            else
+            {
+                iErrorCode  = xsvfPlanSave( &plan, pzPlanFileName );
+            }
+            if ( !iErrorCode )
+            {
+                printf( "Plan = %s (%ld ops, %ld bytes generated data)\n",
+                        pzPlanFileName, plan.lNumOps, plan.lDataBytes );
+            }
+            xsvfPlanFree( &plan );
+            iErrorCode  = XSVF_ERRORCODE( iErrorCode );
+        }
+        inputClose( in );
+    }
+    else if ( iNumChains > 1 )
+    {
+        /* One thread per chain */
+        if ( pzStatsFileName )
+        {
+            printf( "WARNING:  -stats is ignored with several XSVF files.\n" );
+        }
+        if ( pzHistoryFileName )
+        {
+            printf( "WARNING:  -history is ignored with several XSVF files.\n" );
+        }
+        llStartNs   = timingNowNs();
+        xsvfChainsPlay( aChain, iNumChains );
+        llEndNs     = timingNowNs();
+        xsvfChainsReport( aChain, iNumChains, llEndNs - llStartNs );
+        iErrorCode  = XSVF_ERRORCODE( XSVF_ERROR_NONE );
+        for ( i = iNumChains - 1; i >= 0; --i )
+        {
+            if ( aChain[ i ].iErrorCode )
+            {
+                iErrorCode  = XSVF_ERRORCODE( aChain[ i ].iErrorCode );
+            }
+        }
+    }
+    else if ( ( i = hardwareSetup() ) != 0 )
+    {
+        printf( "Error: hardwareSetup failed: %d\n", i );
+        iErrorCode  = XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN );
     }
     else
     {
-        /* read from the XSVF file instead of a real prom */
-        in = fopen( pzXsvfFileName, "rb" );
-        if ( !in )
+        if ( iPipelined ? inputOpenPipelined( &input, pzXsvfFileName )
+                        : inputOpenFile( &input, pzXsvfFileName ) )
         {
             printf( "ERROR:  Cannot open file %s\n", pzXsvfFileName );
             iErrorCode  = XSVF_ERRORCODE( XSVF_ERROR_UNKNOWN );
         }
         else
         {
-            /* Initialize the I/O.  SetPort initializes I/O on first call */
-            setPort( TMS, 1 );
+            if ( pzHistoryFileName )
+            {
+                xsvfLearnOpen( pzHistoryFileName, iAdaptive );
+            }
 
-            /* Execute the XSVF in the file */
+            /* Execute the XSVF in the file, or replay a plan file */
             startClock  = clock();
-            iErrorCode  = xsvfExecute();
+            llStartNs   = timingNowNs();
+            iErrorCode  = XSVF_ERRORCODE( xsvfExecuteInput( &input ) );
             endClock    = clock();
-            fclose( in );
-            printf( "Execution Time = %.3f seconds\n",
+            llEndNs     = timingNowNs();
+            if ( input.pPipe )
+            {
+                printf( "Input reader waits = %ld\n", input.lPipeWaits );
+            }
+            if ( input.iFormat != INPUT_RAW )
+            {
+                printf( "Input = %s; %ld bytes read, %ld bytes decoded\n",
+                        inputFormatName( &input ), inputSourceBytes( &input ),
+                        inputOffset( &input ) );
+            }
+            inputClose( &input );
+            printf( "Execution Time = %.3f seconds (CPU %.3f seconds)\n",
+                    ((double)(llEndNs - llStartNs)) / 1e9,
                     (((double)(endClock - startClock))/CLOCKS_PER_SEC) );
+            printf( "Port syscalls = %ld\n", pPort->lSyscalls );
+            printf( "Shifts = %ld (%ld write-only); bits shifted = %ld; TDO bits sampled = %ld\n",
+                    xsvf_stats.lShifts, xsvf_stats.lShiftsWriteOnly,
+                    xsvf_stats.lBitsShifted, xsvf_stats.lTdoBitsSampled );
+            printf( "Waits (%s) = %ld; requested = %ld usec; actual = %ld usec; max overshoot = %ld usec\n",
+                    timingModeName(), timingStats()->lWaits,
+                    timingStats()->lRequestedUs, timingStats()->lActualUs,
+                    timingStats()->lMaxOverUs );
+            if ( timingStats()->lTckPulses )
+            {
+                printf( "Wait TCK pulses = %ld (%ld per msec)\n",
+                        timingStats()->lTckPulses, timingStats()->lTckPerMs );
+            }
+            if ( xsvfLearnEnabled() )
+            {
+                printf( "Retry history = %s (%d classes); early pulses verified = %ld, retried = %ld; wait saved = %ld usec\n",
+                        pzHistoryFileName, xsvfLearnClasses(),
+                        xsvf_learn.lEarlyOk, xsvf_learn.lEarlyFails,
+                        xsvf_learn.lSavedUs );
+                xsvfLearnSave();
+            }
+            if ( pzStatsFileName )
+            {
+                xsvfWriteStats( pzStatsFileName, iErrorCode,
+                                llEndNs - llStartNs,
+                                ( (long long)( endClock - startClock ) *
+                                  1000000000LL ) / CLOCKS_PER_SEC,
+                                pPort->lSyscalls );
+            }
         }
+        hardwareCleanup();
     }
 
     return( iErrorCode );
@@ -25,9 +25,11 @@
 #define XSVF_ERROR_MAXRETRIES   3   /* TDO mismatch after max retries */
 #define XSVF_ERROR_ILLEGALCMD   4
 #define XSVF_ERROR_ILLEGALSTATE 5
-#define XSVF_ERROR_DATAOVERFLOW 6   /* Data > lenVal MAX_LEN buffer size*/
+#define XSVF_ERROR_DATAOVERFLOW 6   /* Data > LENVAL_MAX_BYTES or no memory */
+#define XSVF_ERROR_TRUNCATED    7   /* XSVF data ends before XCOMPLETE */
+#define XSVF_ERROR_PORT         8   /* the port driver failed a shift */
 /* Insert new errors here */
-#define XSVF_ERROR_LAST         7
+#define XSVF_ERROR_LAST         9
 
 /*****************************************************************************
 * Function:     xsvfExecute
@@ -0,0 +1,256 @@
+/*****************************************************************************
+* File:         microint.h
+* Description:  This header file contains the XSVF command encodings, TAP
+*               states and interpreter helpers that micro.c shares with the
+*               execution plan compiler (xsvfplan.c).  It is not part of the
+*               xsvfExecute() interface in micro.h.
+*****************************************************************************/
+#ifndef XSVF_MICROINT_H
+#define XSVF_MICROINT_H
+
+#include "lenval.h"
+#include "ports.h"
+
+/*****************************************************************************
+* Define:       XSVF_SUPPORT_COMPRESSION
+* Description:  Define this to support the XC9500/XL XSVF data compression
+*               scheme.
+*               Code size can be reduced by NOT supporting this feature.
+*               However, you must use the -nc (no compress) option when
+*               translating SVF to XSVF using the SVF2XSVF translator.
+*               Corresponding, uncompressed XSVF may be larger.
+*****************************************************************************/
+#ifndef XSVF_SUPPORT_COMPRESSION
+    #define XSVF_SUPPORT_COMPRESSION    1
+#endif
+
+/*============================================================================
+* DEBUG_MODE #define
+============================================================================*/
+
+#ifdef  DEBUG_MODE
+    #define XSVFDBG_PRINTF(iDebugLevel,pzFormat) \
+                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
+                    printf( pzFormat ); }
+    #define XSVFDBG_PRINTF1(iDebugLevel,pzFormat,arg1) \
+                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
+                    printf( pzFormat, arg1 ); }
+    #define XSVFDBG_PRINTF2(iDebugLevel,pzFormat,arg1,arg2) \
+                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
+                    printf( pzFormat, arg1, arg2 ); }
+    #define XSVFDBG_PRINTF3(iDebugLevel,pzFormat,arg1,arg2,arg3) \
+                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
+                    printf( pzFormat, arg1, arg2, arg3 ); }
+    #define XSVFDBG_PRINTLENVAL(iDebugLevel,plenVal) \
+                { if ( xsvf_iDebugLevel >= iDebugLevel ) \
+                    xsvfPrintLenVal(plenVal); }
+#else   /* !DEBUG_MODE */
+    #define XSVFDBG_PRINTF(iDebugLevel,pzFormat)
+    #define XSVFDBG_PRINTF1(iDebugLevel,pzFormat,arg1)
+    #define XSVFDBG_PRINTF2(iDebugLevel,pzFormat,arg1,arg2)
+    #define XSVFDBG_PRINTF3(iDebugLevel,pzFormat,arg1,arg2,arg3)
+    #define XSVFDBG_PRINTLENVAL(iDebugLevel,plenVal)
+#endif  /* DEBUG_MODE */
+
+
+/*============================================================================
+* XSVF Command Bytes
+============================================================================*/
+
+/* encodings of xsvf instructions */
+#define XCOMPLETE        0
+#define XTDOMASK         1
+#define XSIR             2
+#define XSDR             3
+#define XRUNTEST         4
+/* Reserved              5 */
+/* Reserved              6 */
+#define XREPEAT          7
+#define XSDRSIZE         8
+#define XSDRTDO          9
+#define XSETSDRMASKS     10
+#define XSDRINC          11
+#define XSDRB            12
+#define XSDRC            13
+#define XSDRE            14
+#define XSDRTDOB         15
+#define XSDRTDOC         16
+#define XSDRTDOE         17
+#define XSTATE           18         /* 4.00 */
+#define XENDIR           19         /* 4.04 */
+#define XENDDR           20         /* 4.04 */
+#define XSIR2            21         /* 4.10 */
+#define XCOMMENT         22         /* 4.14 */
+#define XWAIT            23         /* 5.00 */
+/* Insert new commands here */
+/* and add corresponding xsvfDoCmd function to xsvf_pfDoCmd below. */
+#define XLASTCMD         24         /* Last command marker */
+
+
+/*============================================================================
+* XSVF Command Parameter Values
+============================================================================*/
+
+#define XSTATE_RESET     0          /* 4.00 parameter for XSTATE */
+#define XSTATE_RUNTEST   1          /* 4.00 parameter for XSTATE */
+
+#define XENDXR_RUNTEST   0          /* 4.04 parameter for XENDIR/DR */
+#define XENDXR_PAUSE     1          /* 4.04 parameter for XENDIR/DR */
+
+/* TAP states */
+#define XTAPSTATE_RESET     0x00
+#define XTAPSTATE_RUNTEST   0x01    /* a.k.a. IDLE */
+#define XTAPSTATE_SELECTDR  0x02
+#define XTAPSTATE_CAPTUREDR 0x03
+#define XTAPSTATE_SHIFTDR   0x04
+#define XTAPSTATE_EXIT1DR   0x05
+#define XTAPSTATE_PAUSEDR   0x06
+#define XTAPSTATE_EXIT2DR   0x07
+#define XTAPSTATE_UPDATEDR  0x08
+#define XTAPSTATE_IRSTATES  0x09    /* All IR states begin here */
+#define XTAPSTATE_SELECTIR  0x09
+#define XTAPSTATE_CAPTUREIR 0x0A
+#define XTAPSTATE_SHIFTIR   0x0B
+#define XTAPSTATE_EXIT1IR   0x0C
+#define XTAPSTATE_PAUSEIR   0x0D
+#define XTAPSTATE_EXIT2IR   0x0E
+#define XTAPSTATE_UPDATEIR  0x0F
+
+/*============================================================================
+* XSVF Type Declarations
+============================================================================*/
+
+#ifdef  XSVF_SUPPORT_COMPRESSION
+/*****************************************************************************
+* Struct:       SXsvfSdrScatter
+* Description:  One TDI byte that takes XSDRINC next-data bits:  ucNumBits
+*               bits starting at next-data bit lDataBit (bit 0 = lsb of the
+*               last next-data byte) are deposited into the ucMask bits of
+*               TDI byte lByte.
+*****************************************************************************/
+typedef struct tagSXsvfSdrScatter
+{
+    long            lByte;              /* TDI byte index */
+    long            lDataBit;           /* first next-data bit */
+    unsigned char   ucMask;             /* data mask byte */
+    unsigned char   ucNumBits;          /* bits set in ucMask */
+    unsigned char   ucLowBits;          /* bits set in the low nibble */
+} SXsvfSdrScatter;
+
+/*****************************************************************************
+* Struct:       SXsvfSdrMap
+* Description:  The XSETSDRMASKS masks compiled for XSDRINC (see
+*               xsvfSdrMapBuild()).  The address mask is added only over
+*               the bytes from lAddrLast (least significant) up to
+*               lAddrFirst and then as far as the carry reaches;
+*               lAddrLast < 0 = no address bits.
+*****************************************************************************/
+typedef struct tagSXsvfSdrMap
+{
+    long                lDataBits;      /* bits set in the data mask */
+    long                lAddrFirst;     /* first non-zero address byte */
+    long                lAddrLast;      /* last non-zero address byte */
+    long                lNumScatter;    /* entries in pScatter */
+    long                lMaxScatter;    /* entries allocated */
+    SXsvfSdrScatter*    pScatter;       /* in next-data order */
+} SXsvfSdrMap;
+#endif  /* XSVF_SUPPORT_COMPRESSION */
+
+/*****************************************************************************
+* Struct:       SXsvfStats
+* Description:  Counters accumulated while the XSVF is played.
+*               Shifts whose TDO is never compared (no expected TDO, or an
+*               all-zero TDO mask) run write-only and do not sample TDO.
+*               The times are monotonic wall-clock nanoseconds and are only
+*               taken when iTimed is set (see xsvfStatsNow()); waitTime()
+*               keeps its own totals in timing.c.
+*****************************************************************************/
+typedef struct tagSXsvfStats
+{
+    long            lShifts;            /* Number of xsvfShiftOnly spans */
+    long            lShiftsWriteOnly;   /* Spans that skipped TDO sampling */
+    long            lBitsShifted;       /* Total TDI bits shifted */
+    long            lTdoBitsSampled;    /* Total TDO bits read back */
+    long            lCommands;          /* XSVF commands executed */
+    long            lTapTransitions;    /* TMS paths clocked */
+    long            lTmsBits;           /* TMS bits in those paths */
+    long            lRetries;           /* xsvfShift TDO mismatch retries */
+    long            lMismatchBits;      /* bits that differ in a failed shift */
+    long            lFirstMismatch;     /* first of them, in shift order */
+    int             iTimed;             /* take the times below */
+    long long       llShiftNs;          /* time in shiftBits() */
+    long long       llTmsNs;            /* time in shiftTms() */
+    long            alCommands[ XLASTCMD ];     /* per command byte */
+    long long       allCommandNs[ XLASTCMD ];   /* per command byte */
+} SXsvfStats;
+
+/*****************************************************************************
+* Struct:       SXsvfBroadcast
+* Description:  Lock-step broadcast state, used when the current port has
+*               several TDO pins (-tdo).  Every chain sees the same TMS,
+*               TDI and TCK; chain 0 captures into the usual TDO lenVal and
+*               chains 1..N-1 into pucTdo, lTdoBytes each.  A chain whose
+*               TDO still mismatches after the retries is moved from
+*               ulActive to ulFailed and the other chains carry on.
+*****************************************************************************/
+typedef struct tagSXsvfBroadcast
+{
+    int             iNumChains;         /* 0 = not broadcasting */
+    unsigned long   ulActive;           /* chains still compared */
+    unsigned long   ulFailed;           /* chains masked out on mismatch */
+    long            lTdoBytes;          /* per chain in pucTdo */
+    unsigned char*  pucTdo;             /* chains 1..N-1 captured TDO */
+    const char*     pzCompleted;        /* SUCCESS line held back until the */
+                                        /* failed chains are known          */
+} SXsvfBroadcast;
+
+/*============================================================================
+* Shared Interpreter Functions (micro.c)
+============================================================================*/
+
+extern XSVF_THREAD SXsvfStats xsvf_stats;  /* per chain (thread) */
+extern XSVF_THREAD SXsvfBroadcast xsvf_broadcast;
+
+#ifdef  DEBUG_MODE
+extern char*    xsvf_pzTapState[];
+extern int      xsvf_iDebugLevel;
+extern void     xsvfPrintLenVal( lenVal* plv );
+#endif  /* DEBUG_MODE */
+
+extern long long xsvfStatsNow();
+extern void xsvfStatsCommand( unsigned char ucCommand, long long llStartNs );
+extern long xsvfGetAsNumBytes( long lNumBits );
+extern int  xsvfTapPath( unsigned char      ucStartState,
+                         unsigned char      ucTargetState,
+                         unsigned short*    pusTms,
+                         unsigned short*    pusNumTms );
+extern void xsvfShiftTms( unsigned short usTms, unsigned short usNumTms );
+extern int  xsvfGotoTapState( unsigned char*    pucTapState,
+                              unsigned char     ucTargetState );
+extern int  xsvfShiftOnly( long    lNumBits,
+                           lenVal* plvTdi,
+                           lenVal* plvTdoCaptured,
+                           int     iExitShift );
+extern int  xsvfShift( unsigned char*   pucTapState,
+                       unsigned char    ucStartState,
+                       long             lNumBits,
+                       lenVal*          plvTdi,
+                       lenVal*          plvTdoCaptured,
+                       lenVal*          plvTdoExpected,
+                       lenVal*          plvTdoMask,
+                       unsigned char    ucEndState,
+                       long             lRunTestTime,
+                       unsigned char    ucMaxRepeat );
+extern int  xsvfTdoConsumed( lenVal* plvTdoExpected, lenVal* plvTdoMask );
+#ifdef  XSVF_SUPPORT_COMPRESSION
+extern int  xsvfSdrMapBuild( SXsvfSdrMap*   pMap,
+                             lenVal*        plvAddressMask,
+                             lenVal*        plvDataMask );
+extern void xsvfSdrMapFree( SXsvfSdrMap* pMap );
+extern void xsvfDoSDRMasking( lenVal*       plvTdi,
+                              lenVal*       plvNextData,
+                              lenVal*       plvAddressMask,
+                              SXsvfSdrMap*  pMap );
+#endif  /* XSVF_SUPPORT_COMPRESSION */
+
+#endif  /* XSVF_MICROINT_H */
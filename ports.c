@@ -8,67 +8,29 @@
 /* 12/01/2008:  Same code as before (original v5.01).  */
 /*              Updated comments to clarify instructions.*/
 /*              Add print in setPort for xapp058_example.exe.*/
+/* 10/17/2026:  Move GPIO access behind SPortDriver;  */
+/*              sysfs driver lives in ports_sysfs.c.   */
+/*              waitTime() uses the timing.c modes.    */
+/*              The current port is per thread.        */
+/*              -tck paces the opened driver           */
+/*              (ports_pace.c).                        */
 /*******************************************************/
 #include "ports.h"
+#include "input.h"
+#include "timing.h"
 /*#include "prgispx.h"*/
 
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
-extern FILE *in;
-
-static int  g_iTCK = 0; /* For xapp058_example .exe */
-static int  g_iTMS = 0; /* For xapp058_example .exe */
-static int  g_iTDI = 0; /* For xapp058_example .exe */
-
-static int fvTMS;
-static int fvTDI;
-static int fvTCK;
-static int fvTDO;
-
-#define USLEEPTIME 1
-
-static int setupGPIO(const int gpio, const char* direction, int* valueFile)
-{
-    int fd;
-    char buf[512];
-
-    //export the gpio pins
-    fd = open("/sys/class/gpio/export", O_WRONLY);
-    if(fd < 0) { printf("error opening /sys/class/gpio/export\n"); return fd; }
-    sprintf(buf, "%d", gpio);
-    write(fd, buf, strlen(buf));
-    close(fd);
-
-    sprintf(buf, "/sys/class/gpio/gpio%d/direction", gpio);
-    fd = open(buf, O_WRONLY);
-    if(fd < 0) { printf("error opening %s\n", buf); return fd; }
-    write(fd, direction, strlen(direction));
-    close(fd);
-
-    sprintf(buf, "/sys/class/gpio/gpio%d/active_low", gpio);
-    fd = open(buf, O_WRONLY);
-    if(fd < 0) { printf("error opening %s\n", buf); return fd; }
-    write(fd, "0", 1);
-    close(fd);
-
-    sprintf(buf, "/sys/class/gpio/gpio%d/value", gpio);
-    if(direction[0] == 'i') {
-        *valueFile = open(buf, O_RDONLY);
-    } else if(direction[0] == 'o') {
-        *valueFile = open(buf, O_WRONLY);
-        //setvbuf(*valueFile, (char *)NULL, _IONBF, 0);
-    } else {
-        printf("ERROR: unknown direction: %s must be either 'in' or 'out'\n", direction);
-    }
-
-    return 0;
-}
+extern XSVF_THREAD SXsvfInput *in;
 
 /*
+    Default pin assignment (sysfs GPIO numbers)
     GPIO 927 ==> JTAG_TMS
     GPIO 926 ==> JTAG_TDI
     GPIO 954 ==> JTAG_TCK
@@ -78,109 +40,318 @@ static int setupGPIO(const int gpio, const char* direction, int* valueFile)
 #define JTAG_TDI 926
 #define JTAG_TCK 954
 #define JTAG_TDO 951
-int hardwareSetup()
-{
-    int retval;
 
+/* Available port drivers.  The first entry is the default. */
+static const SPortDriver* g_apPortDrivers[] =
+{
+    &portSysfsDriver,
+    &portGpiodDriver,
+    &portMmioDriver,
+    &portNullDriver,
+    &portSimDriver
+};
+#define NUM_PORT_DRIVERS (sizeof(g_apPortDrivers)/sizeof(g_apPortDrivers[0]))
+
+static SPort g_portDefault =
+{
+    &portSysfsDriver,
+    0,
+    0,
+    { JTAG_TCK, JTAG_TMS, JTAG_TDI, JTAG_TDO },
+    { 0, 0, 0 },
+    0,
+    0L,
+    0,
+    { 0 },
+    0,
+    0L
+};
+
+/* each thread starts on the default port; see portsSetCurrent() */
+static XSVF_THREAD SPort* g_pPort = &g_portDefault;
 
-    printf("doing hardware setup\n");
+#define USLEEPTIME 1
 
-    retval = setupGPIO(JTAG_TMS, "out", &fvTMS);
-    if(retval) { return retval; }
+SPort* portsCurrent()
+{
+    return g_pPort;
+}
 
-    retval = setupGPIO(JTAG_TDI, "out", &fvTDI);
-    if(retval) { return retval; }
+void portsSetCurrent(SPort* pPort)
+{
+    g_pPort = pPort;
+}
 
-    retval = setupGPIO(JTAG_TCK, "out", &fvTCK);
-    if(retval) { return retval; }
+int portsSelectDriver(SPort* pPort, const char* pzName)
+{
+    unsigned int i;
 
-    retval = setupGPIO(JTAG_TDO, "in", &fvTDO);
-    if(retval) { return retval; }
+    for(i = 0; i < NUM_PORT_DRIVERS; ++i) {
+        if(!strcmp(g_apPortDrivers[i]->pzName, pzName)) {
+            pPort->pDriver = g_apPortDrivers[i];
+            return 0;
+        }
+    }
 
-    retval = 0;
-    return retval;
+    printf("ERROR: unknown port driver: %s\n", pzName);
+    return -1;
 }
 
+int portsParsePins(SPort* pPort, const char* pzPins)
+{
+    int aiPin[PORT_NUM_PINS];
 
-/*BYTE *xsvf_data=0;*/
+    /* command line order is tms,tdi,tck,tdo */
+    if(sscanf(pzPins, "%d,%d,%d,%d", &aiPin[TMS], &aiPin[TDI],
+              &aiPin[TCK], &aiPin[TDO]) != PORT_NUM_PINS) {
+        printf("ERROR: pins must be given as tms,tdi,tck,tdo: %s\n", pzPins);
+        return -1;
+    }
 
-static void writeGPIO(int fv, short value)
+    memcpy(pPort->aiPin, aiPin, sizeof(aiPin));
+    return 0;
+}
+
+int portsParseTdo(SPort* pPort, const char* pzPins)
 {
-    int retval;
-    retval = 0;
+    int     aiTdo[PORT_MAX_TDO];
+    int     iNumTdo = 0;
+    char*   pzEnd;
+
+    while(*pzPins && (iNumTdo < PORT_MAX_TDO)) {
+        aiTdo[iNumTdo++] = (int)strtol(pzPins, &pzEnd, 0);
+        if((pzEnd == pzPins) || (*pzEnd && (*pzEnd != ','))) { break; }
+        pzPins = *pzEnd ? pzEnd + 1 : pzEnd;
+    }
+    if(*pzPins || !iNumTdo) {
+        printf("ERROR: -tdo takes 1-%d comma separated pins: %s\n", PORT_MAX_TDO, pzPins);
+        return -1;
+    }
+
+    memcpy(pPort->aiTdo, aiTdo, sizeof(aiTdo));
+    pPort->iNumTdo = iNumTdo;
+    pPort->aiPin[TDO] = aiTdo[0];
+    return 0;
+}
 
-    switch(value) {
-        case 1:
-        retval = write(fv, "1", 1);
-        break;
+int portsTdoPin(SPort* pPort, int iChain)
+{
+    return pPort->iNumTdo ? pPort->aiTdo[iChain] : pPort->aiPin[TDO];
+}
 
-        case 0:
-        retval = write(fv, "0", 1);
-        break;
+int hardwareSetup()
+{
+    int retval;
 
-        default:
-        printf("ERROR: unknown writeGPIO value: %d\n", value);
-        break;
+    printf("doing hardware setup (%s%s)\n", g_pPort->pDriver->pzName,
+           g_pPort->pzSpiDevice ? " + spi" : "");
+
+    g_pPort->lErrors = 0;
+    if (g_pPort->pzSpiDevice)
+        retval = portSpiDriver.pfOpen(g_pPort);
+    else
+        retval = g_pPort->pDriver->pfOpen(g_pPort);
+    if (!retval && (g_pPort->iNumTdo > 1) && !g_pPort->pDriver->pfReadTDOs) {
+        printf("ERROR: the %s driver cannot read %d TDO lines\n",
+               g_pPort->pDriver->pzName, g_pPort->iNumTdo);
+        g_pPort->pDriver->pfClose(g_pPort);
+        retval = -1;
     }
-
-    if(retval != 1){
-        printf("ERROR: writeGPIO returned: %d\n", retval);
+    if (!retval && g_pPort->pzTck) {
+        retval = portPaceDriver.pfOpen(g_pPort);
+        if (retval)
+            g_pPort->pDriver->pfClose(g_pPort);
     }
+    return retval;
+}
+
+void hardwareCleanup()
+{
+    g_pPort->pDriver->pfClose(g_pPort);
 }
 
+
+/*BYTE *xsvf_data=0;*/
+
 /* setPort:  Implement to set the named JTAG signal (p) to the new value (v).*/
-/* if in debugging mode, then just set the variables */
+/* TMS and TDI are only latched here; a TCK write hands all three levels  */
+/* to the port driver, which skips the pins that did not change.          */
 void setPort(short p,short val)
 {
-
-    if (p==TMS)
-        g_iTMS = val;
-    if (p==TDI)
-        g_iTDI = val;
+    g_pPort->asLevel[p] = val;
     if (p==TCK) {
-        g_iTCK = val;
-        //printf( "TCK = %d;  TMS = %d;  TDI = %d\n", g_iTCK, g_iTMS, g_iTDI );
-
-        writeGPIO(fvTMS, g_iTMS);
-        writeGPIO(fvTDI, g_iTDI);
-        writeGPIO(fvTCK, g_iTCK);
+        g_pPort->pDriver->pfSetPins(g_pPort, g_pPort->asLevel[TMS],
+                                  g_pPort->asLevel[TDI], val);
 
         //usleep(USLEEPTIME);
     }
 }
 
+/* pulseClock:  make clock go down->up */
+void pulseClock()
+{
+    setPort(TCK,0);
+    setPort(TCK,1);
+}
+
 
 /* readByte:  Implement to source the next byte from your XSVF file location */
 /* read in a byte of data from the prom */
 void readByte(unsigned char *data)
 {
-    /* pretend reading using a file */
-    *data   = (unsigned char)fgetc( in );
-    /**data=*xsvf_data++;*/
+    if (in->pucCur < in->pucEnd) {
+        *data = *in->pucCur++;
+    } else if (inputRead(in, data, 1) != 1) {
+        *data = 0;  /* readEOF() reports the truncation */
+    }
+}
+
+/* readBytes:  read numBytes bytes of XSVF data with one copy */
+void readBytes(unsigned char *data, long numBytes)
+{
+    long got = inputRead(in, data, numBytes);
+    if (got < numBytes)
+        memset(data + got, 0, numBytes - got);
+}
+
+/* readEOF:  non-zero once a read ran past the end of the XSVF data */
+int readEOF()
+{
+    return in->iEof;
 }
 
 /* readTDOBit:  Implement to return the current value of the JTAG TDO signal.*/
 /* read the TDO bit from port */
 unsigned char readTDOBit()
 {
-    if (lseek(fvTDO, 0, SEEK_SET) < 0) {
-        printf("ERROR: readTDOBit - lseek failed: %s\n", strerror(errno));
-        close(fvTDO);
-        fvTDO = -1;
-        return 255;
+    return g_pPort->pDriver->pfReadTDO(g_pPort);
+}
+
+/* portsShiftPerBit:  shiftBits() fallback for drivers without        */
+/* pfShiftBits.  Drives the pins directly instead of through setPort.  */
+void portsShiftPerBit(SPort* pPort, const unsigned char* pucTdi,
+                        unsigned char* pucTdo, long lNumBits, int iTmsOnLast)
+{
+    const SPortDriver*  pDriver = pPort->pDriver;
+    long                lNumBytes = (lNumBits + 7) / 8;
+    short               sTms = pPort->asLevel[TMS];
+    short               sTdi = pPort->asLevel[TDI];
+    unsigned char       ucTdiByte;
+    unsigned char       ucTdoByte;
+    int                 i;
+
+    /* Shift LSB first.  Last byte holds the first bits. */
+    pucTdi += lNumBytes;
+    if (pucTdo)
+        pucTdo += lNumBytes;
+    while (lNumBits) {
+        ucTdiByte = *(--pucTdi);
+        ucTdoByte = 0;
+        for (i = 0; lNumBits && (i < 8); ++i) {
+            if (!(--lNumBits) && iTmsOnLast)
+                sTms = 1;
+            sTdi = (short)(ucTdiByte & 1);
+            ucTdiByte >>= 1;
+            pDriver->pfSetPins(pPort, sTms, sTdi, 0);
+            if (pucTdo)
+                ucTdoByte |= (unsigned char)(pDriver->pfReadTDO(pPort) << i);
+            pDriver->pfSetPins(pPort, sTms, sTdi, 1);
+        }
+        if (pucTdo)
+            *(--pucTdo) = ucTdoByte;
+    }
+
+    pPort->asLevel[TMS] = sTms;
+    pPort->asLevel[TDI] = sTdi;
+    pPort->asLevel[TCK] = 1;
+}
+
+void shiftBits(const unsigned char* pucTdi, unsigned char* pucTdo,
+               long lNumBits, int iTmsOnLast)
+{
+    if (!lNumBits)
+        return;
+    if (g_pPort->pDriver->pfShiftBits)
+        g_pPort->pDriver->pfShiftBits(g_pPort, pucTdi, pucTdo, lNumBits, iTmsOnLast);
+    else
+        portsShiftPerBit(g_pPort, pucTdi, pucTdo, lNumBits, iTmsOnLast);
+}
+
+/* portsShiftBroadcast:  shiftBits() for broadcast chains.  One      */
+/* pfReadTDOs() per bit samples every chain's TDO at once.             */
+void portsShiftBroadcast(SPort* pPort, const unsigned char* pucTdi,
+                         unsigned char** apucTdo, long lNumBits, int iTmsOnLast)
+{
+    const SPortDriver*  pDriver = pPort->pDriver;
+    long                lIndex = (lNumBits + 7) / 8;
+    short               sTms = pPort->asLevel[TMS];
+    short               sTdi = pPort->asLevel[TDI];
+    unsigned long       aulTdo[8];
+    unsigned char       ucTdiByte;
+    unsigned char       ucTdoByte;
+    int                 iChain;
+    int                 iBits;
+    int                 i;
+
+    /* Shift LSB first.  Last byte holds the first bits. */
+    while (lNumBits) {
+        ucTdiByte = pucTdi[--lIndex];
+        for (iBits = 0; lNumBits && (iBits < 8); ++iBits) {
+            if (!(--lNumBits) && iTmsOnLast)
+                sTms = 1;
+            sTdi = (short)(ucTdiByte & 1);
+            ucTdiByte >>= 1;
+            pDriver->pfSetPins(pPort, sTms, sTdi, 0);
+            aulTdo[iBits] = pDriver->pfReadTDOs(pPort);
+            pDriver->pfSetPins(pPort, sTms, sTdi, 1);
+        }
+        /* turn 8 samples of every chain into one TDO byte per chain */
+        for (iChain = 0; iChain < pPort->iNumTdo; ++iChain) {
+            ucTdoByte = 0;
+            for (i = 0; i < iBits; ++i)
+                ucTdoByte |= (unsigned char)(((aulTdo[i] >> iChain) & 1) << i);
+            apucTdo[iChain][lIndex] = ucTdoByte;
+        }
+    }
+
+    pPort->asLevel[TMS] = sTms;
+    pPort->asLevel[TDI] = sTdi;
+    pPort->asLevel[TCK] = 1;
+}
+
+void shiftBitsBroadcast(const unsigned char* pucTdi, unsigned char** apucTdo,
+                        long lNumBits, int iTmsOnLast)
+{
+    if (lNumBits)
+        portsShiftBroadcast(g_pPort, pucTdi, apucTdo, lNumBits, iTmsOnLast);
+}
+
+/* portsShiftTms:  TMS burst through the driver, or per bit with the */
+/* same pin sequence as setPort(TMS); setPort(TCK,0); setPort(TCK,1).  */
+void portsShiftTms(SPort* pPort, unsigned long ulTms, int iNumBits)
+{
+    const SPortDriver*  pDriver = pPort->pDriver;
+    short               sTms = pPort->asLevel[TMS];
+
+    if (!iNumBits)
+        return;
+    if (pDriver->pfShiftTms) {
+        pDriver->pfShiftTms(pPort, ulTms, iNumBits);
+        return;
     }
 
-    char buf[2] = { 0, 0 };
-    if (read(fvTDO, buf, 1) < 0) {
-        printf("ERROR: readTDOBit - read failed: %s\n", strerror(errno));
-        close(fvTDO);
-        fvTDO = -1;
-        return 255;
+    for (; iNumBits; --iNumBits, ulTms >>= 1) {
+        sTms = (short)(ulTms & 1);
+        pDriver->pfSetPins(pPort, sTms, pPort->asLevel[TDI], 0);
+        pDriver->pfSetPins(pPort, sTms, pPort->asLevel[TDI], 1);
     }
+    pPort->asLevel[TMS] = sTms;
+    pPort->asLevel[TCK] = 1;
+}
 
-    unsigned char retval = atoi(buf);
-//    printf("TDO: %d\n", retval);
-    return retval;
+void shiftTms(unsigned long ulTms, int iNumBits)
+{
+    portsShiftTms(g_pPort, ulTms, iNumBits);
 }
 
 /* waitTime:  Implement as follows: */
@@ -194,9 +365,11 @@ unsigned char readTDOBit()
 /*                              requirement is also satisfied.               */
 void waitTime(long microsec)
 {
+#if 0   /* for the implementations below */
     static long tckCyclesPerMicrosec    = 1; /* must be at least 1 */
     long        tckCycles   = microsec * tckCyclesPerMicrosec;
     long        i;
+#endif
 
 
 #if 0
@@ -240,7 +413,7 @@ void waitTime(long microsec)
     }
 #endif
 
-#if 1
+#if 0
     /* Alternate implementation */
     /* This implementation is valid for only XC9500/XL/XV, CoolRunner/II CPLDs,
        XC18V00 PROMs, or Platform Flash XCFxxS/XCFxxP PROMs.
@@ -251,4 +424,9 @@ void waitTime(long microsec)
     /* Use Windows Sleep().  Round up to the nearest millisec */
     usleep(microsec);
 #endif
+
+    /* timing.c:  "sleep" (default) and "spin" keep TCK low like the CPLD/PROM
+       implementation above; "tck" is the running TCK implementation with a
+       measured TCK rate instead of tckCyclesPerMicrosec. */
+    timingWait(g_pPort, microsec);
 }
@@ -13,6 +13,28 @@
 #define TCK (short) 0
 #define TMS (short) 1
 #define TDI (short) 2
+/* TDO is only used as an index into SPort.aiPin; read it with readTDOBit */
+#define TDO (short) 3
+
+#define PORT_NUM_PINS   4
+
+/* broadcast:  several chains sharing one TMS/TDI/TCK, each with its */
+/* own TDO; chain i is bit i of an unsigned long                      */
+#define PORT_MAX_TDO    32
+
+/* TCK pacing:  phases that -tck can set one by one */
+#define PORT_PACE_PHASES    16
+
+/* storage class of the state the player keeps for the chain it is    */
+/* playing (the current port, the XSVF input, the counters), so that   */
+/* each thread can play its own chain (see xsvfmulti.c)                */
+#ifndef XSVF_THREAD
+#if defined(__GNUC__)
+#define XSVF_THREAD __thread
+#else
+#define XSVF_THREAD
+#endif
+#endif
 
 /* set the port "p" (TCK, TMS, or TDI) to val (0 or 1) */
 extern void setPort(short p, short val);
@@ -26,6 +48,137 @@ extern void pulseClock();
 /* read the next byte of data from the xsvf file */
 extern void readByte(unsigned char *data);
 
+/* read the next numBytes bytes of data from the xsvf file */
+extern void readBytes(unsigned char *data, long numBytes);
+
+/* non-zero once a read ran past the end of the xsvf data */
+extern int readEOF();
+
 extern void waitTime(long microsec);
 
+/* shift lNumBits from pucTdi into the chain, optionally capturing TDO */
+/* into pucTdo.  Both buffers use lenVal byte order: (lNumBits+7)/8    */
+/* bytes with the first bit shifted in the LSB of the LAST byte.       */
+/* If iTmsOnLast, TMS is set to 1 for the last bit to exit Shift-xR.   */
+extern void shiftBits(const unsigned char* pucTdi, unsigned char* pucTdo,
+                      long lNumBits, int iTmsOnLast);
+
+/* clock iNumBits TMS values from ulTms, first bit in the LSB, with one */
+/* TCK pulse each and TDI held.  Used for whole TAP state transitions. */
+extern void shiftTms(unsigned long ulTms, int iNumBits);
+
+/* broadcast shiftBits():  the TDO of chain i is captured into         */
+/* apucTdo[i] for each of the current port's iNumTdo chains            */
+extern void shiftBitsBroadcast(const unsigned char* pucTdi,
+                               unsigned char** apucTdo, long lNumBits,
+                               int iTmsOnLast);
+
+/*******************************************************/
+/* Port drivers                                        */
+/* setPort()/readTDOBit() keep the requested TMS/TDI/  */
+/* TCK levels in an SPort and hand them to a driver    */
+/* on every TCK write.  A driver only has to touch the */
+/* pins whose level changed since its last call.       */
+/*******************************************************/
+typedef struct tagSPort SPort;
+
+typedef struct tagSPortDriver
+{
+    const char*     pzName;
+    /* open the pins named by pPort->aiPin; 0 = success */
+    int             (*pfOpen)( SPort* pPort );
+    void            (*pfClose)( SPort* pPort );
+    /* drive TMS and TDI, then TCK */
+    void            (*pfSetPins)( SPort* pPort, short sTms, short sTdi,
+                                  short sTck );
+    /* sample TDO; 0 or 1, 255 on error */
+    unsigned char   (*pfReadTDO)( SPort* pPort );
+    /* optional; see shiftBits().  0 = per-bit fallback in ports.c */
+    void            (*pfShiftBits)( SPort* pPort, const unsigned char* pucTdi,
+                                    unsigned char* pucTdo, long lNumBits,
+                                    int iTmsOnLast );
+    /* optional; see shiftTms().  0 = per-bit fallback in ports.c */
+    void            (*pfShiftTms)( SPort* pPort, unsigned long ulTms,
+                                   int iNumBits );
+    /* optional; broadcast: sample the TDO of every chain in aiTdo,   */
+    /* chain i in bit i.  0 = the driver cannot broadcast             */
+    unsigned long   (*pfReadTDOs)( SPort* pPort );
+} SPortDriver;
+
+struct tagSPort
+{
+    const SPortDriver*  pDriver;
+    const char*         pzPath;     /* sysfs root, device node, config file */
+    const char*         pzSpiDevice;/* "spidev[:hz]" for bulk shifts, or 0 */
+    int                 aiPin[ PORT_NUM_PINS ]; /* indexed by TCK..TDO */
+    short               asLevel[ 3 ];   /* requested TCK/TMS/TDI levels */
+    void*               pvDriverData;
+    long                lSyscalls;  /* syscalls issued by the driver */
+    int                 iNumTdo;    /* broadcast chains; 0 = aiPin[TDO] only */
+    int                 aiTdo[ PORT_MAX_TDO ];  /* TDO pin of each chain */
+    const char*         pzTck;      /* "hz[,n=hz...]" paces TCK, or 0 */
+    long                lErrors;    /* shifts the driver could not finish; */
+                                    /* xsvfShiftOnly() stops the run       */
+};
+
+extern const SPortDriver portSysfsDriver;
+extern const SPortDriver portGpiodDriver;
+extern const SPortDriver portMmioDriver;
+extern const SPortDriver portSpiDriver;    /* wraps the selected driver */
+extern const SPortDriver portNullDriver;   /* no I/O, for benchmarks */
+extern const SPortDriver portSimDriver;    /* simulated TAP and chain */
+extern const SPortDriver portPaceDriver;   /* paces the opened driver's TCK */
+
+/* the port used by setPort()/readTDOBit() on this thread */
+extern SPort* portsCurrent();
+
+/* make pPort the current port of this thread */
+extern void portsSetCurrent(SPort* pPort);
+
+/* select a driver by name; 0 = success */
+extern int portsSelectDriver(SPort* pPort, const char* pzName);
+
+/* parse "tms,tdi,tck,tdo" into pPort->aiPin; 0 = success */
+extern int portsParsePins(SPort* pPort, const char* pzPins);
+
+/* parse "tdo0,tdo1,..." into pPort->aiTdo for broadcast; 0 = success */
+extern int portsParseTdo(SPort* pPort, const char* pzPins);
+
+/* the TDO pin of chain iChain (aiTdo, or aiPin[TDO] if not broadcast) */
+extern int portsTdoPin(SPort* pPort, int iChain);
+
+/* shiftBitsBroadcast() on pPort through pfSetPins and pfReadTDOs */
+extern void portsShiftBroadcast(SPort* pPort, const unsigned char* pucTdi,
+                                unsigned char** apucTdo, long lNumBits,
+                                int iTmsOnLast);
+
+/* shiftBits() one bit at a time through pPort->pDriver->pfSetPins */
+extern void portsShiftPerBit(SPort* pPort, const unsigned char* pucTdi,
+                             unsigned char* pucTdo, long lNumBits,
+                             int iTmsOnLast);
+
+/* shiftTms() on pPort, through pfShiftTms or one bit at a time */
+extern void portsShiftTms(SPort* pPort, unsigned long ulTms, int iNumBits);
+
+/* TCK pacing (ports_pace.c).  With SPort.pzTck set, hardwareSetup() */
+/* wraps the opened driver so TCK runs at most at the frequency of the */
+/* current phase.  Phase 0 starts the file and each FREQUENCY          */
+/* directive (an SVF statement, or an XSVF XCOMMENT "FREQUENCY f HZ;") */
+/* starts the next one.  A phase runs at the file's frequency capped   */
+/* by the default hz, unless "n=hz" sets phase n.  0 = free running.   */
+
+/* parse "hz[,n=hz...]"; adPhaseHz gets PORT_PACE_PHASES entries, -1 = */
+/* not set.  0 = success                                               */
+extern int portsParseTck(const char* pzSpec, double* pdDefaultHz, double* adPhaseHz);
+
+/* a FREQUENCY directive of dHz (0 = "FREQUENCY;") on a paced pPort */
+extern void portsPaceFrequency(SPort* pPort, double dHz);
+
+/* portsPaceFrequency() if the comment text is a FREQUENCY statement */
+extern void portsPaceComment(SPort* pPort, const char* pzText);
+
+/* open/close the current port */
+extern int hardwareSetup();
+extern void hardwareCleanup();
+
 #endif
@@ -0,0 +1,189 @@
+/*******************************************************/
+/* file: ports_gpiod.c                                 */
+/* abstract:  This file contains the port driver for   */
+/*            the Linux GPIO character device (uAPI    */
+/*            v2).  TMS/TDI/TCK are requested as one   */
+/*            output line group and TDO as an input,   */
+/*            so a TCK edge is one SET_VALUES ioctl    */
+/*            and a TDO sample is one GET_VALUES ioctl.*/
+/*            SPort.pzPath names the chip (default     */
+/*            /dev/gpiochip0) and SPort.aiPin holds    */
+/*            line offsets on that chip.  The gpio-sim */
+/*            module provides a hardware-free chip.    */
+/*******************************************************/
+#include "ports.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+#define GPIOD_CHIP      "/dev/gpiochip0"
+#define GPIOD_CONSUMER  "playxsvf"
+
+/* bit positions of the outputs within the output line request */
+#define GPIOD_BIT_TMS   0
+#define GPIOD_BIT_TDI   1
+#define GPIOD_BIT_TCK   2
+
+typedef struct tagSGpiodPort
+{
+    int         fdOut;      /* line request fd for TMS/TDI/TCK */
+    int         fdIn;       /* line request fd for TDO (every chain) */
+    __u64       ullDriven;  /* last output bits set */
+} SGpiodPort;
+
+static int requestLines(int fdChip, const __u32* pulOffsets, int iNumLines,
+                        __u64 ullFlags)
+{
+    struct gpio_v2_line_request req;
+    int i;
+
+    memset(&req, 0, sizeof(req));
+    for(i = 0; i < iNumLines; ++i) { req.offsets[i] = pulOffsets[i]; }
+    strncpy(req.consumer, GPIOD_CONSUMER, sizeof(req.consumer) - 1);
+    req.config.flags = ullFlags;
+    if(ullFlags & GPIO_V2_LINE_FLAG_OUTPUT) {
+        /* start with all outputs low */
+        req.config.num_attrs = 1;
+        req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+        req.config.attrs[0].attr.values = 0;
+        req.config.attrs[0].mask = (1ULL << iNumLines) - 1;
+    }
+    req.num_lines = iNumLines;
+
+    if(ioctl(fdChip, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        printf("ERROR: gpiod line request failed: %s\n", strerror(errno));
+        return -1;
+    }
+    return req.fd;
+}
+
+static void gpiodClose(SPort* pPort)
+{
+    SGpiodPort* pGpiod = (SGpiodPort*)pPort->pvDriverData;
+
+    if(!pGpiod) { return; }
+    if(pGpiod->fdOut >= 0) { close(pGpiod->fdOut); }
+    if(pGpiod->fdIn >= 0) { close(pGpiod->fdIn); }
+    free(pGpiod);
+    pPort->pvDriverData = 0;
+}
+
+static int gpiodOpen(SPort* pPort)
+{
+    SGpiodPort* pGpiod;
+    const char* pzChip;
+    __u32       aulOut[3];
+    __u32       aulIn[PORT_MAX_TDO];
+    int         iNumIn;
+    int         fdChip;
+    int         i;
+
+    pzChip = pPort->pzPath ? pPort->pzPath : GPIOD_CHIP;
+    fdChip = open(pzChip, O_RDWR | O_CLOEXEC);
+    if(fdChip < 0) { printf("error opening %s\n", pzChip); return -1; }
+
+    pGpiod = (SGpiodPort*)malloc(sizeof(SGpiodPort));
+    if(!pGpiod) { close(fdChip); return -1; }
+    pPort->pvDriverData = pGpiod;
+
+    aulOut[GPIOD_BIT_TMS] = pPort->aiPin[TMS];
+    aulOut[GPIOD_BIT_TDI] = pPort->aiPin[TDI];
+    aulOut[GPIOD_BIT_TCK] = pPort->aiPin[TCK];
+    iNumIn = pPort->iNumTdo ? pPort->iNumTdo : 1;
+    for(i = 0; i < iNumIn; ++i) { aulIn[i] = portsTdoPin(pPort, i); }
+
+    pGpiod->ullDriven = 0;
+    pGpiod->fdOut = requestLines(fdChip, aulOut, 3, GPIO_V2_LINE_FLAG_OUTPUT);
+    pGpiod->fdIn  = requestLines(fdChip, aulIn, iNumIn, GPIO_V2_LINE_FLAG_INPUT);
+    close(fdChip);
+
+    if((pGpiod->fdOut < 0) || (pGpiod->fdIn < 0)) {
+        gpiodClose(pPort);
+        return -1;
+    }
+    return 0;
+}
+
+static void setLines(SPort* pPort, __u64 ullBits, __u64 ullMask)
+{
+    SGpiodPort* pGpiod = (SGpiodPort*)pPort->pvDriverData;
+    struct gpio_v2_line_values values;
+
+    values.bits = ullBits;
+    values.mask = ullMask;
+    ++pPort->lSyscalls;
+    if(ioctl(pGpiod->fdOut, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) < 0) {
+        printf("ERROR: gpiod set values failed: %s\n", strerror(errno));
+        return;
+    }
+    pGpiod->ullDriven = (pGpiod->ullDriven & ~ullMask) | (ullBits & ullMask);
+}
+
+static void gpiodSetPins(SPort* pPort, short sTms, short sTdi, short sTck)
+{
+    SGpiodPort* pGpiod = (SGpiodPort*)pPort->pvDriverData;
+    __u64 ullBits;
+    __u64 ullChanged;
+
+    ullBits = ((__u64)(sTms != 0) << GPIOD_BIT_TMS) |
+              ((__u64)(sTdi != 0) << GPIOD_BIT_TDI) |
+              ((__u64)(sTck != 0) << GPIOD_BIT_TCK);
+    ullChanged = ullBits ^ pGpiod->ullDriven;
+    if(!ullChanged) { return; }
+
+    /* TMS/TDI must be stable before a rising TCK edge */
+    if((ullChanged & (1ULL << GPIOD_BIT_TCK)) && sTck &&
+       (ullChanged & ~(1ULL << GPIOD_BIT_TCK))) {
+        setLines(pPort, ullBits, ullChanged & ~(1ULL << GPIOD_BIT_TCK));
+        ullChanged = 1ULL << GPIOD_BIT_TCK;
+    }
+    setLines(pPort, ullBits, ullChanged);
+}
+
+static unsigned char gpiodReadTDO(SPort* pPort)
+{
+    SGpiodPort* pGpiod = (SGpiodPort*)pPort->pvDriverData;
+    struct gpio_v2_line_values values;
+
+    values.bits = 0;
+    values.mask = 1;
+    ++pPort->lSyscalls;
+    if(ioctl(pGpiod->fdIn, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+        printf("ERROR: readTDOBit - gpiod get values failed: %s\n", strerror(errno));
+        return 255;
+    }
+    return (unsigned char)(values.bits & 1);
+}
+
+static unsigned long gpiodReadTDOs(SPort* pPort)
+{
+    SGpiodPort* pGpiod = (SGpiodPort*)pPort->pvDriverData;
+    struct gpio_v2_line_values values;
+
+    values.bits = 0;
+    values.mask = (1ULL << pPort->iNumTdo) - 1;
+    ++pPort->lSyscalls;
+    if(ioctl(pGpiod->fdIn, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+        printf("ERROR: readTDOBit - gpiod get values failed: %s\n", strerror(errno));
+        return 0;
+    }
+    return (unsigned long)values.bits;
+}
+
+const SPortDriver portGpiodDriver =
+{
+    "gpiod",
+    gpiodOpen,
+    gpiodClose,
+    gpiodSetPins,
+    gpiodReadTDO,
+    0,  /* pfShiftBits: use the per-bit fallback */
+    0,  /* pfShiftTms: use the per-bit fallback */
+    gpiodReadTDOs
+};
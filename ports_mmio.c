@@ -0,0 +1,354 @@
+/*******************************************************/
+/* file: ports_mmio.c                                  */
+/* abstract:  This file contains the port driver for   */
+/*            a memory-mapped SoC GPIO bank.  The      */
+/*            data/direction registers are mmap()ed    */
+/*            from /dev/mem, a UIO device, or a plain  */
+/*            file acting as a simulated register      */
+/*            block, so setPort/readTDOBit are plain   */
+/*            register stores and loads.               */
+/*            SPort.pzPath names a config file of      */
+/*            "key = value" lines:                     */
+/*              device   = /dev/mem   file to map      */
+/*              base     = 0x...      offset of bank   */
+/*              size     = 0x1000     bytes to map     */
+/*              data_out = 0x00       output register  */
+/*              data_in  = 0x00       input register   */
+/*              set      = 0x..       optional W1S reg */
+/*              clear    = 0x..       optional W1C reg */
+/*              dir      = 0x..       optional dir reg */
+/*              dir_out  = 1          dir bit = output */
+/*              tms/tdi/tck/tdo = n   bit positions    */
+/*            Broadcast TDO bits (-tdo) replace "tdo"  */
+/*            and are sampled with one register load.  */
+/*            Registers are 32 bits wide.  Offsets are */
+/*            relative to base; "#" starts a comment.  */
+/*******************************************************/
+#include "ports.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+
+typedef unsigned int    u32;
+
+typedef struct tagSMmioConfig
+{
+    char    szDevice[256];
+    long    lBase;
+    long    lSize;
+    long    lDataOut;
+    long    lDataIn;
+    long    lSet;       /* -1 = not present */
+    long    lClear;     /* -1 = not present */
+    long    lDir;       /* -1 = not present */
+    int     iDirOut;    /* value of a dir bit that selects output */
+    int     aiBit[ PORT_NUM_PINS ];
+} SMmioConfig;
+
+typedef struct tagSMmioPort
+{
+    void*               pvMap;
+    long                lMapSize;
+    volatile u32*       pulDataOut;
+    volatile u32*       pulDataIn;
+    volatile u32*       pulSet;
+    volatile u32*       pulClear;
+    u32                 aulMask[ PORT_NUM_PINS ];
+    u32                 ulDriven;   /* last TMS/TDI/TCK bits written */
+    u32                 ulTdoAll;   /* TDO bits of every chain */
+} SMmioPort;
+
+/* a register must lie inside the mapped size, 32-bit aligned */
+static int checkMmioOffset(const char* pzFile, const char* pzKey, long lOffset, long lSize)
+{
+    if((lOffset < 0) || (lOffset > lSize - 4) || (lOffset & 3)) {
+        printf("ERROR: %s: %s offset %ld is not 4-byte aligned within 0-%ld\n",
+               pzFile, pzKey, lOffset, lSize - 4);
+        return -1;
+    }
+    return 0;
+}
+
+static int readMmioConfig(const char* pzFile, SMmioConfig* pConfig, int iNumTdo)
+{
+    FILE*   fp;
+    char    line[512];
+    char    key[64];
+    char    val[256];
+    int     iLine;
+    int     iHaveSet = 0;
+    int     iHaveClear = 0;
+    int     iHaveDir = 0;
+
+    memset(pConfig, 0, sizeof(*pConfig));
+    strcpy(pConfig->szDevice, "/dev/mem");
+    pConfig->lSize   = 0x1000;
+    pConfig->lDataIn = -1;
+    pConfig->lSet    = -1;
+    pConfig->lClear  = -1;
+    pConfig->lDir    = -1;
+    pConfig->iDirOut = 1;
+    pConfig->aiBit[TMS] = pConfig->aiBit[TDI] = -1;
+    pConfig->aiBit[TCK] = pConfig->aiBit[TDO] = -1;
+
+    fp = fopen(pzFile, "r");
+    if(!fp) { printf("error opening %s\n", pzFile); return -1; }
+
+    for(iLine = 1; fgets(line, sizeof(line), fp); ++iLine) {
+        char* p = strchr(line, '#');
+        if(p) { *p = 0; }
+        if(sscanf(line, " %63[^= \t] = %255s", key, val) != 2) { continue; }
+
+        if(!strcmp(key, "device"))        { snprintf(pConfig->szDevice, sizeof(pConfig->szDevice), "%s", val); }
+        else if(!strcmp(key, "base"))     { pConfig->lBase    = strtol(val, 0, 0); }
+        else if(!strcmp(key, "size"))     { pConfig->lSize    = strtol(val, 0, 0); }
+        else if(!strcmp(key, "data_out")) { pConfig->lDataOut = strtol(val, 0, 0); }
+        else if(!strcmp(key, "data_in"))  { pConfig->lDataIn  = strtol(val, 0, 0); }
+        else if(!strcmp(key, "set"))      { pConfig->lSet     = strtol(val, 0, 0); iHaveSet = 1; }
+        else if(!strcmp(key, "clear"))    { pConfig->lClear   = strtol(val, 0, 0); iHaveClear = 1; }
+        else if(!strcmp(key, "dir"))      { pConfig->lDir     = strtol(val, 0, 0); iHaveDir = 1; }
+        else if(!strcmp(key, "dir_out"))  { pConfig->iDirOut  = (int)strtol(val, 0, 0); }
+        else if(!strcmp(key, "tms"))      { pConfig->aiBit[TMS] = (int)strtol(val, 0, 0); }
+        else if(!strcmp(key, "tdi"))      { pConfig->aiBit[TDI] = (int)strtol(val, 0, 0); }
+        else if(!strcmp(key, "tck"))      { pConfig->aiBit[TCK] = (int)strtol(val, 0, 0); }
+        else if(!strcmp(key, "tdo"))      { pConfig->aiBit[TDO] = (int)strtol(val, 0, 0); }
+        else { printf("WARNING: %s:%d: unknown key %s\n", pzFile, iLine, key); }
+    }
+    fclose(fp);
+
+    if(pConfig->lDataIn < 0) { pConfig->lDataIn = pConfig->lDataOut; }
+    if(iHaveSet != iHaveClear) {
+        printf("ERROR: %s: set and clear must be given together\n", pzFile);
+        return -1;
+    }
+
+    /* every register is checked before anything is mapped */
+    if(pConfig->lSize < 4) {
+        printf("ERROR: %s: size must be at least 4\n", pzFile);
+        return -1;
+    }
+    if(checkMmioOffset(pzFile, "data_out", pConfig->lDataOut, pConfig->lSize) ||
+       checkMmioOffset(pzFile, "data_in", pConfig->lDataIn, pConfig->lSize) ||
+       (iHaveSet && checkMmioOffset(pzFile, "set", pConfig->lSet, pConfig->lSize)) ||
+       (iHaveClear && checkMmioOffset(pzFile, "clear", pConfig->lClear, pConfig->lSize)) ||
+       (iHaveDir && checkMmioOffset(pzFile, "dir", pConfig->lDir, pConfig->lSize))) {
+        return -1;
+    }
+    if(iNumTdo) { pConfig->aiBit[TDO] = 0; }  /* taken from -tdo */
+    for(iLine = 0; iLine < PORT_NUM_PINS; ++iLine) {
+        if((pConfig->aiBit[iLine] < 0) || (pConfig->aiBit[iLine] > 31)) {
+            printf("ERROR: %s: tms, tdi, tck and tdo bits must be 0-31\n", pzFile);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static volatile u32* mmioReg(SMmioPort* pMmio, long lOffset)
+{
+    return (volatile u32*)((char*)pMmio->pvMap + lOffset);
+}
+
+static void mmioClose(SPort* pPort)
+{
+    SMmioPort* pMmio = (SMmioPort*)pPort->pvDriverData;
+
+    if(!pMmio) { return; }
+    if(pMmio->pvMap != MAP_FAILED) { munmap(pMmio->pvMap, pMmio->lMapSize); }
+    free(pMmio);
+    pPort->pvDriverData = 0;
+}
+
+static int mmioOpen(SPort* pPort)
+{
+    SMmioConfig config;
+    SMmioPort*  pMmio;
+    long        lPage;
+    long        lSkew;
+    int         fd;
+    int         i;
+
+    if(!pPort->pzPath) { printf("ERROR: mmio driver needs -gpio <config file>\n"); return -1; }
+    if(readMmioConfig(pPort->pzPath, &config, pPort->iNumTdo)) { return -1; }
+    for(i = 0; i < pPort->iNumTdo; ++i) {
+        if((pPort->aiTdo[i] < 0) || (pPort->aiTdo[i] > 31)) {
+            printf("ERROR: mmio -tdo bits must be 0-31\n");
+            return -1;
+        }
+    }
+    if(pPort->iNumTdo) { config.aiBit[TDO] = pPort->aiTdo[0]; }
+
+    fd = open(config.szDevice, O_RDWR | O_SYNC);
+    if(fd < 0) { printf("error opening %s\n", config.szDevice); return -1; }
+
+    pMmio = (SMmioPort*)malloc(sizeof(SMmioPort));
+    if(!pMmio) { close(fd); return -1; }
+    pPort->pvDriverData = pMmio;
+
+    /* mmap offsets must be page aligned */
+    lPage = sysconf(_SC_PAGESIZE);
+    lSkew = config.lBase % lPage;
+    pMmio->lMapSize = config.lSize + lSkew;
+    pMmio->pvMap = mmap(0, pMmio->lMapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                        fd, config.lBase - lSkew);
+    close(fd);
+    if(pMmio->pvMap == MAP_FAILED) {
+        printf("ERROR: mmap of %s failed: %s\n", config.szDevice, strerror(errno));
+        mmioClose(pPort);
+        return -1;
+    }
+    config.lDataOut += lSkew;
+    config.lDataIn  += lSkew;
+    if(config.lSet >= 0) { config.lSet += lSkew; config.lClear += lSkew; }
+    if(config.lDir >= 0) { config.lDir += lSkew; }
+
+    for(i = 0; i < PORT_NUM_PINS; ++i) { pMmio->aulMask[i] = 1u << config.aiBit[i]; }
+    pMmio->ulTdoAll = pMmio->aulMask[TDO];
+    for(i = 1; i < pPort->iNumTdo; ++i) { pMmio->ulTdoAll |= 1u << pPort->aiTdo[i]; }
+    pMmio->pulDataOut = mmioReg(pMmio, config.lDataOut);
+    pMmio->pulDataIn  = mmioReg(pMmio, config.lDataIn);
+    pMmio->pulSet     = (config.lSet >= 0) ? mmioReg(pMmio, config.lSet) : 0;
+    pMmio->pulClear   = (config.lClear >= 0) ? mmioReg(pMmio, config.lClear) : 0;
+
+    if(config.lDir >= 0) {
+        volatile u32* pulDir = mmioReg(pMmio, config.lDir);
+        u32 ulOut = pMmio->aulMask[TMS] | pMmio->aulMask[TDI] | pMmio->aulMask[TCK];
+        u32 ulDir = *pulDir;
+        if(config.iDirOut) {
+            ulDir = (ulDir | ulOut) & ~pMmio->ulTdoAll;
+        } else {
+            ulDir = (ulDir & ~ulOut) | pMmio->ulTdoAll;
+        }
+        *pulDir = ulDir;
+    }
+
+    pMmio->ulDriven = *pMmio->pulDataOut &
+        (pMmio->aulMask[TMS] | pMmio->aulMask[TDI] | pMmio->aulMask[TCK]);
+    return 0;
+}
+
+static void storeBits(SMmioPort* pMmio, u32 ulBits, u32 ulChanged)
+{
+    if(pMmio->pulSet) {
+        if(ulBits & ulChanged)  { *pMmio->pulSet   = ulBits & ulChanged; }
+        if(~ulBits & ulChanged) { *pMmio->pulClear = ~ulBits & ulChanged; }
+    } else {
+        *pMmio->pulDataOut = (*pMmio->pulDataOut & ~ulChanged) | (ulBits & ulChanged);
+    }
+    pMmio->ulDriven = (pMmio->ulDriven & ~ulChanged) | (ulBits & ulChanged);
+}
+
+static void mmioSetPins(SPort* pPort, short sTms, short sTdi, short sTck)
+{
+    SMmioPort* pMmio = (SMmioPort*)pPort->pvDriverData;
+    u32 ulBits;
+    u32 ulChanged;
+    u32 ulTck = pMmio->aulMask[TCK];
+
+    ulBits = (sTms ? pMmio->aulMask[TMS] : 0) |
+             (sTdi ? pMmio->aulMask[TDI] : 0) |
+             (sTck ? ulTck : 0);
+    ulChanged = ulBits ^ pMmio->ulDriven;
+    if(!ulChanged) { return; }
+
+    /* TMS/TDI must be stable before a rising TCK edge */
+    if((ulChanged & ulTck) && sTck && (ulChanged & ~ulTck)) {
+        storeBits(pMmio, ulBits, ulChanged & ~ulTck);
+        ulChanged = ulTck;
+    }
+    storeBits(pMmio, ulBits, ulChanged);
+}
+
+static unsigned char mmioReadTDO(SPort* pPort)
+{
+    SMmioPort* pMmio = (SMmioPort*)pPort->pvDriverData;
+
+    return (unsigned char)((*pMmio->pulDataIn & pMmio->aulMask[TDO]) != 0);
+}
+
+/* broadcast:  one load, then chain i's bit moved to bit i */
+static unsigned long mmioReadTDOs(SPort* pPort)
+{
+    SMmioPort* pMmio = (SMmioPort*)pPort->pvDriverData;
+    u32 ulIn = *pMmio->pulDataIn;
+    unsigned long ulTdo = 0;
+    int i;
+
+    for(i = 0; i < pPort->iNumTdo; ++i) {
+        if(ulIn & (1u << pPort->aiTdo[i])) { ulTdo |= 1UL << i; }
+    }
+    return ulTdo;
+}
+
+/* A whole span is shifted with register stores/loads in one loop.  TDI */
+/* changes together with the falling TCK edge; TCK rises on its own.   */
+static void mmioShiftBits(SPort* pPort, const unsigned char* pucTdi,
+                          unsigned char* pucTdo, long lNumBits, int iTmsOnLast)
+{
+    SMmioPort*      pMmio = (SMmioPort*)pPort->pvDriverData;
+    long            lNumBytes = (lNumBits + 7) / 8;
+    u32             ulTck = pMmio->aulMask[TCK];
+    u32             ulTdi = pMmio->aulMask[TDI];
+    u32             ulTdo = pMmio->aulMask[TDO];
+    u32             ulBits;
+    unsigned char   ucTdiByte;
+    unsigned char   ucTdoByte;
+    int             i;
+
+    ulBits = pMmio->ulDriven & pMmio->aulMask[TMS];
+    pucTdi += lNumBytes;
+    if(pucTdo) { pucTdo += lNumBytes; }
+    while(lNumBits) {
+        ucTdiByte = *(--pucTdi);
+        ucTdoByte = 0;
+        for(i = 0; lNumBits && (i < 8); ++i) {
+            if(!(--lNumBits) && iTmsOnLast) { ulBits |= pMmio->aulMask[TMS]; }
+            ulBits = (ucTdiByte & 1) ? (ulBits | ulTdi) : (ulBits & ~ulTdi);
+            ucTdiByte >>= 1;
+            storeBits(pMmio, ulBits, (ulBits ^ pMmio->ulDriven) | ulTck);
+            if(pucTdo && (*pMmio->pulDataIn & ulTdo)) { ucTdoByte |= (unsigned char)(1 << i); }
+            storeBits(pMmio, ulBits | ulTck, ulTck);
+        }
+        if(pucTdo) { *(--pucTdo) = ucTdoByte; }
+    }
+
+    pPort->asLevel[TMS] = (short)((ulBits & pMmio->aulMask[TMS]) != 0);
+    pPort->asLevel[TDI] = (short)((ulBits & ulTdi) != 0);
+    pPort->asLevel[TCK] = 1;
+}
+
+/* TMS bursts for TAP state transitions; TDI holds its requested level */
+static void mmioShiftTms(SPort* pPort, unsigned long ulTms, int iNumBits)
+{
+    SMmioPort*  pMmio = (SMmioPort*)pPort->pvDriverData;
+    u32         ulTck = pMmio->aulMask[TCK];
+    u32         ulTmsMask = pMmio->aulMask[TMS];
+    u32         ulBits;
+
+    ulBits = pPort->asLevel[TDI] ? pMmio->aulMask[TDI] : 0;
+    for(; iNumBits; --iNumBits, ulTms >>= 1) {
+        ulBits = (ulTms & 1) ? (ulBits | ulTmsMask) : (ulBits & ~ulTmsMask);
+        storeBits(pMmio, ulBits, (ulBits ^ pMmio->ulDriven) | ulTck);
+        storeBits(pMmio, ulBits | ulTck, ulTck);
+    }
+
+    pPort->asLevel[TMS] = (short)((ulBits & ulTmsMask) != 0);
+    pPort->asLevel[TCK] = 1;
+}
+
+const SPortDriver portMmioDriver =
+{
+    "mmio",
+    mmioOpen,
+    mmioClose,
+    mmioSetPins,
+    mmioReadTDO,
+    mmioShiftBits,
+    mmioShiftTms,
+    mmioReadTDOs
+};
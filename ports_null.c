@@ -0,0 +1,66 @@
+/*******************************************************/
+/* file: ports_null.c                                  */
+/* abstract:  This file contains the null port driver. */
+/*            It drives nothing and reads TDO as 0, so */
+/*            a run measures the interpreter alone     */
+/*            (see xsvfbench.c).  Whole shift spans    */
+/*            and TMS bursts are accepted in one call. */
+/*******************************************************/
+#include "ports.h"
+
+#include <string.h>
+
+static int nullOpen(SPort* pPort)
+{
+    (void)pPort;
+    return 0;
+}
+
+static void nullClose(SPort* pPort)
+{
+    (void)pPort;
+}
+
+static void nullSetPins(SPort* pPort, short sTms, short sTdi, short sTck)
+{
+    (void)pPort; (void)sTms; (void)sTdi; (void)sTck;
+}
+
+static unsigned char nullReadTDO(SPort* pPort)
+{
+    (void)pPort;
+    return 0;
+}
+
+static void nullShiftBits(SPort* pPort, const unsigned char* pucTdi,
+                          unsigned char* pucTdo, long lNumBits, int iTmsOnLast)
+{
+    (void)pucTdi;
+    if(pucTdo) { memset(pucTdo, 0, (lNumBits + 7) / 8); }
+    pPort->asLevel[TMS] = (short)(iTmsOnLast != 0);
+    pPort->asLevel[TCK] = 1;
+}
+
+static void nullShiftTms(SPort* pPort, unsigned long ulTms, int iNumBits)
+{
+    pPort->asLevel[TMS] = (short)((ulTms >> (iNumBits - 1)) & 1);
+    pPort->asLevel[TCK] = 1;
+}
+
+static unsigned long nullReadTDOs(SPort* pPort)
+{
+    (void)pPort;
+    return 0;
+}
+
+const SPortDriver portNullDriver =
+{
+    "null",
+    nullOpen,
+    nullClose,
+    nullSetPins,
+    nullReadTDO,
+    nullShiftBits,
+    nullShiftTms,
+    nullReadTDOs
+};
@@ -0,0 +1,417 @@
+/*******************************************************/
+/* file: ports_pace.c                                  */
+/* abstract:  This file contains the TCK pacing port   */
+/*            driver.  It wraps the opened driver of a */
+/*            port with SPort.pzTck set (see ports.h)  */
+/*            and holds every TCK level for at least   */
+/*            half a period of the current phase's     */
+/*            frequency.  Like SVF FREQUENCY, the rate */
+/*            is a maximum:  TCK may run slower, never */
+/*            faster.  Half periods worth several      */
+/*            clock reads wait on a CLOCK_MONOTONIC    */
+/*            deadline; shorter ones spin a loop that  */
+/*            is calibrated against the clock at open. */
+/*            Every PACE_BLOCK_EDGES spun edges the    */
+/*            clock is read again:  a block that ran   */
+/*            fast is waited out, and the loop count   */
+/*            is raised by the block's error; it never */
+/*            drops below the calibrated count.        */
+/*            A free running phase (0 Hz) keeps the    */
+/*            wrapped driver's bulk shifts.            */
+/*            On close the port prints the requested   */
+/*            and achieved frequency of each phase;    */
+/*            achieved is the TCK cycles of shiftBits()*/
+/*            and shiftTms() over the time they took.  */
+/*******************************************************/
+#include "ports.h"
+#include "timing.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define PACE_CAL_LOOPS      20000L  /* spin loops timed at open */
+#define PACE_CAL_TRIES      8
+#define PACE_CLOCK_READS    64      /* clock reads timed at open */
+#define PACE_CLOCK_FACTOR   4       /* deadlines for half periods of 4+ reads */
+#define PACE_BLOCK_EDGES    64      /* spun edges between clock reads */
+
+typedef struct tagSPacePhase
+{
+    double          dHz;            /* requested; 0 = free running */
+    long long       llCycles;       /* TCK cycles of the timed shifts */
+    long long       llNs;           /* time of the timed shifts */
+} SPacePhase;
+
+typedef struct tagSPacePort
+{
+    SPort           base;           /* the wrapped port */
+    double          dDefaultHz;     /* -tck hz; also caps the file's FREQUENCY */
+    double          adOverride[ PORT_PACE_PHASES ];  /* -tck n=hz; < 0 = none */
+    int             iPhase;
+    int             iDirectives;    /* FREQUENCY directives seen */
+    SPacePhase      aPhase[ PORT_PACE_PHASES ];
+    long long       llHalfNs;       /* half period; 0 = free running */
+    long            lLoops;         /* spin loops per half period; -1 = deadline */
+    long            lMinLoops;      /* calibrated loops per half period */
+    long long       llNextNs;       /* deadline:  earliest time of the next edge; */
+                                    /* spin:  start of the current block */
+    int             iBlockEdges;    /* edges spun in the current block */
+    short           sTck;           /* TCK level last driven */
+    double          dLoopsPerNs;    /* calibrated spin rate */
+    long long       llClockNs;      /* cost of one clock read */
+} SPacePort;
+
+/* fold the wrapped driver's syscall count into ours */
+static void syncBase(SPort* pPort, SPacePort* pPace)
+{
+    pPort->lSyscalls += pPace->base.lSyscalls;
+    pPace->base.lSyscalls = 0;
+    pPort->lErrors += pPace->base.lErrors;
+    pPace->base.lErrors = 0;
+}
+
+static void paceSpin(long lLoops)
+{
+    volatile long i;
+
+    for(i = 0; i < lLoops; ++i) {
+    }
+}
+
+/* time a clock read and the spin loop.  The fastest spin run is kept, */
+/* so a calibrated wait errs on the long side.                         */
+static void paceCalibrate(SPacePort* pPace)
+{
+    long long llStartNs;
+    long long llNs;
+    long long llBestNs = 0;
+    int i;
+
+    llStartNs = timingNowNs();
+    for(i = 0; i < PACE_CLOCK_READS; ++i) { timingNowNs(); }
+    pPace->llClockNs = (timingNowNs() - llStartNs) / (PACE_CLOCK_READS + 1);
+    if(pPace->llClockNs < 1) { pPace->llClockNs = 1; }
+
+    for(i = 0; i < PACE_CAL_TRIES; ++i) {
+        llStartNs = timingNowNs();
+        paceSpin(PACE_CAL_LOOPS);
+        llNs = timingNowNs() - llStartNs;
+        if(!i || (llNs < llBestNs)) { llBestNs = llNs; }
+    }
+    pPace->dLoopsPerNs = (double)PACE_CAL_LOOPS / (double)(llBestNs ? llBestNs : 1);
+}
+
+/* enter phase iPhase (the last one collects any later phases).  The */
+/* file's dFileHz applies up to the -tck default; n=hz always wins.   */
+static void paceSetPhase(SPacePort* pPace, int iPhase, double dFileHz)
+{
+    double dHz = pPace->dDefaultHz;
+
+    if(iPhase >= PORT_PACE_PHASES) { iPhase = PORT_PACE_PHASES - 1; }
+    if((dFileHz > 0) && ((dHz <= 0) || (dFileHz < dHz))) { dHz = dFileHz; }
+    if(pPace->adOverride[iPhase] >= 0) { dHz = pPace->adOverride[iPhase]; }
+
+    pPace->iPhase = iPhase;
+    pPace->aPhase[iPhase].dHz = dHz;
+    pPace->llHalfNs = (dHz > 0) ? (long long)(5e8 / dHz + 0.999) : 0;
+    if(pPace->llHalfNs >= PACE_CLOCK_FACTOR * pPace->llClockNs) {
+        pPace->lLoops = -1;
+    } else {
+        /* no allowance for the driver yet: the first block runs slow */
+        pPace->lLoops = (long)((double)pPace->llHalfNs * pPace->dLoopsPerNs + 0.999);
+    }
+    pPace->lMinLoops = pPace->lLoops;
+}
+
+/* count a timed shift */
+static void paceAccount(SPacePort* pPace, long lCycles, long long llNs)
+{
+    SPacePhase* pPhase = &pPace->aPhase[pPace->iPhase];
+
+    /* paced, the first edge or two of a shift need no wait:  their */
+    /* levels were held before it.  Count them as one period.        */
+    if(pPace->llHalfNs) { llNs += 2 * pPace->llHalfNs; }
+    pPhase->llCycles += lCycles;
+    pPhase->llNs += llNs;
+}
+
+/* start a spin block at the clock (a shift may follow a long gap) */
+static void paceStartBlock(SPacePort* pPace, long long llNowNs)
+{
+    if(pPace->lLoops >= 0) {
+        pPace->llNextNs = llNowNs;
+        pPace->iBlockEdges = 0;
+    }
+}
+
+/* end of a spin block:  a fast block raises the loop count by its    */
+/* error and is waited out.  A slow block leaves the count alone:  it */
+/* may include a gap, and fewer loops than calibrated could hold a    */
+/* level for less than half a period.                                 */
+static void paceEndBlock(SPacePort* pPace)
+{
+    long long llTargetNs = pPace->llNextNs + PACE_BLOCK_EDGES * pPace->llHalfNs;
+    long long llNowNs = timingNowNs();
+    long long llErrNs = llTargetNs - llNowNs;
+
+    if(llErrNs > 0) {
+        pPace->lLoops += (long)((double)llErrNs * pPace->dLoopsPerNs / PACE_BLOCK_EDGES);
+    }
+    if(pPace->lLoops < pPace->lMinLoops) { pPace->lLoops = pPace->lMinLoops; }
+
+    while(llNowNs < llTargetNs) { llNowNs = timingNowNs(); }
+    paceStartBlock(pPace, llNowNs);
+}
+
+/* "hz", "400k", "2.5M"; "max" = 0 = free running */
+static int paceParseHz(const char* pzText, char** ppzEnd, double* pdHz)
+{
+    double dHz;
+
+    if(!strncasecmp(pzText, "max", 3)) {
+        *ppzEnd = (char*)pzText + 3;
+        *pdHz = 0;
+        return 0;
+    }
+    dHz = strtod(pzText, ppzEnd);
+    if((*ppzEnd == pzText) || (dHz < 0)) { return -1; }
+    if((**ppzEnd == 'k') || (**ppzEnd == 'K')) {
+        dHz *= 1e3;
+        ++*ppzEnd;
+    } else if(**ppzEnd == 'M') {
+        dHz *= 1e6;
+        ++*ppzEnd;
+    }
+    *pdHz = dHz;
+    return 0;
+}
+
+int portsParseTck(const char* pzSpec, double* pdDefaultHz, double* adPhaseHz)
+{
+    char* pzEnd;
+    long lPhase;
+    int i;
+
+    for(i = 0; i < PORT_PACE_PHASES; ++i) { adPhaseHz[i] = -1; }
+    if(paceParseHz(pzSpec, &pzEnd, pdDefaultHz)) { return -1; }
+    while(*pzEnd == ',') {
+        pzSpec = pzEnd + 1;
+        lPhase = strtol(pzSpec, &pzEnd, 10);
+        if((pzEnd == pzSpec) || (*pzEnd != '=') ||
+           (lPhase < 0) || (lPhase >= PORT_PACE_PHASES)) {
+            return -1;
+        }
+        if(paceParseHz(pzEnd + 1, &pzEnd, &adPhaseHz[lPhase])) { return -1; }
+    }
+    return *pzEnd ? -1 : 0;
+}
+
+void portsPaceFrequency(SPort* pPort, double dHz)
+{
+    SPacePort* pPace;
+
+    if(pPort->pDriver != &portPaceDriver) { return; }
+    pPace = (SPacePort*)pPort->pvDriverData;
+    ++pPace->iDirectives;
+    paceSetPhase(pPace, pPace->iDirectives, dHz);
+}
+
+void portsPaceComment(SPort* pPort, const char* pzText)
+{
+    char* pzEnd;
+    double dHz = 0;
+
+    while(isspace((unsigned char)*pzText)) { ++pzText; }
+    if(strncasecmp(pzText, "FREQUENCY", 9)) { return; }
+    pzText += 9;
+    if(*pzText && (*pzText != ';') && !isspace((unsigned char)*pzText)) { return; }
+    while(isspace((unsigned char)*pzText)) { ++pzText; }
+
+    /* "FREQUENCY cycles HZ;" or "FREQUENCY;" */
+    if(*pzText && (*pzText != ';')) {
+        dHz = strtod(pzText, &pzEnd);
+        if((pzEnd == pzText) || (dHz <= 0)) { return; }
+        pzText = pzEnd;
+        while(isspace((unsigned char)*pzText)) { ++pzText; }
+        if(!strncasecmp(pzText, "HZ", 2)) { pzText += 2; }
+        while(isspace((unsigned char)*pzText)) { ++pzText; }
+        if(*pzText && (*pzText != ';')) { return; }
+    }
+    portsPaceFrequency(pPort, dHz);
+}
+
+static void paceReport(SPacePort* pPace)
+{
+    SPacePhase* pPhase;
+    char szHz[32];
+    int i;
+
+    for(i = 0; (i < PORT_PACE_PHASES) && (i <= pPace->iDirectives); ++i) {
+        pPhase = &pPace->aPhase[i];
+        if(pPhase->dHz > 0) {
+            snprintf(szHz, sizeof(szHz), "%.3f MHz", pPhase->dHz / 1e6);
+        } else {
+            snprintf(szHz, sizeof(szHz), "max");
+        }
+        printf("TCK phase %d%s: requested %s", i,
+               ((i == PORT_PACE_PHASES - 1) && (pPace->iDirectives >= PORT_PACE_PHASES)) ? "+" : "",
+               szHz);
+        if(pPhase->llNs > 0) {
+            printf(", achieved %.3f MHz over %lld cycles\n",
+                   (double)pPhase->llCycles * 1e3 / (double)pPhase->llNs, pPhase->llCycles);
+        } else {
+            printf(", no shifts\n");
+        }
+    }
+}
+
+static int paceOpen(SPort* pPort)
+{
+    SPacePort* pPace;
+
+    pPace = (SPacePort*)calloc(1, sizeof(SPacePort));
+    if(!pPace) { return -1; }
+    if(portsParseTck(pPort->pzTck, &pPace->dDefaultHz, pPace->adOverride)) {
+        printf("ERROR: bad TCK frequency: %s\n", pPort->pzTck);
+        free(pPace);
+        return -1;
+    }
+
+    /* the port's driver is already open; it moves into base */
+    pPace->base = *pPort;
+    pPace->base.lSyscalls = 0;
+    pPace->sTck = pPort->asLevel[TCK];
+    paceCalibrate(pPace);
+    paceSetPhase(pPace, 0, 0);
+    pPort->pDriver = &portPaceDriver;
+    pPort->pvDriverData = pPace;
+    return 0;
+}
+
+static void paceClose(SPort* pPort)
+{
+    SPacePort* pPace = (SPacePort*)pPort->pvDriverData;
+
+    if(!pPace) { return; }
+    paceReport(pPace);
+    syncBase(pPort, pPace);
+
+    /* hand the port back and close the wrapped driver on it */
+    pPort->pDriver = pPace->base.pDriver;
+    pPort->pvDriverData = pPace->base.pvDriverData;
+    free(pPace);
+    pPort->pDriver->pfClose(pPort);
+}
+
+/* hold the TCK level for half a period before it changes */
+static void paceSetPins(SPort* pPort, short sTms, short sTdi, short sTck)
+{
+    SPacePort* pPace = (SPacePort*)pPort->pvDriverData;
+    long long llNowNs;
+
+    if((sTck != pPace->sTck) && pPace->llHalfNs) {
+        if(pPace->lLoops >= 0) {
+            paceSpin(pPace->lLoops);
+            if(++pPace->iBlockEdges == PACE_BLOCK_EDGES) { paceEndBlock(pPace); }
+        } else {
+            llNowNs = timingNowNs();
+            while(llNowNs < pPace->llNextNs) { llNowNs = timingNowNs(); }
+            pPace->llNextNs = llNowNs + pPace->llHalfNs;
+        }
+    }
+    pPace->sTck = sTck;
+    pPace->base.pDriver->pfSetPins(&pPace->base, sTms, sTdi, sTck);
+    syncBase(pPort, pPace);
+}
+
+static unsigned char paceReadTDO(SPort* pPort)
+{
+    SPacePort*      pPace = (SPacePort*)pPort->pvDriverData;
+    unsigned char   ucTdo;
+
+    ucTdo = pPace->base.pDriver->pfReadTDO(&pPace->base);
+    syncBase(pPort, pPace);
+    return ucTdo;
+}
+
+static unsigned long paceReadTDOs(SPort* pPort)
+{
+    SPacePort*      pPace = (SPacePort*)pPort->pvDriverData;
+    unsigned long   ulTdo;
+
+    /* hardwareSetup() checked the wrapped driver has pfReadTDOs */
+    ulTdo = pPace->base.pDriver->pfReadTDOs(&pPace->base);
+    syncBase(pPort, pPace);
+    return ulTdo;
+}
+
+/* free running:  the wrapped driver's own shift, with our levels */
+static void paceBaseShift(SPort* pPort, SPacePort* pPace, const unsigned char* pucTdi,
+                          unsigned char* pucTdo, long lNumBits, int iTmsOnLast,
+                          unsigned long ulTms)
+{
+    memcpy(pPace->base.asLevel, pPort->asLevel, sizeof(pPort->asLevel));
+    if(!pucTdi) {
+        portsShiftTms(&pPace->base, ulTms, (int)lNumBits);
+    } else if(pPace->base.pDriver->pfShiftBits) {
+        pPace->base.pDriver->pfShiftBits(&pPace->base, pucTdi, pucTdo, lNumBits, iTmsOnLast);
+    } else {
+        portsShiftPerBit(&pPace->base, pucTdi, pucTdo, lNumBits, iTmsOnLast);
+    }
+    memcpy(pPort->asLevel, pPace->base.asLevel, sizeof(pPort->asLevel));
+    pPace->sTck = pPort->asLevel[TCK];
+    syncBase(pPort, pPace);
+}
+
+static void paceShiftBits(SPort* pPort, const unsigned char* pucTdi,
+                          unsigned char* pucTdo, long lNumBits, int iTmsOnLast)
+{
+    SPacePort*  pPace = (SPacePort*)pPort->pvDriverData;
+    long long   llStartNs = timingNowNs();
+
+    if(pPace->llHalfNs) {
+        /* every edge through paceSetPins() */
+        paceStartBlock(pPace, llStartNs);
+        portsShiftPerBit(pPort, pucTdi, pucTdo, lNumBits, iTmsOnLast);
+    } else {
+        paceBaseShift(pPort, pPace, pucTdi, pucTdo, lNumBits, iTmsOnLast, 0);
+    }
+    paceAccount(pPace, lNumBits, timingNowNs() - llStartNs);
+}
+
+static void paceShiftTms(SPort* pPort, unsigned long ulTms, int iNumBits)
+{
+    SPacePort*  pPace = (SPacePort*)pPort->pvDriverData;
+    long long   llStartNs = timingNowNs();
+    short       sTms = pPort->asLevel[TMS];
+    int         i;
+
+    if(pPace->llHalfNs) {
+        paceStartBlock(pPace, llStartNs);
+        for(i = 0; i < iNumBits; ++i, ulTms >>= 1) {
+            sTms = (short)(ulTms & 1);
+            paceSetPins(pPort, sTms, pPort->asLevel[TDI], 0);
+            paceSetPins(pPort, sTms, pPort->asLevel[TDI], 1);
+        }
+        pPort->asLevel[TMS] = sTms;
+        pPort->asLevel[TCK] = 1;
+    } else {
+        paceBaseShift(pPort, pPace, 0, 0, iNumBits, 0, ulTms);
+    }
+    paceAccount(pPace, iNumBits, timingNowNs() - llStartNs);
+}
+
+const SPortDriver portPaceDriver =
+{
+    "pace",
+    paceOpen,
+    paceClose,
+    paceSetPins,
+    paceReadTDO,
+    paceShiftBits,
+    paceShiftTms,
+    paceReadTDOs
+};
@@ -0,0 +1,390 @@
+/*******************************************************/
+/* file: ports_sim.c                                   */
+/* abstract:  This file contains a simulated JTAG      */
+/*            chain port driver.  Every TCK rising     */
+/*            edge steps an IEEE 1149.1 TAP controller */
+/*            (XTAPSTATE_* numbering) shared by a      */
+/*            chain of device models, so playback can  */
+/*            be checked without a board.  Each device */
+/*            has an instruction register, BYPASS, an  */
+/*            optional IDCODE register and an optional */
+/*            user data register that reads back the   */
+/*            value latched by its last Update-DR.     */
+/*            SPort.pzPath is a number n (n devices    */
+/*            with an 8-bit IR and BYPASS only; the    */
+/*            default is 1) or a config file of        */
+/*            "key = value" lines:                     */
+/*              device    = name   starts a device;    */
+/*                                 first is at TDI     */
+/*              irlen     = 8      IR bits (1-32)      */
+/*              idcode    = 0x..   IDCODE value        */
+/*              idcode_ir = 0x..   IDCODE instruction  */
+/*                                 (default 1)         */
+/*              drlen     = n      user DR bits; every */
+/*                                 instruction but     */
+/*                                 BYPASS/IDCODE uses  */
+/*                                 it (0 = BYPASS)     */
+/*              trace     = path   write one line per  */
+/*                                 TCK edge            */
+/*              tdo_stuck = 0x..   broadcast (-tdo)    */
+/*                                 chains whose TDO    */
+/*                                 reads 0; the others */
+/*                                 see the model's TDO */
+/*            Test-Logic-Reset selects IDCODE (BYPASS  */
+/*            without one) and clears the user DR.     */
+/*            Capture-IR loads ...01.  On close the    */
+/*            port prints the edge count and a hash of */
+/*            every TMS/TDI/TDO edge; equal hashes     */
+/*            mean bit-for-bit equal playback.         */
+/*            lSyscalls counts the writes and reads    */
+/*            the sysfs driver would issue.            */
+/*******************************************************/
+#include "ports.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_MAX_DEVICES 32
+#define SIM_MAX_DR      (1L << 24)
+#define SIM_FNV_BASIS   2166136261UL
+#define SIM_FNV_PRIME   16777619UL
+
+/* TAP states, same numbering as XTAPSTATE_* in microint.h */
+#define SIM_RESET       0x00
+#define SIM_CAPTUREDR   0x03
+#define SIM_SHIFTDR     0x04
+#define SIM_UPDATEDR    0x08
+#define SIM_CAPTUREIR   0x0A
+#define SIM_SHIFTIR     0x0B
+#define SIM_UPDATEIR    0x0F
+
+/* next state for TMS=0 and TMS=1 */
+static const unsigned char g_aucSimNext[16][2] =
+{
+    { 0x01, 0x00 },     /* RESET */
+    { 0x01, 0x02 },     /* RUNTEST/IDLE */
+    { 0x03, 0x09 },     /* DRSELECT */
+    { 0x04, 0x05 },     /* DRCAPTURE */
+    { 0x04, 0x05 },     /* DRSHIFT */
+    { 0x06, 0x08 },     /* DREXIT1 */
+    { 0x06, 0x07 },     /* DRPAUSE */
+    { 0x04, 0x08 },     /* DREXIT2 */
+    { 0x01, 0x02 },     /* DRUPDATE */
+    { 0x0A, 0x00 },     /* IRSELECT */
+    { 0x0B, 0x0C },     /* IRCAPTURE */
+    { 0x0B, 0x0C },     /* IRSHIFT */
+    { 0x0D, 0x0F },     /* IREXIT1 */
+    { 0x0D, 0x0E },     /* IRPAUSE */
+    { 0x0B, 0x0F },     /* IREXIT2 */
+    { 0x01, 0x02 }      /* IRUPDATE */
+};
+
+/* data register selected by the current instruction */
+#define SIM_DR_BYPASS   0
+#define SIM_DR_IDCODE   1
+#define SIM_DR_USER     2
+
+typedef struct tagSSimDevice
+{
+    int             iIrLen;
+    unsigned long   ulIrMask;
+    unsigned long   ulIdcode;
+    int             iHasIdcode;
+    unsigned long   ulIdcodeIr;
+    long            lDrLen;
+    unsigned long   ulIr;           /* current instruction */
+    int             iDr;            /* SIM_DR_* selected by ulIr */
+    unsigned long   ulShift;        /* IR, BYPASS or IDCODE shift stage */
+    unsigned char*  pucDr;          /* user DR ring, one byte per bit */
+    unsigned char*  pucDrLatch;     /* value of the last Update-DR */
+    long            lDrPos;         /* ring index of the bit nearest TDO */
+} SSimDevice;
+
+typedef struct tagSSimPort
+{
+    unsigned char   ucState;
+    short           asDriven[ 3 ];  /* last levels, for the syscall count */
+    int             iNumDevices;
+    SSimDevice      aDevice[ SIM_MAX_DEVICES ];
+    FILE*           fpTrace;
+    unsigned long   ulTdoStuck;     /* broadcast chains that read 0 */
+    long            lEdges;
+    unsigned long   ulHash;
+} SSimPort;
+
+static void simSelectDr(SSimDevice* pDev)
+{
+    if(pDev->ulIr == pDev->ulIrMask) {
+        pDev->iDr = SIM_DR_BYPASS;
+    } else if(pDev->iHasIdcode && (pDev->ulIr == pDev->ulIdcodeIr)) {
+        pDev->iDr = SIM_DR_IDCODE;
+    } else {
+        pDev->iDr = pDev->lDrLen ? SIM_DR_USER : SIM_DR_BYPASS;
+    }
+}
+
+static void simReset(SSimDevice* pDev)
+{
+    pDev->ulIr = pDev->iHasIdcode ? pDev->ulIdcodeIr : pDev->ulIrMask;
+    simSelectDr(pDev);
+    if(pDev->lDrLen) { memset(pDev->pucDrLatch, 0, pDev->lDrLen); }
+}
+
+static int simAddDevice(SSimPort* pSim)
+{
+    SSimDevice* pDev;
+
+    if(pSim->iNumDevices == SIM_MAX_DEVICES) {
+        printf("ERROR: sim chain has more than %d devices\n", SIM_MAX_DEVICES);
+        return -1;
+    }
+    pDev = &pSim->aDevice[pSim->iNumDevices++];
+    memset(pDev, 0, sizeof(*pDev));
+    pDev->iIrLen = 8;
+    pDev->ulIdcodeIr = 1;
+    return 0;
+}
+
+/* check the device and allocate its user DR */
+static int simFinishDevice(SSimDevice* pDev)
+{
+    if((pDev->iIrLen < 1) || (pDev->iIrLen > 32) ||
+       (pDev->lDrLen < 0) || (pDev->lDrLen > SIM_MAX_DR)) {
+        printf("ERROR: sim device needs irlen 1-32 and drlen 0-%ld\n", SIM_MAX_DR);
+        return -1;
+    }
+    pDev->ulIrMask = (pDev->iIrLen == 32) ? 0xFFFFFFFFUL : ((1UL << pDev->iIrLen) - 1);
+    pDev->ulIdcodeIr &= pDev->ulIrMask;
+    if(pDev->lDrLen) {
+        pDev->pucDr = (unsigned char*)calloc(pDev->lDrLen, 1);
+        pDev->pucDrLatch = (unsigned char*)calloc(pDev->lDrLen, 1);
+        if(!pDev->pucDr || !pDev->pucDrLatch) { return -1; }
+    }
+    simReset(pDev);
+    return 0;
+}
+
+static int readSimConfig(SSimPort* pSim, const char* pzFile, int iCurrent)
+{
+    FILE*       fp;
+    SSimDevice* pDev = 0;
+    char        line[512];
+    char        key[64];
+    char        val[256];
+    int         iLine;
+
+    fp = fopen(pzFile, "r");
+    if(!fp) { printf("error opening %s\n", pzFile); return -1; }
+
+    for(iLine = 1; fgets(line, sizeof(line), fp); ++iLine) {
+        char* p = strchr(line, '#');
+        if(p) { *p = 0; }
+        if(sscanf(line, " %63[^= \t] = %255s", key, val) != 2) { continue; }
+
+        if(!strcmp(key, "device")) {
+            if(simAddDevice(pSim)) { fclose(fp); return -1; }
+            pDev = &pSim->aDevice[pSim->iNumDevices - 1];
+        } else if(!strcmp(key, "trace")) {
+            /* only the port that plays the XSVF writes the trace */
+            if(iCurrent && !pSim->fpTrace) {
+                pSim->fpTrace = fopen(val, "w");
+                if(!pSim->fpTrace) { printf("error opening %s\n", val); }
+            }
+        } else if(!strcmp(key, "tdo_stuck")) {
+            pSim->ulTdoStuck = strtoul(val, 0, 0);
+        } else if(!pDev) {
+            printf("WARNING: %s:%d: %s before the first device\n", pzFile, iLine, key);
+        }
+        else if(!strcmp(key, "irlen"))     { pDev->iIrLen = (int)strtol(val, 0, 0); }
+        else if(!strcmp(key, "idcode"))    { pDev->ulIdcode = strtoul(val, 0, 0) & 0xFFFFFFFFUL;
+                                             pDev->iHasIdcode = 1; }
+        else if(!strcmp(key, "idcode_ir")) { pDev->ulIdcodeIr = strtoul(val, 0, 0); }
+        else if(!strcmp(key, "drlen"))     { pDev->lDrLen = strtol(val, 0, 0); }
+        else { printf("WARNING: %s:%d: unknown key %s\n", pzFile, iLine, key); }
+    }
+    fclose(fp);
+    return 0;
+}
+
+static void simClose(SPort* pPort)
+{
+    SSimPort* pSim = (SSimPort*)pPort->pvDriverData;
+    int i;
+
+    if(!pSim) { return; }
+    if(pPort == portsCurrent()) {
+        printf("sim: %ld TCK edges, trace hash 0x%08lx\n", pSim->lEdges, pSim->ulHash);
+    }
+    if(pSim->fpTrace) { fclose(pSim->fpTrace); }
+    for(i = 0; i < pSim->iNumDevices; ++i) {
+        free(pSim->aDevice[i].pucDr);
+        free(pSim->aDevice[i].pucDrLatch);
+    }
+    free(pSim);
+    pPort->pvDriverData = 0;
+}
+
+static int simOpen(SPort* pPort)
+{
+    SSimPort*   pSim;
+    const char* pzSpec = pPort->pzPath ? pPort->pzPath : "1";
+    char*       pzEnd;
+    long        lNumDevices;
+    int         retval = 0;
+    int         i;
+
+    pSim = (SSimPort*)calloc(1, sizeof(SSimPort));
+    if(!pSim) { return -1; }
+    pSim->ulHash = SIM_FNV_BASIS;
+    pPort->pvDriverData = pSim;
+
+    lNumDevices = strtol(pzSpec, &pzEnd, 0);
+    if(*pzSpec && !*pzEnd) {
+        if((lNumDevices < 1) || (lNumDevices > SIM_MAX_DEVICES)) {
+            printf("ERROR: sim chain must have 1-%d devices\n", SIM_MAX_DEVICES);
+            retval = -1;
+        }
+        for(i = 0; !retval && (i < lNumDevices); ++i) { retval = simAddDevice(pSim); }
+    } else {
+        retval = readSimConfig(pSim, pzSpec, pPort == portsCurrent());
+        if(!retval && !pSim->iNumDevices) {
+            printf("ERROR: %s: no sim devices\n", pzSpec);
+            retval = -1;
+        }
+    }
+    for(i = 0; !retval && (i < pSim->iNumDevices); ++i) {
+        retval = simFinishDevice(&pSim->aDevice[i]);
+    }
+    memset(pSim->asDriven, 0xFF, sizeof(pSim->asDriven));
+
+    if(retval) { simClose(pPort); }
+    return retval;
+}
+
+/* the bit each device presents to the next one (the last one to TDO) */
+static int simDeviceOut(SSimDevice* pDev, int iIr)
+{
+    if(!iIr && (pDev->iDr == SIM_DR_USER)) { return pDev->pucDr[pDev->lDrPos]; }
+    return (int)(pDev->ulShift & 1);
+}
+
+static void simDeviceShift(SSimDevice* pDev, int iIr, int iIn)
+{
+    if(iIr) {
+        pDev->ulShift = (pDev->ulShift >> 1) | ((unsigned long)iIn << (pDev->iIrLen - 1));
+    } else if(pDev->iDr == SIM_DR_USER) {
+        pDev->pucDr[pDev->lDrPos] = (unsigned char)iIn;
+        if(++pDev->lDrPos == pDev->lDrLen) { pDev->lDrPos = 0; }
+    } else if(pDev->iDr == SIM_DR_IDCODE) {
+        pDev->ulShift = (pDev->ulShift >> 1) | ((unsigned long)iIn << 31);
+    } else {
+        pDev->ulShift = (unsigned long)iIn;
+    }
+}
+
+/* Capture-xR and Update-xR actions of one device */
+static void simDeviceCapture(SSimDevice* pDev, unsigned char ucState)
+{
+    long i;
+
+    if(ucState == SIM_CAPTUREIR) {
+        pDev->ulShift = 1;
+    } else if(ucState == SIM_UPDATEIR) {
+        pDev->ulIr = pDev->ulShift & pDev->ulIrMask;
+        simSelectDr(pDev);
+    } else if(pDev->iDr == SIM_DR_USER) {
+        if(ucState == SIM_CAPTUREDR) {
+            memcpy(pDev->pucDr, pDev->pucDrLatch, pDev->lDrLen);
+            pDev->lDrPos = 0;
+        } else {
+            for(i = 0; i < pDev->lDrLen; ++i) {
+                pDev->pucDrLatch[i] = pDev->pucDr[(pDev->lDrPos + i) % pDev->lDrLen];
+            }
+        }
+    } else if(ucState == SIM_CAPTUREDR) {
+        pDev->ulShift = (pDev->iDr == SIM_DR_IDCODE) ? pDev->ulIdcode : 0;
+    }
+}
+
+static unsigned char simTdo(SSimPort* pSim)
+{
+    int iIr = (pSim->ucState == SIM_SHIFTIR);
+
+    return (unsigned char)simDeviceOut(&pSim->aDevice[pSim->iNumDevices - 1], iIr);
+}
+
+static void simSetPins(SPort* pPort, short sTms, short sTdi, short sTck)
+{
+    SSimPort*       pSim = (SSimPort*)pPort->pvDriverData;
+    unsigned char   ucState = pSim->ucState;
+    int             iRising = (pSim->asDriven[TCK] == 0) && sTck;
+    int             iIr = (ucState == SIM_SHIFTIR);
+    int             iIn;
+    int             iOut;
+    int             i;
+
+    pPort->lSyscalls += (pSim->asDriven[TMS] != sTms) +
+                        (pSim->asDriven[TDI] != sTdi) +
+                        (pSim->asDriven[TCK] != sTck);
+    pSim->asDriven[TMS] = sTms;
+    pSim->asDriven[TDI] = sTdi;
+    pSim->asDriven[TCK] = sTck;
+    if(!iRising) { return; }
+
+    iOut = simTdo(pSim);
+    ++pSim->lEdges;
+    pSim->ulHash = ((pSim->ulHash ^ (unsigned long)((sTms ? 1 : 0) | (sTdi ? 2 : 0) | (iOut << 2))) *
+                    SIM_FNV_PRIME) & 0xFFFFFFFFUL;
+    if(pSim->fpTrace) {
+        fprintf(pSim->fpTrace, "%x %d %d %d\n", ucState, sTms ? 1 : 0, sTdi ? 1 : 0, iOut);
+    }
+
+    if((ucState == SIM_SHIFTDR) || iIr) {
+        /* every device shifts the bit its TDI-side neighbour presented */
+        iIn = sTdi ? 1 : 0;
+        for(i = 0; i < pSim->iNumDevices; ++i) {
+            iOut = simDeviceOut(&pSim->aDevice[i], iIr);
+            simDeviceShift(&pSim->aDevice[i], iIr, iIn);
+            iIn = iOut;
+        }
+    }
+
+    ucState = g_aucSimNext[ucState][sTms ? 1 : 0];
+    pSim->ucState = ucState;
+    if(ucState == SIM_RESET) {
+        for(i = 0; i < pSim->iNumDevices; ++i) { simReset(&pSim->aDevice[i]); }
+    } else if((ucState == SIM_CAPTUREDR) || (ucState == SIM_UPDATEDR) ||
+              (ucState == SIM_CAPTUREIR) || (ucState == SIM_UPDATEIR)) {
+        for(i = 0; i < pSim->iNumDevices; ++i) { simDeviceCapture(&pSim->aDevice[i], ucState); }
+    }
+}
+
+static unsigned char simReadTDO(SPort* pPort)
+{
+    ++pPort->lSyscalls;
+    return simTdo((SSimPort*)pPort->pvDriverData);
+}
+
+static unsigned long simReadTDOs(SPort* pPort)
+{
+    SSimPort*       pSim = (SSimPort*)pPort->pvDriverData;
+    unsigned long   ulAll;
+
+    /* every broadcast chain is a copy of the model, read in one syscall */
+    ++pPort->lSyscalls;
+    ulAll = (pPort->iNumTdo >= 32) ? 0xFFFFFFFFUL : ((1UL << pPort->iNumTdo) - 1);
+    return simTdo(pSim) ? (ulAll & ~pSim->ulTdoStuck) : 0;
+}
+
+const SPortDriver portSimDriver =
+{
+    "sim",
+    simOpen,
+    simClose,
+    simSetPins,
+    simReadTDO,
+    0,  /* pfShiftBits: per bit, every edge goes through the TAP model */
+    0,  /* pfShiftTms: per bit */
+    simReadTDOs
+};
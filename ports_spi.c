@@ -0,0 +1,235 @@
+/*******************************************************/
+/* file: ports_spi.c                                   */
+/* abstract:  This file contains the SPI-as-JTAG port  */
+/*            driver.  It wraps a GPIO port driver and */
+/*            moves the whole bytes of each shift span */
+/*            over /dev/spidevX.Y full-duplex          */
+/*            transfers (MOSI=TDI, MISO=TDO, SCLK=TCK).*/
+/*            TAP transitions, the trailing partial    */
+/*            byte and the final TMS=1 bit still go    */
+/*            through the GPIO driver.  The board must */
+/*            combine SCLK with the GPIO TCK (e.g. OR  */
+/*            gate); the GPIO TCK is held low while    */
+/*            the SPI controller clocks.               */
+/*            SPort.pzSpiDevice is "device[:hz]".      */
+/*******************************************************/
+#include "ports.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#define SPI_DEFAULT_HZ  1000000
+#define SPI_MAX_XFER    4096    /* spidev default bufsiz */
+
+typedef struct tagSSpiPort
+{
+    SPort           base;       /* the wrapped GPIO port */
+    int             fdSpi;
+    int             iLsbFirst;  /* controller shifts LSB first itself */
+    unsigned int    uiHz;
+    unsigned char   aucTx[ SPI_MAX_XFER ];
+    unsigned char   aucRx[ SPI_MAX_XFER ];
+} SSpiPort;
+
+static unsigned char reverseBits(unsigned char uc)
+{
+    uc = (unsigned char)(((uc & 0xF0) >> 4) | ((uc & 0x0F) << 4));
+    uc = (unsigned char)(((uc & 0xCC) >> 2) | ((uc & 0x33) << 2));
+    uc = (unsigned char)(((uc & 0xAA) >> 1) | ((uc & 0x55) << 1));
+    return uc;
+}
+
+/* fold the wrapped driver's syscall count into ours */
+static void syncBase(SPort* pPort, SSpiPort* pSpi)
+{
+    pPort->lSyscalls += pSpi->base.lSyscalls;
+    pSpi->base.lSyscalls = 0;
+    pPort->lErrors += pSpi->base.lErrors;
+    pSpi->base.lErrors = 0;
+}
+
+static void spiClose(SPort* pPort)
+{
+    SSpiPort* pSpi = (SSpiPort*)pPort->pvDriverData;
+
+    if(!pSpi) { return; }
+    if(pSpi->base.pvDriverData) { pSpi->base.pDriver->pfClose(&pSpi->base); }
+    if(pSpi->fdSpi >= 0) { close(pSpi->fdSpi); }
+    syncBase(pPort, pSpi);
+
+    /* hand the port back to the GPIO driver */
+    pPort->pDriver = pSpi->base.pDriver;
+    pPort->pvDriverData = 0;
+    free(pSpi);
+}
+
+static int spiOpen(SPort* pPort)
+{
+    SSpiPort*       pSpi;
+    char            szDevice[256];
+    char*           pzHz;
+    unsigned char   ucMode;
+    unsigned char   ucBits;
+    int             retval;
+
+    pSpi = (SSpiPort*)calloc(1, sizeof(SSpiPort));
+    if(!pSpi) { return -1; }
+    pSpi->base = *pPort;
+    pSpi->base.lSyscalls = 0;
+    pSpi->fdSpi = -1;
+
+    retval = pSpi->base.pDriver->pfOpen(&pSpi->base);
+    pPort->pDriver = &portSpiDriver;
+    pPort->pvDriverData = pSpi;
+    if(retval) { spiClose(pPort); return retval; }
+
+    snprintf(szDevice, sizeof(szDevice), "%s", pPort->pzSpiDevice);
+    pSpi->uiHz = SPI_DEFAULT_HZ;
+    pzHz = strchr(szDevice, ':');
+    if(pzHz) {
+        *pzHz++ = 0;
+        pSpi->uiHz = (unsigned int)strtoul(pzHz, 0, 0);
+    }
+
+    pSpi->fdSpi = open(szDevice, O_RDWR);
+    if(pSpi->fdSpi < 0) {
+        printf("error opening %s\n", szDevice);
+        spiClose(pPort);
+        return -1;
+    }
+
+    /* mode 0: TDI changes on the falling edge, TDO sampled on the rising */
+    ucMode = SPI_MODE_0 | SPI_LSB_FIRST;
+    pSpi->iLsbFirst = 1;
+    if(ioctl(pSpi->fdSpi, SPI_IOC_WR_MODE, &ucMode) < 0) {
+        ucMode = SPI_MODE_0;
+        pSpi->iLsbFirst = 0;
+        if(ioctl(pSpi->fdSpi, SPI_IOC_WR_MODE, &ucMode) < 0) {
+            printf("ERROR: spi mode: %s\n", strerror(errno));
+            spiClose(pPort);
+            return -1;
+        }
+    }
+    ucBits = 8;
+    if((ioctl(pSpi->fdSpi, SPI_IOC_WR_BITS_PER_WORD, &ucBits) < 0) ||
+       (ioctl(pSpi->fdSpi, SPI_IOC_WR_MAX_SPEED_HZ, &pSpi->uiHz) < 0)) {
+        printf("ERROR: spi setup: %s\n", strerror(errno));
+        spiClose(pPort);
+        return -1;
+    }
+    return 0;
+}
+
+static void spiSetPins(SPort* pPort, short sTms, short sTdi, short sTck)
+{
+    SSpiPort* pSpi = (SSpiPort*)pPort->pvDriverData;
+
+    pSpi->base.pDriver->pfSetPins(&pSpi->base, sTms, sTdi, sTck);
+    syncBase(pPort, pSpi);
+}
+
+static unsigned char spiReadTDO(SPort* pPort)
+{
+    SSpiPort*       pSpi = (SSpiPort*)pPort->pvDriverData;
+    unsigned char   ucTdo;
+
+    ucTdo = pSpi->base.pDriver->pfReadTDO(&pSpi->base);
+    syncBase(pPort, pSpi);
+    return ucTdo;
+}
+
+/* transfer lNumBytes whole bytes ending at pucTdiEnd (lenVal order) */
+static int spiTransfer(SPort* pPort, SSpiPort* pSpi, const unsigned char* pucTdiEnd,
+                       unsigned char* pucTdoEnd, long lNumBytes)
+{
+    struct spi_ioc_transfer xfer;
+    long i;
+
+    /* the first bit on the wire is the LSB of the last lenVal byte */
+    for(i = 0; i < lNumBytes; ++i) {
+        pSpi->aucTx[i] = *(--pucTdiEnd);
+        if(!pSpi->iLsbFirst) { pSpi->aucTx[i] = reverseBits(pSpi->aucTx[i]); }
+    }
+
+    memset(&xfer, 0, sizeof(xfer));
+    xfer.tx_buf = (unsigned long)pSpi->aucTx;
+    xfer.rx_buf = pucTdoEnd ? (unsigned long)pSpi->aucRx : 0;
+    xfer.len = (unsigned int)lNumBytes;
+    xfer.speed_hz = pSpi->uiHz;
+    xfer.bits_per_word = 8;
+    ++pPort->lSyscalls;
+    if(ioctl(pSpi->fdSpi, SPI_IOC_MESSAGE(1), &xfer) < 0) {
+        printf("ERROR: spi transfer failed: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if(pucTdoEnd) {
+        for(i = 0; i < lNumBytes; ++i) {
+            *(--pucTdoEnd) = pSpi->iLsbFirst ? pSpi->aucRx[i] : reverseBits(pSpi->aucRx[i]);
+        }
+    }
+    return 0;
+}
+
+static void spiShiftBits(SPort* pPort, const unsigned char* pucTdi,
+                         unsigned char* pucTdo, long lNumBits, int iTmsOnLast)
+{
+    SSpiPort*   pSpi = (SSpiPort*)pPort->pvDriverData;
+    long        lNumBytes = (lNumBits + 7) / 8;
+    long        lSpiBytes;
+    long        lChunk;
+    const unsigned char* pucTdiEnd = pucTdi + lNumBytes;
+    unsigned char*       pucTdoEnd = pucTdo ? pucTdo + lNumBytes : 0;
+
+    /* the final TMS=1 bit and any partial byte are bit-banged */
+    lSpiBytes = (lNumBits - (iTmsOnLast ? 1 : 0)) / 8;
+    if(lSpiBytes) {
+        /* SCLK drives TCK; keep the GPIO TCK low and TMS in Shift-xR */
+        pSpi->base.asLevel[TMS] = 0;
+        pSpi->base.asLevel[TCK] = 0;
+        spiSetPins(pPort, 0, pPort->asLevel[TDI], 0);
+
+        lNumBits -= lSpiBytes * 8;
+        while(lSpiBytes) {
+            lChunk = (lSpiBytes > SPI_MAX_XFER) ? SPI_MAX_XFER : lSpiBytes;
+            if(spiTransfer(pPort, pSpi, pucTdiEnd, pucTdoEnd, lChunk)) {
+                /* the TAP is left mid-shift:  the run must stop */
+                ++pPort->lErrors;
+                return;
+            }
+            pucTdiEnd -= lChunk;
+            if(pucTdoEnd) { pucTdoEnd -= lChunk; }
+            lSpiBytes -= lChunk;
+        }
+        pPort->asLevel[TMS] = 0;
+        pPort->asLevel[TCK] = 0;
+    }
+
+    if(lNumBits) {
+        lNumBytes = (lNumBits + 7) / 8;
+        pSpi->base.asLevel[TMS] = pPort->asLevel[TMS];
+        pSpi->base.asLevel[TDI] = pPort->asLevel[TDI];
+        portsShiftPerBit(&pSpi->base, pucTdiEnd - lNumBytes,
+                         pucTdoEnd ? pucTdoEnd - lNumBytes : 0, lNumBits, iTmsOnLast);
+        syncBase(pPort, pSpi);
+        memcpy(pPort->asLevel, pSpi->base.asLevel, sizeof(pPort->asLevel));
+    }
+}
+
+const SPortDriver portSpiDriver =
+{
+    "spi",
+    spiOpen,
+    spiClose,
+    spiSetPins,
+    spiReadTDO,
+    spiShiftBits,
+    0,  /* pfShiftTms: per bit through spiSetPins */
+    0   /* pfReadTDOs: MISO is a single TDO */
+};
@@ -0,0 +1,184 @@
+/*******************************************************/
+/* file: ports_sysfs.c                                 */
+/* abstract:  This file contains the port driver for   */
+/*            the legacy /sys/class/gpio interface.    */
+/*            The value files stay open for the whole  */
+/*            run and the last level written to each   */
+/*            pin is cached, so a TCK edge costs one   */
+/*            write() unless TMS or TDI also changed.  */
+/*            SPort.pzPath may name a fake sysfs tree  */
+/*            (default /sys/class/gpio).               */
+/*******************************************************/
+#include "ports.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define SYSFS_GPIO_ROOT "/sys/class/gpio"
+
+typedef struct tagSSysfsPort
+{
+    int     afdValue[ PORT_NUM_PINS ];  /* value file per pin */
+    short   asDriven[ 3 ];              /* last level written; -1 = unknown */
+    int     afdTdo[ PORT_MAX_TDO ];     /* broadcast: TDO of chain 1.. */
+} SSysfsPort;
+
+static int writeSysfsFile(const char* pzFile, const char* pzText)
+{
+    int fd;
+    int retval;
+
+    fd = open(pzFile, O_WRONLY);
+    if(fd < 0) { printf("error opening %s\n", pzFile); return fd; }
+    retval = write(fd, pzText, strlen(pzText));
+    close(fd);
+    return (retval < 0) ? retval : 0;
+}
+
+static int setupGPIO(const char* pzRoot, const int gpio, const char* direction, int* valueFile)
+{
+    char buf[512];
+    char num[16];
+
+    //export the gpio pins; this fails harmlessly if already exported
+    sprintf(buf, "%s/export", pzRoot);
+    sprintf(num, "%d", gpio);
+    writeSysfsFile(buf, num);
+
+    sprintf(buf, "%s/gpio%d/direction", pzRoot, gpio);
+    if(writeSysfsFile(buf, direction)) { return -1; }
+
+    sprintf(buf, "%s/gpio%d/active_low", pzRoot, gpio);
+    if(writeSysfsFile(buf, "0")) { return -1; }
+
+    sprintf(buf, "%s/gpio%d/value", pzRoot, gpio);
+    if(direction[0] == 'i') {
+        *valueFile = open(buf, O_RDONLY);
+    } else if(direction[0] == 'o') {
+        *valueFile = open(buf, O_WRONLY);
+    } else {
+        printf("ERROR: unknown direction: %s must be either 'in' or 'out'\n", direction);
+        return -1;
+    }
+
+    if(*valueFile < 0) { printf("error opening %s\n", buf); return -1; }
+    return 0;
+}
+
+static void sysfsClose(SPort* pPort)
+{
+    SSysfsPort* pSysfs = (SSysfsPort*)pPort->pvDriverData;
+    int i;
+
+    if(!pSysfs) { return; }
+    for(i = 0; i < PORT_NUM_PINS; ++i) {
+        if(pSysfs->afdValue[i] >= 0) { close(pSysfs->afdValue[i]); }
+    }
+    for(i = 1; i < PORT_MAX_TDO; ++i) {
+        if(pSysfs->afdTdo[i] >= 0) { close(pSysfs->afdTdo[i]); }
+    }
+    free(pSysfs);
+    pPort->pvDriverData = 0;
+}
+
+static int sysfsOpen(SPort* pPort)
+{
+    SSysfsPort* pSysfs;
+    const char* pzRoot;
+    int retval;
+    int i;
+
+    pSysfs = (SSysfsPort*)malloc(sizeof(SSysfsPort));
+    if(!pSysfs) { return -1; }
+    for(i = 0; i < PORT_NUM_PINS; ++i) { pSysfs->afdValue[i] = -1; }
+    for(i = 0; i < 3; ++i) { pSysfs->asDriven[i] = -1; }
+    for(i = 0; i < PORT_MAX_TDO; ++i) { pSysfs->afdTdo[i] = -1; }
+    pPort->pvDriverData = pSysfs;
+
+    pzRoot = pPort->pzPath ? pPort->pzPath : SYSFS_GPIO_ROOT;
+
+    retval = setupGPIO(pzRoot, pPort->aiPin[TMS], "out", &pSysfs->afdValue[TMS]);
+    if(!retval) { retval = setupGPIO(pzRoot, pPort->aiPin[TDI], "out", &pSysfs->afdValue[TDI]); }
+    if(!retval) { retval = setupGPIO(pzRoot, pPort->aiPin[TCK], "out", &pSysfs->afdValue[TCK]); }
+    if(!retval) { retval = setupGPIO(pzRoot, portsTdoPin(pPort, 0), "in", &pSysfs->afdValue[TDO]); }
+    for(i = 1; !retval && (i < pPort->iNumTdo); ++i) {
+        retval = setupGPIO(pzRoot, pPort->aiTdo[i], "in", &pSysfs->afdTdo[i]);
+    }
+
+    if(retval) { sysfsClose(pPort); }
+    return retval;
+}
+
+static void writeGPIO(SPort* pPort, short p, short value)
+{
+    SSysfsPort* pSysfs = (SSysfsPort*)pPort->pvDriverData;
+    int retval;
+
+    if(pSysfs->asDriven[p] == value) { return; }
+
+    ++pPort->lSyscalls;
+    retval = write(pSysfs->afdValue[p], value ? "1" : "0", 1);
+    if(retval != 1){
+        printf("ERROR: writeGPIO returned: %d\n", retval);
+        pSysfs->asDriven[p] = -1;
+        return;
+    }
+    pSysfs->asDriven[p] = value;
+}
+
+static void sysfsSetPins(SPort* pPort, short sTms, short sTdi, short sTck)
+{
+    writeGPIO(pPort, TMS, sTms);
+    writeGPIO(pPort, TDI, sTdi);
+    writeGPIO(pPort, TCK, sTck);
+}
+
+/* pread() rewinds and reads the value file in a single syscall */
+static unsigned char sysfsReadTDO(SPort* pPort)
+{
+    SSysfsPort* pSysfs = (SSysfsPort*)pPort->pvDriverData;
+    char buf[2] = { 0, 0 };
+
+    ++pPort->lSyscalls;
+    if (pread(pSysfs->afdValue[TDO], buf, 1, 0) < 1) {
+        printf("ERROR: readTDOBit - read failed: %s\n", strerror(errno));
+        return 255;
+    }
+
+    return (unsigned char)(buf[0] == '1');
+}
+
+/* broadcast:  one pread() per chain */
+static unsigned long sysfsReadTDOs(SPort* pPort)
+{
+    SSysfsPort* pSysfs = (SSysfsPort*)pPort->pvDriverData;
+    unsigned long ulTdo = 0;
+    char buf[2] = { 0, 0 };
+    int i;
+
+    for(i = 0; i < pPort->iNumTdo; ++i) {
+        ++pPort->lSyscalls;
+        if(pread(i ? pSysfs->afdTdo[i] : pSysfs->afdValue[TDO], buf, 1, 0) < 1) {
+            printf("ERROR: readTDOBit - read failed: %s\n", strerror(errno));
+            continue;
+        }
+        if(buf[0] == '1') { ulTdo |= 1UL << i; }
+    }
+    return ulTdo;
+}
+
+const SPortDriver portSysfsDriver =
+{
+    "sysfs",
+    sysfsOpen,
+    sysfsClose,
+    sysfsSetPins,
+    sysfsReadTDO,
+    0,  /* pfShiftBits: use the per-bit fallback */
+    0,  /* pfShiftTms: use the per-bit fallback */
+    sysfsReadTDOs
+};
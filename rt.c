@@ -0,0 +1,181 @@
+/*******************************************************/
+/* file: rt.c                                          */
+/* abstract:  This file contains the real-time mode    */
+/*            (see rt.h).  Each step that the system   */
+/*            refuses (no CAP_SYS_NICE, a small        */
+/*            RLIMIT_MEMLOCK) is reported once and the */
+/*            run goes on without it.  The counters    */
+/*            are per thread, like the timing totals:  */
+/*  wake-up latency:  how late each waitTime() sleep   */
+/*                    returned after its deadline.     */
+/*  context switches and page faults:  getrusage() of  */
+/*                    the thread, rtEnter to rtLeave.  */
+/*******************************************************/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     /* sched_setaffinity, RUSAGE_THREAD */
+#endif
+#include "rt.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include "ports.h"  /* XSVF_THREAD */
+
+static int g_iEnabled = 0;
+static int g_iCpu = -1;
+static int g_iPriority = RT_DEFAULT_PRIORITY;
+static int g_iNextCpu = 0;          /* threads that entered so far */
+static int g_iLocked = 0;           /* mlockall() done (process-wide) */
+
+static XSVF_THREAD SRtStats g_rt;
+static XSVF_THREAD int g_iActive;   /* this thread is SCHED_FIFO */
+static XSVF_THREAD int g_iOldPolicy;
+static XSVF_THREAD struct sched_param g_oldParam;
+static XSVF_THREAD struct rusage g_usage;
+
+static int rtUsage(struct rusage* pUsage)
+{
+#ifdef RUSAGE_THREAD
+    return getrusage(RUSAGE_THREAD, pUsage);
+#else
+    return getrusage(RUSAGE_SELF, pUsage);
+#endif
+}
+
+/* touch the stack the player will use, so locking maps it in now */
+static void rtTouchStack()
+{
+    volatile unsigned char aucStack[RT_STACK_BYTES];
+
+    memset((void*)aucStack, 0, sizeof(aucStack));
+}
+
+static int rtSetFifo(int iFifo)
+{
+    struct sched_param param;
+
+    if(!iFifo) { return sched_setscheduler(0, g_iOldPolicy, &g_oldParam); }
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = g_iPriority;
+    return sched_setscheduler(0, SCHED_FIFO, &param);
+}
+
+int rtParse(const char* pzSpec)
+{
+    char* pzEnd;
+    long lValue;
+
+    if(!strncmp(pzSpec, "any", 3)) {
+        g_iCpu = -1;
+        pzEnd = (char*)pzSpec + 3;
+    } else {
+        lValue = strtol(pzSpec, &pzEnd, 0);
+        if((pzEnd == pzSpec) || (lValue < 0) || (lValue >= CPU_SETSIZE)) { return -1; }
+        g_iCpu = (int)lValue;
+    }
+    if(*pzEnd == ',') {
+        pzSpec = pzEnd + 1;
+        lValue = strtol(pzSpec, &pzEnd, 0);
+        if((pzEnd == pzSpec) || (lValue < sched_get_priority_min(SCHED_FIFO)) ||
+           (lValue > sched_get_priority_max(SCHED_FIFO))) {
+            return -1;
+        }
+        g_iPriority = (int)lValue;
+    }
+    if(*pzEnd) { return -1; }
+    g_iEnabled = 1;
+    return 0;
+}
+
+int rtEnabled()
+{
+    return g_iEnabled;
+}
+
+void rtEnter()
+{
+    cpu_set_t cpus;
+    long lCpus;
+    int iThread;
+
+    memset(&g_rt, 0, sizeof(g_rt));
+    g_rt.iCpu = -1;
+    if(!g_iEnabled) { return; }
+
+    iThread = __sync_fetch_and_add(&g_iNextCpu, 1);
+    if(g_iCpu >= 0) {
+        lCpus = sysconf(_SC_NPROCESSORS_CONF);
+        if(lCpus < 1) { lCpus = 1; }
+        CPU_ZERO(&cpus);
+        CPU_SET((int)((g_iCpu + iThread) % lCpus), &cpus);
+        if(sched_setaffinity(0, sizeof(cpus), &cpus)) {
+            printf("WARNING: -rt: cannot pin to CPU %ld\n", (g_iCpu + iThread) % lCpus);
+        } else {
+            g_rt.iCpu = (int)((g_iCpu + iThread) % lCpus);
+        }
+    }
+
+    /* lock once for the process; MCL_FUTURE covers later lenVal growth */
+    rtTouchStack();
+    if(!__sync_lock_test_and_set(&g_iLocked, 1)) {
+        if(mlockall(MCL_CURRENT | MCL_FUTURE)) {
+            printf("WARNING: -rt: cannot lock memory (RLIMIT_MEMLOCK?)\n");
+            g_iLocked = -1;
+        }
+    }
+    g_rt.iLocked = (g_iLocked > 0);
+
+    g_iOldPolicy = sched_getscheduler(0);
+    sched_getparam(0, &g_oldParam);
+    g_iActive = !rtSetFifo(1);
+    g_rt.iFifo = g_iActive;
+    if(!g_iActive) {
+        printf("WARNING: -rt: SCHED_FIFO refused (CAP_SYS_NICE?)\n");
+    }
+    rtUsage(&g_usage);
+}
+
+void rtLeave()
+{
+    struct rusage usage;
+
+    if(!g_iEnabled) { return; }
+    if(!rtUsage(&usage)) {
+        g_rt.lInvoluntary = usage.ru_nivcsw - g_usage.ru_nivcsw;
+        g_rt.lMajorFaults = usage.ru_majflt - g_usage.ru_majflt;
+        g_rt.lMinorFaults = usage.ru_minflt - g_usage.ru_minflt;
+    }
+    if(g_iActive) {
+        rtSetFifo(0);
+        g_iActive = 0;
+    }
+}
+
+int rtSleepBegin(long lMicrosec)
+{
+    if(!g_iActive || (lMicrosec < RT_DEMOTE_US)) { return 0; }
+    return !rtSetFifo(0);
+}
+
+void rtSleepEnd(int iDemoted, long long llLateNs)
+{
+    if(!g_iEnabled) { return; }
+    if(iDemoted) {
+        rtSetFifo(1);
+        ++g_rt.lDemoted;
+    }
+    if(llLateNs < 0) { llLateNs = 0; }
+    ++g_rt.lSleeps;
+    g_rt.llWakeNs += llLateNs;
+    if(llLateNs > g_rt.llMaxWakeNs) { g_rt.llMaxWakeNs = llLateNs; }
+}
+
+const SRtStats* rtStats()
+{
+    return &g_rt;
+}
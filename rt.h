@@ -0,0 +1,57 @@
+/*******************************************************/
+/* file: rt.h                                          */
+/* abstract:  This file contains the real-time mode.   */
+/*            With -rt, the thread that shifts a chain */
+/*            is pinned to a CPU and raised to         */
+/*            SCHED_FIFO, and the process memory (the  */
+/*            lenVal arena, the mapped input) is       */
+/*            locked, so the bit-bang loop is neither  */
+/*            preempted nor page-faulted.  Long sleeps */
+/*            in waitTime() run at normal priority.    */
+/*******************************************************/
+
+#ifndef rt_dot_h
+#define rt_dot_h
+
+#define RT_DEFAULT_PRIORITY 50      /* SCHED_FIFO priority */
+#define RT_DEMOTE_US        2000L   /* sleeps this long run as SCHED_OTHER */
+#define RT_STACK_BYTES      (64L * 1024L)   /* stack touched before locking */
+
+typedef struct tagSRtStats
+{
+    int         iCpu;           /* pinned CPU, -1 = not pinned */
+    int         iFifo;          /* SCHED_FIFO was granted */
+    int         iLocked;        /* mlockall() succeeded */
+    long        lSleeps;        /* sleeps in waitTime() */
+    long        lDemoted;       /* of those, run at normal priority */
+    long long   llWakeNs;       /* sum of the wake-up latencies */
+    long long   llMaxWakeNs;    /* largest wake-up latency */
+    long        lInvoluntary;   /* involuntary context switches */
+    long        lMajorFaults;   /* page faults that needed I/O */
+    long        lMinorFaults;
+} SRtStats;
+
+/* parse "cpu[,priority]" (cpu "any" = no pinning) and enable -rt; */
+/* 0 = success                                                     */
+extern int rtParse(const char* pzSpec);
+
+/* non-zero if -rt was given */
+extern int rtEnabled();
+
+/* make the calling thread real-time (see above).  Each thread that */
+/* enters takes the next CPU after the configured one.               */
+extern void rtEnter();
+
+/* restore the thread's scheduling and finish its counters */
+extern void rtLeave();
+
+/* around a sleep of lMicrosec:  rtSleepBegin() returns non-zero if */
+/* it lowered the priority; rtSleepEnd() restores it and records     */
+/* how late (llLateNs) the thread woke                               */
+extern int rtSleepBegin(long lMicrosec);
+extern void rtSleepEnd(int iDemoted, long long llLateNs);
+
+/* this thread's counters */
+extern const SRtStats* rtStats();
+
+#endif
@@ -0,0 +1,1181 @@
+/*****************************************************************************
+* file:         svf.c
+* abstract:     This file contains the SVF player (see svf.h).
+* Usage:        svfRun() reads the SVF text one statement at a time and
+*               plays each statement as it is read:  scans go through
+*               xsvfShift() and state changes through xsvfGotoTapState(),
+*               exactly as the XSVF commands that svf2xsvf would produce.
+*               Hex payloads are decoded straight into the shift buffers
+*               while they are read and no other text is kept, so memory is
+*               bounded by the longest scan (LENVAL_MAX_BYTES).
+*               Supported:      SIR SDR HIR HDR TIR TDR ENDIR ENDDR RUNTEST
+*                               STATE FREQUENCY TRST (accepted; there is no
+*                               TRST pin)
+*               Not supported:  PIO PIOMAP (XSVF_ERROR_ILLEGALCMD)
+*               Like xsvfInitialize(), the player starts with a TMS reset.
+*               A TCK count in RUNTEST is clocked in the run state; with a
+*               FREQUENCY, or a minimum time, the remaining time is waited
+*               with waitTime().  SCK counts are clocked like TCK counts.
+*               With -tck, each FREQUENCY also starts the next TCK phase
+*               (portsPaceFrequency()).
+*****************************************************************************/
+#define DEBUG_MODE
+#ifdef  DEBUG_MODE
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+#endif  /* DEBUG_MODE */
+
+#include "micro.h"
+#include "lenval.h"
+#include "microint.h"
+#include "ports.h"
+#include "input.h"
+#include "timing.h"
+#include "svf.h"
+
+
+/*============================================================================
+* SVF Player Types
+============================================================================*/
+
+/* scan kinds; the header and trailer of scan n are n + 2 and n + 4 */
+#define SVF_SIR         0
+#define SVF_SDR         1
+#define SVF_HIR         2
+#define SVF_HDR         3
+#define SVF_TIR         4
+#define SVF_TDR         5
+#define SVF_NUM_SCANS   6
+
+/* svfToken() results */
+#define SVF_TOK_EOF     0
+#define SVF_TOK_WORD    1
+#define SVF_TOK_LPAREN  2
+#define SVF_TOK_SEMI    3
+
+/*****************************************************************************
+* Struct:       SSvfScan
+* Description:  The sticky parameters of one scan kind.  TDI, MASK and
+*               SMASK carry over to the next statement of the same kind and
+*               length; a length change resets TDI to 0 and MASK/SMASK to
+*               all ones.  Each buffer holds lNumBytes, MSB first, like a
+*               lenVal.  TDO is compared only when the last SIR/SDR gave
+*               one; a header or trailer TDO stays until its next statement.
+*****************************************************************************/
+typedef struct tagSSvfScan
+{
+    long            lNumBits;
+    long            lNumBytes;
+    long            lMaxBytes;          /* allocated per buffer */
+    unsigned char*  pucArena;           /* the four buffers below */
+    unsigned char*  pucTdi;
+    unsigned char*  pucTdo;
+    unsigned char*  pucMask;
+    unsigned char*  pucSmask;
+    int             iTdo;               /* pucTdo is to be compared */
+} SSvfScan;
+
+/*****************************************************************************
+* Struct:       SSvfPlayer
+* Description:  The SVF player state.  When a scan has a header or trailer
+*               the whole scan is assembled in the full-scan lenVals.
+*****************************************************************************/
+typedef struct tagSSvfPlayer
+{
+    SXsvfInput*     pInput;
+    long            lLine;              /* current line */
+    long            lStatementLine;     /* line of the current statement */
+
+    unsigned char   ucTapState;
+    unsigned char   ucEndIR;
+    unsigned char   ucEndDR;
+    unsigned char   ucRunState;         /* RUNTEST run_state */
+    unsigned char   ucRunEndState;      /* RUNTEST ENDSTATE */
+    double          dFrequency;         /* FREQUENCY in Hz; 0 = none */
+
+    SSvfScan        aScan[ SVF_NUM_SCANS ];
+
+    unsigned char*  pucArena;           /* storage of the full scan */
+    long            lArenaBytes;        /* bytes per full-scan lenVal */
+    lenVal          lvTdi;
+    lenVal          lvTdoExpected;
+    lenVal          lvTdoMask;
+    lenVal          lvTdoCaptured;
+
+    char            szWord[ SVF_MAX_WORD ];
+} SSvfPlayer;
+
+/* SVF state names, in XTAPSTATE_* order */
+static const char* svf_apzState[] =
+{
+    "RESET",    "IDLE",     "DRSELECT", "DRCAPTURE",
+    "DRSHIFT",  "DREXIT1",  "DRPAUSE",  "DREXIT2",
+    "DRUPDATE", "IRSELECT", "IRCAPTURE", "IRSHIFT",
+    "IREXIT1",  "IRPAUSE",  "IREXIT2",  "IRUPDATE"
+};
+#define SVF_NUM_STATES  16
+
+
+/*============================================================================
+* SVF Tokenizer
+============================================================================*/
+
+/*****************************************************************************
+* Function:     svfGetc
+* Description:  Next character of the SVF text.  Reads the input buffer
+*               directly; pfRefill() makes more of it available.
+* Parameters:   pSvf    - the player.
+* Returns:      int     - the character, or -1 at the end of the input.
+*****************************************************************************/
+static int svfGetc( SSvfPlayer* pSvf )
+{
+    SXsvfInput* pInput  = pSvf->pInput;
+
+    if ( ( pInput->pucCur == pInput->pucEnd ) && !pInput->pfRefill( pInput ) )
+    {
+        return( -1 );
+    }
+    return( *(pInput->pucCur)++ );
+}
+
+/*****************************************************************************
+* Function:     svfSkipLine
+* Description:  Skip a comment up to the end of its line.
+* Parameters:   pSvf    - the player.
+* Returns:      void.
+*****************************************************************************/
+static void svfSkipLine( SSvfPlayer* pSvf )
+{
+    int iChar;
+
+    do
+    {
+        iChar   = svfGetc( pSvf );
+    } while ( ( iChar >= 0 ) && ( iChar != '\n' ) );
+    ++pSvf->lLine;
+}
+
+/*****************************************************************************
+* Function:     svfToken
+* Description:  Read the next token:  a word (keyword, number or state
+*               name, upper-cased into szWord), "(", ";" or the end of the
+*               input.  Whitespace and "!" or "//" comments are skipped.
+*               A ")" outside of a hex value is an error, not an empty
+*               word.
+* Parameters:   pSvf    - the player.
+*               piToken - receives SVF_TOK_*.
+* Returns:      int     - 0 = success; otherwise XSVF_ERROR_ILLEGALCMD.
+*****************************************************************************/
+static int svfToken( SSvfPlayer* pSvf, int* piToken )
+{
+    int iChar;
+    int iLen;
+
+    for ( ; ; )
+    {
+        iChar   = svfGetc( pSvf );
+        if ( iChar < 0 )
+        {
+            *piToken    = SVF_TOK_EOF;
+            return( XSVF_ERROR_NONE );
+        }
+        if ( iChar == '\n' )
+        {
+            ++pSvf->lLine;
+        }
+        else if ( iChar == '!' )
+        {
+            svfSkipLine( pSvf );
+        }
+        else if ( iChar == '/' )
+        {
+            if ( svfGetc( pSvf ) != '/' )
+            {
+                return( XSVF_ERROR_ILLEGALCMD );
+            }
+            svfSkipLine( pSvf );
+        }
+        else if ( iChar > ' ' )
+        {
+            break;
+        }
+    }
+
+    if ( iChar == '(' )
+    {
+        *piToken    = SVF_TOK_LPAREN;
+        return( XSVF_ERROR_NONE );
+    }
+    if ( iChar == ';' )
+    {
+        *piToken    = SVF_TOK_SEMI;
+        return( XSVF_ERROR_NONE );
+    }
+
+    iLen    = 0;
+    while ( ( iChar > ' ' ) && ( iChar != '(' ) && ( iChar != ')' ) &&
+            ( iChar != ';' ) && ( iChar != '!' ) )
+    {
+        if ( iLen == SVF_MAX_WORD - 1 )
+        {
+            return( XSVF_ERROR_ILLEGALCMD );
+        }
+        pSvf->szWord[ iLen++ ]  = (char)( ( ( iChar >= 'a' ) && ( iChar <= 'z' ) )
+                                          ? ( iChar - 'a' + 'A' ) : iChar );
+        iChar   = svfGetc( pSvf );
+    }
+    pSvf->szWord[ iLen ]    = 0;
+    if ( !iLen )
+    {
+        /* a stray ")":  giving it back would return it again forever */
+        return( XSVF_ERROR_ILLEGALCMD );
+    }
+
+    /* give back the character that ended the word */
+    if ( iChar >= 0 )
+    {
+        --(pSvf->pInput->pucCur);
+    }
+    *piToken    = SVF_TOK_WORD;
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     svfWord
+* Description:  Read a token that must be a word.
+* Parameters:   pSvf    - the player.
+* Returns:      int     - 0 = success; otherwise error.
+*****************************************************************************/
+static int svfWord( SSvfPlayer* pSvf )
+{
+    int iToken;
+    int iErrorCode;
+
+    iErrorCode  = svfToken( pSvf, &iToken );
+    if ( !iErrorCode && ( iToken != SVF_TOK_WORD ) )
+    {
+        iErrorCode  = ( iToken == SVF_TOK_EOF ) ? XSVF_ERROR_TRUNCATED
+                                                : XSVF_ERROR_ILLEGALCMD;
+    }
+    return( iErrorCode );
+}
+
+/*****************************************************************************
+* Function:     svfNumber
+* Description:  Convert szWord to a number.
+* Parameters:   pSvf    - the player.
+*               pdValue - receives the number.
+* Returns:      int     - 0 = success; otherwise XSVF_ERROR_ILLEGALCMD.
+*****************************************************************************/
+static int svfNumber( SSvfPlayer* pSvf, double* pdValue )
+{
+    char*   pzEnd;
+
+    *pdValue    = strtod( pSvf->szWord, &pzEnd );
+    if ( ( pzEnd == pSvf->szWord ) || *pzEnd || ( *pdValue < 0 ) )
+    {
+        return( XSVF_ERROR_ILLEGALCMD );
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     svfState
+* Description:  Convert szWord to a TAP state.
+* Parameters:   pSvf        - the player.
+*               pucState    - receives the XTAPSTATE_* value.
+* Returns:      int         - 0 = success; otherwise not a state name.
+*****************************************************************************/
+static int svfState( SSvfPlayer* pSvf, unsigned char* pucState )
+{
+    int i;
+
+    for ( i = 0; i < SVF_NUM_STATES; ++i )
+    {
+        if ( !strcmp( pSvf->szWord, svf_apzState[ i ] ) )
+        {
+            *pucState   = (unsigned char)i;
+            return( XSVF_ERROR_NONE );
+        }
+    }
+    return( XSVF_ERROR_ILLEGALSTATE );
+}
+
+/*****************************************************************************
+* Function:     svfIsStable
+* Description:  Check for a stable state, the only legal end states.
+* Parameters:   ucState - XTAPSTATE_*.
+* Returns:      int     - non-zero if stable.
+*****************************************************************************/
+static int svfIsStable( unsigned char ucState )
+{
+    return( ( ucState == XTAPSTATE_RESET ) || ( ucState == XTAPSTATE_RUNTEST ) ||
+            ( ucState == XTAPSTATE_PAUSEDR ) || ( ucState == XTAPSTATE_PAUSEIR ) );
+}
+
+/*****************************************************************************
+* Function:     svfReadHex
+* Description:  Read the hex digits of a "(...)" value, up to the ")",
+*               into lNumBits right-aligned bits of pucDst.  The digits are
+*               packed into pucDst as they arrive and right-aligned once at
+*               the end, so no text is buffered.  Leading zero digits are
+*               ignored; bits above lNumBits are cleared.
+* Parameters:   pSvf        - the player.
+*               pucDst      - receives (lNumBits + 7) / 8 bytes.
+*               lNumBits    - length of the value.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+static int svfReadHex( SSvfPlayer* pSvf, unsigned char* pucDst, long lNumBits )
+{
+    long    lNumBytes;
+    long    lMaxDigits;
+    long    lDigits;
+    long    lShift;
+    long    lBytes;
+    long    j;
+    int     iChar;
+    int     iDigit;
+
+    lNumBytes   = ( lNumBits + 7 ) / 8;
+    lMaxDigits  = 2 * lNumBytes;
+    lDigits     = 0;
+    for ( ; ; )
+    {
+        iChar   = svfGetc( pSvf );
+        if ( ( iChar >= '0' ) && ( iChar <= '9' ) )
+        {
+            iDigit  = iChar - '0';
+        }
+        else if ( ( ( iChar | 0x20 ) >= 'a' ) && ( ( iChar | 0x20 ) <= 'f' ) )
+        {
+            iDigit  = ( iChar | 0x20 ) - 'a' + 10;
+        }
+        else if ( iChar == ')' )
+        {
+            break;
+        }
+        else if ( iChar < 0 )
+        {
+            return( XSVF_ERROR_TRUNCATED );
+        }
+        else if ( iChar == '\n' )
+        {
+            ++pSvf->lLine;
+            continue;
+        }
+        else if ( iChar <= ' ' )
+        {
+            continue;
+        }
+        else
+        {
+            return( XSVF_ERROR_ILLEGALCMD );
+        }
+
+        if ( !lDigits && !iDigit )
+        {
+            continue;
+        }
+        if ( lDigits == lMaxDigits )
+        {
+            XSVFDBG_PRINTF1( 0, "ERROR:  SVF value longer than %ld bits\n",
+                             lNumBits );
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        if ( lDigits & 1 )
+        {
+            pucDst[ lDigits >> 1 ]  |= (unsigned char)iDigit;
+        }
+        else
+        {
+            pucDst[ lDigits >> 1 ]  = (unsigned char)( iDigit << 4 );
+        }
+        ++lDigits;
+    }
+
+    /* Right-align:  move the digits up by lShift nibbles */
+    lShift  = lMaxDigits - lDigits;
+    lBytes  = lShift >> 1;
+    if ( !lDigits )
+    {
+        memset( pucDst, 0, lNumBytes );
+    }
+    else if ( !( lShift & 1 ) )
+    {
+        if ( lBytes )
+        {
+            memmove( pucDst + lBytes, pucDst, lNumBytes - lBytes );
+            memset( pucDst, 0, lBytes );
+        }
+    }
+    else
+    {
+        for ( j = lNumBytes - 1; j > lBytes; --j )
+        {
+            pucDst[ j ] = (unsigned char)( ( pucDst[ j - lBytes - 1 ] << 4 ) |
+                                           ( pucDst[ j - lBytes ] >> 4 ) );
+        }
+        pucDst[ lBytes ]    = (unsigned char)( pucDst[ 0 ] >> 4 );
+        memset( pucDst, 0, lBytes );
+    }
+    if ( lNumBits & 7 )
+    {
+        pucDst[ 0 ] &= (unsigned char)( ( 1 << ( lNumBits & 7 ) ) - 1 );
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+
+/*============================================================================
+* SVF Statements
+============================================================================*/
+
+/*****************************************************************************
+* Function:     svfScanReserve
+* Description:  Set a scan kind to a new length:  TDI 0, MASK and SMASK
+*               all ones, no TDO.
+* Parameters:   pScan       - the scan kind.
+*               lNumBits    - the new length.
+* Returns:      int         - 0 = success; otherwise XSVF_ERROR_DATAOVERFLOW.
+*****************************************************************************/
+static int svfScanReserve( SSvfScan* pScan, long lNumBits )
+{
+    long    lNumBytes;
+
+    lNumBytes   = ( lNumBits + 7 ) / 8;
+    if ( ( lNumBits < 0 ) || ( lNumBytes > LENVAL_MAX_BYTES ) )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+    if ( lNumBytes > pScan->lMaxBytes )
+    {
+        free( pScan->pucArena );
+        pScan->pucArena     = (unsigned char*)malloc( 4 * lNumBytes );
+        pScan->lMaxBytes    = pScan->pucArena ? lNumBytes : 0;
+        if ( !pScan->pucArena )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        pScan->pucTdi       = pScan->pucArena;
+        pScan->pucTdo       = pScan->pucArena + lNumBytes;
+        pScan->pucMask      = pScan->pucArena + 2 * lNumBytes;
+        pScan->pucSmask     = pScan->pucArena + 3 * lNumBytes;
+    }
+
+    pScan->lNumBits     = lNumBits;
+    pScan->lNumBytes    = lNumBytes;
+    pScan->iTdo         = 0;
+    if ( lNumBytes )
+    {
+        memset( pScan->pucTdi, 0, lNumBytes );
+        memset( pScan->pucMask, 0xFF, lNumBytes );
+        memset( pScan->pucSmask, 0xFF, lNumBytes );
+        if ( lNumBits & 7 )
+        {
+            pScan->pucMask[ 0 ]     = (unsigned char)( ( 1 << ( lNumBits & 7 ) ) - 1 );
+            pScan->pucSmask[ 0 ]    = pScan->pucMask[ 0 ];
+        }
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     svfArenaReserve
+* Description:  Make each full-scan lenVal able to hold lNumBytes.
+* Parameters:   pSvf        - the player.
+*               lNumBytes   - bytes of the full scan.
+* Returns:      int         - 0 = success; otherwise XSVF_ERROR_DATAOVERFLOW.
+*****************************************************************************/
+static int svfArenaReserve( SSvfPlayer* pSvf, long lNumBytes )
+{
+    if ( lNumBytes > LENVAL_MAX_BYTES )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+    if ( lNumBytes > pSvf->lArenaBytes )
+    {
+        free( pSvf->pucArena );
+        pSvf->pucArena      = (unsigned char*)malloc( 4 * lNumBytes );
+        pSvf->lArenaBytes   = pSvf->pucArena ? lNumBytes : 0;
+        if ( !pSvf->pucArena )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+    }
+    pSvf->lvTdi.val         = pSvf->pucArena;
+    pSvf->lvTdoExpected.val = pSvf->pucArena + lNumBytes;
+    pSvf->lvTdoMask.val     = pSvf->pucArena + 2 * lNumBytes;
+    pSvf->lvTdoCaptured.val = pSvf->pucArena + 3 * lNumBytes;
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     svfPutBits
+* Description:  OR a right-aligned value into a lenVal at a bit offset,
+*               where bit 0 is the first bit shifted (LSB of the last byte).
+* Parameters:   plv         - the destination.
+*               lBitOffset  - first destination bit.
+*               pucSrc      - the value, MSB first.
+*               lSrcBytes   - bytes in pucSrc.
+* Returns:      void.
+*****************************************************************************/
+static void svfPutBits( lenVal*                 plv,
+                        long                    lBitOffset,
+                        const unsigned char*    pucSrc,
+                        long                    lSrcBytes )
+{
+    long            lByte;
+    long            j;
+    int             iShift;
+    unsigned char   ucValue;
+
+    lByte   = plv->len - 1 - ( lBitOffset >> 3 );
+    iShift  = (int)( lBitOffset & 7 );
+    for ( j = lSrcBytes - 1; ( j >= 0 ) && ( lByte >= 0 ); --j, --lByte )
+    {
+        ucValue         = pucSrc[ j ];
+        plv->val[ lByte ]   |= (unsigned char)( ucValue << iShift );
+        if ( iShift && lByte )
+        {
+            plv->val[ lByte - 1 ]   |= (unsigned char)( ucValue >> ( 8 - iShift ) );
+        }
+    }
+}
+
+/*****************************************************************************
+* Function:     svfDoScan
+* Description:  Play an SIR or SDR with its header and trailer.  Without a
+*               header or trailer the scan's own buffers are shifted as
+*               they are; otherwise header, data and trailer are assembled
+*               in shift order (header first) in the full-scan lenVals.
+* Parameters:   pSvf    - the player.
+*               iScan   - SVF_SIR or SVF_SDR.
+* Returns:      int     - 0 = success; otherwise error.
+*****************************************************************************/
+static int svfDoScan( SSvfPlayer* pSvf, int iScan )
+{
+    SSvfScan*   apPart[ 3 ];
+    long        lNumBits;
+    long        lNumBytes;
+    long        lOffset;
+    int         iTdo;
+    int         iErrorCode;
+    int         i;
+
+    apPart[ 0 ] = &(pSvf->aScan[ iScan + 2 ]);     /* header */
+    apPart[ 1 ] = &(pSvf->aScan[ iScan ]);
+    apPart[ 2 ] = &(pSvf->aScan[ iScan + 4 ]);     /* trailer */
+
+    lNumBits    = 0;
+    iTdo        = 0;
+    for ( i = 0; i < 3; ++i )
+    {
+        lNumBits    += apPart[ i ]->lNumBits;
+        iTdo        |= ( apPart[ i ]->iTdo && apPart[ i ]->lNumBits );
+    }
+    lNumBytes   = ( lNumBits + 7 ) / 8;
+    iErrorCode  = svfArenaReserve( pSvf, lNumBytes );
+    if ( iErrorCode )
+    {
+        return( iErrorCode );
+    }
+    pSvf->lvTdi.len         = lNumBytes;
+    pSvf->lvTdoExpected.len = lNumBytes;
+    pSvf->lvTdoMask.len     = lNumBytes;
+    pSvf->lvTdoCaptured.len = lNumBytes;
+
+    if ( lNumBits == apPart[ 1 ]->lNumBits )
+    {
+        /* No header or trailer:  shift the hex straight from the scan */
+        pSvf->lvTdi.val         = apPart[ 1 ]->pucTdi;
+        pSvf->lvTdoExpected.val = apPart[ 1 ]->pucTdo;
+        pSvf->lvTdoMask.val     = apPart[ 1 ]->pucMask;
+    }
+    else if ( lNumBytes )
+    {
+        memset( pSvf->lvTdi.val, 0, lNumBytes );
+        memset( pSvf->lvTdoExpected.val, 0, lNumBytes );
+        memset( pSvf->lvTdoMask.val, 0, lNumBytes );
+        lOffset = 0;
+        for ( i = 0; i < 3; ++i )
+        {
+            svfPutBits( &(pSvf->lvTdi), lOffset, apPart[ i ]->pucTdi,
+                        apPart[ i ]->lNumBytes );
+            if ( apPart[ i ]->iTdo )
+            {
+                /* parts without TDO stay 0 in the mask:  not compared */
+                svfPutBits( &(pSvf->lvTdoExpected), lOffset,
+                            apPart[ i ]->pucTdo, apPart[ i ]->lNumBytes );
+                svfPutBits( &(pSvf->lvTdoMask), lOffset,
+                            apPart[ i ]->pucMask, apPart[ i ]->lNumBytes );
+            }
+            lOffset += apPart[ i ]->lNumBits;
+        }
+    }
+
+    if ( !lNumBits )
+    {
+        /* Compatibility with XSDR 0:  no shift, just the end state */
+        return( xsvfGotoTapState( &(pSvf->ucTapState),
+                                  ( iScan == SVF_SIR ) ? pSvf->ucEndIR
+                                                       : pSvf->ucEndDR ) );
+    }
+
+    return( xsvfShift( &(pSvf->ucTapState),
+                       ( iScan == SVF_SIR ) ? XTAPSTATE_SHIFTIR
+                                            : XTAPSTATE_SHIFTDR,
+                       lNumBits, &(pSvf->lvTdi),
+                       iTdo ? &(pSvf->lvTdoCaptured) : 0,
+                       iTdo ? &(pSvf->lvTdoExpected) : 0,
+                       iTdo ? &(pSvf->lvTdoMask) : 0,
+                       ( iScan == SVF_SIR ) ? pSvf->ucEndIR : pSvf->ucEndDR,
+                       0, 0 ) );
+}
+
+/*****************************************************************************
+* Function:     svfDoScanStatement
+* Description:  SIR, SDR, HIR, HDR, TIR or TDR:
+*                   length [TDI (tdi)] [TDO (tdo)] [MASK (mask)]
+*                   [SMASK (smask)] ;
+*               SIR and SDR are played; the others set the header or
+*               trailer of later scans.
+* Parameters:   pSvf    - the player.
+*               iScan   - SVF_SIR ... SVF_TDR.
+* Returns:      int     - 0 = success; otherwise error.
+*****************************************************************************/
+static int svfDoScanStatement( SSvfPlayer* pSvf, int iScan )
+{
+    SSvfScan*       pScan;
+    unsigned char*  pucDst;
+    double          dLength;
+    int             iToken;
+    int             iErrorCode;
+
+    pScan   = &(pSvf->aScan[ iScan ]);
+    if ( ( iErrorCode = svfWord( pSvf ) ) ||
+         ( iErrorCode = svfNumber( pSvf, &dLength ) ) )
+    {
+        return( iErrorCode );
+    }
+    if ( ( (long)dLength != pScan->lNumBits ) || !pScan->pucArena )
+    {
+        if ( ( dLength < 0 ) || ( dLength > 8.0 * LENVAL_MAX_BYTES ) ||
+             ( iErrorCode = svfScanReserve( pScan, (long)dLength ) ) )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+    }
+    if ( iScan < SVF_HIR )
+    {
+        pScan->iTdo = 0;
+    }
+
+    for ( ; ; )
+    {
+        if ( ( iErrorCode = svfToken( pSvf, &iToken ) ) )
+        {
+            return( iErrorCode );
+        }
+        if ( iToken == SVF_TOK_SEMI )
+        {
+            break;
+        }
+        if ( iToken != SVF_TOK_WORD )
+        {
+            return( ( iToken == SVF_TOK_EOF ) ? XSVF_ERROR_TRUNCATED
+                                              : XSVF_ERROR_ILLEGALCMD );
+        }
+
+        if ( !strcmp( pSvf->szWord, "TDI" ) )
+        {
+            pucDst  = pScan->pucTdi;
+        }
+        else if ( !strcmp( pSvf->szWord, "TDO" ) )
+        {
+            pucDst      = pScan->pucTdo;
+            pScan->iTdo = 1;
+        }
+        else if ( !strcmp( pSvf->szWord, "MASK" ) )
+        {
+            pucDst  = pScan->pucMask;
+        }
+        else if ( !strcmp( pSvf->szWord, "SMASK" ) )
+        {
+            pucDst  = pScan->pucSmask;
+        }
+        else
+        {
+            return( XSVF_ERROR_ILLEGALCMD );
+        }
+
+        if ( ( iErrorCode = svfToken( pSvf, &iToken ) ) )
+        {
+            return( iErrorCode );
+        }
+        if ( iToken != SVF_TOK_LPAREN )
+        {
+            return( XSVF_ERROR_ILLEGALCMD );
+        }
+        if ( ( iErrorCode = svfReadHex( pSvf, pucDst, pScan->lNumBits ) ) )
+        {
+            return( iErrorCode );
+        }
+    }
+
+    if ( iScan < SVF_HIR )
+    {
+        return( svfDoScan( pSvf, iScan ) );
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     svfClock
+* Description:  Clock TCK lCount times in the current (stable) state.
+* Parameters:   pSvf    - the player.
+*               lCount  - number of TCK cycles.
+* Returns:      void.
+*****************************************************************************/
+static void svfClock( SSvfPlayer* pSvf, long lCount )
+{
+    unsigned short  usTms;
+    int             iNumBits;
+
+    /* Test-Logic-Reset holds with TMS=1, the other stable states with 0 */
+    usTms   = ( pSvf->ucTapState == XTAPSTATE_RESET ) ? 0xFFFF : 0;
+    while ( lCount > 0 )
+    {
+        iNumBits    = ( lCount > 16 ) ? 16 : (int)lCount;
+        xsvfShiftTms( usTms, (unsigned short)iNumBits );
+        lCount      -= iNumBits;
+    }
+}
+
+/*****************************************************************************
+* Function:     svfDoRunTest
+* Description:  RUNTEST [run_state] run_count TCK|SCK [min_time SEC
+*                   [MAXIMUM max_time SEC]] [ENDSTATE end_state] ;
+*               RUNTEST [run_state] min_time SEC [MAXIMUM max_time SEC]
+*                   [ENDSTATE end_state] ;
+*               The run and end states are sticky; a run_state without an
+*               ENDSTATE is also the end state.  The wait is the longer of
+*               run_count at FREQUENCY and min_time; the maximum cannot be
+*               enforced by this player and is ignored.
+* Parameters:   pSvf    - the player.
+* Returns:      int     - 0 = success; otherwise error.
+*****************************************************************************/
+static int svfDoRunTest( SSvfPlayer* pSvf )
+{
+    unsigned char   ucState;
+    double          dValue;
+    double          dCount;
+    double          dMinSec;
+    long long       llStartNs;
+    long long       llWaitNs;
+    int             iToken;
+    int             iErrorCode;
+
+    dCount  = 0;
+    dMinSec = 0;
+    if ( ( iErrorCode = svfWord( pSvf ) ) )
+    {
+        return( iErrorCode );
+    }
+    if ( !svfState( pSvf, &ucState ) )
+    {
+        if ( !svfIsStable( ucState ) )
+        {
+            return( XSVF_ERROR_ILLEGALSTATE );
+        }
+        pSvf->ucRunState    = ucState;
+        pSvf->ucRunEndState = ucState;
+        if ( ( iErrorCode = svfWord( pSvf ) ) )
+        {
+            return( iErrorCode );
+        }
+    }
+
+    /* run_count TCK|SCK and/or min_time SEC */
+    for ( ; ; )
+    {
+        if ( ( iErrorCode = svfNumber( pSvf, &dValue ) ) ||
+             ( iErrorCode = svfWord( pSvf ) ) )
+        {
+            return( iErrorCode );
+        }
+        if ( !strcmp( pSvf->szWord, "TCK" ) || !strcmp( pSvf->szWord, "SCK" ) )
+        {
+            dCount  = dValue;
+        }
+        else if ( !strcmp( pSvf->szWord, "SEC" ) )
+        {
+            dMinSec = dValue;
+        }
+        else
+        {
+            return( XSVF_ERROR_ILLEGALCMD );
+        }
+
+        if ( ( iErrorCode = svfToken( pSvf, &iToken ) ) )
+        {
+            return( iErrorCode );
+        }
+        if ( iToken != SVF_TOK_WORD )
+        {
+            break;
+        }
+        if ( !strcmp( pSvf->szWord, "MAXIMUM" ) )
+        {
+            if ( ( iErrorCode = svfWord( pSvf ) ) ||
+                 ( iErrorCode = svfNumber( pSvf, &dValue ) ) ||
+                 ( iErrorCode = svfWord( pSvf ) ) ||
+                 ( iErrorCode = svfToken( pSvf, &iToken ) ) )
+            {
+                return( iErrorCode );
+            }
+            if ( iToken != SVF_TOK_WORD )
+            {
+                break;
+            }
+        }
+        if ( !strcmp( pSvf->szWord, "ENDSTATE" ) )
+        {
+            if ( ( iErrorCode = svfWord( pSvf ) ) ||
+                 ( iErrorCode = svfState( pSvf, &ucState ) ) )
+            {
+                return( iErrorCode );
+            }
+            if ( !svfIsStable( ucState ) )
+            {
+                return( XSVF_ERROR_ILLEGALSTATE );
+            }
+            pSvf->ucRunEndState = ucState;
+            if ( ( iErrorCode = svfToken( pSvf, &iToken ) ) )
+            {
+                return( iErrorCode );
+            }
+            break;
+        }
+    }
+    if ( iToken != SVF_TOK_SEMI )
+    {
+        return( ( iToken == SVF_TOK_EOF ) ? XSVF_ERROR_TRUNCATED
+                                          : XSVF_ERROR_ILLEGALCMD );
+    }
+
+    iErrorCode  = xsvfGotoTapState( &(pSvf->ucTapState), pSvf->ucRunState );
+    if ( iErrorCode )
+    {
+        return( iErrorCode );
+    }
+
+    llStartNs   = timingNowNs();
+    svfClock( pSvf, (long)dCount );
+    if ( pSvf->dFrequency > 0 )
+    {
+        dValue  = dCount / pSvf->dFrequency;
+        if ( dValue > dMinSec )
+        {
+            dMinSec = dValue;
+        }
+    }
+    llWaitNs    = (long long)( dMinSec * 1e9 ) - ( timingNowNs() - llStartNs );
+    if ( llWaitNs > 0 )
+    {
+        XSVFDBG_PRINTF1( 3, "   Wait = %ld usec\n",
+                         (long)( ( llWaitNs + 999 ) / 1000 ) );
+        waitTime( (long)( ( llWaitNs + 999 ) / 1000 ) );
+    }
+
+    return( xsvfGotoTapState( &(pSvf->ucTapState), pSvf->ucRunEndState ) );
+}
+
+/*****************************************************************************
+* Function:     svfDoState
+* Description:  STATE [path_state ...] stable_state ;  each state is
+*               entered in turn.
+* Parameters:   pSvf    - the player.
+* Returns:      int     - 0 = success; otherwise error.
+*****************************************************************************/
+static int svfDoState( SSvfPlayer* pSvf )
+{
+    unsigned char   ucState;
+    int             iToken;
+    int             iErrorCode;
+
+    ucState = pSvf->ucTapState;
+    for ( ; ; )
+    {
+        if ( ( iErrorCode = svfToken( pSvf, &iToken ) ) )
+        {
+            return( iErrorCode );
+        }
+        if ( iToken != SVF_TOK_WORD )
+        {
+            break;
+        }
+        if ( ( iErrorCode = svfState( pSvf, &ucState ) ) ||
+             ( iErrorCode = xsvfGotoTapState( &(pSvf->ucTapState), ucState ) ) )
+        {
+            return( iErrorCode );
+        }
+    }
+    if ( iToken != SVF_TOK_SEMI )
+    {
+        return( ( iToken == SVF_TOK_EOF ) ? XSVF_ERROR_TRUNCATED
+                                          : XSVF_ERROR_ILLEGALCMD );
+    }
+    return( svfIsStable( ucState ) ? XSVF_ERROR_NONE : XSVF_ERROR_ILLEGALSTATE );
+}
+
+/*****************************************************************************
+* Function:     svfDoSimple
+* Description:  ENDIR, ENDDR, FREQUENCY and TRST:  read the statement's
+*               words up to the ";" and apply them.
+* Parameters:   pSvf        - the player.
+*               pzCommand   - the (upper-case) command.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+static int svfDoSimple( SSvfPlayer* pSvf, const char* pzCommand )
+{
+    unsigned char   ucState;
+    double          dValue;
+    int             iToken;
+    int             iWords;
+    int             iErrorCode;
+
+    iWords  = 0;
+    for ( ; ; )
+    {
+        if ( ( iErrorCode = svfToken( pSvf, &iToken ) ) )
+        {
+            return( iErrorCode );
+        }
+        if ( iToken != SVF_TOK_WORD )
+        {
+            break;
+        }
+        ++iWords;
+
+        if ( !strcmp( pzCommand, "ENDIR" ) || !strcmp( pzCommand, "ENDDR" ) )
+        {
+            if ( ( iWords > 1 ) || svfState( pSvf, &ucState ) ||
+                 !svfIsStable( ucState ) )
+            {
+                return( XSVF_ERROR_ILLEGALSTATE );
+            }
+            if ( pzCommand[ 3 ] == 'I' )
+            {
+                pSvf->ucEndIR   = ucState;
+            }
+            else
+            {
+                pSvf->ucEndDR   = ucState;
+            }
+        }
+        else if ( !strcmp( pzCommand, "FREQUENCY" ) )
+        {
+            /* FREQUENCY cycles HZ */
+            if ( iWords == 1 )
+            {
+                if ( ( iErrorCode = svfNumber( pSvf, &dValue ) ) )
+                {
+                    return( iErrorCode );
+                }
+                pSvf->dFrequency    = dValue;
+            }
+            else if ( ( iWords > 2 ) || strcmp( pSvf->szWord, "HZ" ) )
+            {
+                return( XSVF_ERROR_ILLEGALCMD );
+            }
+        }
+        else
+        {
+            /* TRST ON|OFF|Z|ABSENT:  there is no TRST pin */
+            if ( ( iWords > 1 ) ||
+                 ( strcmp( pSvf->szWord, "ON" ) &&
+                   strcmp( pSvf->szWord, "OFF" ) &&
+                   strcmp( pSvf->szWord, "Z" ) &&
+                   strcmp( pSvf->szWord, "ABSENT" ) ) )
+            {
+                return( XSVF_ERROR_ILLEGALCMD );
+            }
+            XSVFDBG_PRINTF1( 2, "   TRST %s ignored\n", pSvf->szWord );
+        }
+    }
+    if ( iToken != SVF_TOK_SEMI )
+    {
+        return( ( iToken == SVF_TOK_EOF ) ? XSVF_ERROR_TRUNCATED
+                                          : XSVF_ERROR_ILLEGALCMD );
+    }
+    if ( !strcmp( pzCommand, "TRST" ) && !iWords )
+    {
+        return( XSVF_ERROR_ILLEGALCMD );
+    }
+    if ( !strcmp( pzCommand, "FREQUENCY" ) && !iWords )
+    {
+        /* FREQUENCY ;  back to the default:  no TCK rate */
+        pSvf->dFrequency    = 0;
+    }
+    if ( !strcmp( pzCommand, "FREQUENCY" ) )
+    {
+        /* -tck:  the next TCK phase */
+        portsPaceFrequency( portsCurrent(), pSvf->dFrequency );
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     svfStatement
+* Description:  Read and play one statement.
+* Parameters:   pSvf        - the player.
+*               piDone      - set at the end of the input.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+static int svfStatement( SSvfPlayer* pSvf, int* piDone )
+{
+    static const char*  apzScan[ SVF_NUM_SCANS ] =
+        { "SIR", "SDR", "HIR", "HDR", "TIR", "TDR" };
+    char                szCommand[ SVF_MAX_WORD ];
+    int                 iToken;
+    int                 iErrorCode;
+    int                 i;
+
+    if ( ( iErrorCode = svfToken( pSvf, &iToken ) ) )
+    {
+        return( iErrorCode );
+    }
+    pSvf->lStatementLine    = pSvf->lLine;
+    if ( iToken == SVF_TOK_EOF )
+    {
+        *piDone = 1;
+        return( XSVF_ERROR_NONE );
+    }
+    if ( iToken == SVF_TOK_SEMI )
+    {
+        return( XSVF_ERROR_NONE );
+    }
+    if ( iToken != SVF_TOK_WORD )
+    {
+        return( XSVF_ERROR_ILLEGALCMD );
+    }
+
+    ++xsvf_stats.lCommands;
+    strcpy( szCommand, pSvf->szWord );
+    XSVFDBG_PRINTF2( 2, "SVF line %ld: %s\n", pSvf->lLine, szCommand );
+    for ( i = 0; i < SVF_NUM_SCANS; ++i )
+    {
+        if ( !strcmp( szCommand, apzScan[ i ] ) )
+        {
+            return( svfDoScanStatement( pSvf, i ) );
+        }
+    }
+    if ( !strcmp( szCommand, "RUNTEST" ) )
+    {
+        return( svfDoRunTest( pSvf ) );
+    }
+    if ( !strcmp( szCommand, "STATE" ) )
+    {
+        return( svfDoState( pSvf ) );
+    }
+    if ( !strcmp( szCommand, "ENDIR" ) || !strcmp( szCommand, "ENDDR" ) ||
+         !strcmp( szCommand, "FREQUENCY" ) || !strcmp( szCommand, "TRST" ) )
+    {
+        return( svfDoSimple( pSvf, szCommand ) );
+    }
+
+    XSVFDBG_PRINTF1( 0, "ERROR:  Unsupported SVF command %s\n", szCommand );
+    return( XSVF_ERROR_ILLEGALCMD );
+}
+
+
+/*============================================================================
+* SVF Player Interface
+============================================================================*/
+
+/*****************************************************************************
+* Function:     svfIsSvf
+* Description:  SVF is text:  the first non-blank character is a letter or
+*               starts a comment, and every byte looked at is printable or
+*               a space, tab, CR or LF.  XSVF starts with command bytes
+*               below 0x20.
+* Parameters:   pucData     - the first bytes of the input.
+*               lSize       - number of bytes.
+* Returns:      int         - non-zero for SVF.
+*****************************************************************************/
+int svfIsSvf( const unsigned char* pucData, long lSize )
+{
+    long    i;
+    int     iFirst;
+
+    iFirst  = 0;
+    for ( i = 0; i < lSize; ++i )
+    {
+        if ( ( pucData[ i ] < ' ' ) && ( pucData[ i ] != '\t' ) &&
+             ( pucData[ i ] != '\r' ) && ( pucData[ i ] != '\n' ) )
+        {
+            return( 0 );
+        }
+        if ( ( pucData[ i ] >= 0x7F ) )
+        {
+            return( 0 );
+        }
+        if ( !iFirst && ( pucData[ i ] > ' ' ) )
+        {
+            iFirst  = pucData[ i ];
+        }
+    }
+    return( ( iFirst == '!' ) || ( iFirst == '/' ) ||
+            ( ( ( iFirst | 0x20 ) >= 'a' ) && ( ( iFirst | 0x20 ) <= 'z' ) ) );
+}
+
+/*****************************************************************************
+* Function:     svfRun
+* Description:  Play the SVF statements in pInput; see svf.h.
+* Parameters:   pInput      - the SVF text.
+*               plLine      - receives the line of the failing statement.
+* Returns:      int         - XSVF_ERROR_*; see micro.h.
+*****************************************************************************/
+int svfRun( SXsvfInput* pInput, long* plLine )
+{
+    SSvfPlayer  svf;
+    int         iDone;
+    int         iErrorCode;
+    int         i;
+
+    memset( &svf, 0, sizeof( svf ) );
+    svf.pInput          = pInput;
+    svf.lLine           = 1;
+    svf.lStatementLine  = 1;
+    svf.ucEndIR         = XTAPSTATE_RUNTEST;
+    svf.ucEndDR         = XTAPSTATE_RUNTEST;
+    svf.ucRunState      = XTAPSTATE_RUNTEST;
+    svf.ucRunEndState   = XTAPSTATE_RUNTEST;
+    for ( i = 0; i < SVF_NUM_SCANS; ++i )
+    {
+        svf.aScan[ i ].lNumBits = -1;   /* first statement sets the length */
+    }
+    for ( i = SVF_HIR; i < SVF_NUM_SCANS; ++i )
+    {
+        svf.aScan[ i ].lNumBits = 0;    /* no header or trailer */
+    }
+
+    /* Initialize the TAPs */
+    iErrorCode  = xsvfGotoTapState( &(svf.ucTapState), XTAPSTATE_RESET );
+
+    iDone   = 0;
+    while ( !iErrorCode && !iDone )
+    {
+        iErrorCode  = svfStatement( &svf, &iDone );
+    }
+
+    for ( i = 0; i < SVF_NUM_SCANS; ++i )
+    {
+        free( svf.aScan[ i ].pucArena );
+    }
+    free( svf.pucArena );
+
+    *plLine = svf.lStatementLine;
+    return( iErrorCode );
+}
@@ -0,0 +1,38 @@
+/*****************************************************************************
+* File:         svf.h
+* Description:  This header file contains the SVF player.  SVF (Serial
+*               Vector Format) text is read from the same input as XSVF and
+*               played through the XSVF interpreter's shift and TAP state
+*               primitives, so vendor SVF files need no svf2xsvf step.
+*****************************************************************************/
+#ifndef XSVF_SVF_H
+#define XSVF_SVF_H
+
+#include "input.h"
+
+/* longest keyword or number in an SVF statement */
+#define SVF_MAX_WORD    64
+
+/* bytes svfIsSvf() wants to look at, if the input has them */
+#define SVF_SNIFF_BYTES 64
+
+/*****************************************************************************
+* Function:     svfIsSvf
+* Description:  Check whether data starts like SVF text rather than XSVF.
+* Parameters:   pucData     - the first bytes of the input.
+*               lSize       - number of bytes (up to SVF_SNIFF_BYTES).
+* Returns:      int         - non-zero for SVF.
+*****************************************************************************/
+extern int svfIsSvf( const unsigned char* pucData, long lSize );
+
+/*****************************************************************************
+* Function:     svfRun
+* Description:  Play SVF statements from pInput on the current port until
+*               the end of the input or the first error.
+* Parameters:   pInput      - the SVF text.
+*               plLine      - receives the line of the failing statement.
+* Returns:      int         - XSVF_ERROR_*; see micro.h.
+*****************************************************************************/
+extern int svfRun( SXsvfInput* pInput, long* plLine );
+
+#endif  /* XSVF_SVF_H */
@@ -0,0 +1,220 @@
+/*******************************************************/
+/* file: timing.c                                      */
+/* abstract:  This file contains the waitTime() modes. */
+/*            usleep() overshoots by the scheduler     */
+/*            granularity and keeps TCK still, which   */
+/*            FPGA and indirect flash programming do   */
+/*            not allow.  Each wait here sleeps, spins */
+/*            or pulses TCK against an absolute        */
+/*            CLOCK_MONOTONIC deadline:                */
+/*  TIMING_SLEEP:  TCK low; clock_nanosleep(ABSTIME).  */
+/*  TIMING_SPIN:   TCK low; sleep until the measured   */
+/*                 wake-up latency before the deadline,*/
+/*                 then spin on the clock.  Short      */
+/*                 waits only spin.                    */
+/*  TIMING_TCK:    at least lMicrosec TCK pulses AND   */
+/*                 until the deadline, TMS held.  The  */
+/*                 TCK rate of earlier waits sizes the */
+/*                 bursts between clock reads.         */
+/*******************************************************/
+#include "timing.h"
+#include "rt.h"
+
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+
+#define TIMING_TCK_BURST    32  /* TMS bits per portsShiftTms() call */
+#define TIMING_CAL_SAMPLES  8   /* sleeps used to measure wake-up latency */
+#define TIMING_CAL_US       100
+
+static const char* g_apzModeName[TIMING_NUM_MODES] = { "sleep", "spin", "tck" };
+
+static int          g_iMode = TIMING_SLEEP;
+static XSVF_THREAD STimingStats g_timing;   /* per chain (thread) */
+
+static void timeNow(struct timespec* pTs)
+{
+    clock_gettime(CLOCK_MONOTONIC, pTs);
+}
+
+static void timeAddUs(struct timespec* pTs, long lMicrosec)
+{
+    pTs->tv_sec += lMicrosec / 1000000L;
+    pTs->tv_nsec += (lMicrosec % 1000000L) * 1000L;
+    if(pTs->tv_nsec >= 1000000000L) {
+        pTs->tv_nsec -= 1000000000L;
+        ++pTs->tv_sec;
+    } else if(pTs->tv_nsec < 0) {
+        pTs->tv_nsec += 1000000000L;
+        --pTs->tv_sec;
+    }
+}
+
+/* microseconds from pFrom to pTo, rounded up; negative if pTo is earlier */
+static long timeDiffUs(const struct timespec* pFrom, const struct timespec* pTo)
+{
+    long long llNs = (long long)(pTo->tv_sec - pFrom->tv_sec) * 1000000000LL +
+                     (pTo->tv_nsec - pFrom->tv_nsec);
+
+    return (long)((llNs >= 0) ? (llNs + 999) / 1000 : llNs / 1000);
+}
+
+static long usecUntil(const struct timespec* pDeadline)
+{
+    struct timespec ts;
+
+    timeNow(&ts);
+    return timeDiffUs(&ts, pDeadline);
+}
+
+/* a long sleep runs at normal priority in -rt mode (see rt.h) */
+static void sleepUntil(const struct timespec* pDeadline)
+{
+    int iDemoted = rtSleepBegin(usecUntil(pDeadline));
+
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, pDeadline, 0) == EINTR) {
+    }
+    rtSleepEnd(iDemoted, timingNowNs() -
+                         ((long long)pDeadline->tv_sec * 1000000000LL + pDeadline->tv_nsec));
+}
+
+/* worst wake-up latency of a short clock_nanosleep() on this system */
+static void calibrateWake()
+{
+    struct timespec tsStart;
+    struct timespec tsDeadline;
+    long lOver;
+    int i;
+
+    g_timing.lWakeUs = 1;
+    for(i = 0; i < TIMING_CAL_SAMPLES; ++i) {
+        timeNow(&tsStart);
+        tsDeadline = tsStart;
+        timeAddUs(&tsDeadline, TIMING_CAL_US);
+        sleepUntil(&tsDeadline);
+        lOver = -usecUntil(&tsDeadline);
+        if(lOver > g_timing.lWakeUs) { g_timing.lWakeUs = lOver; }
+    }
+}
+
+/* Make sure TCK is low during the wait for XC18V00/XCFxxS PROMs */
+static void tckLow(SPort* pPort)
+{
+    pPort->asLevel[TCK] = 0;
+    pPort->pDriver->pfSetPins(pPort, pPort->asLevel[TMS], pPort->asLevel[TDI], 0);
+}
+
+static void waitSpin(const struct timespec* pDeadline, long lMicrosec)
+{
+    struct timespec tsWake;
+
+    if(!g_timing.lWakeUs) { calibrateWake(); }
+    if(lMicrosec > g_timing.lWakeUs) {
+        tsWake = *pDeadline;
+        timeAddUs(&tsWake, -g_timing.lWakeUs);
+        sleepUntil(&tsWake);
+    }
+    while(usecUntil(pDeadline) > 0) {
+    }
+}
+
+static void waitTck(SPort* pPort, const struct timespec* pDeadline, long lMicrosec)
+{
+    unsigned long ulTms = pPort->asLevel[TMS] ? ~0UL : 0UL;
+    long lPulses = 0;
+    long lLeftUs;
+    long lBatch;
+    int iBurst;
+
+    for(;;) {
+        lLeftUs = usecUntil(pDeadline);
+        if((lPulses >= lMicrosec) && (lLeftUs <= 0)) { break; }
+
+        /* pulses expected to fill the time left, at the measured rate */
+        lBatch = ((lLeftUs > 0) && g_timing.lTckPerMs) ?
+                 (lLeftUs * g_timing.lTckPerMs) / 1000L : 1;
+        if(lBatch < lMicrosec - lPulses) { lBatch = lMicrosec - lPulses; }
+        if(lBatch < 1) { lBatch = 1; }
+
+        lPulses += lBatch;
+        while(lBatch) {
+            iBurst = (lBatch > TIMING_TCK_BURST) ? TIMING_TCK_BURST : (int)lBatch;
+            portsShiftTms(pPort, ulTms, iBurst);
+            lBatch -= iBurst;
+        }
+    }
+    g_timing.lTckPulses += lPulses;
+}
+
+int timingSelectMode(const char* pzName)
+{
+    int i;
+
+    for(i = 0; i < TIMING_NUM_MODES; ++i) {
+        if(!strcmp(g_apzModeName[i], pzName)) {
+            g_iMode = i;
+            return 0;
+        }
+    }
+
+    printf("ERROR: unknown wait mode: %s\n", pzName);
+    return -1;
+}
+
+const char* timingModeName()
+{
+    return g_apzModeName[g_iMode];
+}
+
+void timingWait(SPort* pPort, long lMicrosec)
+{
+    struct timespec tsStart;
+    struct timespec tsDeadline;
+    long lPulses = g_timing.lTckPulses;
+    long lActual;
+
+    if(lMicrosec < 0) { lMicrosec = 0; }
+    if(g_iMode != TIMING_TCK) { tckLow(pPort); }
+
+    timeNow(&tsStart);
+    tsDeadline = tsStart;
+    timeAddUs(&tsDeadline, lMicrosec);
+    switch(g_iMode) {
+    case TIMING_SPIN:
+        waitSpin(&tsDeadline, lMicrosec);
+        break;
+    case TIMING_TCK:
+        waitTck(pPort, &tsDeadline, lMicrosec);
+        break;
+    default:
+        if(lMicrosec) { sleepUntil(&tsDeadline); }
+        break;
+    }
+    lActual = -usecUntil(&tsStart);
+
+    ++g_timing.lWaits;
+    g_timing.lRequestedUs += lMicrosec;
+    g_timing.lActualUs += lActual;
+    if(lActual - lMicrosec > g_timing.lMaxOverUs) {
+        g_timing.lMaxOverUs = lActual - lMicrosec;
+    }
+    lPulses = g_timing.lTckPulses - lPulses;
+    if((g_iMode == TIMING_TCK) && (lPulses >= TIMING_TCK_BURST) && (lActual > 0)) {
+        g_timing.lTckPerMs = (lPulses * 1000L) / lActual;
+    }
+}
+
+const STimingStats* timingStats()
+{
+    return &g_timing;
+}
+
+long long timingNowNs()
+{
+    struct timespec ts;
+
+    timeNow(&ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,46 @@
+/*******************************************************/
+/* file: timing.h                                      */
+/* abstract:  This file contains the waitTime() modes. */
+/*            Every wait runs against an absolute      */
+/*            CLOCK_MONOTONIC deadline and records the */
+/*            requested and the actual wait.           */
+/*******************************************************/
+
+#ifndef timing_dot_h
+#define timing_dot_h
+
+#include "ports.h"
+
+/* wait modes; select one per target with timingSelectMode() */
+#define TIMING_SLEEP    0   /* TCK low, clock_nanosleep to the deadline */
+#define TIMING_SPIN     1   /* TCK low, sleep, then a calibrated spin */
+#define TIMING_TCK      2   /* pulse TCK until the deadline (FPGAs, flash) */
+
+#define TIMING_NUM_MODES    3
+
+typedef struct tagSTimingStats
+{
+    long    lWaits;         /* number of waitTime() calls */
+    long    lRequestedUs;   /* sum of the requested waits */
+    long    lActualUs;      /* sum of the measured waits */
+    long    lMaxOverUs;     /* largest overshoot of a single wait */
+    long    lTckPulses;     /* TCK pulses issued by TIMING_TCK */
+    long    lTckPerMs;      /* measured TCK rate, 0 = not measured yet */
+    long    lWakeUs;        /* measured sleep wake-up latency (TIMING_SPIN) */
+} STimingStats;
+
+/* select a mode by name ("sleep", "spin", "tck"); 0 = success */
+extern int timingSelectMode(const char* pzName);
+
+extern const char* timingModeName();
+
+/* wait at least lMicrosec microseconds on pPort in the selected mode */
+extern void timingWait(SPort* pPort, long lMicrosec);
+
+/* this thread's totals */
+extern const STimingStats* timingStats();
+
+/* CLOCK_MONOTONIC in nanoseconds */
+extern long long timingNowNs();
+
+#endif
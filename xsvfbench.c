@@ -0,0 +1,605 @@
+/*******************************************************/
+/* file: xsvfbench.c                                   */
+/* abstract:  This file contains the xsvfbench program.*/
+/*            It builds synthetic XSVF streams in      */
+/*            memory and plays each one through        */
+/*            micro.c on every selected port backend,  */
+/*            by default the null driver (interpreter  */
+/*            only) and the simulated chain (ports_    */
+/*            sim.c), so it needs no JTAG hardware:    */
+/*  fpga:    XSDRB/XSDRC/XSDRE configuration bitstream */
+/*  xc9500:  XSETSDRMASKS + XSDRINC compressed program */
+/*  verify:  XSDRTDO loop with every TDO bit compared  */
+/*           against TDO from the sim chain model      */
+/*            All waits are 0 so only the interpreter  */
+/*            and the port are measured.  micro.c is   */
+/*            compiled with XSVF_NO_MAIN.              */
+/*            -input raw,gzip,xz,zstd writes each      */
+/*            stream to a temporary file in those      */
+/*            formats and plays it through input.c, to */
+/*            compare time and bytes read.             */
+/*            -svf also writes each stream as the SVF  */
+/*            text svf2xsvf would have started from    */
+/*            and plays it through svf.c, to compare   */
+/*            the SVF parser with the XSVF path.       */
+/*            With -svf, malformed SVF statements that */
+/*            once hung the parser are played first;   */
+/*            each must fail.                          */
+/*******************************************************/
+#define DEBUG_MODE      /* as in micro.c; for xsvf_iDebugLevel */
+#include "micro.h"
+#include "lenval.h"
+#include "microint.h"
+#include "ports.h"
+#include "input.h"
+#include "timing.h"
+#include "xsvfplan.h"
+#include "svf.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef XSVF_SUPPORT_GZIP
+#include <zlib.h>
+#endif
+#ifdef XSVF_SUPPORT_XZ
+#include <lzma.h>
+#endif
+#ifdef XSVF_SUPPORT_ZSTD
+#include <zstd.h>
+#endif
+
+#define BENCH_DEFAULT_BITS  (4L * 1024L * 1024L)
+#define BENCH_FPGA_CHUNK    32768L  /* bits per XSDRB/C/E */
+#define BENCH_CPLD_BITS     96L     /* XC9500 ISP shift length */
+#define BENCH_CPLD_TIMES    255     /* XSDRINC pieces per command */
+#define BENCH_VERIFY_BITS   256L    /* XSDRTDO shift length */
+#define BENCH_SVF_LINE      64L     /* SVF hex bytes per line */
+
+extern XSVF_THREAD SXsvfInput* in;
+
+typedef struct tagSBenchBuf
+{
+    unsigned char*  puc;
+    long            lSize;
+    long            lMax;
+} SBenchBuf;
+
+/* every run starts from BENCH_SEED, so the XSVF and SVF of a stream */
+/* (and each -input format) carry the same data                        */
+#define BENCH_SEED  0x2545F491UL
+static unsigned long g_ulSeed = BENCH_SEED;
+
+static unsigned char nextRandom()
+{
+    g_ulSeed ^= g_ulSeed << 13;
+    g_ulSeed ^= g_ulSeed >> 17;
+    g_ulSeed ^= g_ulSeed << 5;
+    g_ulSeed &= 0xFFFFFFFFUL;
+    return (unsigned char)(g_ulSeed >> 11);
+}
+
+static void putBytes(SBenchBuf* pBuf, const unsigned char* puc, long lNumBytes)
+{
+    unsigned char* pucNew;
+
+    if(pBuf->lSize + lNumBytes > pBuf->lMax) {
+        while(pBuf->lSize + lNumBytes > pBuf->lMax) {
+            pBuf->lMax = pBuf->lMax ? pBuf->lMax * 2 : 65536;
+        }
+        pucNew = (unsigned char*)realloc(pBuf->puc, pBuf->lMax);
+        if(!pucNew) { printf("ERROR: out of memory\n"); exit(1); }
+        pBuf->puc = pucNew;
+    }
+    memcpy(pBuf->puc + pBuf->lSize, puc, lNumBytes);
+    pBuf->lSize += lNumBytes;
+}
+
+static void putByte(SBenchBuf* pBuf, unsigned char uc)
+{
+    putBytes(pBuf, &uc, 1);
+}
+
+/* XSVF 4-byte values are big-endian */
+static void putLong(SBenchBuf* pBuf, unsigned long ul)
+{
+    unsigned char auc[4];
+
+    auc[0] = (unsigned char)(ul >> 24);
+    auc[1] = (unsigned char)(ul >> 16);
+    auc[2] = (unsigned char)(ul >> 8);
+    auc[3] = (unsigned char)ul;
+    putBytes(pBuf, auc, 4);
+}
+
+static void putRandom(SBenchBuf* pBuf, long lNumBytes)
+{
+    while(lNumBytes--) { putByte(pBuf, nextRandom()); }
+}
+
+static void putText(SBenchBuf* pBuf, const char* pz)
+{
+    putBytes(pBuf, (const unsigned char*)pz, (long)strlen(pz));
+}
+
+/* SVF hex value, MSB first like a lenVal, wrapped every BENCH_SVF_LINE bytes */
+static void putHex(SBenchBuf* pBuf, const char* pzName, const unsigned char* puc,
+                   long lNumBytes)
+{
+    static const char acHex[] = "0123456789ABCDEF";
+    long i;
+
+    putText(pBuf, pzName);
+    putText(pBuf, " (");
+    for(i = 0; i < lNumBytes; ++i) {
+        if(i && !(i % BENCH_SVF_LINE)) { putByte(pBuf, '\n'); }
+        putByte(pBuf, (unsigned char)acHex[puc[i] >> 4]);
+        putByte(pBuf, (unsigned char)acHex[puc[i] & 15]);
+    }
+    putText(pBuf, ")");
+}
+
+static void putHeader(SBenchBuf* pBuf, unsigned char ucRepeat, unsigned char ucIr,
+                      int iSvf)
+{
+    char sz[32];
+
+    if(iSvf) {
+        /* SVF has no XREPEAT; XRUNTEST 0 is the default */
+        snprintf(sz, sizeof(sz), "SIR 8 TDI (%02X);\n", ucIr);
+        putText(pBuf, sz);
+        return;
+    }
+    putByte(pBuf, XREPEAT);
+    putByte(pBuf, ucRepeat);
+    putByte(pBuf, XRUNTEST);
+    putLong(pBuf, 0);
+    putByte(pBuf, XSIR);
+    putByte(pBuf, 8);
+    putByte(pBuf, ucIr);
+}
+
+/* FPGA configuration:  one long DR shift split into XSDRB/C/E pieces. */
+/* In SVF it is one SDR; its first bits shifted are the last hex digits, */
+/* so the chunks are written last first.                                */
+static void genFpga(SBenchBuf* pBuf, long lBits, SPort* pModel, int iSvf)
+{
+    long lChunks = lBits / BENCH_FPGA_CHUNK;
+    long i;
+    long j;
+    unsigned char* pucData;
+    char sz[48];
+
+    (void)pModel;   /* no TDO expected */
+
+    if(lChunks < 2) { lChunks = 2; }
+    putHeader(pBuf, 0, 0x05, iSvf);     /* CFG_IN */
+    if(iSvf) {
+        pucData = (unsigned char*)malloc(lChunks * (BENCH_FPGA_CHUNK / 8));
+        if(!pucData) { printf("ERROR: out of memory\n"); exit(1); }
+        for(i = lChunks - 1; i >= 0; --i) {
+            for(j = 0; j < BENCH_FPGA_CHUNK / 8; ++j) {
+                pucData[i * (BENCH_FPGA_CHUNK / 8) + j] = nextRandom();
+            }
+        }
+        snprintf(sz, sizeof(sz), "SDR %ld ", lChunks * BENCH_FPGA_CHUNK);
+        putText(pBuf, sz);
+        putHex(pBuf, "TDI", pucData, lChunks * (BENCH_FPGA_CHUNK / 8));
+        putText(pBuf, ";\n");
+        free(pucData);
+        return;
+    }
+    putByte(pBuf, XSDRSIZE);
+    putLong(pBuf, BENCH_FPGA_CHUNK);
+    for(i = 0; i < lChunks; ++i) {
+        putByte(pBuf, (i == 0) ? XSDRB : ((i == lChunks - 1) ? XSDRE : XSDRC));
+        putRandom(pBuf, BENCH_FPGA_CHUNK / 8);
+    }
+    putByte(pBuf, XCOMPLETE);
+}
+
+/* XC9500 program:  address field incremented by XSDRINC, 64 data bits */
+/* In SVF every piece is a plain SDR:  the address mask is added and   */
+/* the data bytes replace bytes 2-9, as xsvfDoSDRMasking() does.        */
+static void genXc9500(SBenchBuf* pBuf, long lBits, SPort* pModel, int iSvf)
+{
+    long lNumBytes = BENCH_CPLD_BITS / 8;
+    long lDone;
+    long i;
+    long j;
+    unsigned char aucTdi[BENCH_CPLD_BITS / 8];
+    char sz[32];
+
+    (void)pModel;   /* no TDO expected */
+
+    putHeader(pBuf, 16, 0xEA, iSvf);    /* FPGM */
+    if(iSvf) {
+        snprintf(sz, sizeof(sz), "SDR %ld ", BENCH_CPLD_BITS);
+        for(lDone = 0; lDone < lBits; lDone += (BENCH_CPLD_TIMES + 1) * BENCH_CPLD_BITS) {
+            for(i = 0; i < lNumBytes; ++i) { aucTdi[i] = nextRandom(); }
+            for(j = 0; j <= BENCH_CPLD_TIMES; ++j) {
+                if(j) {
+                    if(!++aucTdi[1]) { ++aucTdi[0]; }
+                    for(i = 2; i < 10; ++i) { aucTdi[i] = nextRandom(); }
+                }
+                putText(pBuf, sz);
+                putHex(pBuf, "TDI", aucTdi, lNumBytes);
+                putText(pBuf, ";\n");
+            }
+        }
+        return;
+    }
+    putByte(pBuf, XSDRSIZE);
+    putLong(pBuf, BENCH_CPLD_BITS);
+    putByte(pBuf, XTDOMASK);
+    for(i = 0; i < lNumBytes; ++i) { putByte(pBuf, 0); }
+    putByte(pBuf, XSETSDRMASKS);
+    for(i = 0; i < lNumBytes; ++i) { putByte(pBuf, (unsigned char)((i == 1) ? 0x01 : 0)); }
+    for(i = 0; i < lNumBytes; ++i) { putByte(pBuf, (unsigned char)(((i >= 2) && (i < 10)) ? 0xFF : 0)); }
+    for(lDone = 0; lDone < lBits; lDone += (BENCH_CPLD_TIMES + 1) * BENCH_CPLD_BITS) {
+        putByte(pBuf, XSDRINC);
+        putRandom(pBuf, lNumBytes);
+        putByte(pBuf, BENCH_CPLD_TIMES);
+        putRandom(pBuf, 8L * BENCH_CPLD_TIMES);
+    }
+    putByte(pBuf, XCOMPLETE);
+}
+
+/* verify loop:  XSDRTDO with an all-ones TDO mask.  With the sim      */
+/* backend the expected TDO is captured from a second instance of the  */
+/* same chain model, driven through the same TAP states as xsvfShift(); */
+/* other backends are expected to return 0 (the null driver does).     */
+/* In SVF every SDR gives TDI, TDO and the mask, as vendor tools write. */
+static void genVerify(SBenchBuf* pBuf, long lBits, SPort* pModel, int iSvf)
+{
+    unsigned char aucTdi[BENCH_VERIFY_BITS / 8];
+    unsigned char aucTdo[BENCH_VERIFY_BITS / 8];
+    unsigned char aucMask[BENCH_VERIFY_BITS / 8];
+    unsigned char ucIr = 0x07;
+    long lDone;
+    long i;
+    char sz[32];
+
+    memset(aucMask, 0xFF, sizeof(aucMask));
+    putHeader(pBuf, 0, ucIr, iSvf);
+    if(!iSvf) {
+        putByte(pBuf, XSDRSIZE);
+        putLong(pBuf, BENCH_VERIFY_BITS);
+        putByte(pBuf, XTDOMASK);
+        putBytes(pBuf, aucMask, BENCH_VERIFY_BITS / 8);
+    }
+    if(pModel) {
+        portsShiftTms(pModel, 0x3F, 6);         /* Test-Logic-Reset */
+        portsShiftTms(pModel, 0x06, 5);         /* -> Shift-IR */
+        portsShiftPerBit(pModel, &ucIr, 0, 8, 1);
+        portsShiftTms(pModel, 0x01, 2);         /* Exit1-IR -> Run-Test/Idle */
+    }
+    memset(aucTdo, 0, sizeof(aucTdo));
+    for(lDone = 0; lDone < lBits; lDone += BENCH_VERIFY_BITS) {
+        for(i = 0; i < BENCH_VERIFY_BITS / 8; ++i) { aucTdi[i] = nextRandom(); }
+        if(pModel) {
+            portsShiftTms(pModel, 0x01, 3);     /* -> Shift-DR */
+            portsShiftPerBit(pModel, aucTdi, aucTdo, BENCH_VERIFY_BITS, 1);
+            portsShiftTms(pModel, 0x01, 2);     /* Exit1-DR -> Run-Test/Idle */
+        }
+        if(iSvf) {
+            snprintf(sz, sizeof(sz), "SDR %ld ", BENCH_VERIFY_BITS);
+            putText(pBuf, sz);
+            putHex(pBuf, "TDI", aucTdi, BENCH_VERIFY_BITS / 8);
+            putHex(pBuf, " TDO", aucTdo, BENCH_VERIFY_BITS / 8);
+            putHex(pBuf, " MASK", aucMask, BENCH_VERIFY_BITS / 8);
+            putText(pBuf, ";\n");
+            continue;
+        }
+        putByte(pBuf, XSDRTDO);
+        putBytes(pBuf, aucTdi, BENCH_VERIFY_BITS / 8);
+        putBytes(pBuf, aucTdo, BENCH_VERIFY_BITS / 8);
+    }
+    if(!iSvf) { putByte(pBuf, XCOMPLETE); }
+}
+
+typedef struct tagSBenchStream
+{
+    const char* pzName;
+    void        (*pfGen)(SBenchBuf* pBuf, long lBits, SPort* pModel, int iSvf);
+} SBenchStream;
+
+static const SBenchStream g_aStreams[] =
+{
+    { "fpga",   genFpga },
+    { "xc9500", genXc9500 },
+    { "verify", genVerify }
+};
+#define NUM_STREAMS (sizeof(g_aStreams)/sizeof(g_aStreams[0]))
+
+/* malformed SVF that svfRun() must reject rather than loop on */
+static const char* g_apzBadSvf[] =
+{
+    "TRST ) ;\n",
+    "TRST FOO ;\n",
+    "TRST ;\n",
+    "ENDDR ) ;\n",
+    "SIR 8 TDI (00) ) ;\n"
+};
+#define NUM_BAD_SVF (sizeof(g_apzBadSvf)/sizeof(g_apzBadSvf[0]))
+
+/* -input formats; BENCH_MEMORY plays the stream from memory */
+#define BENCH_MEMORY    (-1)
+static const char* g_apzInputs[] = { "raw", "gzip", "xz", "zstd" };
+#define NUM_INPUTS  (sizeof(g_apzInputs)/sizeof(g_apzInputs[0]))
+
+/* write the stream to a temporary file in iFormat; 0 = success */
+static int benchWriteFile(const SBenchBuf* pBuf, int iFormat, char* pzPath)
+{
+    unsigned char*  pucOut = 0;
+    long            lOut = 0;
+    FILE*           fp;
+    int             fd;
+    int             iOk = 0;
+
+    strcpy(pzPath, "/tmp/xsvfbench.XXXXXX");
+    fd = mkstemp(pzPath);
+    if(fd < 0) { printf("ERROR: cannot create %s\n", pzPath); return -1; }
+    close(fd);
+
+    switch(iFormat) {
+    case INPUT_RAW:
+        pucOut = pBuf->puc;
+        lOut = pBuf->lSize;
+        iOk = 1;
+        break;
+#ifdef XSVF_SUPPORT_GZIP
+    case INPUT_GZIP:
+        {
+            gzFile gz = gzopen(pzPath, "wb6");
+            iOk = gz && (gzwrite(gz, pBuf->puc, (unsigned)pBuf->lSize) == (int)pBuf->lSize);
+            if(gz && (gzclose(gz) != Z_OK)) { iOk = 0; }
+            return iOk ? 0 : -1;
+        }
+#endif
+#ifdef XSVF_SUPPORT_XZ
+    case INPUT_XZ:
+        {
+            size_t tPos = 0;
+            size_t tMax = lzma_stream_buffer_bound(pBuf->lSize);
+            pucOut = (unsigned char*)malloc(tMax);
+            iOk = pucOut && (lzma_easy_buffer_encode(6, LZMA_CHECK_CRC64, 0,
+                                 pBuf->puc, pBuf->lSize, pucOut, &tPos, tMax) == LZMA_OK);
+            lOut = (long)tPos;
+        }
+        break;
+#endif
+#ifdef XSVF_SUPPORT_ZSTD
+    case INPUT_ZSTD:
+        {
+            size_t tMax = ZSTD_compressBound(pBuf->lSize);
+            size_t tSize;
+            pucOut = (unsigned char*)malloc(tMax);
+            tSize = pucOut ? ZSTD_compress(pucOut, tMax, pBuf->puc, pBuf->lSize, 19) : 0;
+            iOk = pucOut && !ZSTD_isError(tSize);
+            lOut = (long)tSize;
+        }
+        break;
+#endif
+    default:
+        printf("ERROR: xsvfbench built without %s support\n", g_apzInputs[iFormat]);
+        break;
+    }
+
+    if(iOk) {
+        fp = fopen(pzPath, "wb");
+        iOk = fp && (fwrite(pucOut, 1, lOut, fp) == (size_t)lOut);
+        if(fp && fclose(fp)) { iOk = 0; }
+    }
+    if(pucOut && (pucOut != pBuf->puc)) { free(pucOut); }
+    return iOk ? 0 : -1;
+}
+
+/* play one stream, as XSVF or as SVF text, on the open port and print */
+/* a result line.  SVF is always streamed:  -plan applies to XSVF.      */
+static int benchRun(SPort* pPort, const SBenchStream* pStream, long lBits, int iPlan,
+                    int iInput, int iSvf)
+{
+    char            szPath[32];
+    SBenchBuf       buf;
+    SXsvfInput      input;
+    SXsvfPlan       plan;
+    long long       llStartNs;
+    double          dSec;
+    SPort           model;
+    SPort*          pModelPort;
+    long            lCommand;
+    long            lInBytes;
+    long            lLoaded = 0;    /* end of a loaded plan's source */
+    long            lLine;
+    int             iErrorCode;
+
+    /* a private copy of the sim chain computes the expected TDO */
+    pModelPort = 0;
+    if(pPort->pDriver == &portSimDriver) {
+        memset(&model, 0, sizeof(model));
+        model.pDriver = &portSimDriver;
+        model.pzPath = pPort->pzPath;
+        if(!portSimDriver.pfOpen(&model)) { pModelPort = &model; }
+    }
+
+    memset(&buf, 0, sizeof(buf));
+    g_ulSeed = BENCH_SEED;
+    pStream->pfGen(&buf, lBits, pModelPort, iSvf);
+    if(pModelPort) { portSimDriver.pfClose(pModelPort); }
+
+    if((iInput != BENCH_MEMORY) && benchWriteFile(&buf, iInput, szPath)) {
+        unlink(szPath);
+        free(buf.puc);
+        return 1;
+    }
+
+    memset(&xsvf_stats, 0, sizeof(xsvf_stats));
+    pPort->lSyscalls = 0;
+    in = &input;
+    llStartNs = timingNowNs();
+    if(iInput == BENCH_MEMORY) {
+        inputOpenMemory(in, buf.puc, buf.lSize);
+    } else if(inputOpenFile(in, szPath)) {
+        printf("ERROR: cannot open %s\n", szPath);
+        unlink(szPath);
+        free(buf.puc);
+        return 1;
+    }
+    if(iSvf) {
+        iErrorCode = svfRun(in, &lLine);
+    } else if(iPlan) {
+        /* the time includes reading and decoding the whole file */
+        const unsigned char* pucData;
+        long lSize;
+        pucData = inputLoadAll(in, &lSize);
+        if(pucData) { lLoaded = inputOffset(in) + lSize; }
+        iErrorCode = pucData ? xsvfPlanCompile(&plan, pucData, lSize) : XSVF_ERROR_UNKNOWN;
+        if(!iErrorCode) { iErrorCode = xsvfPlanRun(&plan, &lCommand); }
+        xsvfPlanFree(&plan);
+    } else {
+        iErrorCode = xsvfExecute();
+    }
+    dSec = (double)(timingNowNs() - llStartNs) / 1e9;
+    lInBytes = inputSourceBytes(in);
+    /* a mapped source counts what was consumed, and a plan is read in */
+    /* place without consuming it                                      */
+    if(lInBytes < lLoaded) { lInBytes = lLoaded; }
+    inputClose(in);
+    if(iInput != BENCH_MEMORY) { unlink(szPath); }
+    free(buf.puc);
+    if(dSec <= 0) { dSec = 1e-9; }
+
+    printf("%-6s %-8s %-4s %-6s %10ld %11ld %9ld %8.3f %10.2f %10.1f %9.3f%s\n",
+           pPort->pDriver->pzName, pStream->pzName, iSvf ? "svf" : "xsvf",
+           (iInput == BENCH_MEMORY) ? "memory" : g_apzInputs[iInput], lInBytes,
+           xsvf_stats.lBitsShifted, xsvf_stats.lCommands, dSec,
+           xsvf_stats.lBitsShifted / dSec / 1e6,
+           xsvf_stats.lCommands / dSec / 1e3,
+           xsvf_stats.lBitsShifted ?
+               (double)pPort->lSyscalls / xsvf_stats.lBitsShifted : 0.0,
+           iErrorCode ? "  FAILED" : "");
+    return iErrorCode;
+}
+
+/* play each g_apzBadSvf statement on the open port; 0 = all rejected */
+static int benchBadSvf()
+{
+    SXsvfInput  input;
+    long        lLine;
+    int         iFailed = 0;
+    unsigned int k;
+
+    for(k = 0; k < NUM_BAD_SVF; ++k) {
+        in = &input;
+        inputOpenMemory(in, (const unsigned char*)g_apzBadSvf[k],
+                        (long)strlen(g_apzBadSvf[k]));
+        if(!svfRun(in, &lLine)) {
+            printf("ERROR: malformed SVF accepted: %s", g_apzBadSvf[k]);
+            iFailed = 1;
+        }
+        inputClose(in);
+    }
+    return iFailed;
+}
+
+int main(int iArgc, char** ppzArgv)
+{
+    static const char*  apzDefault[] = { "null", "sim" };
+    const char*         apzPorts[8];
+    int                 iNumPorts = 0;
+    SPort*              pPort = portsCurrent();
+    long                lBits = BENCH_DEFAULT_BITS;
+    int                 aiInputs[NUM_INPUTS];
+    int                 iNumInputs = 0;
+    int                 iPlan = 0;
+    int                 iSvf = 0;
+    int                 iFormat;
+    int                 iFailed = 0;
+    char*               pzList;
+    char*               pzName;
+    unsigned int        k;
+    unsigned int        j;
+    int                 i;
+
+    for(i = 1; i < iArgc; ++i) {
+        if(!strcmp(ppzArgv[i], "-bits") && (i + 1 < iArgc)) {
+            lBits = strtol(ppzArgv[++i], 0, 0);
+            if((lBits <= 0) || (lBits > LENVAL_MAX_BYTES * 8)) {
+                printf("ERROR: -bits must be 1-%ld\n", LENVAL_MAX_BYTES * 8);
+                return 1;
+            }
+        } else if(!strcmp(ppzArgv[i], "-port") && (i + 1 < iArgc) &&
+                  (iNumPorts < (int)(sizeof(apzPorts)/sizeof(apzPorts[0])))) {
+            apzPorts[iNumPorts++] = ppzArgv[++i];
+        } else if(!strcmp(ppzArgv[i], "-gpio") && (i + 1 < iArgc)) {
+            pPort->pzPath = ppzArgv[++i];
+        } else if(!strcmp(ppzArgv[i], "-pins") && (i + 1 < iArgc)) {
+            if(portsParsePins(pPort, ppzArgv[++i])) { return 1; }
+        } else if(!strcmp(ppzArgv[i], "-plan")) {
+            iPlan = 1;
+        } else if(!strcmp(ppzArgv[i], "-svf")) {
+            iSvf = 1;
+        } else if(!strcmp(ppzArgv[i], "-input") && (i + 1 < iArgc)) {
+            pzList = ppzArgv[++i];
+            for(pzName = strtok(pzList, ","); pzName; pzName = strtok(0, ",")) {
+                for(k = 0; (k < NUM_INPUTS) && strcmp(pzName, g_apzInputs[k]); ++k) {
+                }
+                if((k == NUM_INPUTS) || (iNumInputs == (int)NUM_INPUTS)) {
+                    printf("ERROR: unknown -input format %s\n", pzName);
+                    return 1;
+                }
+                aiInputs[iNumInputs++] = (int)k;
+            }
+        } else {
+            printf("USAGE:  xsvfbench [-bits n] [-port driver]... [-gpio path]\n");
+            printf("                  [-pins tms,tdi,tck,tdo] [-plan] [-input list] [-svf]\n");
+            printf("where:  -bits n       = bits shifted per stream (default=%ld)\n",
+                   BENCH_DEFAULT_BITS);
+            printf("        -port driver  = backend to measure, may repeat\n");
+            printf("                        (default=null and sim)\n");
+            printf("        -gpio path    = as for playxsvf; sim chain config\n");
+            printf("        -plan         = compile each stream and replay the plan\n");
+            printf("        -input list   = play each stream from a file in these\n");
+            printf("                        formats: raw, gzip, xz, zstd\n");
+            printf("                        (default=from memory)\n");
+            printf("        -svf          = also play each stream as SVF text\n");
+            printf("                        (after checking that malformed SVF fails)\n");
+            return 1;
+        }
+    }
+    if(!iNumPorts) {
+        for(j = 0; j < sizeof(apzDefault)/sizeof(apzDefault[0]); ++j) {
+            apzPorts[iNumPorts++] = apzDefault[j];
+        }
+    }
+
+    xsvf_iDebugLevel = -1;  /* no per-run SUCCESS lines */
+    if(!iNumInputs) { aiInputs[iNumInputs++] = BENCH_MEMORY; }
+
+    printf("%-6s %-8s %-4s %-6s %10s %11s %9s %8s %10s %10s %9s\n", "port", "stream",
+           "fmt", "input", "in-bytes", "bits", "commands", "seconds", "Mbit/s", "kcmd/s",
+           "sysc/bit");
+    for(i = 0; i < iNumPorts; ++i) {
+        if(portsSelectDriver(pPort, apzPorts[i]) || hardwareSetup()) {
+            printf("ERROR: cannot open port driver %s\n", apzPorts[i]);
+            iFailed = 1;
+            continue;
+        }
+        if(iSvf && benchBadSvf()) { iFailed = 1; }
+        for(j = 0; j < NUM_STREAMS; ++j) {
+            for(iFormat = 0; iFormat <= iSvf; ++iFormat) {
+                for(k = 0; k < (unsigned int)iNumInputs; ++k) {
+                    if(benchRun(pPort, &g_aStreams[j], lBits, iPlan, aiInputs[k],
+                                iFormat)) {
+                        iFailed = 1;
+                    }
+                }
+            }
+        }
+        hardwareCleanup();
+    }
+    return iFailed;
+}
@@ -0,0 +1,381 @@
+/*****************************************************************************
+* file:         xsvflearn.c
+* abstract:     This file contains the XC9500/XL retry history (see
+*               xsvflearn.h).
+* Usage:        xsvfShift() reports each status-checked shift:  the
+*               compare (xsvfLearnVerified()) settles the pulse before it,
+*               and the wait after it (xsvfLearnPulse()) is the next
+*               pending pulse.  The history is one class per line of
+*               whitespace separated numbers, in the order of
+*               SXsvfLearnClass; lines starting with '#' are comments.
+*               The history is shared by the process:  it is only used
+*               when a single chain is played.
+*****************************************************************************/
+#define DEBUG_MODE
+#ifdef  DEBUG_MODE
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+#endif  /* DEBUG_MODE */
+
+#include "micro.h"
+#include "lenval.h"
+#include "microint.h"
+#include "ports.h"
+#include "xsvflearn.h"
+
+
+/*============================================================================
+* Retry History
+============================================================================*/
+
+XSVF_THREAD SXsvfLearnState xsvf_learn;
+
+static SXsvfLearnClass  g_aClass[ XLEARN_MAX_CLASSES ];
+static int              g_iNumClasses   = 0;
+static int              g_iEnabled      = 0;
+static int              g_iAdaptive     = 0;
+static const char*      g_pzFileName    = 0;
+
+/*****************************************************************************
+* Function:     xsvfLearnFold
+* Description:  Fold a lenVal, masked, into 32 bits.  Values of up to 32
+*               bits (an IDCODE, an instruction) come out unchanged.
+* Parameters:   plv         - the value.
+*               plvMask     - its mask, or 0.
+* Returns:      unsigned long   - the folded value.
+*****************************************************************************/
+static unsigned long xsvfLearnFold( lenVal* plv, lenVal* plvMask )
+{
+    unsigned long   ulValue;
+    long            lIndex;
+
+    ulValue = 0;
+    for ( lIndex = 0; lIndex < plv->len; ++lIndex )
+    {
+        ulValue = ( ( ulValue << 8 ) | ( ulValue >> 24 ) ) & 0xFFFFFFFFUL;
+        ulValue ^= plv->val[ lIndex ] &
+                   ( plvMask ? plvMask->val[ lIndex ] : 0xFF );
+    }
+    return( ulValue );
+}
+
+/*****************************************************************************
+* Function:     xsvfLearnFind
+* Description:  Find the class of the pulse, or add it.
+* Parameters:   lFileTime   - the file's XRUNTEST.
+* Returns:      SXsvfLearnClass*    - the class; 0 if the history is full.
+*****************************************************************************/
+static SXsvfLearnClass* xsvfLearnFind( long lFileTime )
+{
+    SXsvfLearnClass*    pClass;
+    int                 i;
+
+    for ( i = 0; i < g_iNumClasses; ++i )
+    {
+        pClass  = &g_aClass[ i ];
+        if ( ( pClass->ulDevice == xsvf_learn.ulDevice ) &&
+             ( pClass->ulInstruction == xsvf_learn.ulInstruction ) &&
+             ( pClass->lFileUs == lFileTime ) )
+        {
+            return( pClass );
+        }
+    }
+    if ( g_iNumClasses == XLEARN_MAX_CLASSES )
+    {
+        return( 0 );
+    }
+    pClass  = &g_aClass[ g_iNumClasses++ ];
+    memset( pClass, 0, sizeof( *pClass ) );
+    pClass->ulDevice        = xsvf_learn.ulDevice;
+    pClass->ulInstruction   = xsvf_learn.ulInstruction;
+    pClass->lFileUs         = lFileTime;
+    return( pClass );
+}
+
+/*****************************************************************************
+* Function:     xsvfLearnOpen
+* Description:  Load the history file (a missing file starts empty) and
+*               turn recording on, and adaptive mode if iAdaptive.
+* Parameters:   pzFileName  - the history file.
+*               iAdaptive   - non-zero = wait early pulses.
+* Returns:      int         - 0 = success.
+*****************************************************************************/
+int xsvfLearnOpen( const char* pzFileName, int iAdaptive )
+{
+    FILE*               pFile;
+    SXsvfLearnClass*    pClass;
+    char                szLine[ 256 ];
+    long                lLine;
+
+    g_iNumClasses   = 0;
+    pFile           = fopen( pzFileName, "r" );
+    for ( lLine = 1; pFile && fgets( szLine, sizeof( szLine ), pFile ); ++lLine )
+    {
+        if ( ( szLine[ 0 ] == '#' ) || ( szLine[ strspn( szLine, " \t\r\n" ) ] == 0 ) )
+        {
+            continue;
+        }
+        if ( g_iNumClasses == XLEARN_MAX_CLASSES )
+        {
+            printf( "WARNING:  %s:  more than %d classes; the rest are dropped\n",
+                    pzFileName, XLEARN_MAX_CLASSES );
+            break;
+        }
+        pClass  = &g_aClass[ g_iNumClasses ];
+        if ( sscanf( szLine, "%lx %lx %ld %ld %ld %ld %ld %ld %ld %ld",
+                     &pClass->ulDevice, &pClass->ulInstruction,
+                     &pClass->lFileUs, &pClass->lPulses, &pClass->lFails,
+                     &pClass->lMaxOkUs, &pClass->lEarlyUs, &pClass->lEarlyOk,
+                     &pClass->lEarlyFails, &pClass->lEarlyRun ) != 10 )
+        {
+            printf( "WARNING:  %s:%ld:  bad history line ignored\n",
+                    pzFileName, lLine );
+            continue;
+        }
+        ++g_iNumClasses;
+    }
+    if ( pFile )
+    {
+        fclose( pFile );
+    }
+
+    g_pzFileName    = pzFileName;
+    g_iAdaptive     = iAdaptive;
+    g_iEnabled      = 1;
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     xsvfLearnSave
+* Description:  Write the history back to the file given to xsvfLearnOpen().
+*               The new history replaces the file only once it is written.
+* Parameters:   none.
+* Returns:      int         - 0 = success.
+*****************************************************************************/
+int xsvfLearnSave()
+{
+    FILE*               pFile;
+    SXsvfLearnClass*    pClass;
+    char                szTemp[ 1024 ];
+    int                 iOk;
+    int                 i;
+
+    if ( !g_iEnabled )
+    {
+        return( XSVF_ERROR_NONE );
+    }
+    snprintf( szTemp, sizeof( szTemp ), "%s.tmp", g_pzFileName );
+    pFile   = fopen( szTemp, "w" );
+    if ( !pFile )
+    {
+        printf( "ERROR:  Cannot create history file %s\n", szTemp );
+        return( XSVF_ERROR_UNKNOWN );
+    }
+    iOk = ( fprintf( pFile, "# playxsvf retry history\n"
+                            "# device instruction runtest_us pulses fails max_ok_us"
+                            " early_us early_ok early_fails early_run\n" ) > 0 );
+    for ( i = 0; iOk && ( i < g_iNumClasses ); ++i )
+    {
+        pClass  = &g_aClass[ i ];
+        iOk = ( fprintf( pFile, "0x%08lx 0x%08lx %ld %ld %ld %ld %ld %ld %ld %ld\n",
+                         pClass->ulDevice, pClass->ulInstruction,
+                         pClass->lFileUs, pClass->lPulses, pClass->lFails,
+                         pClass->lMaxOkUs, pClass->lEarlyUs, pClass->lEarlyOk,
+                         pClass->lEarlyFails, pClass->lEarlyRun ) > 0 );
+    }
+    iOk = ( fclose( pFile ) == 0 ) && iOk;
+    if ( !iOk || rename( szTemp, g_pzFileName ) )
+    {
+        printf( "ERROR:  Cannot write history file %s\n", g_pzFileName );
+        remove( szTemp );
+        return( XSVF_ERROR_UNKNOWN );
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+int xsvfLearnEnabled()
+{
+    return( g_iEnabled );
+}
+
+int xsvfLearnClasses()
+{
+    return( g_iNumClasses );
+}
+
+void xsvfLearnStart()
+{
+    memset( &xsvf_learn, 0, sizeof( xsvf_learn ) );
+}
+
+/*****************************************************************************
+* Function:     xsvfLearnScan
+* Description:  Note a compared or instruction scan:  the Shift-IR TDI is
+*               the instruction of the next pulses, and the first compared
+*               Shift-DR TDO is the device.
+* Parameters:   ucStartState    - Shift-DR or Shift-IR.
+*               plvTdi          - TDI shifted.
+*               plvTdoCaptured  - TDO captured, or 0.
+*               plvTdoMask      - TDO mask, or 0.
+* Returns:      void.
+*****************************************************************************/
+void xsvfLearnScan( unsigned char ucStartState, lenVal* plvTdi,
+                    lenVal* plvTdoCaptured, lenVal* plvTdoMask )
+{
+    if ( ucStartState == XTAPSTATE_SHIFTIR )
+    {
+        xsvf_learn.ulInstruction    = xsvfLearnFold( plvTdi, 0 );
+    }
+    else if ( plvTdoCaptured && !xsvf_learn.iDeviceKnown )
+    {
+        xsvf_learn.ulDevice         = xsvfLearnFold( plvTdoCaptured, plvTdoMask );
+        xsvf_learn.iDeviceKnown     = 1;
+    }
+}
+
+/*****************************************************************************
+* Function:     xsvfLearnBegin
+* Description:  Start of an xsvfShift().  A shift that is not a status
+*               check settles the pending pulse:  an early one is topped up
+*               while the TAP is still in Run-Test/Idle.
+* Parameters:   iStatus     - non-zero for a status-checked shift.
+* Returns:      void.
+*****************************************************************************/
+void xsvfLearnBegin( int iStatus )
+{
+    if ( iStatus )
+    {
+        xsvf_learn.iVerifying   = 1;
+        return;
+    }
+    xsvfLearnSettle();
+    xsvf_learn.pPending = 0;
+}
+
+/*****************************************************************************
+* Function:     xsvfLearnVerified
+* Description:  Record the compare of a status-checked shift against the
+*               pending pulse.  Early pulses that keep verifying are
+*               shortened by 25%; one that fails lengthens the next by 50%.
+* Parameters:   iMismatch   - the compare failed.
+* Returns:      int         - non-zero if the pulse was early and failed:
+*                             retry at the file's time, free of XREPEAT.
+*****************************************************************************/
+int xsvfLearnVerified( int iMismatch )
+{
+    SXsvfLearnClass*    pClass  = xsvf_learn.pPending;
+    int                 iFree   = 0;
+
+    xsvf_learn.iVerifying   = 0;
+    xsvf_learn.lOwedUs      = 0;
+    xsvf_learn.pPending     = 0;
+    if ( !pClass )
+    {
+        return( 0 );
+    }
+
+    if ( !xsvf_learn.iPendingEarly )
+    {
+        ++pClass->lPulses;
+        if ( iMismatch )
+        {
+            ++pClass->lFails;
+        }
+        else if ( xsvf_learn.lPendingUs > pClass->lMaxOkUs )
+        {
+            pClass->lMaxOkUs    = xsvf_learn.lPendingUs;
+        }
+    }
+    else if ( !iMismatch )
+    {
+        ++pClass->lEarlyOk;
+        ++xsvf_learn.lEarlyOk;
+        xsvf_learn.lSavedUs += pClass->lFileUs - xsvf_learn.lPendingUs;
+        if ( ( ++pClass->lEarlyRun >= XLEARN_STEP_RUN ) &&
+             ( pClass->lEarlyUs - ( pClass->lEarlyUs >> 2 ) >=
+               pClass->lFileUs / XLEARN_MIN_DIVISOR ) )
+        {
+            pClass->lEarlyUs    -= ( pClass->lEarlyUs >> 2 );
+            pClass->lEarlyRun   = 0;
+        }
+    }
+    else
+    {
+        /* The early poll failed:  the retry pulse is the file's time */
+        ++pClass->lEarlyFails;
+        ++xsvf_learn.lEarlyFails;
+        xsvf_learn.lSavedUs -= xsvf_learn.lPendingUs;
+        pClass->lEarlyRun   = 0;
+        pClass->lEarlyUs    += ( pClass->lEarlyUs >> 1 ) + 1;
+        iFree               = 1;
+    }
+    XSVFDBG_PRINTF3( 3, "   Pulse of %ld usec %s (class runtest %ld usec)\n",
+                     xsvf_learn.lPendingUs,
+                     iMismatch ? "failed" : "verified", pClass->lFileUs );
+    return( iFree );
+}
+
+/*****************************************************************************
+* Function:     xsvfLearnPulse
+* Description:  The wait for a status-checked shift's pulse, which becomes
+*               the pending pulse.  A pulse is early only in adaptive mode,
+*               on a normal exit, for a class that has verified at least
+*               XLEARN_MIN_PULSES pulses at full time and never needed a
+*               retry.  The first early pulse is half the file's time.
+* Parameters:   lFileTime       - the file's XRUNTEST:  the class.
+*               lRunTestTime    - the time due, grown by any retries.
+*               iMayBeEarly     - a normal exit:  an early pulse is allowed.
+* Returns:      long            - usec to wait.
+*****************************************************************************/
+long xsvfLearnPulse( long lFileTime, long lRunTestTime, int iMayBeEarly )
+{
+    SXsvfLearnClass*    pClass;
+
+    xsvf_learn.pPending     = 0;
+    xsvf_learn.lOwedUs      = 0;
+    if ( !xsvf_learn.iDeviceKnown || !( pClass = xsvfLearnFind( lFileTime ) ) )
+    {
+        return( lRunTestTime );
+    }
+    xsvf_learn.pPending         = pClass;
+    xsvf_learn.lPendingUs       = lRunTestTime;
+    xsvf_learn.iPendingEarly    = 0;
+
+    if ( g_iAdaptive && iMayBeEarly && ( lRunTestTime == lFileTime ) &&
+         ( pClass->lPulses >= XLEARN_MIN_PULSES ) && !pClass->lFails )
+    {
+        if ( !pClass->lEarlyUs )
+        {
+            pClass->lEarlyUs    = lFileTime / 2;
+        }
+        if ( ( pClass->lEarlyUs > 0 ) && ( pClass->lEarlyUs < lFileTime ) )
+        {
+            xsvf_learn.lPendingUs       = pClass->lEarlyUs;
+            xsvf_learn.iPendingEarly    = 1;
+            xsvf_learn.lOwedUs          = lFileTime - pClass->lEarlyUs;
+        }
+    }
+    return( xsvf_learn.lPendingUs );
+}
+
+/*****************************************************************************
+* Function:     xsvfLearnSettle
+* Description:  Finish an early pulse that will not be verified:  wait the
+*               rest of the file's time.  Called before the TAP leaves
+*               Run-Test/Idle other than into its verify, and at the end.
+* Parameters:   none.
+* Returns:      void.
+*****************************************************************************/
+void xsvfLearnSettle()
+{
+    if ( xsvf_learn.lOwedUs )
+    {
+        XSVFDBG_PRINTF1( 3, "   Wait = %ld usec (rest of an early pulse)\n",
+                         xsvf_learn.lOwedUs );
+        waitTime( xsvf_learn.lOwedUs );
+        xsvf_learn.lPendingUs       += xsvf_learn.lOwedUs;
+        xsvf_learn.iPendingEarly    = 0;
+        xsvf_learn.lOwedUs          = 0;
+    }
+}
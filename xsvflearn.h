@@ -0,0 +1,153 @@
+/*****************************************************************************
+* File:         xsvflearn.h
+* Description:  This header file contains the XC9500/XL retry history.  A
+*               status-checked shift (XREPEAT and XRUNTEST set, expected
+*               TDO) verifies the program/erase pulse that the previous
+*               such shift waited for.  The history records, per device
+*               (the masked TDO of the file's first compared DR scan,
+*               i.e. its IDCODE check) and command class (instruction and
+*               XRUNTEST time), how the pulses verified, and is kept in a
+*               text file between runs.
+*               Adaptive mode (opt-in) waits an early pulse instead of the
+*               file's XRUNTEST once a class has verified at full time
+*               without a retry.  Its compare is the early poll:  a match
+*               keeps the shorter pulse, and runs of matches shorten it
+*               further.  A mismatch gets a free retry at the file's own
+*               time, which does not count against XREPEAT.  An early
+*               pulse that the next shift would not verify is topped up
+*               to the file's time before the TAP leaves Run-Test/Idle.
+*****************************************************************************/
+#ifndef XSVF_LEARN_H
+#define XSVF_LEARN_H
+
+#include "lenval.h"
+#include "ports.h"      /* XSVF_THREAD */
+
+#define XLEARN_MAX_CLASSES  256
+#define XLEARN_MIN_PULSES   16  /* full pulses verified before going early */
+#define XLEARN_STEP_RUN     32  /* early matches in a row before shortening */
+#define XLEARN_MIN_DIVISOR  8   /* early pulse is at least 1/8 of the file's */
+
+/*****************************************************************************
+* Struct:       SXsvfLearnClass
+* Description:  The history of one device and command class.
+*****************************************************************************/
+typedef struct tagSXsvfLearnClass
+{
+    unsigned long   ulDevice;       /* masked IDCODE of the device */
+    unsigned long   ulInstruction;  /* instruction loaded for the pulse */
+    long            lFileUs;        /* the file's XRUNTEST */
+    long            lPulses;        /* pulses of at least lFileUs verified */
+    long            lFails;         /* of those, the ones that mismatched */
+    long            lMaxOkUs;       /* longest pulse a verify needed */
+    long            lEarlyUs;       /* adaptive pulse; 0 = not started */
+    long            lEarlyOk;       /* early pulses that verified */
+    long            lEarlyFails;    /* early pulses retried at lFileUs */
+    long            lEarlyRun;      /* early matches in a row at lEarlyUs */
+} SXsvfLearnClass;
+
+/*****************************************************************************
+* Struct:       SXsvfLearnState
+* Description:  The pulse waiting for its verify on this thread.
+*****************************************************************************/
+typedef struct tagSXsvfLearnState
+{
+    unsigned long   ulDevice;       /* masked IDCODE, once iDeviceKnown */
+    int             iDeviceKnown;
+    unsigned long   ulInstruction;  /* last Shift-IR TDI */
+    SXsvfLearnClass* pPending;      /* class of the unverified pulse, or 0 */
+    long            lPendingUs;     /* its length */
+    int             iPendingEarly;  /* it was an early pulse */
+    long            lOwedUs;        /* time left to the file's XRUNTEST */
+    int             iVerifying;     /* the next TAP move starts its verify */
+    long            lSavedUs;       /* wait saved by verified early pulses */
+    long            lEarlyOk;       /* this run's early pulses verified */
+    long            lEarlyFails;    /* this run's early pulses retried */
+} SXsvfLearnState;
+
+extern XSVF_THREAD SXsvfLearnState xsvf_learn;
+
+/*****************************************************************************
+* Function:     xsvfLearnOpen
+* Description:  Load the history file (a missing file starts empty) and
+*               turn recording on, and adaptive mode if iAdaptive.
+* Parameters:   pzFileName  - the history file.
+*               iAdaptive   - non-zero = wait early pulses.
+* Returns:      int         - 0 = success.
+*****************************************************************************/
+extern int xsvfLearnOpen( const char* pzFileName, int iAdaptive );
+
+/*****************************************************************************
+* Function:     xsvfLearnSave
+* Description:  Write the history back to the file given to xsvfLearnOpen().
+* Parameters:   none.
+* Returns:      int         - 0 = success.
+*****************************************************************************/
+extern int xsvfLearnSave();
+
+/* non-zero once xsvfLearnOpen() succeeded */
+extern int xsvfLearnEnabled();
+
+/* number of classes in the history */
+extern int xsvfLearnClasses();
+
+/* forget this thread's device and pending pulse; call per file */
+extern void xsvfLearnStart();
+
+/*****************************************************************************
+* Function:     xsvfLearnScan
+* Description:  Note a compared or instruction scan:  the Shift-IR TDI is
+*               the instruction of the next pulses, and the first compared
+*               Shift-DR TDO is the device.
+* Parameters:   ucStartState    - Shift-DR or Shift-IR.
+*               plvTdi          - TDI shifted.
+*               plvTdoCaptured  - TDO captured, or 0.
+*               plvTdoMask      - TDO mask, or 0.
+* Returns:      void.
+*****************************************************************************/
+extern void xsvfLearnScan( unsigned char ucStartState, lenVal* plvTdi,
+                           lenVal* plvTdoCaptured, lenVal* plvTdoMask );
+
+/*****************************************************************************
+* Function:     xsvfLearnBegin
+* Description:  Start of an xsvfShift().  A shift that is not a status
+*               check settles the pending pulse:  an early one is topped up
+*               while the TAP is still in Run-Test/Idle.
+* Parameters:   iStatus     - non-zero for a status-checked shift.
+* Returns:      void.
+*****************************************************************************/
+extern void xsvfLearnBegin( int iStatus );
+
+/*****************************************************************************
+* Function:     xsvfLearnVerified
+* Description:  Record the compare of a status-checked shift against the
+*               pending pulse.
+* Parameters:   iMismatch   - the compare failed.
+* Returns:      int         - non-zero if the pulse was early and failed:
+*                             retry at the file's time, free of XREPEAT.
+*****************************************************************************/
+extern int xsvfLearnVerified( int iMismatch );
+
+/*****************************************************************************
+* Function:     xsvfLearnPulse
+* Description:  The wait for a status-checked shift's pulse, which becomes
+*               the pending pulse.
+* Parameters:   lFileTime       - the file's XRUNTEST:  the class.
+*               lRunTestTime    - the time due, grown by any retries.
+*               iMayBeEarly     - a normal exit:  an early pulse is allowed.
+* Returns:      long            - usec to wait.
+*****************************************************************************/
+extern long xsvfLearnPulse( long lFileTime, long lRunTestTime,
+                            int iMayBeEarly );
+
+/*****************************************************************************
+* Function:     xsvfLearnSettle
+* Description:  Finish an early pulse that will not be verified:  wait the
+*               rest of the file's time.  Called before the TAP leaves
+*               Run-Test/Idle other than into its verify, and at the end.
+* Parameters:   none.
+* Returns:      void.
+*****************************************************************************/
+extern void xsvfLearnSettle();
+
+#endif  /* XSVF_LEARN_H */
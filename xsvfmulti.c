@@ -0,0 +1,184 @@
+/*****************************************************************************
+* file:         xsvfmulti.c
+* abstract:     This file contains the multi-chain executor (see
+*               xsvfmulti.h).  Each chain's thread makes the chain's port
+*               current, opens it and its file, and plays the file with
+*               xsvfExecuteInput(), exactly like a single-chain run.
+*               The counters the thread accumulated are copied into the
+*               chain before the thread ends.
+*****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "micro.h"
+#include "xsvfmulti.h"
+
+
+/*****************************************************************************
+* Function:     xsvfChainCpuNs
+* Description:  CPU time of the calling thread.
+* Parameters:   none.
+* Returns:      long long   - nanoseconds.
+*****************************************************************************/
+static long long xsvfChainCpuNs()
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+    return( (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec );
+}
+
+/*****************************************************************************
+* Function:     xsvfChainPlay
+* Description:  Open the chain's port and file and play the file on the
+*               calling thread.
+* Parameters:   pChain  - the chain.
+* Returns:      int     - XSVF_ERROR_*; see micro.h.
+*****************************************************************************/
+int xsvfChainPlay( SXsvfChain* pChain )
+{
+    SXsvfInput  input;
+    long long   llStartNs;
+    long long   llCpuNs;
+    int         iError;
+
+    portsSetCurrent( &(pChain->port) );
+    memset( &xsvf_stats, 0, sizeof( xsvf_stats ) );
+    llStartNs           = timingNowNs();
+    llCpuNs             = xsvfChainCpuNs();
+    pChain->iErrorCode  = XSVF_ERROR_UNKNOWN;
+
+    if ( ( iError = hardwareSetup() ) != 0 )
+    {
+        printf( "Error: %s: hardwareSetup failed: %d\n",
+                pChain->pzFileName, iError );
+    }
+    else
+    {
+        if ( pChain->iPipelined
+             ? inputOpenPipelined( &input, pChain->pzFileName )
+             : inputOpenFile( &input, pChain->pzFileName ) )
+        {
+            printf( "ERROR:  Cannot open file %s\n", pChain->pzFileName );
+        }
+        else
+        {
+            pChain->iErrorCode  = xsvfExecuteInput( &input );
+            inputClose( &input );
+        }
+        hardwareCleanup();
+    }
+
+    pChain->llWallNs    = timingNowNs() - llStartNs;
+    pChain->llCpuNs     = xsvfChainCpuNs() - llCpuNs;
+    pChain->stats       = xsvf_stats;
+    pChain->timing      = *timingStats();
+    return( pChain->iErrorCode );
+}
+
+/*****************************************************************************
+* Function:     xsvfChainThread
+* Description:  pthread entry point for one chain.
+* Parameters:   pvChain - the SXsvfChain.
+* Returns:      void*   - 0.
+*****************************************************************************/
+static void* xsvfChainThread( void* pvChain )
+{
+    xsvfChainPlay( (SXsvfChain*)pvChain );
+    return( 0 );
+}
+
+/*****************************************************************************
+* Function:     xsvfChainsPlay
+* Description:  Play every chain on its own thread and wait for all of
+*               them.  A chain whose thread cannot be created is played on
+*               the calling thread after the others have started.
+* Parameters:   aChain      - the chains.
+*               iNumChains  - number of chains.
+* Returns:      int         - the number of chains that failed.
+*****************************************************************************/
+int xsvfChainsPlay( SXsvfChain* aChain, int iNumChains )
+{
+    int i;
+    int iFailed;
+
+    for ( i = 0; i < iNumChains; ++i )
+    {
+        aChain[ i ].iStarted    =
+            !pthread_create( &(aChain[ i ].thread), 0, xsvfChainThread,
+                             &(aChain[ i ]) );
+    }
+
+    iFailed = 0;
+    for ( i = 0; i < iNumChains; ++i )
+    {
+        if ( aChain[ i ].iStarted )
+        {
+            pthread_join( aChain[ i ].thread, 0 );
+        }
+        else
+        {
+            xsvfChainPlay( &(aChain[ i ]) );
+        }
+        iFailed += ( aChain[ i ].iErrorCode != XSVF_ERROR_NONE );
+    }
+
+    return( iFailed );
+}
+
+/*****************************************************************************
+* Function:     xsvfChainsReport
+* Description:  Print each chain's result, time and I/O counts, then the
+*               panel time against the sum of the chain times.
+* Parameters:   aChain      - the chains.
+*               iNumChains  - number of chains.
+*               llWallNs    - wall time of xsvfChainsPlay().
+* Returns:      void.
+*****************************************************************************/
+void xsvfChainsReport( SXsvfChain* aChain, int iNumChains,
+                       long long llWallNs )
+{
+    SXsvfChain* pChain;
+    long long   llSumNs;
+    long long   llMaxNs;
+    int         iFailed;
+    int         i;
+    char        szResult[ 24 ];
+
+    llSumNs = 0;
+    llMaxNs = 0;
+    iFailed = 0;
+    for ( i = 0; i < iNumChains; ++i )
+    {
+        pChain  = &(aChain[ i ]);
+        if ( pChain->iErrorCode )
+        {
+            snprintf( szResult, sizeof( szResult ), "FAILED (error %d)",
+                      pChain->iErrorCode );
+        }
+        else
+        {
+            snprintf( szResult, sizeof( szResult ), "SUCCESS" );
+        }
+        printf( "Chain %d = %s (%s %s): %s; %.3f seconds (CPU %.3f); %ld shifts, %ld bits; %ld port syscalls; %ld waits, %ld usec\n",
+                i, pChain->pzFileName, pChain->port.pDriver->pzName,
+                pChain->port.pzPath ? pChain->port.pzPath : "-",
+                szResult,
+                ( (double)pChain->llWallNs ) / 1e9,
+                ( (double)pChain->llCpuNs ) / 1e9,
+                pChain->stats.lShifts, pChain->stats.lBitsShifted,
+                pChain->port.lSyscalls, pChain->timing.lWaits,
+                pChain->timing.lActualUs );
+        llSumNs += pChain->llWallNs;
+        if ( pChain->llWallNs > llMaxNs )
+        {
+            llMaxNs = pChain->llWallNs;
+        }
+        iFailed += ( pChain->iErrorCode != XSVF_ERROR_NONE );
+    }
+
+    printf( "Panel Time = %.3f seconds (slowest chain %.3f, sum of chains %.3f); %d of %d chains failed\n",
+            ( (double)llWallNs ) / 1e9, ( (double)llMaxNs ) / 1e9,
+            ( (double)llSumNs ) / 1e9, iFailed, iNumChains );
+}
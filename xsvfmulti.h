@@ -0,0 +1,60 @@
+/*****************************************************************************
+* File:         xsvfmulti.h
+* Description:  This header file contains the multi-chain executor.  Each
+*               SXsvfChain is one JTAG chain:  its own port (driver, GPIO
+*               path and pins) and its own XSVF or plan file.  The chains
+*               are played concurrently, one thread each, so a panel of
+*               boards takes about as long as its slowest chain.
+*               The player keeps its per-chain state (current port, XSVF
+*               input, counters, wait totals) per thread (XSVF_THREAD), so
+*               every chain runs the unchanged xsvfExecute() path.
+*****************************************************************************/
+#ifndef XSVF_MULTI_H
+#define XSVF_MULTI_H
+
+#include <pthread.h>
+
+#include "lenval.h"
+#include "microint.h"
+#include "ports.h"
+#include "input.h"
+#include "timing.h"
+
+#define XSVF_MAX_CHAINS     32
+
+/*****************************************************************************
+* Struct:       SXsvfChain
+* Description:  One chain to play and, after xsvfChainPlay(), its results.
+*               The caller fills in port, pzFileName and iPipelined.
+*****************************************************************************/
+typedef struct tagSXsvfChain
+{
+    SPort           port;           /* the chain's JTAG port */
+    const char*     pzFileName;     /* XSVF, SVF, plan or .bit/.bin file */
+    int             iPipelined;     /* read the file on a reader thread */
+
+    int             iErrorCode;     /* XSVF_ERROR_* (micro.h) */
+    long long       llWallNs;       /* open to close */
+    long long       llCpuNs;        /* CPU time of the chain's thread */
+    SXsvfStats      stats;          /* the chain's xsvf_stats */
+    STimingStats    timing;         /* the chain's waitTime() totals */
+
+    pthread_t       thread;
+    int             iStarted;       /* thread was created */
+} SXsvfChain;
+
+/* play one chain on the calling thread; returns pChain->iErrorCode */
+extern int xsvfChainPlay( SXsvfChain* pChain );
+
+/* play the chains concurrently; returns the number that failed */
+extern int xsvfChainsPlay( SXsvfChain* aChain, int iNumChains );
+
+/* print one result line per chain and the panel time */
+extern void xsvfChainsReport( SXsvfChain* aChain, int iNumChains,
+                              long long llWallNs );
+
+/* micro.c:  play the XSVF, SVF, plan or bitstream file in pInput on
+   the current port and report like xsvfExecute(); returns XSVF_ERROR_* */
+extern int xsvfExecuteInput( SXsvfInput* pInput );
+
+#endif  /* XSVF_MULTI_H */
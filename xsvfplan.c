@@ -0,0 +1,1134 @@
+/*****************************************************************************
+* file:         xsvfplan.c
+* abstract:     This file contains the XSVF execution plan compiler, the
+*               plan file reader/writer and the plan player.
+* Usage:        xsvfPlanCompile() walks the XSVF image once, the way
+*               xsvfRun() would, and records each JTAG action as an
+*               SXsvfPlanOp.  xsvfPlanRun() replays the ops through the
+*               same xsvfShift()/waitTime() primitives as the interpreter,
+*               so the pin waveform is unchanged.
+*               The compiler assumes every TDO compare passes; a mismatch
+*               during replay stops the plan at that op, as xsvfRun() does.
+*****************************************************************************/
+#define DEBUG_MODE
+#ifdef  DEBUG_MODE
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+#endif  /* DEBUG_MODE */
+
+#include "micro.h"
+#include "lenval.h"
+#include "microint.h"
+#include "ports.h"
+#include "xsvfplan.h"
+
+
+/*============================================================================
+* Plan Compiler
+============================================================================*/
+
+/*****************************************************************************
+* Struct:       SXsvfPlanCompiler
+* Description:  The interpreter state that the compiler tracks while it
+*               walks the XSVF.  Spans are image offsets or XPLAN_NONE.
+*****************************************************************************/
+typedef struct tagSXsvfPlanCompiler
+{
+    SXsvfPlan*              pPlan;
+    const unsigned char*    pucCur;             /* next unread XSVF byte */
+    const unsigned char*    pucEnd;
+    long                    lCommandCount;
+    unsigned char           ucCommand;          /* command being compiled */
+
+    unsigned char           ucTapState;
+    unsigned char           ucEndIR;
+    unsigned char           ucEndDR;
+    unsigned char           ucMaxRepeat;
+    long                    lRunTestTime;
+    long                    lShiftLengthBits;
+    long                    lShiftLengthBytes;
+
+    long                    lTdoExpected;       /* last expected TDO */
+    long                    lTdoExpectedBytes;
+    long                    lTdoMask;           /* last XTDOMASK */
+    long                    lTdoMaskBytes;
+    long                    lAddressMask;       /* last XSETSDRMASKS */
+    long                    lDataMask;
+    long                    lMasksBytes;
+} SXsvfPlanCompiler;
+
+/*****************************************************************************
+* Function:     xsvfPlanSpan
+* Description:  Resolve a plan data offset to a pointer.
+* Parameters:   pPlan   - the plan.
+*               lOffset - offset into the image or the generated data.
+* Returns:      unsigned char* - the data.
+*****************************************************************************/
+static unsigned char* xsvfPlanSpan( SXsvfPlan* pPlan, long lOffset )
+{
+    if ( lOffset < pPlan->lImageBytes )
+    {
+        return( (unsigned char*)( pPlan->pucImage + lOffset ) );
+    }
+    return( pPlan->pucData + ( lOffset - pPlan->lImageBytes ) );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanAddOp
+* Description:  Append an op with no data spans.
+* Parameters:   pCompiler   - the compiler.
+*               ucOp        - the XPLAN_* op code.
+* Returns:      SXsvfPlanOp* - the new op; 0 = out of memory.
+*****************************************************************************/
+static SXsvfPlanOp* xsvfPlanAddOp( SXsvfPlanCompiler* pCompiler,
+                                   unsigned char ucOp )
+{
+    SXsvfPlan*      pPlan   = pCompiler->pPlan;
+    SXsvfPlanOp*    pOp;
+    long            lMaxOps;
+
+    if ( pPlan->lNumOps == pPlan->lMaxOps )
+    {
+        lMaxOps = pPlan->lMaxOps ? ( pPlan->lMaxOps * 2 ) : 256;
+        pOp     = (SXsvfPlanOp*)realloc( pPlan->pOps,
+                                         lMaxOps * sizeof( SXsvfPlanOp ) );
+        if ( !pOp )
+        {
+            return( 0 );
+        }
+        pPlan->pOps     = pOp;
+        pPlan->lMaxOps  = lMaxOps;
+    }
+
+    pOp = &(pPlan->pOps[ pPlan->lNumOps++ ]);
+    memset( pOp, 0, sizeof( SXsvfPlanOp ) );
+    pOp->ucOp           = ucOp;
+    pOp->lCommand       = pCompiler->lCommandCount;
+    pOp->ucCommand      = pCompiler->ucCommand;
+    pOp->lTdi           = XPLAN_NONE;
+    pOp->lTdoExpected   = XPLAN_NONE;
+    pOp->lTdoMask       = XPLAN_NONE;
+    return( pOp );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanAddData
+* Description:  Append generated data (e.g. an expanded XSDRINC value).
+* Parameters:   pPlan       - the plan.
+*               pucData     - the bytes to copy; 0 = zero fill.
+*               lNumBytes   - number of bytes.
+* Returns:      long        - plan data offset; XPLAN_NONE = out of memory.
+*****************************************************************************/
+static long xsvfPlanAddData( SXsvfPlan*             pPlan,
+                             const unsigned char*   pucData,
+                             long                   lNumBytes )
+{
+    unsigned char*  pucNew;
+    long            lMaxData;
+    long            lOffset;
+
+    if ( ( pPlan->lDataBytes + lNumBytes ) > pPlan->lMaxData )
+    {
+        lMaxData    = pPlan->lMaxData ? pPlan->lMaxData : 4096;
+        while ( lMaxData < ( pPlan->lDataBytes + lNumBytes ) )
+        {
+            lMaxData    *= 2;
+        }
+        pucNew  = (unsigned char*)realloc( pPlan->pucData, lMaxData );
+        if ( !pucNew )
+        {
+            return( XPLAN_NONE );
+        }
+        pPlan->pucData  = pucNew;
+        pPlan->lMaxData = lMaxData;
+    }
+
+    lOffset = pPlan->lImageBytes + pPlan->lDataBytes;
+    if ( pucData )
+    {
+        memcpy( pPlan->pucData + pPlan->lDataBytes, pucData, lNumBytes );
+    }
+    else
+    {
+        memset( pPlan->pucData + pPlan->lDataBytes, 0, lNumBytes );
+    }
+    pPlan->lDataBytes   += lNumBytes;
+    return( lOffset );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanRead
+* Description:  Consume command parameter bytes from the XSVF image.
+* Parameters:   pCompiler   - the compiler.
+*               lNumBytes   - number of bytes.
+* Returns:      long        - image offset of the bytes; XPLAN_NONE = the
+*                             XSVF ends first.
+*****************************************************************************/
+static long xsvfPlanRead( SXsvfPlanCompiler* pCompiler, long lNumBytes )
+{
+    long    lOffset;
+
+    if ( ( pCompiler->pucEnd - pCompiler->pucCur ) < lNumBytes )
+    {
+        return( XPLAN_NONE );
+    }
+    lOffset             = (long)( pCompiler->pucCur - pCompiler->pPlan->pucImage );
+    pCompiler->pucCur   += lNumBytes;
+    return( lOffset );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanReadValue
+* Description:  Consume a big-endian integer parameter, like readVal() and
+*               value() in the interpreter.
+* Parameters:   pCompiler   - the compiler.
+*               lNumBytes   - number of bytes (1..4).
+*               plValue     - returns the value.
+* Returns:      int         - 0 = success; otherwise XSVF_ERROR_TRUNCATED.
+*****************************************************************************/
+static int xsvfPlanReadValue( SXsvfPlanCompiler*    pCompiler,
+                              long                  lNumBytes,
+                              long*                 plValue )
+{
+    const unsigned char*    pucValue;
+    long                    lOffset;
+
+    lOffset = xsvfPlanRead( pCompiler, lNumBytes );
+    if ( lOffset == XPLAN_NONE )
+    {
+        return( XSVF_ERROR_TRUNCATED );
+    }
+    pucValue    = pCompiler->pPlan->pucImage + lOffset;
+    *plValue    = 0;
+    while ( lNumBytes-- )
+    {
+        *plValue    = ( *plValue << 8 ) | *pucValue++;
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanGoto
+* Description:  Record the TMS path to the target TAP state.
+* Parameters:   pCompiler       - the compiler.
+*               ucTargetState   - the target TAP state.
+* Returns:      int             - 0 = success; otherwise error.
+*****************************************************************************/
+static int xsvfPlanGoto( SXsvfPlanCompiler* pCompiler,
+                         unsigned char      ucTargetState )
+{
+    SXsvfPlanOp*    pOp;
+    unsigned short  usTms;
+    unsigned short  usNumTms;
+    int             iErrorCode;
+
+    iErrorCode  = xsvfTapPath( pCompiler->ucTapState, ucTargetState,
+                               &usTms, &usNumTms );
+    if ( ( iErrorCode == XSVF_ERROR_NONE ) && usNumTms )
+    {
+        pOp = xsvfPlanAddOp( pCompiler, XPLAN_TMS );
+        if ( !pOp )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        pOp->usTms          = usTms;
+        pOp->usNumTms       = usNumTms;
+        pOp->ucEndState     = ucTargetState;
+        pCompiler->ucTapState   = ucTargetState;
+    }
+    return( iErrorCode );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanShift
+* Description:  Record an xsvfShift().  Mirrors its TAP state changes and
+*               resolves write-only shifts at compile time.
+* Parameters:   pCompiler       - the compiler.
+*               ucStartState    - Shift-DR or Shift-IR.
+*               lNumBits        - number of bits to shift.
+*               lTdi            - TDI span.
+*               lTdoExpected    - expected TDO span or XPLAN_NONE.
+*               lTdoMask        - TDO mask span; XPLAN_NONE = compare all.
+*               lTdoBytes       - length of the expected TDO and mask.
+*               ucEndState      - state in which to end the shift.
+*               lRunTestTime    - amount of time to wait after the shift.
+*               ucMaxRepeat     - maximum number of retries.
+* Returns:      int             - 0 = success; otherwise error.
+*****************************************************************************/
+static int xsvfPlanShift( SXsvfPlanCompiler*    pCompiler,
+                          unsigned char         ucStartState,
+                          long                  lNumBits,
+                          long                  lTdi,
+                          long                  lTdoExpected,
+                          long                  lTdoMask,
+                          long                  lTdoBytes,
+                          unsigned char         ucEndState,
+                          long                  lRunTestTime,
+                          unsigned char         ucMaxRepeat )
+{
+    SXsvfPlan*      pPlan   = pCompiler->pPlan;
+    SXsvfPlanOp*    pOp;
+    lenVal          lvTdoExpected;
+    lenVal          lvTdoMask;
+    long            lNumBytes;
+    int             iErrorCode;
+
+    if ( !lNumBits )
+    {
+        /* XSDR 0 = no shift, but wait in RTI */
+        if ( !lRunTestTime )
+        {
+            return( XSVF_ERROR_NONE );
+        }
+        iErrorCode  = xsvfPlanGoto( pCompiler, XTAPSTATE_RUNTEST );
+        pOp         = xsvfPlanAddOp( pCompiler, XPLAN_WAIT );
+        if ( !pOp )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        pOp->lRunTestTime   = lRunTestTime;
+        return( iErrorCode );
+    }
+
+    lNumBytes   = xsvfGetAsNumBytes( lNumBits );
+    if ( lNumBytes > pPlan->lMaxBytes )
+    {
+        pPlan->lMaxBytes    = lNumBytes;
+    }
+
+    if ( lTdoExpected != XPLAN_NONE )
+    {
+        lvTdoExpected.len   = lTdoBytes;
+        lvTdoExpected.val   = xsvfPlanSpan( pPlan, lTdoExpected );
+        lvTdoMask.len       = lTdoBytes;
+        lvTdoMask.val       = ( lTdoMask != XPLAN_NONE ) ?
+                              xsvfPlanSpan( pPlan, lTdoMask ) : 0;
+        if ( !xsvfTdoConsumed( &lvTdoExpected,
+                               lvTdoMask.val ? &lvTdoMask : 0 ) )
+        {
+            /* Write-only:  the captured TDO would never be compared */
+            lTdoExpected    = XPLAN_NONE;
+            lTdoMask        = XPLAN_NONE;
+        }
+    }
+    if ( lTdoExpected == XPLAN_NONE )
+    {
+        lTdoMask    = XPLAN_NONE;
+        lTdoBytes   = 0;
+    }
+
+    iErrorCode  = xsvfPlanGoto( pCompiler, ucStartState );
+    pOp         = xsvfPlanAddOp( pCompiler, XPLAN_SHIFT );
+    if ( !pOp )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+    pOp->ucStartState   = ucStartState;
+    pOp->ucEndState     = ucEndState;
+    pOp->ucMaxRepeat    = ucMaxRepeat;
+    pOp->lNumBits       = lNumBits;
+    pOp->lRunTestTime   = lRunTestTime;
+    pOp->lTdi           = lTdi;
+    pOp->lTdoExpected   = lTdoExpected;
+    pOp->lTdoMask       = lTdoMask;
+    pOp->lTdoBytes      = lTdoBytes;
+
+    /* The TAP state xsvfShift() leaves behind when the compare passes */
+    if ( ucStartState != ucEndState )
+    {
+        pCompiler->ucTapState   = lRunTestTime ? XTAPSTATE_RUNTEST : ucEndState;
+    }
+    return( iErrorCode );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanDRShift
+* Description:  Record an XSDR-style shift that compares against the last
+*               expected TDO under the last XTDOMASK.  Before any XTDOMASK
+*               the interpreter's mask is all zeros, so the shift is
+*               write-only.
+* Parameters:   pCompiler   - the compiler.
+*               lTdi        - TDI span.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+static int xsvfPlanDRShift( SXsvfPlanCompiler* pCompiler, long lTdi )
+{
+    long    lTdoExpected;
+    long    lTdoMask;
+
+    lTdoExpected    = pCompiler->lTdoExpected;
+    if ( ( lTdoExpected != XPLAN_NONE ) &&
+         ( ( pCompiler->lTdoMask == XPLAN_NONE ) ||
+           ( pCompiler->lTdoMaskBytes < pCompiler->lTdoExpectedBytes ) ) )
+    {
+        /* No mask yet, or too short to cover the expected TDO:  keep a
+           zero-padded copy so replay never reads past the span */
+        lTdoMask    = xsvfPlanAddData( pCompiler->pPlan, 0,
+                                       pCompiler->lTdoExpectedBytes );
+        if ( lTdoMask == XPLAN_NONE )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        if ( pCompiler->lTdoMask != XPLAN_NONE )
+        {
+            memcpy( xsvfPlanSpan( pCompiler->pPlan, lTdoMask ),
+                    xsvfPlanSpan( pCompiler->pPlan, pCompiler->lTdoMask ),
+                    pCompiler->lTdoMaskBytes );
+        }
+        pCompiler->lTdoMask         = lTdoMask;
+        pCompiler->lTdoMaskBytes    = pCompiler->lTdoExpectedBytes;
+    }
+    lTdoMask        = pCompiler->lTdoMask;
+
+    return( xsvfPlanShift( pCompiler, XTAPSTATE_SHIFTDR,
+                           pCompiler->lShiftLengthBits, lTdi,
+                           lTdoExpected, lTdoMask,
+                           pCompiler->lTdoExpectedBytes, pCompiler->ucEndDR,
+                           pCompiler->lRunTestTime,
+                           pCompiler->ucMaxRepeat ) );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanXSDRINC
+* Description:  Expand XSDRINC into one shift per data piece.  Each TDI
+*               value is built with xsvfDoSDRMasking() at compile time and
+*               stored in the generated data.
+* Parameters:   pCompiler   - the compiler.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+#ifdef  XSVF_SUPPORT_COMPRESSION
+static int xsvfPlanXSDRINC( SXsvfPlanCompiler* pCompiler )
+{
+    SXsvfPlan*      pPlan   = pCompiler->pPlan;
+    lenVal          lvTdi;
+    lenVal          lvNextData;
+    lenVal          lvAddressMask;
+    lenVal          lvDataMask;
+    SXsvfSdrMap     sdrMap;
+    unsigned char*  pucWork;
+    long            lNumBytes;
+    long            lMaskBytes;
+    long            lTdi;
+    long            lNumTimes;
+    long            i;
+    int             iErrorCode;
+
+    lNumBytes   = pCompiler->lShiftLengthBytes;
+    lTdi        = xsvfPlanRead( pCompiler, lNumBytes );
+    if ( lTdi == XPLAN_NONE )
+    {
+        return( XSVF_ERROR_TRUNCATED );
+    }
+    iErrorCode  = xsvfPlanDRShift( pCompiler, lTdi );
+    if ( iErrorCode )
+    {
+        return( iErrorCode );
+    }
+
+    /* Zero-padded working copies of the TDI value and the masks */
+    pucWork = (unsigned char*)calloc( 3, lNumBytes ? lNumBytes : 1 );
+    if ( !pucWork )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+    lvTdi.len           = lNumBytes;
+    lvTdi.val           = pucWork;
+    lvAddressMask.len   = lNumBytes;
+    lvAddressMask.val   = pucWork + lNumBytes;
+    lvDataMask.len      = lNumBytes;
+    lvDataMask.val      = pucWork + ( 2 * lNumBytes );
+    memcpy( lvTdi.val, xsvfPlanSpan( pPlan, lTdi ), lNumBytes );
+    lMaskBytes  = ( pCompiler->lMasksBytes < lNumBytes ) ?
+                  pCompiler->lMasksBytes : lNumBytes;
+    if ( pCompiler->lAddressMask != XPLAN_NONE )
+    {
+        memcpy( lvAddressMask.val,
+                xsvfPlanSpan( pPlan, pCompiler->lAddressMask ), lMaskBytes );
+        memcpy( lvDataMask.val,
+                xsvfPlanSpan( pPlan, pCompiler->lDataMask ), lMaskBytes );
+    }
+
+    memset( &sdrMap, 0, sizeof( sdrMap ) );
+    iErrorCode  = xsvfSdrMapBuild( &sdrMap, &lvAddressMask, &lvDataMask );
+    if ( iErrorCode )
+    {
+        free( pucWork );
+        return( iErrorCode );
+    }
+
+    iErrorCode  = xsvfPlanReadValue( pCompiler, 1, &lNumTimes );
+    for ( i = 0; !iErrorCode && ( i < lNumTimes ); ++i )
+    {
+        lvNextData.len  = xsvfGetAsNumBytes( sdrMap.lDataBits );
+        lTdi            = xsvfPlanRead( pCompiler, lvNextData.len );
+        if ( lTdi == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        lvNextData.val  = xsvfPlanSpan( pPlan, lTdi );
+        xsvfDoSDRMasking( &lvTdi, &lvNextData, &lvAddressMask, &sdrMap );
+
+        lTdi    = xsvfPlanAddData( pPlan, lvTdi.val, lNumBytes );
+        if ( lTdi == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_DATAOVERFLOW;
+            break;
+        }
+        iErrorCode  = xsvfPlanDRShift( pCompiler, lTdi );
+    }
+
+    xsvfSdrMapFree( &sdrMap );
+    free( pucWork );
+    return( iErrorCode );
+}
+#endif  /* XSVF_SUPPORT_COMPRESSION */
+
+/*****************************************************************************
+* Function:     xsvfPlanCommand
+* Description:  Compile one XSVF command.
+* Parameters:   pCompiler   - the compiler.
+*               ucCommand   - the command byte.
+*               piComplete  - set to 1 by XCOMPLETE.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+static int xsvfPlanCommand( SXsvfPlanCompiler*  pCompiler,
+                            unsigned char       ucCommand,
+                            int*                piComplete )
+{
+    SXsvfPlanOp*    pOp;
+    long            lValue;
+    long            lTdi;
+    long            lTdoExpected;
+    long            lNumBytes;
+    long            lWaitState;
+    long            lEndState;
+    int             iErrorCode;
+
+    iErrorCode  = XSVF_ERROR_NONE;
+    lNumBytes   = pCompiler->lShiftLengthBytes;
+
+    switch ( ucCommand )
+    {
+    case XCOMPLETE:
+        if ( !xsvfPlanAddOp( pCompiler, XPLAN_COMPLETE ) )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        *piComplete = 1;
+        break;
+    case XTDOMASK:
+        pCompiler->lTdoMask         = xsvfPlanRead( pCompiler, lNumBytes );
+        pCompiler->lTdoMaskBytes    = lNumBytes;
+        if ( pCompiler->lTdoMask == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+        }
+        break;
+    case XSIR:
+    case XSIR2:
+        iErrorCode  = xsvfPlanReadValue( pCompiler,
+                                         ( ucCommand == XSIR ) ? 1 : 2,
+                                         &lValue );
+        if ( iErrorCode )
+        {
+            break;
+        }
+        lTdi    = xsvfPlanRead( pCompiler, xsvfGetAsNumBytes( lValue ) );
+        if ( lTdi == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        iErrorCode  = xsvfPlanShift( pCompiler, XTAPSTATE_SHIFTIR, lValue,
+                                     lTdi, XPLAN_NONE, XPLAN_NONE, 0,
+                                     pCompiler->ucEndIR,
+                                     pCompiler->lRunTestTime, 0 );
+        break;
+    case XSDR:
+        lTdi    = xsvfPlanRead( pCompiler, lNumBytes );
+        if ( lTdi == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        iErrorCode  = xsvfPlanDRShift( pCompiler, lTdi );
+        break;
+    case XRUNTEST:
+        iErrorCode  = xsvfPlanReadValue( pCompiler, 4,
+                                         &(pCompiler->lRunTestTime) );
+        break;
+    case XREPEAT:
+        iErrorCode  = xsvfPlanReadValue( pCompiler, 1, &lValue );
+        pCompiler->ucMaxRepeat  = (unsigned char)lValue;
+        break;
+    case XSDRSIZE:
+        iErrorCode  = xsvfPlanReadValue( pCompiler, 4,
+                                         &(pCompiler->lShiftLengthBits) );
+        if ( !iErrorCode &&
+             ( ( pCompiler->lShiftLengthBits < 0 ) ||
+               ( pCompiler->lShiftLengthBits > LENVAL_MAX_BYTES * 8 ) ) )
+        {
+            pCompiler->lShiftLengthBits = 0;
+            iErrorCode  = XSVF_ERROR_DATAOVERFLOW;
+        }
+        pCompiler->lShiftLengthBytes    =
+            xsvfGetAsNumBytes( pCompiler->lShiftLengthBits );
+        break;
+    case XSDRTDO:
+        lTdi            = xsvfPlanRead( pCompiler, lNumBytes );
+        lTdoExpected    = xsvfPlanRead( pCompiler, lNumBytes );
+        if ( lTdoExpected == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        pCompiler->lTdoExpected         = lTdoExpected;
+        pCompiler->lTdoExpectedBytes    = lNumBytes;
+        iErrorCode  = xsvfPlanDRShift( pCompiler, lTdi );
+        break;
+#ifdef  XSVF_SUPPORT_COMPRESSION
+    case XSETSDRMASKS:
+        pCompiler->lAddressMask = xsvfPlanRead( pCompiler, lNumBytes );
+        pCompiler->lDataMask    = xsvfPlanRead( pCompiler, lNumBytes );
+        pCompiler->lMasksBytes  = lNumBytes;
+        if ( pCompiler->lDataMask == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+        }
+        break;
+    case XSDRINC:
+        iErrorCode  = xsvfPlanXSDRINC( pCompiler );
+        break;
+#endif  /* XSVF_SUPPORT_COMPRESSION */
+    case XSDRB:
+    case XSDRC:
+    case XSDRE:
+        lTdi    = xsvfPlanRead( pCompiler, lNumBytes );
+        if ( lTdi == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        iErrorCode  = xsvfPlanShift( pCompiler, XTAPSTATE_SHIFTDR,
+                                     pCompiler->lShiftLengthBits, lTdi,
+                                     XPLAN_NONE, XPLAN_NONE, 0,
+                                     (unsigned char)( ( ucCommand == XSDRE ) ?
+                                        pCompiler->ucEndDR : XTAPSTATE_SHIFTDR ),
+                                     0, 0 );
+        break;
+    case XSDRTDOB:
+    case XSDRTDOC:
+    case XSDRTDOE:
+        lTdi            = xsvfPlanRead( pCompiler, lNumBytes );
+        lTdoExpected    = xsvfPlanRead( pCompiler, lNumBytes );
+        if ( lTdoExpected == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        pCompiler->lTdoExpected         = lTdoExpected;
+        pCompiler->lTdoExpectedBytes    = lNumBytes;
+        /* Compare all bits:  XTDOMASK is not used */
+        iErrorCode  = xsvfPlanShift( pCompiler, XTAPSTATE_SHIFTDR,
+                                     pCompiler->lShiftLengthBits, lTdi,
+                                     lTdoExpected, XPLAN_NONE, lNumBytes,
+                                     (unsigned char)( ( ucCommand == XSDRTDOE ) ?
+                                        pCompiler->ucEndDR : XTAPSTATE_SHIFTDR ),
+                                     0, 0 );
+        break;
+    case XSTATE:
+        iErrorCode  = xsvfPlanReadValue( pCompiler, 1, &lValue );
+        if ( !iErrorCode )
+        {
+            iErrorCode  = xsvfPlanGoto( pCompiler, (unsigned char)lValue );
+        }
+        break;
+    case XENDIR:
+    case XENDDR:
+        iErrorCode  = xsvfPlanReadValue( pCompiler, 1, &lValue );
+        if ( iErrorCode )
+        {
+            break;
+        }
+        if ( ( lValue != XENDXR_RUNTEST ) && ( lValue != XENDXR_PAUSE ) )
+        {
+            iErrorCode  = XSVF_ERROR_ILLEGALSTATE;
+        }
+        else if ( ucCommand == XENDIR )
+        {
+            pCompiler->ucEndIR  = (unsigned char)( ( lValue == XENDXR_RUNTEST ) ?
+                                  XTAPSTATE_RUNTEST : XTAPSTATE_PAUSEIR );
+        }
+        else
+        {
+            pCompiler->ucEndDR  = (unsigned char)( ( lValue == XENDXR_RUNTEST ) ?
+                                  XTAPSTATE_RUNTEST : XTAPSTATE_PAUSEDR );
+        }
+        break;
+    case XCOMMENT:
+        lTdi    = (long)( pCompiler->pucCur - pCompiler->pPlan->pucImage );
+        while ( ( pCompiler->pucCur < pCompiler->pucEnd ) &&
+                *(pCompiler->pucCur) )
+        {
+            ++(pCompiler->pucCur);
+        }
+        if ( xsvfPlanRead( pCompiler, 1 ) == XPLAN_NONE )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        pOp = xsvfPlanAddOp( pCompiler, XPLAN_COMMENT );
+        if ( !pOp )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        pOp->lTdi   = lTdi;
+        break;
+    case XWAIT:
+        iErrorCode  = xsvfPlanReadValue( pCompiler, 1, &lWaitState );
+        if ( !iErrorCode )
+        {
+            iErrorCode  = xsvfPlanReadValue( pCompiler, 1, &lEndState );
+        }
+        if ( !iErrorCode )
+        {
+            iErrorCode  = xsvfPlanReadValue( pCompiler, 4, &lValue );
+        }
+        if ( iErrorCode )
+        {
+            break;
+        }
+        if ( pCompiler->ucTapState != lWaitState )
+        {
+            iErrorCode  = xsvfPlanGoto( pCompiler, (unsigned char)lWaitState );
+        }
+        pOp = xsvfPlanAddOp( pCompiler, XPLAN_WAIT );
+        if ( !pOp )
+        {
+            return( XSVF_ERROR_DATAOVERFLOW );
+        }
+        pOp->lRunTestTime   = lValue;
+        if ( !iErrorCode && ( pCompiler->ucTapState != lEndState ) )
+        {
+            iErrorCode  = xsvfPlanGoto( pCompiler, (unsigned char)lEndState );
+        }
+        break;
+    default:
+        iErrorCode  = XSVF_ERROR_ILLEGALCMD;
+        break;
+    }
+
+    return( iErrorCode );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanCompile
+* Description:  Compile the XSVF image into a plan.  The image is not
+*               copied; it must stay mapped while the plan is used.
+* Parameters:   pPlan       - receives the plan.
+*               pucXsvf     - the XSVF image.
+*               lSize       - number of bytes in the image.
+* Returns:      int         - 0 = success; otherwise error, and
+*                             pPlan->lErrorCommand is the command number.
+*****************************************************************************/
+int xsvfPlanCompile( SXsvfPlan*             pPlan,
+                     const unsigned char*   pucXsvf,
+                     long                   lSize )
+{
+    SXsvfPlanCompiler   compiler;
+    int                 iComplete;
+    int                 iErrorCode;
+
+    memset( pPlan, 0, sizeof( SXsvfPlan ) );
+    pPlan->pucImage     = pucXsvf;
+    pPlan->lImageBytes  = lSize;
+    pPlan->lMaxBytes    = LENVAL_MIN_BYTES;
+
+    memset( &compiler, 0, sizeof( compiler ) );
+    compiler.pPlan          = pPlan;
+    compiler.pucCur         = pucXsvf;
+    compiler.pucEnd         = pucXsvf + lSize;
+    compiler.ucCommand      = XPLAN_NOCMD;
+    compiler.ucTapState     = XTAPSTATE_RESET;
+    compiler.ucEndIR        = XTAPSTATE_RUNTEST;
+    compiler.ucEndDR        = XTAPSTATE_RUNTEST;
+    compiler.lTdoExpected   = XPLAN_NONE;
+    compiler.lTdoMask       = XPLAN_NONE;
+    compiler.lAddressMask   = XPLAN_NONE;
+    compiler.lDataMask      = XPLAN_NONE;
+
+    /* xsvfInitialize():  TMS reset sequence */
+    iErrorCode  = xsvfPlanGoto( &compiler, XTAPSTATE_RESET );
+    iComplete   = 0;
+    while ( !iErrorCode && !iComplete )
+    {
+        ++compiler.lCommandCount;
+        if ( compiler.pucCur >= compiler.pucEnd )
+        {
+            iErrorCode  = XSVF_ERROR_TRUNCATED;
+            break;
+        }
+        compiler.ucCommand  = *(compiler.pucCur++);
+        iErrorCode  = xsvfPlanCommand( &compiler, compiler.ucCommand,
+                                       &iComplete );
+    }
+
+    pPlan->lErrorCommand    = compiler.lCommandCount;
+    XSVFDBG_PRINTF2( 2, "  Plan:  %ld commands -> %ld ops\n",
+                     compiler.lCommandCount, pPlan->lNumOps );
+    return( iErrorCode );
+}
+
+
+/*============================================================================
+* Plan Files
+============================================================================*/
+
+/*****************************************************************************
+* Function:     xsvfPlanIsPlan
+* Description:  Check for a plan file header.
+* Parameters:   pucData     - the file data.
+*               lSize       - number of bytes.
+* Returns:      int         - non-zero if the data is a plan file.
+*****************************************************************************/
+int xsvfPlanIsPlan( const unsigned char* pucData, long lSize )
+{
+    SXsvfPlanHeader header;
+
+    if ( lSize < (long)sizeof( SXsvfPlanHeader ) )
+    {
+        return( 0 );
+    }
+    memcpy( &header, pucData, sizeof( header ) );
+    return( header.lMagic == XPLAN_MAGIC );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanCheckSpan
+* Description:  Check that a data span of a loaded plan lies within the
+*               image and the generated data.
+* Parameters:   pPlan       - the plan being loaded.
+*               lOffset     - the span offset, or XPLAN_NONE.
+*               lBytes      - the span length.
+* Returns:      int         - non-zero if the span is valid.
+*****************************************************************************/
+static int xsvfPlanCheckSpan( SXsvfPlan* pPlan, long lOffset, long lBytes )
+{
+    long    lTotal;
+
+    lTotal  = pPlan->lImageBytes + pPlan->lDataBytes;
+    return( ( lOffset == XPLAN_NONE ) ||
+            ( ( lOffset >= 0 ) && ( lBytes >= 0 ) &&
+              ( lOffset <= lTotal ) && ( lBytes <= lTotal - lOffset ) ) );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanCheckOp
+* Description:  Check one op of a loaded plan before it is replayed:  the
+*               op code, the TAP states, the shift length against
+*               lMaxBytes (the size of the TDO capture buffer) and every
+*               data span.
+* Parameters:   pPlan       - the plan being loaded.
+*               pOp         - the op.
+* Returns:      int         - non-zero if the op is valid.
+*****************************************************************************/
+static int xsvfPlanCheckOp( SXsvfPlan* pPlan, const SXsvfPlanOp* pOp )
+{
+    const unsigned char*    pucText;
+    long                    lBytes;
+
+    if ( ( pOp->ucStartState > XTAPSTATE_UPDATEIR ) ||
+         ( pOp->ucEndState > XTAPSTATE_UPDATEIR ) )
+    {
+        return( 0 );
+    }
+    switch ( pOp->ucOp )
+    {
+    case XPLAN_TMS:
+        return( pOp->usNumTms <= 16 );
+    case XPLAN_SHIFT:
+        if ( ( pOp->lNumBits < 0 ) || ( pOp->lTdoBytes < 0 ) ||
+             ( pOp->lTdoBytes > pPlan->lMaxBytes ) ||
+             ( ( pOp->ucStartState != XTAPSTATE_SHIFTDR ) &&
+               ( pOp->ucStartState != XTAPSTATE_SHIFTIR ) ) )
+        {
+            return( 0 );
+        }
+        lBytes  = xsvfGetAsNumBytes( pOp->lNumBits );
+        return( ( lBytes <= pPlan->lMaxBytes ) &&
+                ( pOp->lTdi != XPLAN_NONE ) &&
+                xsvfPlanCheckSpan( pPlan, pOp->lTdi, lBytes ) &&
+                xsvfPlanCheckSpan( pPlan, pOp->lTdoExpected, pOp->lTdoBytes ) &&
+                xsvfPlanCheckSpan( pPlan, pOp->lTdoMask, pOp->lTdoBytes ) );
+    case XPLAN_WAIT:
+    case XPLAN_COMPLETE:
+        return( 1 );
+    case XPLAN_COMMENT:
+        /* the text must end within the plan data */
+        if ( ( pOp->lTdi == XPLAN_NONE ) ||
+             !xsvfPlanCheckSpan( pPlan, pOp->lTdi, 1 ) )
+        {
+            return( 0 );
+        }
+        pucText = xsvfPlanSpan( pPlan, pOp->lTdi );
+        lBytes  = pPlan->lImageBytes + pPlan->lDataBytes - pOp->lTdi;
+        return( memchr( pucText, 0, lBytes ) != 0 );
+    default:
+        return( 0 );
+    }
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanLoad
+* Description:  Use a plan file in place.  Nothing is copied, so the file
+*               must stay mapped while the plan is used.  A plan written by
+*               a build with a different SXsvfPlanOp layout is rejected, and
+*               so is any op that would shift, compare or print outside the
+*               plan data (see xsvfPlanCheckOp()).
+* Parameters:   pPlan       - receives the plan.
+*               pucData     - the plan file data.
+*               lSize       - number of bytes.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+int xsvfPlanLoad( SXsvfPlan* pPlan, const unsigned char* pucData, long lSize )
+{
+    const SXsvfPlanHeader*  pHeader;
+    long                    lOpBytes;
+    long                    lOp;
+
+    memset( pPlan, 0, sizeof( SXsvfPlan ) );
+    if ( !xsvfPlanIsPlan( pucData, lSize ) )
+    {
+        return( XSVF_ERROR_UNKNOWN );
+    }
+
+    pHeader = (const SXsvfPlanHeader*)pucData;
+    if ( ( pHeader->lVersion != XPLAN_VERSION ) ||
+         ( pHeader->lOpSize != (long)sizeof( SXsvfPlanOp ) ) ||
+         ( pHeader->lNumOps < 0 ) || ( pHeader->lImageBytes < 0 ) ||
+         ( pHeader->lDataBytes < 0 ) || ( pHeader->lMaxBytes < 0 ) )
+    {
+        printf( "ERROR:  Plan file version or layout does not match; recompile it.\n" );
+        return( XSVF_ERROR_UNKNOWN );
+    }
+    /* Sizes are compared part by part so that no product or sum overflows */
+    lSize       -= (long)sizeof( SXsvfPlanHeader );
+    if ( pHeader->lNumOps > lSize / (long)sizeof( SXsvfPlanOp ) )
+    {
+        return( XSVF_ERROR_TRUNCATED );
+    }
+    lOpBytes    = pHeader->lNumOps * (long)sizeof( SXsvfPlanOp );
+    lSize       -= lOpBytes;
+    if ( ( pHeader->lImageBytes > lSize ) ||
+         ( pHeader->lDataBytes > lSize - pHeader->lImageBytes ) )
+    {
+        return( XSVF_ERROR_TRUNCATED );
+    }
+
+    pPlan->pOps         = (SXsvfPlanOp*)( pucData + sizeof( SXsvfPlanHeader ) );
+    pPlan->lNumOps      = pHeader->lNumOps;
+    pPlan->pucImage     = pucData + sizeof( SXsvfPlanHeader ) + lOpBytes;
+    pPlan->lImageBytes  = pHeader->lImageBytes;
+    pPlan->pucData      = (unsigned char*)( pPlan->pucImage + pPlan->lImageBytes );
+    pPlan->lDataBytes   = pHeader->lDataBytes;
+    pPlan->lMaxBytes    = pHeader->lMaxBytes;
+
+    for ( lOp = 0; lOp < pPlan->lNumOps; ++lOp )
+    {
+        if ( !xsvfPlanCheckOp( pPlan, &pPlan->pOps[ lOp ] ) )
+        {
+            XSVFDBG_PRINTF1( 0, "ERROR:  Plan op #%ld is not valid.\n", lOp );
+            memset( pPlan, 0, sizeof( SXsvfPlan ) );
+            return( XSVF_ERROR_ILLEGALCMD );
+        }
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanSave
+* Description:  Write the plan file:  header, ops, XSVF image, generated data.
+* Parameters:   pPlan       - the plan.
+*               pzFileName  - the plan file name.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+int xsvfPlanSave( SXsvfPlan* pPlan, const char* pzFileName )
+{
+    SXsvfPlanHeader header;
+    FILE*           pFile;
+    int             iOk;
+
+    memset( &header, 0, sizeof( header ) );
+    header.lMagic       = XPLAN_MAGIC;
+    header.lVersion     = XPLAN_VERSION;
+    header.lOpSize      = (long)sizeof( SXsvfPlanOp );
+    header.lNumOps      = pPlan->lNumOps;
+    header.lImageBytes  = pPlan->lImageBytes;
+    header.lDataBytes   = pPlan->lDataBytes;
+    header.lMaxBytes    = pPlan->lMaxBytes;
+
+    pFile   = fopen( pzFileName, "wb" );
+    if ( !pFile )
+    {
+        printf( "ERROR:  Cannot create plan file %s\n", pzFileName );
+        return( XSVF_ERROR_UNKNOWN );
+    }
+    iOk = ( fwrite( &header, sizeof( header ), 1, pFile ) == 1 );
+    iOk = iOk && ( !pPlan->lNumOps ||
+                   ( fwrite( pPlan->pOps, sizeof( SXsvfPlanOp ),
+                             pPlan->lNumOps, pFile ) == (size_t)pPlan->lNumOps ) );
+    iOk = iOk && ( !pPlan->lImageBytes ||
+                   ( fwrite( pPlan->pucImage, pPlan->lImageBytes, 1, pFile ) == 1 ) );
+    iOk = iOk && ( !pPlan->lDataBytes ||
+                   ( fwrite( pPlan->pucData, pPlan->lDataBytes, 1, pFile ) == 1 ) );
+    iOk = ( fclose( pFile ) == 0 ) && iOk;
+    if ( !iOk )
+    {
+        printf( "ERROR:  Cannot write plan file %s\n", pzFileName );
+        return( XSVF_ERROR_UNKNOWN );
+    }
+    return( XSVF_ERROR_NONE );
+}
+
+/*****************************************************************************
+* Function:     xsvfPlanFree
+* Description:  Free what the compiler allocated.  A loaded plan owns
+*               nothing.
+* Parameters:   pPlan       - the plan.
+* Returns:      void.
+*****************************************************************************/
+void xsvfPlanFree( SXsvfPlan* pPlan )
+{
+    if ( pPlan->lMaxOps )
+    {
+        free( pPlan->pOps );
+    }
+    if ( pPlan->lMaxData )
+    {
+        free( pPlan->pucData );
+    }
+    memset( pPlan, 0, sizeof( SXsvfPlan ) );
+}
+
+
+/*============================================================================
+* Plan Player
+============================================================================*/
+
+/*****************************************************************************
+* Function:     xsvfPlanRun
+* Description:  Replay the plan on the JTAG port.
+* Parameters:   pPlan       - the plan.
+*               plCommand   - returns the XSVF command number of the last
+*                             op run, for error reports.
+* Returns:      int         - 0 = success; otherwise error.
+*****************************************************************************/
+int xsvfPlanRun( SXsvfPlan* pPlan, long* plCommand )
+{
+    const SXsvfPlanOp*  pOp;
+    const SXsvfPlanOp*  pOpEnd;
+    const SXsvfPlanOp*  pCommandOp;     /* first op of the current command */
+    long long           llStartNs;
+    unsigned char       ucTapState;
+    lenVal              lvTdi;
+    lenVal              lvTdoCaptured;
+    lenVal              lvTdoExpected;
+    lenVal              lvTdoMask;
+    int                 iErrorCode;
+
+    lvTdoCaptured.len   = 0;
+    lvTdoCaptured.val   = (unsigned char*)malloc( pPlan->lMaxBytes ?
+                                                  pPlan->lMaxBytes : 1 );
+    if ( !lvTdoCaptured.val )
+    {
+        return( XSVF_ERROR_DATAOVERFLOW );
+    }
+
+    iErrorCode  = XSVF_ERROR_TRUNCATED;     /* unless XCOMPLETE is reached */
+    ucTapState  = XTAPSTATE_RESET;
+    *plCommand  = 0;
+    pOpEnd      = pPlan->pOps + pPlan->lNumOps;
+    pCommandOp  = 0;
+    llStartNs   = 0;
+    for ( pOp = pPlan->pOps; pOp < pOpEnd; ++pOp )
+    {
+        *plCommand  = pOp->lCommand;
+        if ( !pCommandOp || ( pOp->lCommand != pCommandOp->lCommand ) )
+        {
+            /* Commands are counted by the ops they produced */
+            if ( pCommandOp && ( pCommandOp->ucCommand != XPLAN_NOCMD ) )
+            {
+                xsvfStatsCommand( pCommandOp->ucCommand, llStartNs );
+            }
+            pCommandOp  = pOp;
+            llStartNs   = xsvfStatsNow();
+        }
+
+        if ( pOp->ucOp == XPLAN_TMS )
+        {
+            xsvfShiftTms( pOp->usTms, pOp->usNumTms );
+            ucTapState  = pOp->ucEndState;
+            XSVFDBG_PRINTF1( 3, "   TAP State = %s\n",
+                             xsvf_pzTapState[ ucTapState ] );
+        }
+        else if ( pOp->ucOp == XPLAN_SHIFT )
+        {
+            lvTdi.len   = xsvfGetAsNumBytes( pOp->lNumBits );
+            lvTdi.val   = xsvfPlanSpan( pPlan, pOp->lTdi );
+            if ( pOp->lTdoExpected != XPLAN_NONE )
+            {
+                lvTdoExpected.len   = pOp->lTdoBytes;
+                lvTdoExpected.val   = xsvfPlanSpan( pPlan, pOp->lTdoExpected );
+            }
+            if ( pOp->lTdoMask != XPLAN_NONE )
+            {
+                lvTdoMask.len   = pOp->lTdoBytes;
+                lvTdoMask.val   = xsvfPlanSpan( pPlan, pOp->lTdoMask );
+            }
+            iErrorCode  = xsvfShift( &ucTapState, pOp->ucStartState,
+                                     pOp->lNumBits, &lvTdi, &lvTdoCaptured,
+                                     ( pOp->lTdoExpected != XPLAN_NONE ) ?
+                                        &lvTdoExpected : 0,
+                                     ( pOp->lTdoMask != XPLAN_NONE ) ?
+                                        &lvTdoMask : 0,
+                                     pOp->ucEndState, pOp->lRunTestTime,
+                                     pOp->ucMaxRepeat );
+            if ( iErrorCode )
+            {
+                break;
+            }
+        }
+        else if ( pOp->ucOp == XPLAN_WAIT )
+        {
+            XSVFDBG_PRINTF1( 3, "   Wait = %ld usec\n", pOp->lRunTestTime );
+            waitTime( pOp->lRunTestTime );
+        }
+        else if ( pOp->ucOp == XPLAN_COMMENT )
+        {
+            XSVFDBG_PRINTF1( 1, " %s\n",
+                             (char*)xsvfPlanSpan( pPlan, pOp->lTdi ) );
+            portsPaceComment( portsCurrent(),
+                              (char*)xsvfPlanSpan( pPlan, pOp->lTdi ) );
+        }
+        else if ( pOp->ucOp == XPLAN_COMPLETE )
+        {
+            iErrorCode  = XSVF_ERROR_NONE;
+            break;
+        }
+        else
+        {
+            iErrorCode  = XSVF_ERROR_ILLEGALCMD;
+            break;
+        }
+    }
+
+    if ( pCommandOp && ( pCommandOp->ucCommand != XPLAN_NOCMD ) )
+    {
+        xsvfStatsCommand( pCommandOp->ucCommand, llStartNs );
+    }
+
+    free( lvTdoCaptured.val );
+    return( iErrorCode );
+}
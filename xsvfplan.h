@@ -0,0 +1,111 @@
+/*****************************************************************************
+* File:         xsvfplan.h
+* Description:  This header file contains the XSVF execution plan.  A plan
+*               is the XSVF file compiled once into resolved operations:
+*               command parameters are decoded, TAP paths are precomputed
+*               as TMS bit sequences, XSDRINC data is expanded into whole
+*               TDI values, and shift data is referenced in place in the
+*               mapped XSVF image instead of being copied.  Replaying a
+*               plan skips readByte() and command dispatch entirely.
+*               A plan can be saved to a file and mapped back for each
+*               board; the plan file carries a copy of the XSVF image, so
+*               the original XSVF file is not needed to replay it.
+*****************************************************************************/
+#ifndef XSVF_PLAN_H
+#define XSVF_PLAN_H
+
+#define XPLAN_MAGIC     0x4E4C5058L     /* "XPLN" */
+#define XPLAN_VERSION   2L
+
+/* plan operation codes */
+#define XPLAN_TMS       0   /* clock TMS bits; ucEndState = resulting state */
+#define XPLAN_SHIFT     1   /* xsvfShift() with resolved data spans */
+#define XPLAN_WAIT      2   /* waitTime( lRunTestTime ) */
+#define XPLAN_COMMENT   3   /* XCOMMENT text at lTdi, printed if verbose */
+#define XPLAN_COMPLETE  4   /* XCOMPLETE */
+
+#define XPLAN_NONE      (-1L)   /* no data span */
+#define XPLAN_NOCMD     0xFF    /* op not made by an XSVF command */
+
+/*****************************************************************************
+* Struct:       SXsvfPlanOp
+* Description:  One resolved operation.  Data spans are offsets into the
+*               plan data: offsets below lImageBytes are in the XSVF image,
+*               the rest are in the data generated by the compiler.
+*****************************************************************************/
+typedef struct tagSXsvfPlanOp
+{
+    unsigned char   ucOp;           /* XPLAN_* */
+    unsigned char   ucStartState;   /* SHIFT: Shift-DR or Shift-IR */
+    unsigned char   ucEndState;     /* SHIFT: ENDIR/ENDDR; TMS: final state */
+    unsigned char   ucMaxRepeat;    /* SHIFT: XC9500/XL retries */
+    unsigned short  usTms;          /* TMS: bits to clock, first = LSB */
+    unsigned short  usNumTms;       /* TMS: number of bits */
+    unsigned char   ucCommand;      /* XSVF command byte, or XPLAN_NOCMD */
+    long            lCommand;       /* XSVF command number, for errors */
+    long            lNumBits;       /* SHIFT: shift length */
+    long            lRunTestTime;   /* SHIFT/WAIT: wait in usec */
+    long            lTdi;           /* SHIFT: TDI span; COMMENT: text */
+    long            lTdoExpected;   /* SHIFT: expected TDO or XPLAN_NONE */
+    long            lTdoMask;       /* SHIFT: TDO mask or XPLAN_NONE */
+    long            lTdoBytes;      /* SHIFT: length of expected TDO/mask */
+} SXsvfPlanOp;
+
+/*****************************************************************************
+* Struct:       SXsvfPlanHeader
+* Description:  Start of a plan file.  The ops follow the header, then the
+*               XSVF image, then the generated data.
+*****************************************************************************/
+typedef struct tagSXsvfPlanHeader
+{
+    long            lMagic;         /* XPLAN_MAGIC */
+    long            lVersion;       /* XPLAN_VERSION */
+    long            lOpSize;        /* sizeof( SXsvfPlanOp ) of the writer */
+    long            lNumOps;
+    long            lImageBytes;
+    long            lDataBytes;     /* generated data bytes */
+    long            lMaxBytes;      /* longest shift in bytes */
+} SXsvfPlanHeader;
+
+/*****************************************************************************
+* Struct:       SXsvfPlan
+* Description:  A compiled or loaded plan.  The XSVF image (or the plan
+*               file) it points into must stay mapped while it is used.
+*****************************************************************************/
+typedef struct tagSXsvfPlan
+{
+    SXsvfPlanOp*            pOps;
+    long                    lNumOps;
+    long                    lMaxOps;        /* allocated ops; 0 = loaded */
+    const unsigned char*    pucImage;       /* XSVF image */
+    long                    lImageBytes;
+    unsigned char*          pucData;        /* generated data */
+    long                    lDataBytes;
+    long                    lMaxData;       /* allocated data; 0 = loaded */
+    long                    lMaxBytes;      /* longest shift in bytes */
+    long                    lErrorCommand;  /* compile error command number */
+} SXsvfPlan;
+
+/* compile the XSVF image; 0 = success, else XSVF_ERROR_* and lErrorCommand */
+extern int xsvfPlanCompile( SXsvfPlan* pPlan, const unsigned char* pucXsvf,
+                            long lSize );
+
+/* non-zero if the data starts with a plan file header */
+extern int xsvfPlanIsPlan( const unsigned char* pucData, long lSize );
+
+/* use a mapped plan file in place; 0 = success */
+extern int xsvfPlanLoad( SXsvfPlan* pPlan, const unsigned char* pucData,
+                         long lSize );
+
+/* write the plan file; 0 = success */
+extern int xsvfPlanSave( SXsvfPlan* pPlan, const char* pzFileName );
+
+/* replay the plan; returns XSVF_ERROR_* and the failing command number */
+extern int xsvfPlanRun( SXsvfPlan* pPlan, long* plCommand );
+
+extern void xsvfPlanFree( SXsvfPlan* pPlan );
+
+/* micro.c:  replay the plan and report like xsvfExecute() */
+extern int xsvfExecutePlan( SXsvfPlan* pPlan );
+
+#endif  /* XSVF_PLAN_H */